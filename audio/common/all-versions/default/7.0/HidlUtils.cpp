@@ -17,6 +17,11 @@
 #include <stdio.h>
 #include <string.h>
 #include <algorithm>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
 
 #define LOG_TAG "HidlUtils"
 #include <log/log.h>
@@ -24,6 +29,7 @@
 #include PATH(APM_XSD_ENUMS_H_FILENAME)
 #include <common/all-versions/HidlSupport.h>
 #include <common/all-versions/VersionUtils.h>
+#include <xsdc/XsdcSupport.h>
 
 #include "HidlUtils.h"
 
@@ -38,6 +44,210 @@ namespace xsd {
 using namespace ::android::audio::policy::configuration::CPP_VERSION;
 }
 
+namespace {
+
+uint64_t mixHash(uint64_t h) {
+    // The finalizer of splitmix64.
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+uint64_t hashKey(std::string_view key, uint64_t seed) {
+    uint64_t h = 0xcbf29ce484222325ULL ^ seed;  // FNV-1a
+    for (unsigned char c : key) {
+        h = (h ^ c) * 0x100000001b3ULL;
+    }
+    return mixHash(h);
+}
+
+template <typename E, typename = std::enable_if_t<std::is_enum_v<E>>>
+uint64_t hashKey(E key, uint64_t seed) {
+    using U = std::make_unsigned_t<std::underlying_type_t<E>>;
+    return mixHash(static_cast<U>(key) ^ (seed << 32));
+}
+
+// A read-only map without collisions, built with "hash and displace": keys are
+// spread over buckets, then each bucket, the fullest first, picks the seed that
+// puts all of its keys into free slots. A lookup hashes the key twice and
+// compares it with one entry.
+template <typename K, typename V>
+class PerfectHashMap {
+  public:
+    // On duplicate keys, the first entry is kept.
+    explicit PerfectHashMap(std::vector<std::pair<K, V>> entries) {
+        std::unordered_set<K> keys;
+        for (auto& entry : entries) {
+            if (keys.insert(entry.first).second) mEntries.push_back(std::move(entry));
+        }
+        build();
+    }
+
+    template <typename Q>
+    const V* find(const Q& key) const {
+        if (mEntries.empty()) return nullptr;
+        const uint32_t seed = mSeeds[hashKey(key, 0) & (mSeeds.size() - 1)];
+        const int32_t index = mSlots[hashKey(key, seed) & (mSlots.size() - 1)];
+        return index >= 0 && mEntries[index].first == key ? &mEntries[index].second : nullptr;
+    }
+
+    const std::vector<std::pair<K, V>>& entries() const { return mEntries; }
+
+  private:
+    std::vector<std::pair<K, V>> mEntries;
+    std::vector<uint32_t> mSeeds;  // one per bucket
+    std::vector<int32_t> mSlots;   // indexes into mEntries, -1 if free
+
+    static size_t powerOfTwoAtLeast(size_t n) {
+        size_t result = 1;
+        while (result < n) result <<= 1;
+        return result;
+    }
+
+    void build() {
+        if (mEntries.empty()) return;
+        // As many buckets as keys, and the slots are at most half full.
+        mSeeds.assign(powerOfTwoAtLeast(mEntries.size()), 0);
+        mSlots.assign(powerOfTwoAtLeast(mEntries.size() * 2), -1);
+        std::vector<std::vector<int32_t>> buckets(mSeeds.size());
+        for (size_t i = 0; i < mEntries.size(); ++i) {
+            buckets[hashKey(mEntries[i].first, 0) & (buckets.size() - 1)].push_back(i);
+        }
+        std::vector<size_t> order(buckets.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return buckets[a].size() > buckets[b].size();
+        });
+        std::vector<size_t> taken;
+        for (size_t bucket : order) {
+            if (buckets[bucket].empty()) break;
+            for (uint32_t seed = 1;; ++seed) {
+                LOG_ALWAYS_FATAL_IF(seed == 0, "No perfect hash seed found");
+                taken.clear();
+                for (int32_t index : buckets[bucket]) {
+                    size_t slot = hashKey(mEntries[index].first, seed) & (mSlots.size() - 1);
+                    if (mSlots[slot] >= 0) break;
+                    mSlots[slot] = index;
+                    taken.push_back(slot);
+                }
+                if (taken.size() == buckets[bucket].size()) {
+                    mSeeds[bucket] = seed;
+                    break;
+                }
+                for (size_t slot : taken) mSlots[slot] = -1;
+            }
+        }
+    }
+};
+
+// The names of an XSD enum, along with their HAL values if they have one.
+template <typename H>
+using NameTable = PerfectHashMap<std::string, std::optional<H>>;
+// The names of HAL values, interned.
+template <typename H>
+using ValueTable = PerfectHashMap<H, std::string>;
+
+template <typename X, typename H>
+NameTable<H> makeNameTable(bool (*fromString)(const char*, H*)) {
+    std::vector<std::pair<std::string, std::optional<H>>> entries;
+    for (const auto value : xsdc_enum_range<X>{}) {
+        std::string name = toString(value);
+        H halValue;
+        entries.emplace_back(name, fromString(name.c_str(), &halValue)
+                                           ? std::optional<H>(halValue)
+                                           : std::nullopt);
+    }
+    return NameTable<H>(std::move(entries));
+}
+
+// Only the values of 'names' are considered, as 'toString' is expected to return
+// the name of a value which converts back to the same value.
+template <typename H>
+ValueTable<H> makeValueTable(const NameTable<H>& names, const char* (*toString)(H)) {
+    std::vector<std::pair<H, std::string>> entries;
+    for (const auto& [name, halValue] : names.entries()) {
+        if (!halValue.has_value()) continue;
+        const char* halName = toString(*halValue);
+        if (halName != nullptr && names.find(std::string_view(halName)) != nullptr) {
+            entries.emplace_back(*halValue, halName);
+        }
+    }
+    return ValueTable<H>(std::move(entries));
+}
+
+// Replaces the lookups of names by xsd::isUnknown* and audio_*_from_string, and
+// the linear searches of audio_*_to_string. Built on first use.
+struct ConversionTables {
+    NameTable<audio_channel_mask_t> channelMasks =
+            makeNameTable<xsd::AudioChannelMask>(audio_channel_mask_from_string);
+    ValueTable<audio_channel_mask_t> indexChannelMasks =
+            makeValueTable(channelMasks, audio_channel_index_mask_to_string);
+    ValueTable<audio_channel_mask_t> inputChannelMasks =
+            makeValueTable(channelMasks, audio_channel_in_mask_to_string);
+    ValueTable<audio_channel_mask_t> outputChannelMasks =
+            makeValueTable(channelMasks, audio_channel_out_mask_to_string);
+    NameTable<audio_content_type_t> contentTypes =
+            makeNameTable<xsd::AudioContentType>(audio_content_type_from_string);
+    ValueTable<audio_content_type_t> contentTypeNames =
+            makeValueTable(contentTypes, audio_content_type_to_string);
+    NameTable<audio_devices_t> devices = makeNameTable<xsd::AudioDevice>(audio_device_from_string);
+    ValueTable<audio_devices_t> deviceNames = makeValueTable(devices, audio_device_to_string);
+    NameTable<audio_encapsulation_type_t> encapsulationTypes =
+            makeNameTable<xsd::AudioEncapsulationType>(audio_encapsulation_type_from_string);
+    ValueTable<audio_encapsulation_type_t> encapsulationTypeNames =
+            makeValueTable(encapsulationTypes, audio_encapsulation_type_to_string);
+    NameTable<audio_format_t> formats = makeNameTable<xsd::AudioFormat>(audio_format_from_string);
+    ValueTable<audio_format_t> formatNames = makeValueTable(formats, audio_format_to_string);
+    NameTable<audio_gain_mode_t> gainModes =
+            makeNameTable<xsd::AudioGainMode>(audio_gain_mode_from_string);
+    ValueTable<audio_gain_mode_t> gainModeNames =
+            makeValueTable(gainModes, audio_gain_mode_to_string);
+    NameTable<audio_source_t> sources = makeNameTable<xsd::AudioSource>(audio_source_from_string);
+    ValueTable<audio_source_t> sourceNames = makeValueTable(sources, audio_source_to_string);
+    NameTable<audio_stream_type_t> streamTypes =
+            makeNameTable<xsd::AudioStreamType>(audio_stream_type_from_string);
+    ValueTable<audio_stream_type_t> streamTypeNames =
+            makeValueTable(streamTypes, audio_stream_type_to_string);
+    NameTable<audio_usage_t> usages = makeNameTable<xsd::AudioUsage>(audio_usage_from_string);
+    ValueTable<audio_usage_t> usageNames = makeValueTable(usages, audio_usage_to_string);
+};
+
+const ConversionTables& getTables() {
+    static const ConversionTables tables;
+    return tables;
+}
+
+template <typename S>
+std::string_view nameOf(const S& name) {
+    return std::string_view(name.c_str(), name.size());
+}
+
+// Whether the name is a value of the XSD enum.
+template <typename H>
+bool isKnown(const NameTable<H>& table, std::string_view name) {
+    return table.find(name) != nullptr;
+}
+
+// Succeeds if the name is a value of the XSD enum which also has a HAL value.
+template <typename H>
+bool nameToHal(const NameTable<H>& table, std::string_view name, H* halValue) {
+    const std::optional<H>* value = table.find(name);
+    if (value == nullptr || !value->has_value()) return false;
+    *halValue = **value;
+    return true;
+}
+
+// Succeeds if the HAL value has a name in the XSD enum.
+template <typename H, typename S>
+bool halToName(const ValueTable<H>& table, H halValue, S* name) {
+    const std::string* value = table.find(halValue);
+    if (value == nullptr) return false;
+    *name = *value;
+    return true;
+}
+
+}  // namespace
+
 #define CONVERT_CHECKED(expr, result)                   \
     if (status_t status = (expr); status != NO_ERROR) { \
         result = status;                                \
@@ -45,8 +255,7 @@ using namespace ::android::audio::policy::configuration::CPP_VERSION;
 
 status_t HidlUtils::audioIndexChannelMaskFromHal(audio_channel_mask_t halChannelMask,
                                                  AudioChannelMask* channelMask) {
-    *channelMask = audio_channel_index_mask_to_string(halChannelMask);
-    if (!channelMask->empty() && !xsd::isUnknownAudioChannelMask(*channelMask)) {
+    if (halToName(getTables().indexChannelMasks, halChannelMask, channelMask)) {
         return NO_ERROR;
     }
     ALOGE("Unknown index channel mask value 0x%X", halChannelMask);
@@ -56,8 +265,7 @@ status_t HidlUtils::audioIndexChannelMaskFromHal(audio_channel_mask_t halChannel
 
 status_t HidlUtils::audioInputChannelMaskFromHal(audio_channel_mask_t halChannelMask,
                                                  AudioChannelMask* channelMask) {
-    *channelMask = audio_channel_in_mask_to_string(halChannelMask);
-    if (!channelMask->empty() && !xsd::isUnknownAudioChannelMask(*channelMask)) {
+    if (halToName(getTables().inputChannelMasks, halChannelMask, channelMask)) {
         return NO_ERROR;
     }
     ALOGE("Unknown input channel mask value 0x%X", halChannelMask);
@@ -67,8 +275,7 @@ status_t HidlUtils::audioInputChannelMaskFromHal(audio_channel_mask_t halChannel
 
 status_t HidlUtils::audioOutputChannelMaskFromHal(audio_channel_mask_t halChannelMask,
                                                   AudioChannelMask* channelMask) {
-    *channelMask = audio_channel_out_mask_to_string(halChannelMask);
-    if (!channelMask->empty() && !xsd::isUnknownAudioChannelMask(*channelMask)) {
+    if (halToName(getTables().outputChannelMasks, halChannelMask, channelMask)) {
         return NO_ERROR;
     }
     ALOGE("Unknown output channel mask value 0x%X", halChannelMask);
@@ -103,7 +310,7 @@ status_t HidlUtils::audioChannelMasksFromHal(const std::vector<std::string>& hal
     tempChannelMasks.resize(halChannelMasks.size());
     size_t tempPos = 0;
     for (const auto& halChannelMask : halChannelMasks) {
-        if (!halChannelMask.empty() && !xsd::isUnknownAudioChannelMask(halChannelMask)) {
+        if (isKnown(getTables().channelMasks, halChannelMask)) {
             tempChannelMasks[tempPos++] = halChannelMask;
         }
     }
@@ -118,8 +325,7 @@ status_t HidlUtils::audioChannelMasksFromHal(const std::vector<std::string>& hal
 
 status_t HidlUtils::audioChannelMaskToHal(const AudioChannelMask& channelMask,
                                           audio_channel_mask_t* halChannelMask) {
-    if (!xsd::isUnknownAudioChannelMask(channelMask) &&
-        audio_channel_mask_from_string(channelMask.c_str(), halChannelMask)) {
+    if (nameToHal(getTables().channelMasks, nameOf(channelMask), halChannelMask)) {
         return NO_ERROR;
     }
     ALOGE("Unknown channel mask \"%s\"", channelMask.c_str());
@@ -203,8 +409,7 @@ status_t HidlUtils::audioConfigBaseOptionalToHal(const AudioConfigBaseOptional&
 
 status_t HidlUtils::audioContentTypeFromHal(const audio_content_type_t halContentType,
                                             AudioContentType* contentType) {
-    *contentType = audio_content_type_to_string(halContentType);
-    if (!contentType->empty() && !xsd::isUnknownAudioContentType(*contentType)) {
+    if (halToName(getTables().contentTypeNames, halContentType, contentType)) {
         return NO_ERROR;
     }
     ALOGE("Unknown audio content type value 0x%X", halContentType);
@@ -214,8 +419,7 @@ status_t HidlUtils::audioContentTypeFromHal(const audio_content_type_t halConten
 
 status_t HidlUtils::audioContentTypeToHal(const AudioContentType& contentType,
                                           audio_content_type_t* halContentType) {
-    if (!xsd::isUnknownAudioContentType(contentType) &&
-        audio_content_type_from_string(contentType.c_str(), halContentType)) {
+    if (nameToHal(getTables().contentTypes, nameOf(contentType), halContentType)) {
         return NO_ERROR;
     }
     ALOGE("Unknown audio content type \"%s\"", contentType.c_str());
@@ -224,8 +428,7 @@ status_t HidlUtils::audioContentTypeToHal(const AudioContentType& contentType,
 }
 
 status_t HidlUtils::audioDeviceTypeFromHal(audio_devices_t halDevice, AudioDevice* device) {
-    *device = audio_device_to_string(halDevice);
-    if (!device->empty() && !xsd::isUnknownAudioDevice(*device)) {
+    if (halToName(getTables().deviceNames, halDevice, device)) {
         return NO_ERROR;
     }
     ALOGE("Unknown audio device value 0x%X", halDevice);
@@ -234,7 +437,7 @@ status_t HidlUtils::audioDeviceTypeFromHal(audio_devices_t halDevice, AudioDevic
 }
 
 status_t HidlUtils::audioDeviceTypeToHal(const AudioDevice& device, audio_devices_t* halDevice) {
-    if (!xsd::isUnknownAudioDevice(device) && audio_device_from_string(device.c_str(), halDevice)) {
+    if (nameToHal(getTables().devices, nameOf(device), halDevice)) {
         return NO_ERROR;
     }
     ALOGE("Unknown audio device \"%s\"", device.c_str());
@@ -243,11 +446,11 @@ status_t HidlUtils::audioDeviceTypeToHal(const AudioDevice& device, audio_device
 }
 
 status_t HidlUtils::audioFormatFromHal(audio_format_t halFormat, AudioFormat* format) {
-    *format = audio_format_to_string(halFormat);
-    if (!format->empty() && !xsd::isUnknownAudioFormat(*format)) {
+    if (halToName(getTables().formatNames, halFormat, format)) {
         return NO_ERROR;
     }
     ALOGE("Unknown audio format value 0x%X", halFormat);
+    *format = audio_format_to_string(halFormat);
     return BAD_VALUE;
 }
 
@@ -257,7 +460,7 @@ status_t HidlUtils::audioFormatsFromHal(const std::vector<std::string>& halForma
     tempFormats.resize(halFormats.size());
     size_t tempPos = 0;
     for (const auto& halFormat : halFormats) {
-        if (!halFormat.empty() && !xsd::isUnknownAudioFormat(halFormat)) {
+        if (isKnown(getTables().formats, halFormat)) {
             tempFormats[tempPos++] = halFormat;
         }
     }
@@ -270,7 +473,7 @@ status_t HidlUtils::audioFormatsFromHal(const std::vector<std::string>& halForma
 }
 
 status_t HidlUtils::audioFormatToHal(const AudioFormat& format, audio_format_t* halFormat) {
-    if (!xsd::isUnknownAudioFormat(format) && audio_format_from_string(format.c_str(), halFormat)) {
+    if (nameToHal(getTables().formats, nameOf(format), halFormat)) {
         return NO_ERROR;
     }
     ALOGE("Unknown audio format \"%s\"", format.c_str());
@@ -285,8 +488,8 @@ status_t HidlUtils::audioGainModeMaskFromHal(audio_gain_mode_t halGainModeMask,
     for (uint32_t bit = 0; halGainModeMask != 0 && bit < sizeof(audio_gain_mode_t) * 8; ++bit) {
         audio_gain_mode_t flag = static_cast<audio_gain_mode_t>(1u << bit);
         if ((flag & halGainModeMask) == flag) {
-            AudioGainMode flagStr = audio_gain_mode_to_string(flag);
-            if (!flagStr.empty() && !xsd::isUnknownAudioGainMode(flagStr)) {
+            AudioGainMode flagStr;
+            if (halToName(getTables().gainModeNames, flag, &flagStr)) {
                 result.push_back(flagStr);
             } else {
                 ALOGE("Unknown audio gain mode value 0x%X", flag);
@@ -305,8 +508,7 @@ status_t HidlUtils::audioGainModeMaskToHal(const hidl_vec<AudioGainMode>& gainMo
     *halGainModeMask = {};
     for (const auto& gainMode : gainModeMask) {
         audio_gain_mode_t halGainMode;
-        if (!xsd::isUnknownAudioGainMode(gainMode) &&
-            audio_gain_mode_from_string(gainMode.c_str(), &halGainMode)) {
+        if (nameToHal(getTables().gainModes, nameOf(gainMode), &halGainMode)) {
             *halGainModeMask = static_cast<audio_gain_mode_t>(*halGainModeMask | halGainMode);
         } else {
             ALOGE("Unknown audio gain mode \"%s\"", gainMode.c_str());
@@ -317,8 +519,7 @@ status_t HidlUtils::audioGainModeMaskToHal(const hidl_vec<AudioGainMode>& gainMo
 }
 
 status_t HidlUtils::audioSourceFromHal(audio_source_t halSource, AudioSource* source) {
-    *source = audio_source_to_string(halSource);
-    if (!source->empty() && !xsd::isUnknownAudioSource(*source)) {
+    if (halToName(getTables().sourceNames, halSource, source)) {
         return NO_ERROR;
     }
     ALOGE("Unknown audio source value 0x%X", halSource);
@@ -327,7 +528,7 @@ status_t HidlUtils::audioSourceFromHal(audio_source_t halSource, AudioSource* so
 }
 
 status_t HidlUtils::audioSourceToHal(const AudioSource& source, audio_source_t* halSource) {
-    if (!xsd::isUnknownAudioSource(source) && audio_source_from_string(source.c_str(), halSource)) {
+    if (nameToHal(getTables().sources, nameOf(source), halSource)) {
         return NO_ERROR;
     }
     ALOGE("Unknown audio source \"%s\"", source.c_str());
@@ -339,11 +540,11 @@ status_t HidlUtils::audioSourceToHal(const AudioSource& source, audio_source_t*
 status_t HidlUtils::audioStreamTypeFromHal(audio_stream_type_t halStreamType,
                                            AudioStreamType* streamType) {
     if (halStreamType != AUDIO_STREAM_DEFAULT) {
-        *streamType = audio_stream_type_to_string(halStreamType);
-        if (!streamType->empty() && !xsd::isUnknownAudioStreamType(*streamType)) {
+        if (halToName(getTables().streamTypeNames, halStreamType, streamType)) {
             return NO_ERROR;
         }
         ALOGE("Unknown audio stream type value 0x%X", halStreamType);
+        *streamType = audio_stream_type_to_string(halStreamType);
         return BAD_VALUE;
     } else {
         *streamType = "";
@@ -354,8 +555,7 @@ status_t HidlUtils::audioStreamTypeFromHal(audio_stream_type_t halStreamType,
 status_t HidlUtils::audioStreamTypeToHal(const AudioStreamType& streamType,
                                          audio_stream_type_t* halStreamType) {
     if (!streamType.empty()) {
-        if (!xsd::isUnknownAudioStreamType(streamType) &&
-            audio_stream_type_from_string(streamType.c_str(), halStreamType)) {
+        if (nameToHal(getTables().streamTypes, nameOf(streamType), halStreamType)) {
             return NO_ERROR;
         }
         ALOGE("Unknown audio stream type \"%s\"", streamType.c_str());
@@ -493,8 +693,7 @@ status_t HidlUtils::audioUsageFromHal(audio_usage_t halUsage, AudioUsage* usage)
 #endif
         halUsage = AUDIO_USAGE_NOTIFICATION;
     }
-    *usage = audio_usage_to_string(halUsage);
-    if (!usage->empty() && !xsd::isUnknownAudioUsage(*usage)) {
+    if (halToName(getTables().usageNames, halUsage, usage)) {
         return NO_ERROR;
     }
     ALOGE("Unknown audio usage %d", halUsage);
@@ -503,7 +702,7 @@ status_t HidlUtils::audioUsageFromHal(audio_usage_t halUsage, AudioUsage* usage)
 }
 
 status_t HidlUtils::audioUsageToHal(const AudioUsage& usage, audio_usage_t* halUsage) {
-    if (!xsd::isUnknownAudioUsage(usage) && audio_usage_from_string(usage.c_str(), halUsage)) {
+    if (nameToHal(getTables().usages, nameOf(usage), halUsage)) {
         return NO_ERROR;
     }
     ALOGE("Unknown audio usage \"%s\"", usage.c_str());
@@ -721,8 +920,7 @@ status_t HidlUtils::audioPortExtendedInfoToHal(const AudioPortExtendedInfo& ext,
 
 status_t HidlUtils::encapsulationTypeFromHal(audio_encapsulation_type_t halEncapsulationType,
                                              AudioEncapsulationType* encapsulationType) {
-    *encapsulationType = audio_encapsulation_type_to_string(halEncapsulationType);
-    if (!encapsulationType->empty() && !xsd::isUnknownAudioEncapsulationType(*encapsulationType)) {
+    if (halToName(getTables().encapsulationTypeNames, halEncapsulationType, encapsulationType)) {
         return NO_ERROR;
     }
     ALOGE("Unknown audio encapsulation type value 0x%X", halEncapsulationType);
@@ -731,8 +929,8 @@ status_t HidlUtils::encapsulationTypeFromHal(audio_encapsulation_type_t halEncap
 
 status_t HidlUtils::encapsulationTypeToHal(const AudioEncapsulationType& encapsulationType,
                                            audio_encapsulation_type_t* halEncapsulationType) {
-    if (!xsd::isUnknownAudioEncapsulationType(encapsulationType) &&
-        audio_encapsulation_type_from_string(encapsulationType.c_str(), halEncapsulationType)) {
+    if (nameToHal(getTables().encapsulationTypes, nameOf(encapsulationType),
+                  halEncapsulationType)) {
         return NO_ERROR;
     }
     ALOGE("Unknown audio encapsulation type \"%s\"", encapsulationType.c_str());
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the table based conversions of HidlUtils with the string based ones
+// they replaced, which are reproduced here as the *ByString benchmarks. Every
+// iteration converts all the values of the XSD enum. BM_PortConfigs* convert
+// vectors of port configs, like the ones of an audio patch.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#define LOG_TAG "HidlUtils_Benchmark"
+#include <log/log.h>
+
+#include <HidlUtils.h>
+#include PATH(APM_XSD_ENUMS_H_FILENAME)
+#include <system/audio.h>
+#include <xsdc/XsdcSupport.h>
+
+using namespace android;
+using ::android::hardware::hidl_vec;
+using namespace ::android::hardware::audio::common::COMMON_TYPES_CPP_VERSION;
+using ::android::hardware::audio::common::COMMON_TYPES_CPP_VERSION::implementation::HidlUtils;
+using ::benchmark::State;
+namespace xsd {
+using namespace ::android::audio::policy::configuration::CPP_VERSION;
+}
+
+namespace {
+
+template <typename X>
+std::vector<std::string> getNames() {
+    std::vector<std::string> names;
+    for (const auto enumVal : xsdc_enum_range<X>{}) names.push_back(toString(enumVal));
+    return names;
+}
+
+template <typename X, typename H>
+std::vector<H> getHalValues(bool (*fromString)(const char*, H*)) {
+    std::vector<H> values;
+    for (const auto& name : getNames<X>()) {
+        H value;
+        if (fromString(name.c_str(), &value)) values.push_back(value);
+    }
+    return values;
+}
+
+bool formatToHalByString(const AudioFormat& format, audio_format_t* halFormat) {
+    return !xsd::isUnknownAudioFormat(format) &&
+           audio_format_from_string(format.c_str(), halFormat);
+}
+
+bool formatFromHalByString(audio_format_t halFormat, AudioFormat* format) {
+    *format = audio_format_to_string(halFormat);
+    return !format->empty() && !xsd::isUnknownAudioFormat(*format);
+}
+
+bool deviceToHalByString(const AudioDevice& device, audio_devices_t* halDevice) {
+    return !xsd::isUnknownAudioDevice(device) &&
+           audio_device_from_string(device.c_str(), halDevice);
+}
+
+bool channelMaskFromHalByString(audio_channel_mask_t halChannelMask,
+                                AudioChannelMask* channelMask) {
+    *channelMask = audio_channel_out_mask_to_string(halChannelMask);
+    return !channelMask->empty() && !xsd::isUnknownAudioChannelMask(*channelMask);
+}
+
+void BM_FormatToHal(State& state) {
+    const std::vector<std::string> names = getNames<xsd::AudioFormat>();
+    const hidl_vec<AudioFormat> formats(names.begin(), names.end());
+    for (auto _ : state) {
+        for (const auto& format : formats) {
+            audio_format_t halFormat;
+            benchmark::DoNotOptimize(HidlUtils::audioFormatToHal(format, &halFormat));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * formats.size());
+}
+
+void BM_FormatToHalByString(State& state) {
+    const std::vector<std::string> names = getNames<xsd::AudioFormat>();
+    const hidl_vec<AudioFormat> formats(names.begin(), names.end());
+    for (auto _ : state) {
+        for (const auto& format : formats) {
+            audio_format_t halFormat;
+            benchmark::DoNotOptimize(formatToHalByString(format, &halFormat));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * formats.size());
+}
+
+void BM_FormatFromHal(State& state) {
+    const auto halFormats = getHalValues<xsd::AudioFormat>(audio_format_from_string);
+    AudioFormat format;
+    for (auto _ : state) {
+        for (const auto halFormat : halFormats) {
+            benchmark::DoNotOptimize(HidlUtils::audioFormatFromHal(halFormat, &format));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * halFormats.size());
+}
+
+void BM_FormatFromHalByString(State& state) {
+    const auto halFormats = getHalValues<xsd::AudioFormat>(audio_format_from_string);
+    AudioFormat format;
+    for (auto _ : state) {
+        for (const auto halFormat : halFormats) {
+            benchmark::DoNotOptimize(formatFromHalByString(halFormat, &format));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * halFormats.size());
+}
+
+void BM_DeviceToHal(State& state) {
+    const std::vector<std::string> names = getNames<xsd::AudioDevice>();
+    const hidl_vec<AudioDevice> devices(names.begin(), names.end());
+    for (auto _ : state) {
+        for (const auto& device : devices) {
+            audio_devices_t halDevice;
+            benchmark::DoNotOptimize(HidlUtils::audioDeviceTypeToHal(device, &halDevice));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * devices.size());
+}
+
+void BM_DeviceToHalByString(State& state) {
+    const std::vector<std::string> names = getNames<xsd::AudioDevice>();
+    const hidl_vec<AudioDevice> devices(names.begin(), names.end());
+    for (auto _ : state) {
+        for (const auto& device : devices) {
+            audio_devices_t halDevice;
+            benchmark::DoNotOptimize(deviceToHalByString(device, &halDevice));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * devices.size());
+}
+
+std::vector<audio_channel_mask_t> getOutputChannelMasks() {
+    std::vector<audio_channel_mask_t> halChannelMasks;
+    for (const auto enumVal : xsdc_enum_range<xsd::AudioChannelMask>{}) {
+        const std::string name = toString(enumVal);
+        audio_channel_mask_t halChannelMask;
+        if (name.find("_CHANNEL_OUT_") != std::string::npos &&
+            audio_channel_mask_from_string(name.c_str(), &halChannelMask)) {
+            halChannelMasks.push_back(halChannelMask);
+        }
+    }
+    return halChannelMasks;
+}
+
+void BM_ChannelMaskFromHal(State& state) {
+    const auto halChannelMasks = getOutputChannelMasks();
+    AudioChannelMask channelMask;
+    for (auto _ : state) {
+        for (const auto halChannelMask : halChannelMasks) {
+            benchmark::DoNotOptimize(HidlUtils::audioChannelMaskFromHal(
+                    halChannelMask, false /*isInput*/, &channelMask));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * halChannelMasks.size());
+}
+
+void BM_ChannelMaskFromHalByString(State& state) {
+    const auto halChannelMasks = getOutputChannelMasks();
+    AudioChannelMask channelMask;
+    for (auto _ : state) {
+        for (const auto halChannelMask : halChannelMasks) {
+            benchmark::DoNotOptimize(channelMaskFromHalByString(halChannelMask, &channelMask));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * halChannelMasks.size());
+}
+
+hidl_vec<AudioPortConfig> generatePortConfigs(size_t count) {
+    hidl_vec<AudioPortConfig> configs(count);
+    for (size_t i = 0; i < count; ++i) {
+        auto& config = configs[i];
+        config.id = i + 1;
+        config.base.sampleRateHz.value(48000);
+        config.base.channelMask.value(toString(xsd::AudioChannelMask::AUDIO_CHANNEL_OUT_STEREO));
+        config.base.format.value(toString(xsd::AudioFormat::AUDIO_FORMAT_PCM_16_BIT));
+        config.gain.unspecified({});
+        if (i % 2 == 0) {
+            config.ext.device({});
+            config.ext.device().deviceType = toString(xsd::AudioDevice::AUDIO_DEVICE_OUT_SPEAKER);
+        } else {
+            config.ext.mix({});
+            config.ext.mix().ioHandle = i;
+            config.ext.mix().useCase.stream(toString(xsd::AudioStreamType::AUDIO_STREAM_MUSIC));
+        }
+    }
+    return configs;
+}
+
+void BM_PortConfigsToHal(State& state) {
+    const hidl_vec<AudioPortConfig> configs = generatePortConfigs(state.range(0));
+    std::unique_ptr<audio_port_config[]> halConfigs;
+    for (auto _ : state) {
+        if (HidlUtils::audioPortConfigsToHal(configs, &halConfigs) != NO_ERROR) {
+            state.SkipWithError("conversion failed");
+            return;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * configs.size());
+}
+
+void BM_PortConfigsFromHal(State& state) {
+    const hidl_vec<AudioPortConfig> configs = generatePortConfigs(state.range(0));
+    std::unique_ptr<audio_port_config[]> halConfigs;
+    if (HidlUtils::audioPortConfigsToHal(configs, &halConfigs) != NO_ERROR) {
+        state.SkipWithError("conversion failed");
+        return;
+    }
+    hidl_vec<AudioPortConfig> configsBack;
+    for (auto _ : state) {
+        if (HidlUtils::audioPortConfigsFromHal(configs.size(), halConfigs.get(), &configsBack) !=
+            NO_ERROR) {
+            state.SkipWithError("conversion failed");
+            return;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * configs.size());
+}
+
+BENCHMARK(BM_FormatToHal);
+BENCHMARK(BM_FormatToHalByString);
+BENCHMARK(BM_FormatFromHal);
+BENCHMARK(BM_FormatFromHalByString);
+BENCHMARK(BM_DeviceToHal);
+BENCHMARK(BM_DeviceToHalByString);
+BENCHMARK(BM_ChannelMaskFromHal);
+BENCHMARK(BM_ChannelMaskFromHalByString);
+BENCHMARK(BM_PortConfigsToHal)->Arg(8)->Arg(256);
+BENCHMARK(BM_PortConfigsFromHal)->Arg(8)->Arg(256);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -954,6 +954,77 @@ TEST(HidlUtils, ConvertAudioPortConfig) {
     EXPECT_TRUE(audio_port_configs_are_equal(&halConfig, &halConfigBack));
 }
 
+TEST(HidlUtils, ConvertAudioPortConfigs) {
+    hidl_vec<AudioPortConfig> configs(3);
+    for (size_t i = 0; i < configs.size(); ++i) {
+        auto& config = configs[i];
+        config.id = 42 + i;
+        config.base.sampleRateHz.value(48000);
+        config.base.channelMask.value(toString(xsd::AudioChannelMask::AUDIO_CHANNEL_OUT_STEREO));
+        config.base.format.value(toString(xsd::AudioFormat::AUDIO_FORMAT_PCM_FLOAT));
+        config.gain.unspecified({});
+        config.ext.device({});
+        config.ext.device().deviceType = toString(xsd::AudioDevice::AUDIO_DEVICE_OUT_SPEAKER);
+    }
+    configs[2].ext.device().deviceType = toString(xsd::AudioDevice::AUDIO_DEVICE_OUT_EARPIECE);
+    std::unique_ptr<audio_port_config[]> halConfigs;
+    EXPECT_EQ(NO_ERROR, HidlUtils::audioPortConfigsToHal(configs, &halConfigs));
+    hidl_vec<AudioPortConfig> configsBack;
+    EXPECT_EQ(NO_ERROR,
+              HidlUtils::audioPortConfigsFromHal(configs.size(), halConfigs.get(), &configsBack));
+    EXPECT_EQ(configs, configsBack);
+
+    // An invalid config doesn't prevent the conversion of the others.
+    configs[1].base.format.value("random string");
+    EXPECT_EQ(BAD_VALUE, HidlUtils::audioPortConfigsToHal(configs, &halConfigs));
+    EXPECT_EQ(AUDIO_DEVICE_OUT_EARPIECE, halConfigs[2].ext.device.type);
+}
+
+// The conversions use lookup tables built from the XSD enums, they must agree
+// with the string conversions of the system.
+TEST(HidlUtils, ConversionsMatchSystemStrings) {
+    for (const auto enumVal : xsdc_enum_range<xsd::AudioFormat>{}) {
+        const AudioFormat format = toString(enumVal);
+        audio_format_t halFormat, expectedHalFormat;
+        ASSERT_TRUE(audio_format_from_string(format.c_str(), &expectedHalFormat)) << format;
+        ASSERT_EQ(NO_ERROR, HidlUtils::audioFormatToHal(format, &halFormat)) << format;
+        EXPECT_EQ(expectedHalFormat, halFormat) << format;
+        AudioFormat formatBack;
+        EXPECT_EQ(NO_ERROR, HidlUtils::audioFormatFromHal(halFormat, &formatBack)) << format;
+        EXPECT_EQ(std::string(audio_format_to_string(halFormat)), formatBack) << format;
+    }
+    for (const auto enumVal : xsdc_enum_range<xsd::AudioDevice>{}) {
+        const AudioDevice device = toString(enumVal);
+        audio_devices_t halDevice, expectedHalDevice;
+        ASSERT_TRUE(audio_device_from_string(device.c_str(), &expectedHalDevice)) << device;
+        ASSERT_EQ(NO_ERROR, HidlUtils::audioDeviceTypeToHal(device, &halDevice)) << device;
+        EXPECT_EQ(expectedHalDevice, halDevice) << device;
+        AudioDevice deviceBack;
+        EXPECT_EQ(NO_ERROR, HidlUtils::audioDeviceTypeFromHal(halDevice, &deviceBack)) << device;
+        EXPECT_EQ(std::string(audio_device_to_string(halDevice)), deviceBack) << device;
+    }
+    for (const auto enumVal : xsdc_enum_range<xsd::AudioChannelMask>{}) {
+        const AudioChannelMask channelMask = toString(enumVal);
+        audio_channel_mask_t halChannelMask, expectedHalChannelMask;
+        ASSERT_TRUE(audio_channel_mask_from_string(channelMask.c_str(), &expectedHalChannelMask))
+                << channelMask;
+        ASSERT_EQ(NO_ERROR, HidlUtils::audioChannelMaskToHal(channelMask, &halChannelMask))
+                << channelMask;
+        EXPECT_EQ(expectedHalChannelMask, halChannelMask) << channelMask;
+        if (isInputChannelMask(enumVal) || isOutputChannelMask(enumVal)) {
+            const bool isInput = isInputChannelMask(enumVal);
+            AudioChannelMask channelMaskBack;
+            EXPECT_EQ(NO_ERROR, HidlUtils::audioChannelMaskFromHal(halChannelMask, isInput,
+                                                                   &channelMaskBack))
+                    << channelMask;
+            EXPECT_EQ(std::string(isInput ? audio_channel_in_mask_to_string(halChannelMask)
+                                          : audio_channel_out_mask_to_string(halChannelMask)),
+                      channelMaskBack)
+                    << channelMask;
+        }
+    }
+}
+
 static AudioProfile generateValidAudioProfile() {
     AudioProfile profile;
     profile.format = toString(xsd::AudioFormat::AUDIO_FORMAT_PCM_16_BIT);
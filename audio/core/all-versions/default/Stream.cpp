@@ -22,6 +22,7 @@
 #include "core/default/Util.h"
 
 #include <inttypes.h>
+#include <stdio.h>
 
 #include <HidlUtils.h>
 #include <android/log.h>
@@ -450,6 +451,18 @@ Return<void> Stream::debugDump(const hidl_handle& fd) {
 }
 #endif
 
+void StreamDataStats::dump(int fd) const {
+    dprintf(fd,
+            "Data transfers: %" PRIu64 " (%" PRIu64 " split, %" PRIu64 " short, %" PRIu64
+            " xruns)\n",
+            transfers.load(std::memory_order_relaxed),
+            splitTransfers.load(std::memory_order_relaxed),
+            shortTransfers.load(std::memory_order_relaxed), xruns.load(std::memory_order_relaxed));
+    dprintf(fd, "Bytes passed in place: %" PRIu64 ", copied: %" PRIu64 "\n",
+            zeroCopyBytes.load(std::memory_order_relaxed),
+            copiedBytes.load(std::memory_order_relaxed));
+}
+
 }  // namespace implementation
 }  // namespace CPP_VERSION
 }  // namespace audio
@@ -28,6 +28,7 @@
 #include <hardware/audio.h>
 #include <util/CoreUtils.h>
 #include <utils/Trace.h>
+#include <algorithm>
 #include <cmath>
 #include <memory>
 
@@ -49,7 +50,8 @@ class ReadThread : public Thread {
    public:
     // ReadThread's lifespan never exceeds StreamIn's lifespan.
     ReadThread(std::atomic<bool>* stop, audio_stream_in_t* stream, StreamIn::CommandMQ* commandMQ,
-               StreamIn::DataMQ* dataMQ, StreamIn::StatusMQ* statusMQ, EventFlag* efGroup)
+               StreamIn::DataMQ* dataMQ, StreamIn::StatusMQ* statusMQ, EventFlag* efGroup,
+               size_t frameSize, StreamDataStats* stats)
         : Thread(false /*canCallJava*/),
           mStop(stop),
           mStream(stream),
@@ -57,6 +59,8 @@ class ReadThread : public Thread {
           mDataMQ(dataMQ),
           mStatusMQ(statusMQ),
           mEfGroup(efGroup),
+          mFrameSize(frameSize),
+          mStats(stats),
           mBuffer(nullptr) {}
     bool init() {
         mBuffer.reset(new (std::nothrow) uint8_t[mDataMQ->getQuantumCount()]);
@@ -71,6 +75,9 @@ class ReadThread : public Thread {
     StreamIn::DataMQ* mDataMQ;
     StreamIn::StatusMQ* mStatusMQ;
     EventFlag* mEfGroup;
+    const size_t mFrameSize;
+    StreamDataStats* mStats;
+    // Only used when the queue wraps around in the middle of a frame.
     std::unique_ptr<uint8_t[]> mBuffer;
     IStreamIn::ReadParameters mParameters;
     IStreamIn::ReadStatus mStatus;
@@ -90,13 +97,50 @@ void ReadThread::doRead() {
             "space",
             (int32_t)requestedToRead, (int32_t)availableToWrite);
         requestedToRead = availableToWrite;
+        StreamDataStats::add(mStats->xruns, 1);
     }
-    ssize_t readResult = mStream->read(mStream, &mBuffer[0], requestedToRead);
     mStatus.retval = Result::OK;
+    StreamIn::DataMQ::MemTransaction tx;
+    if (!mDataMQ->beginWrite(requestedToRead, &tx)) {
+        ALOGW("data message queue write failed");
+        mStatus.reply.read = 0;
+        return;
+    }
+    StreamDataStats::add(mStats->transfers, 1);
+
+    // The HAL writes the data in place, it becomes visible to the client on commit.
+    const auto& first = tx.getFirstRegion();
+    const auto& second = tx.getSecondRegion();
+    ssize_t readResult;
+    if (second.getLength() == 0 || first.getLength() % mFrameSize == 0) {
+        readResult = mStream->read(mStream, first.getAddress(), first.getLength());
+        if (readResult == static_cast<ssize_t>(first.getLength()) && second.getLength() > 0) {
+            StreamDataStats::add(mStats->splitTransfers, 1);
+            ssize_t secondResult = mStream->read(mStream, second.getAddress(), second.getLength());
+            // The first part is already read, an error is reported by the next read.
+            if (secondResult >= 0) {
+                readResult += secondResult;
+            } else {
+                (void)Stream::analyzeStatus("read", secondResult);
+            }
+        }
+        if (readResult > 0) StreamDataStats::add(mStats->zeroCopyBytes, readResult);
+    } else {
+        // Never split a frame between two HAL reads.
+        readResult = mStream->read(mStream, &mBuffer[0], requestedToRead);
+        if (readResult > 0) {
+            size_t firstBytes = std::min(static_cast<size_t>(readResult), first.getLength());
+            memcpy(first.getAddress(), &mBuffer[0], firstBytes);
+            memcpy(second.getAddress(), &mBuffer[firstBytes], readResult - firstBytes);
+            StreamDataStats::add(mStats->copiedBytes, readResult);
+        }
+    }
+
     if (readResult >= 0) {
         mStatus.reply.read = readResult;
-        if (!mDataMQ->write(&mBuffer[0], readResult)) {
-            ALOGW("data message queue write failed");
+        mDataMQ->commitWrite(readResult);
+        if (static_cast<size_t>(readResult) < requestedToRead) {
+            StreamDataStats::add(mStats->shortTransfers, 1);
         }
     } else {
         mStatus.retval = Stream::analyzeStatus("read", readResult);
@@ -418,7 +462,7 @@ Return<void> StreamIn::prepareForReading(uint32_t frameSize, uint32_t framesCoun
     // Create and launch the thread.
     auto tempReadThread =
             sp<ReadThread>::make(&mStopReadThread, mStream, tempCommandMQ.get(), tempDataMQ.get(),
-                                 tempStatusMQ.get(), tempElfGroup.get());
+                                 tempStatusMQ.get(), tempElfGroup.get(), frameSize, &mDataStats);
     if (!tempReadThread->init()) {
         ALOGW("failed to start reader thread: %s", strerror(-status));
         sendError(Result::INVALID_ARGUMENTS);
@@ -478,6 +522,9 @@ Return<void> StreamIn::getCapturePosition(getCapturePosition_cb _hidl_cb) {
 }
 
 Return<void> StreamIn::debug(const hidl_handle& fd, const hidl_vec<hidl_string>& options) {
+    if (fd.getNativeHandle() != nullptr && fd->numFds == 1) {
+        mDataStats.dump(fd->data[0]);
+    }
     return mStreamCommon->debug(fd, options);
 }
 
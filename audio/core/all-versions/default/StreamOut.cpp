@@ -52,7 +52,8 @@ class WriteThread : public Thread {
     // WriteThread's lifespan never exceeds StreamOut's lifespan.
     WriteThread(std::atomic<bool>* stop, audio_stream_out_t* stream,
                 StreamOut::CommandMQ* commandMQ, StreamOut::DataMQ* dataMQ,
-                StreamOut::StatusMQ* statusMQ, EventFlag* efGroup)
+                StreamOut::StatusMQ* statusMQ, EventFlag* efGroup, size_t frameSize,
+                StreamDataStats* stats)
         : Thread(false /*canCallJava*/),
           mStop(stop),
           mStream(stream),
@@ -60,6 +61,8 @@ class WriteThread : public Thread {
           mDataMQ(dataMQ),
           mStatusMQ(statusMQ),
           mEfGroup(efGroup),
+          mFrameSize(frameSize),
+          mStats(stats),
           mBuffer(nullptr) {}
     bool init() {
         mBuffer.reset(new (std::nothrow) uint8_t[mDataMQ->getQuantumCount()]);
@@ -74,6 +77,9 @@ class WriteThread : public Thread {
     StreamOut::DataMQ* mDataMQ;
     StreamOut::StatusMQ* mStatusMQ;
     EventFlag* mEfGroup;
+    const size_t mFrameSize;
+    StreamDataStats* mStats;
+    // Only used when the queue wraps around in the middle of a frame.
     std::unique_ptr<uint8_t[]> mBuffer;
     IStreamOut::WriteStatus mStatus;
 
@@ -88,13 +94,49 @@ void WriteThread::doWrite() {
     const size_t availToRead = mDataMQ->availableToRead();
     mStatus.retval = Result::OK;
     mStatus.reply.written = 0;
-    if (mDataMQ->read(&mBuffer[0], availToRead)) {
-        ssize_t writeResult = mStream->write(mStream, &mBuffer[0], availToRead);
-        if (writeResult >= 0) {
-            mStatus.reply.written = writeResult;
-        } else {
-            mStatus.retval = Stream::analyzeStatus("write", writeResult);
+    StreamOut::DataMQ::MemTransaction tx;
+    if (!mDataMQ->beginRead(availToRead, &tx)) {
+        ALOGE("data message queue read failed");
+        return;
+    }
+    StreamDataStats::add(mStats->transfers, 1);
+    if (availToRead == 0) StreamDataStats::add(mStats->xruns, 1);
+
+    // The HAL reads the data in place. The client doesn't write into the queue
+    // until it gets the status, so the data is only released after the HAL is done with it.
+    const auto& first = tx.getFirstRegion();
+    const auto& second = tx.getSecondRegion();
+    ssize_t writeResult;
+    if (second.getLength() == 0 || first.getLength() % mFrameSize == 0) {
+        writeResult = mStream->write(mStream, first.getAddress(), first.getLength());
+        if (writeResult == static_cast<ssize_t>(first.getLength()) && second.getLength() > 0) {
+            StreamDataStats::add(mStats->splitTransfers, 1);
+            ssize_t secondResult = mStream->write(mStream, second.getAddress(), second.getLength());
+            // The first part is already written, an error is reported by the next write.
+            if (secondResult >= 0) {
+                writeResult += secondResult;
+            } else {
+                (void)Stream::analyzeStatus("write", secondResult);
+            }
+        }
+        StreamDataStats::add(mStats->zeroCopyBytes, availToRead);
+    } else {
+        // Never split a frame between two HAL writes.
+        memcpy(&mBuffer[0], first.getAddress(), first.getLength());
+        memcpy(&mBuffer[first.getLength()], second.getAddress(), second.getLength());
+        writeResult = mStream->write(mStream, &mBuffer[0], availToRead);
+        StreamDataStats::add(mStats->copiedBytes, availToRead);
+    }
+    // As before, whatever the HAL didn't take is dropped.
+    mDataMQ->commitRead(availToRead);
+
+    if (writeResult >= 0) {
+        mStatus.reply.written = writeResult;
+        if (static_cast<size_t>(writeResult) < availToRead) {
+            StreamDataStats::add(mStats->shortTransfers, 1);
         }
+    } else {
+        mStatus.retval = Stream::analyzeStatus("write", writeResult);
     }
 }
 
@@ -404,7 +446,7 @@ Return<void> StreamOut::prepareForWriting(uint32_t frameSize, uint32_t framesCou
     // Create and launch the thread.
     auto tempWriteThread =
             sp<WriteThread>::make(&mStopWriteThread, mStream, tempCommandMQ.get(), tempDataMQ.get(),
-                                  tempStatusMQ.get(), tempElfGroup.get());
+                                  tempStatusMQ.get(), tempElfGroup.get(), frameSize, &mDataStats);
     if (!tempWriteThread->init()) {
         ALOGW("failed to start writer thread: %s", strerror(-status));
         sendError(Result::INVALID_ARGUMENTS);
@@ -587,6 +629,9 @@ Return<void> StreamOut::getMmapPosition(getMmapPosition_cb _hidl_cb) {
 }
 
 Return<void> StreamOut::debug(const hidl_handle& fd, const hidl_vec<hidl_string>& options) {
+    if (fd.getNativeHandle() != nullptr && fd->numFds == 1) {
+        mDataStats.dump(fd->data[0]);
+    }
     return mStreamCommon->debug(fd, options);
 }
 
@@ -23,6 +23,7 @@
 
 #include "ParametersUtil.h"
 
+#include <atomic>
 #include <vector>
 
 #include <hardware/audio.h>
@@ -132,6 +133,30 @@ struct Stream : public IStream, public ParametersUtil {
      int halSetParameters(const char* keysAndValues) override;
 };
 
+/** Counters of the data transfers between the data message queue and the legacy HAL
+ * stream. They are only updated by the I/O thread, and printed by debug().
+ */
+struct StreamDataStats {
+    // Read or write commands served.
+    std::atomic<uint64_t> transfers{0};
+    // Bytes the HAL accessed directly in the message queue.
+    std::atomic<uint64_t> zeroCopyBytes{0};
+    // Bytes that went through the intermediate buffer of the I/O thread.
+    std::atomic<uint64_t> copiedBytes{0};
+    // Transfers passed to the HAL as two calls because of the queue wraparound.
+    std::atomic<uint64_t> splitTransfers{0};
+    // Transfers where the HAL consumed or produced less than requested.
+    std::atomic<uint64_t> shortTransfers{0};
+    // Output: write commands with an empty queue. Input: reads truncated for lack of space.
+    std::atomic<uint64_t> xruns{0};
+
+    static void add(std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    void dump(int fd) const;
+};
+
 template <typename T>
 struct StreamMmap : public RefBase {
     explicit StreamMmap(T* stream) : mStream(stream) {}
@@ -149,6 +149,7 @@ struct StreamIn : public IStreamIn {
     EventFlag* mEfGroup;
     std::atomic<bool> mStopReadThread;
     sp<Thread> mReadThread;
+    StreamDataStats mDataStats;
 
     virtual ~StreamIn();
 };
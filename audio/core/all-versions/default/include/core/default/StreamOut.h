@@ -179,6 +179,7 @@ struct StreamOut : public IStreamOut {
     EventFlag* mEfGroup;
     std::atomic<bool> mStopWriteThread;
     sp<Thread> mWriteThread;
+    StreamDataStats mDataStats;
 
     virtual ~StreamOut();
 
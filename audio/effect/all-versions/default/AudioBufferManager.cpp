@@ -16,7 +16,9 @@
 
 #include "AudioBufferManager.h"
 
-#include <atomic>
+#include <sys/stat.h>
+
+#include <utility>
 
 #include <hidlmemory/mapping.h>
 
@@ -25,29 +27,116 @@ namespace android {
 ANDROID_SINGLETON_STATIC_INSTANCE(AudioBufferManager);
 
 bool AudioBufferManager::wrap(const AudioBuffer& buffer, sp<AudioBufferWrapper>* wrapper) {
-    // Check if we have this buffer already
-    std::lock_guard<std::mutex> lock(mLock);
-    ssize_t idx = mBuffers.indexOfKey(buffer.id);
-    if (idx >= 0) {
-        *wrapper = mBuffers[idx].promote();
-        if (*wrapper != nullptr) {
-            (*wrapper)->getHalBuffer()->frameCount = buffer.frameCount;
-            return true;
+    // Wrappers may only be released without holding a lock, their destructor takes it.
+    Shard& shard = getShard(buffer.id);
+    sp<AudioBufferWrapper> existing;
+    {
+        std::lock_guard<std::mutex> lock(shard.lock);
+        auto it = shard.buffers.find(buffer.id);
+        if (it != shard.buffers.end()) existing = it->second.promote();
+    }
+    if (existing == nullptr) {
+        // Mapping is slow, so it's done without holding the lock.
+        sp<AudioBufferWrapper> created(new AudioBufferWrapper(buffer));
+        sp<IMemory> memory = takeFromPool(buffer);
+        if (memory != nullptr ? !created->init(memory) : !created->init()) return false;
+        mMappings.fetch_add(memory == nullptr ? 1 : 0, std::memory_order_relaxed);
+        mPoolHits.fetch_add(memory != nullptr ? 1 : 0, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(shard.lock);
+        auto& entry = shard.buffers[buffer.id];
+        // Another thread may have wrapped the same buffer meanwhile.
+        existing = entry.promote();
+        if (existing == nullptr) {
+            entry = created;
+            existing = created;
         }
-        mBuffers.removeItemsAt(idx);
     }
-    // Need to create and init a new AudioBufferWrapper.
-    sp<AudioBufferWrapper> tempBuffer(new AudioBufferWrapper(buffer));
-    if (!tempBuffer->init()) return false;
-    *wrapper = tempBuffer;
-    mBuffers.add(buffer.id, *wrapper);
+    existing->getHalBuffer()->frameCount = buffer.frameCount;
+    *wrapper = existing;
+    mWraps.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool AudioBufferManager::wrap(const std::vector<AudioBuffer>& buffers,
+                              std::vector<sp<AudioBufferWrapper>>* wrappers) {
+    std::vector<sp<AudioBufferWrapper>> result(buffers.size());
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        if (!wrap(buffers[i], &result[i])) return false;
+    }
+    *wrappers = std::move(result);
     return true;
 }
 
-void AudioBufferManager::removeEntry(uint64_t id) {
-    std::lock_guard<std::mutex> lock(mLock);
-    ssize_t idx = mBuffers.indexOfKey(id);
-    if (idx >= 0) mBuffers.removeItemsAt(idx);
+void AudioBufferManager::setPoolCapacity(size_t capacity) {
+    std::list<PooledMapping> evicted;
+    std::lock_guard<std::mutex> lock(mPoolLock);
+    mPoolCapacity = capacity;
+    while (mPool.size() > mPoolCapacity) evicted.splice(evicted.end(), mPool, --mPool.end());
+}
+
+AudioBufferManager::Statistics AudioBufferManager::getStatistics() const {
+    return {mWraps.load(std::memory_order_relaxed), mMappings.load(std::memory_order_relaxed),
+            mPoolHits.load(std::memory_order_relaxed)};
+}
+
+// Buffer ids are chosen by the client and may be reused for a different region,
+// so a pooled mapping also needs to come from the same file as the new buffer.
+bool AudioBufferManager::getFileId(const AudioBuffer& buffer, FileId* fileId) {
+    const native_handle_t* handle = buffer.data.handle();
+    if (handle == nullptr || handle->numFds < 1) return false;
+    struct stat st;
+    if (fstat(handle->data[0], &st) != 0) return false;
+    *fileId = {st.st_dev, st.st_ino};
+    return true;
+}
+
+sp<IMemory> AudioBufferManager::takeFromPool(const AudioBuffer& buffer) {
+    FileId fileId;
+    if (!getFileId(buffer, &fileId)) return nullptr;
+    // Unmapping happens after the pool lock is released.
+    std::list<PooledMapping> evicted;
+    std::lock_guard<std::mutex> lock(mPoolLock);
+    for (auto it = mPool.begin(); it != mPool.end(); ++it) {
+        if (it->buffer.id != buffer.id) continue;
+        if (it->fileId == fileId && it->buffer.data.size() == buffer.data.size() &&
+            it->buffer.data.name() == buffer.data.name()) {
+            sp<IMemory> memory = std::move(it->memory);
+            mPool.erase(it);
+            return memory;
+        }
+        // The id now refers to a different region, the old mapping is stale.
+        evicted.splice(evicted.end(), mPool, it);
+        break;
+    }
+    return nullptr;
+}
+
+void AudioBufferManager::removeEntry(const AudioBufferWrapper* wrapper, AudioBuffer buffer,
+                                     sp<IMemory> memory) {
+    {
+        Shard& shard = getShard(buffer.id);
+        std::lock_guard<std::mutex> lock(shard.lock);
+        auto it = shard.buffers.find(buffer.id);
+        // The entry may already belong to a newer wrapper of the same buffer.
+        if (it != shard.buffers.end() && it->second.unsafe_get() == wrapper) {
+            shard.buffers.erase(it);
+        }
+    }
+    FileId fileId;
+    if (memory == nullptr || !getFileId(buffer, &fileId)) return;
+
+    // Unmapping happens after the pool lock is released.
+    std::list<PooledMapping> evicted;
+    std::lock_guard<std::mutex> lock(mPoolLock);
+    for (auto it = mPool.begin(); it != mPool.end(); ++it) {
+        if (it->buffer.id == buffer.id) {
+            evicted.splice(evicted.end(), mPool, it);
+            break;
+        }
+    }
+    mPool.push_front({std::move(buffer), fileId, std::move(memory)});
+    while (mPool.size() > mPoolCapacity) evicted.splice(evicted.end(), mPool, --mPool.end());
 }
 
 namespace hardware {
@@ -60,15 +149,22 @@ AudioBufferWrapper::AudioBufferWrapper(const AudioBuffer& buffer)
     : mHidlBuffer(buffer), mHalBuffer{0, {nullptr}} {}
 
 AudioBufferWrapper::~AudioBufferWrapper() {
-    AudioBufferManager::getInstance().removeEntry(mHidlBuffer.id);
+    // Only a complete mapping is worth keeping.
+    AudioBufferManager::getInstance().removeEntry(
+            this, std::move(mHidlBuffer),
+            mHalBuffer.raw != nullptr ? std::move(mHidlMemory) : nullptr);
 }
 
 bool AudioBufferWrapper::init() {
+    return init(nullptr);
+}
+
+bool AudioBufferWrapper::init(const sp<IMemory>& memory) {
     if (mHalBuffer.raw != nullptr) {
         ALOGE("An attempt to init AudioBufferWrapper twice");
         return false;
     }
-    mHidlMemory = mapMemory(mHidlBuffer.data);
+    mHidlMemory = memory != nullptr ? memory : mapMemory(mHidlBuffer.data);
     if (mHidlMemory == nullptr) {
         ALOGE("Could not map HIDL memory to IMemory");
         return false;
@@ -19,11 +19,18 @@
 
 #include PATH(android/hardware/audio/effect/FILE_VERSION/types.h)
 
+#include <sys/types.h>
+
+#include <array>
+#include <atomic>
+#include <list>
 #include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <android/hidl/memory/1.0/IMemory.h>
 #include <system/audio_effect.h>
-#include <utils/KeyedVector.h>
 #include <utils/RefBase.h>
 #include <utils/Singleton.h>
 
@@ -42,6 +49,8 @@ class AudioBufferWrapper : public RefBase {
     explicit AudioBufferWrapper(const AudioBuffer& buffer);
     virtual ~AudioBufferWrapper();
     bool init();
+    // Uses a mapping of the same buffer made by an earlier wrapper.
+    bool init(const sp<IMemory>& memory);
     audio_buffer_t* getHalBuffer() { return &mHalBuffer; }
 
    private:
@@ -65,18 +74,63 @@ using ::android::hardware::audio::effect::CPP_VERSION::implementation::AudioBuff
 namespace android {
 
 // This class needs to be in 'android' ns because Singleton macros require that.
+//
+// Wrappers are indexed by buffer id in shards with a lock of their own, so that
+// effects of different sessions don't contend. When the last wrapper of a buffer
+// goes away its mapping is kept in a small LRU pool, as clients tend to set the
+// same buffers again after a reconfiguration.
 class AudioBufferManager : public Singleton<AudioBufferManager> {
    public:
+    static constexpr size_t kDefaultPoolCapacity = 16;
+
+    struct Statistics {
+        uint64_t wraps;     // successful calls to wrap() for a single buffer
+        uint64_t mappings;  // of them, the ones that had to map memory
+        uint64_t poolHits;  // of them, the ones that reused a pooled mapping
+    };
+
     bool wrap(const AudioBuffer& buffer, sp<AudioBufferWrapper>* wrapper);
+    // Wraps either all the buffers or none of them.
+    bool wrap(const std::vector<AudioBuffer>& buffers,
+              std::vector<sp<AudioBufferWrapper>>* wrappers);
+
+    // Mappings beyond the capacity are released right away, 0 disables the pool.
+    void setPoolCapacity(size_t capacity);
+    Statistics getStatistics() const;
 
    private:
     friend class hardware::audio::effect::CPP_VERSION::implementation::AudioBufferWrapper;
 
-    // Called by AudioBufferWrapper.
-    void removeEntry(uint64_t id);
+    static constexpr size_t kShardCount = 16;
 
-    std::mutex mLock;
-    KeyedVector<uint64_t, wp<AudioBufferWrapper>> mBuffers;
+    struct Shard {
+        std::mutex lock;
+        std::unordered_map<uint64_t, wp<AudioBufferWrapper>> buffers;
+    };
+
+    // Identifies the file behind a buffer's fd, as st_dev and st_ino.
+    using FileId = std::pair<dev_t, ino_t>;
+
+    struct PooledMapping {
+        AudioBuffer buffer;
+        FileId fileId;
+        sp<IMemory> memory;
+    };
+
+    // Called by AudioBufferWrapper.
+    void removeEntry(const AudioBufferWrapper* wrapper, AudioBuffer buffer, sp<IMemory> memory);
+
+    Shard& getShard(uint64_t id) { return mShards[id % kShardCount]; }
+    static bool getFileId(const AudioBuffer& buffer, FileId* fileId);
+    sp<IMemory> takeFromPool(const AudioBuffer& buffer);
+
+    std::array<Shard, kShardCount> mShards;
+    std::mutex mPoolLock;
+    std::list<PooledMapping> mPool;               // guarded by mPoolLock, most recent first
+    size_t mPoolCapacity = kDefaultPoolCapacity;  // guarded by mPoolLock
+    std::atomic<uint64_t> mWraps{0};
+    std::atomic<uint64_t> mMappings{0};
+    std::atomic<uint64_t> mPoolHits{0};
 };
 
 }  // namespace android
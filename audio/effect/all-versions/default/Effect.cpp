@@ -26,7 +26,6 @@
 #include <HidlUtils.h>
 #include <android/log.h>
 #include <media/EffectsFactoryApi.h>
-#include <mediautils/ScopedStatistics.h>
 #include <util/EffectUtils.h>
 #include <utils/Trace.h>
 
@@ -45,106 +44,6 @@ using ::android::hardware::audio::common::COMMON_TYPES_CPP_VERSION::implementati
 #endif
 using ::android::hardware::audio::common::COMMON_TYPES_CPP_VERSION::implementation::HidlUtils;
 
-namespace {
-
-#define SCOPED_STATS()                                                       \
-    ::android::mediautils::ScopedStatistics scopedStatistics {               \
-        std::string("EffectHal::").append(__func__), mEffectHal->mStatistics \
-    }
-
-class ProcessThread : public Thread {
-   public:
-    // ProcessThread's lifespan never exceeds Effect's lifespan.
-     ProcessThread(std::atomic<bool>* stop, effect_handle_t effect,
-                   std::atomic<audio_buffer_t*>* inBuffer, std::atomic<audio_buffer_t*>* outBuffer,
-                   Effect::StatusMQ* statusMQ, EventFlag* efGroup, Effect* effectHal)
-         : Thread(false /*canCallJava*/),
-           mStop(stop),
-           mEffect(effect),
-           mHasProcessReverse((*mEffect)->process_reverse != NULL),
-           mInBuffer(inBuffer),
-           mOutBuffer(outBuffer),
-           mStatusMQ(statusMQ),
-           mEfGroup(efGroup),
-           mEffectHal(effectHal) {}
-     virtual ~ProcessThread() {}
-
-   private:
-    std::atomic<bool>* mStop;
-    effect_handle_t mEffect;
-    bool mHasProcessReverse;
-    std::atomic<audio_buffer_t*>* mInBuffer;
-    std::atomic<audio_buffer_t*>* mOutBuffer;
-    Effect::StatusMQ* mStatusMQ;
-    EventFlag* mEfGroup;
-    Effect* const mEffectHal;
-
-    bool threadLoop() override;
-};
-
-bool ProcessThread::threadLoop() {
-    // This implementation doesn't return control back to the Thread until it decides to stop,
-    // as the Thread uses mutexes, and this can lead to priority inversion.
-    while (!std::atomic_load_explicit(mStop, std::memory_order_acquire)) {
-        uint32_t efState = 0;
-        mEfGroup->wait(static_cast<uint32_t>(MessageQueueFlagBits::REQUEST_PROCESS_ALL), &efState);
-        if (!(efState & static_cast<uint32_t>(MessageQueueFlagBits::REQUEST_PROCESS_ALL)) ||
-            (efState & static_cast<uint32_t>(MessageQueueFlagBits::REQUEST_QUIT))) {
-            continue;  // Nothing to do or time to quit.
-        }
-        Result retval = Result::OK;
-        if (efState & static_cast<uint32_t>(MessageQueueFlagBits::REQUEST_PROCESS_REVERSE) &&
-            !mHasProcessReverse) {
-            retval = Result::NOT_SUPPORTED;
-        }
-
-        if (retval == Result::OK) {
-            // affects both buffer pointers and their contents.
-            std::atomic_thread_fence(std::memory_order_acquire);
-            int32_t processResult;
-            audio_buffer_t* inBuffer =
-                std::atomic_load_explicit(mInBuffer, std::memory_order_relaxed);
-            audio_buffer_t* outBuffer =
-                std::atomic_load_explicit(mOutBuffer, std::memory_order_relaxed);
-            if (inBuffer != nullptr && outBuffer != nullptr) {
-                // Time this effect process
-                SCOPED_STATS();
-
-                if (efState & static_cast<uint32_t>(MessageQueueFlagBits::REQUEST_PROCESS)) {
-                    processResult = (*mEffect)->process(mEffect, inBuffer, outBuffer);
-                } else {
-                    processResult = (*mEffect)->process_reverse(mEffect, inBuffer, outBuffer);
-                }
-                std::atomic_thread_fence(std::memory_order_release);
-            } else {
-                ALOGE("processing buffers were not set before calling 'process'");
-                processResult = -ENODEV;
-            }
-            switch (processResult) {
-                case 0:
-                    retval = Result::OK;
-                    break;
-                case -ENODATA:
-                    retval = Result::INVALID_STATE;
-                    break;
-                case -EINVAL:
-                    retval = Result::INVALID_ARGUMENTS;
-                    break;
-                default:
-                    retval = Result::NOT_INITIALIZED;
-            }
-        }
-        if (!mStatusMQ->write(&retval)) {
-            ALOGW("status message queue write failed");
-        }
-        mEfGroup->wake(static_cast<uint32_t>(MessageQueueFlagBits::DONE_PROCESSING));
-    }
-
-    return false;
-}
-
-}  // namespace
-
 // static
 const char* Effect::sContextResultOfCommand = "returned status";
 const char* Effect::sContextCallToCommand = "error";
@@ -175,6 +74,7 @@ Effect::~Effect() {
     ALOGW_IF(status, "Error releasing effect %p: %s", mHandle, strerror(-status));
 #endif
     EffectMap::getInstance().remove(mHandle);
+    EffectChain::unassign(mHandle);
     mHandle = 0;
 }
 
@@ -393,14 +293,27 @@ Return<void> Effect::prepareForProcessing(prepareForProcessing_cb _hidl_cb) {
         return Void();
     }
 
-    // Create and launch the thread.
-    mProcessThread = new ProcessThread(&mStopProcessThread, mHandle, &mHalInBufferPtr,
-                                       &mHalOutBufferPtr, tempStatusMQ.get(), mEfGroup, this);
-    status = mProcessThread->run("effect", PRIORITY_URGENT_AUDIO);
-    if (status != OK) {
-        ALOGW("failed to start effect processing thread: %s", strerror(-status));
-        _hidl_cb(Result::INVALID_ARGUMENTS, MQDescriptorSync<Result>());
-        return Void();
+    // Join the chain of the session, or create and launch a thread of our own.
+    const ProcessingContext context = {mHandle,
+                                       (*mHandle)->process_reverse != NULL,
+                                       &mHalInBufferPtr,
+                                       &mHalOutBufferPtr,
+                                       tempStatusMQ.get(),
+                                       mEfGroup,
+                                       mStatistics};
+    mChain = EffectChain::getForEffect(mHandle);
+    if (mChain != nullptr && !mChain->add(context)) {
+        ALOGW("effect chain is full, processing on a separate thread");
+        mChain.clear();
+    }
+    if (mChain == nullptr) {
+        mProcessThread = new ProcessThread(&mStopProcessThread, context);
+        status = mProcessThread->run("effect", PRIORITY_URGENT_AUDIO);
+        if (status != OK) {
+            ALOGW("failed to start effect processing thread: %s", strerror(-status));
+            _hidl_cb(Result::INVALID_ARGUMENTS, MQDescriptorSync<Result>());
+            return Void();
+        }
     }
 
     mStatusMQ = std::move(tempStatusMQ);
@@ -411,17 +324,13 @@ Return<void> Effect::prepareForProcessing(prepareForProcessing_cb _hidl_cb) {
 Return<Result> Effect::setProcessBuffers(const AudioBuffer& inBuffer,
                                          const AudioBuffer& outBuffer) {
     AudioBufferManager& manager = AudioBufferManager::getInstance();
-    sp<AudioBufferWrapper> tempInBuffer, tempOutBuffer;
-    if (!manager.wrap(inBuffer, &tempInBuffer)) {
-        ALOGE("Could not map memory of the input buffer");
-        return Result::INVALID_ARGUMENTS;
-    }
-    if (!manager.wrap(outBuffer, &tempOutBuffer)) {
-        ALOGE("Could not map memory of the output buffer");
+    std::vector<sp<AudioBufferWrapper>> wrappers;
+    if (!manager.wrap({inBuffer, outBuffer}, &wrappers)) {
+        ALOGE("Could not map memory of the input or output buffer");
         return Result::INVALID_ARGUMENTS;
     }
-    mInBuffer = tempInBuffer;
-    mOutBuffer = tempOutBuffer;
+    mInBuffer = wrappers[0];
+    mOutBuffer = wrappers[1];
     // The processing thread only reads these pointers after waking up by an event flag,
     // so it's OK to update the pair non-atomically.
     mHalInBufferPtr.store(mInBuffer->getHalBuffer(), std::memory_order_release);
@@ -705,7 +614,8 @@ Return<void> Effect::command(uint32_t commandId, const hidl_vec<uint8_t>& data,
         case 'gtid':  // retrieve the tid, used for spatializer priority boost
             if (halDataSize == 0 && resultMaxSize == sizeof(int32_t)) {
                 auto ptid = (int32_t*)resultPtr;
-                ptid[0] = mProcessThread ? mProcessThread->getTid() : -1;
+                ptid[0] = mChain ? mChain->getTid()
+                                 : mProcessThread ? mProcessThread->getTid() : -1;
                 status = OK;
                 break;  // we have handled 'gtid' here.
             }
@@ -781,7 +691,9 @@ Return<Result> Effect::close() {
         return Result::INVALID_STATE;
     }
     mStopProcessThread.store(true, std::memory_order_release);
-    if (mEfGroup) {
+    if (mChain) {
+        mChain->remove(mHandle);
+    } else if (mEfGroup) {
         mEfGroup->wake(static_cast<uint32_t>(MessageQueueFlagBits::REQUEST_QUIT));
     }
 #if MAJOR_VERSION <= 5
@@ -792,6 +704,7 @@ Return<Result> Effect::close() {
     Result retval =
             analyzeStatus("EffectRelease", "", sContextCallFunction, EffectRelease(mHandle));
     EffectMap::getInstance().remove(mHandle);
+    EffectChain::unassign(mHandle);
     return retval;
 #endif
 }
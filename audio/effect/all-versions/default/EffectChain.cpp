@@ -0,0 +1,311 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "EffectHAL"
+#define ATRACE_TAG ATRACE_TAG_AUDIO
+
+#include "EffectChain.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <map>
+#include <utility>
+
+#include <android/log.h>
+#include <mediautils/ScopedStatistics.h>
+#include <utils/Trace.h>
+
+namespace android {
+namespace hardware {
+namespace audio {
+namespace effect {
+namespace CPP_VERSION {
+namespace implementation {
+
+namespace {
+
+constexpr uint32_t kRequestAll = static_cast<uint32_t>(MessageQueueFlagBits::REQUEST_PROCESS_ALL);
+
+#ifdef __NR_futex_waitv
+// One slot is taken by the generation word of the chain.
+constexpr size_t kMaxMembers = FUTEX_WAITV_MAX - 1;
+
+long futexWaitv(struct futex_waitv* waiters, size_t count) {
+    return syscall(__NR_futex_waitv, waiters, count, 0 /*flags*/, nullptr /*timeout*/, 0);
+}
+#else
+constexpr size_t kMaxMembers = 0;
+#endif
+
+// Effects of the same session on the same I/O handle form a chain.
+using ChainKey = std::pair<int32_t, int32_t>;
+
+struct ChainRegistry {
+    std::mutex lock;
+    std::map<effect_handle_t, ChainKey> keys;
+    std::map<ChainKey, wp<EffectChain>> chains;
+};
+
+ChainRegistry& getRegistry() {
+    static ChainRegistry registry;
+    return registry;
+}
+
+}  // namespace
+
+void processRequest(const ProcessingContext& context, uint32_t efState) {
+    Result retval = Result::OK;
+    if (efState & static_cast<uint32_t>(MessageQueueFlagBits::REQUEST_PROCESS_REVERSE) &&
+        !context.hasProcessReverse) {
+        retval = Result::NOT_SUPPORTED;
+    }
+
+    if (retval == Result::OK) {
+        // affects both buffer pointers and their contents.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        int32_t processResult;
+        audio_buffer_t* inBuffer =
+                std::atomic_load_explicit(context.inBuffer, std::memory_order_relaxed);
+        audio_buffer_t* outBuffer =
+                std::atomic_load_explicit(context.outBuffer, std::memory_order_relaxed);
+        if (inBuffer != nullptr && outBuffer != nullptr) {
+            // Time this effect process, under the same name as before chains existed.
+            ::android::mediautils::ScopedStatistics scopedStatistics{
+                    std::string("EffectHal::threadLoop"), context.statistics};
+
+            effect_handle_t effect = context.effect;
+            if (efState & static_cast<uint32_t>(MessageQueueFlagBits::REQUEST_PROCESS)) {
+                processResult = (*effect)->process(effect, inBuffer, outBuffer);
+            } else {
+                processResult = (*effect)->process_reverse(effect, inBuffer, outBuffer);
+            }
+            std::atomic_thread_fence(std::memory_order_release);
+        } else {
+            ALOGE("processing buffers were not set before calling 'process'");
+            processResult = -ENODEV;
+        }
+        switch (processResult) {
+            case 0:
+                retval = Result::OK;
+                break;
+            case -ENODATA:
+                retval = Result::INVALID_STATE;
+                break;
+            case -EINVAL:
+                retval = Result::INVALID_ARGUMENTS;
+                break;
+            default:
+                retval = Result::NOT_INITIALIZED;
+        }
+    }
+    if (!context.statusMQ->write(&retval)) {
+        ALOGW("status message queue write failed");
+    }
+    context.efGroup->wake(static_cast<uint32_t>(MessageQueueFlagBits::DONE_PROCESSING));
+}
+
+bool ProcessThread::threadLoop() {
+    // This implementation doesn't return control back to the Thread until it decides to stop,
+    // as the Thread uses mutexes, and this can lead to priority inversion.
+    while (!std::atomic_load_explicit(mStop, std::memory_order_acquire)) {
+        uint32_t efState = 0;
+        mContext.efGroup->wait(kRequestAll, &efState);
+        if (!(efState & kRequestAll) ||
+            (efState & static_cast<uint32_t>(MessageQueueFlagBits::REQUEST_QUIT))) {
+            continue;  // Nothing to do or time to quit.
+        }
+        processRequest(mContext, efState);
+    }
+
+    return false;
+}
+
+class ChainThread : public Thread {
+   public:
+    // ChainThread's lifespan never exceeds EffectChain's lifespan.
+    explicit ChainThread(EffectChain* chain) : Thread(false /*canCallJava*/), mChain(chain) {}
+    virtual ~ChainThread() {}
+
+   private:
+    EffectChain* const mChain;
+
+    bool threadLoop() override;
+};
+
+bool ChainThread::threadLoop() {
+#ifdef __NR_futex_waitv
+    std::vector<ProcessingContext> members;
+    std::vector<std::atomic<uint32_t>*> words;
+    std::vector<struct futex_waitv> waiters;
+    uint32_t servedGeneration = mChain->mGeneration.load(std::memory_order_acquire) - 1;
+
+    // As in ProcessThread, control only returns to the Thread when it's time to stop.
+    // The lock is only taken after the members have changed.
+    while (!mChain->mStop.load(std::memory_order_acquire)) {
+        const uint32_t generation = mChain->mGeneration.load(std::memory_order_acquire);
+        if (generation != servedGeneration) {
+            std::lock_guard<std::mutex> lock(mChain->mLock);
+            members = mChain->mMembers;
+            words.clear();
+            for (auto& member : members) words.push_back(member.statusMQ->getEventFlagWord());
+            waiters.resize(members.size() + 1);
+            servedGeneration = generation;
+            mChain->mServedGeneration = generation;
+            mChain->mServed.notify_all();
+        }
+
+        bool served = false;
+        for (size_t i = 0; i < members.size(); i++) {
+            // Consumes the request bits like EventFlag::wait does.
+            uint32_t efState = words[i]->fetch_and(~kRequestAll) & kRequestAll;
+            if (efState == 0) continue;
+            served = true;
+            if (efState & static_cast<uint32_t>(MessageQueueFlagBits::REQUEST_QUIT)) continue;
+            processRequest(members[i], efState);
+        }
+        if (served) continue;  // Another request may have arrived meanwhile.
+
+        // Values are read before sleeping, so a request arriving after the read
+        // either changes the value or wakes the thread up.
+        waiters[0] = {generation, reinterpret_cast<uintptr_t>(&mChain->mGeneration), FUTEX_32, 0};
+        bool pending = false;
+        for (size_t i = 0; i < words.size(); i++) {
+            uint32_t value = words[i]->load(std::memory_order_acquire);
+            pending |= (value & kRequestAll) != 0;
+            waiters[i + 1] = {value, reinterpret_cast<uintptr_t>(words[i]), FUTEX_32, 0};
+        }
+        if (pending) continue;
+        if (futexWaitv(waiters.data(), waiters.size()) < 0 && errno != EAGAIN && errno != EINTR) {
+            ALOGE("waiting for effect requests failed: %s", strerror(errno));
+            std::lock_guard<std::mutex> lock(mChain->mLock);
+            mChain->mThreadFailed = true;
+            mChain->mServed.notify_all();
+            return false;
+        }
+    }
+#endif
+    return false;
+}
+
+// static
+bool EffectChain::isSupported() {
+#ifdef __NR_futex_waitv
+    // Without waiters the call fails with EINVAL where it's implemented.
+    static const bool supported = futexWaitv(nullptr, 0) < 0 && errno == EINVAL;
+    return supported;
+#else
+    return false;
+#endif
+}
+
+// static
+void EffectChain::assign(effect_handle_t effect, int32_t session, int32_t ioHandle) {
+    auto& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.lock);
+    registry.keys[effect] = {session, ioHandle};
+}
+
+// static
+void EffectChain::unassign(effect_handle_t effect) {
+    auto& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.lock);
+    registry.keys.erase(effect);
+}
+
+// static
+sp<EffectChain> EffectChain::getForEffect(effect_handle_t effect) {
+    auto& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.lock);
+    auto key = registry.keys.find(effect);
+    if (key == registry.keys.end()) return nullptr;
+    auto& weakChain = registry.chains[key->second];
+    sp<EffectChain> chain = weakChain.promote();
+    if (chain == nullptr) {
+        chain = new EffectChain();
+        weakChain = chain;
+        // Drop the entries of the chains that are gone.
+        for (auto it = registry.chains.begin(); it != registry.chains.end();) {
+            it = it->second.promote() == nullptr ? registry.chains.erase(it) : std::next(it);
+        }
+    }
+    return chain;
+}
+
+EffectChain::EffectChain() {}
+
+EffectChain::~EffectChain() {
+    ATRACE_CALL();
+    mStop.store(true, std::memory_order_release);
+    wakeThread();
+    if (mThread.get()) {
+        ATRACE_NAME("mThread->join");
+        status_t status = mThread->join();
+        ALOGE_IF(status, "effect chain thread exit error: %s", strerror(-status));
+    }
+}
+
+void EffectChain::wakeThread() {
+    mGeneration.fetch_add(1, std::memory_order_acq_rel);
+    syscall(__NR_futex, &mGeneration, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+bool EffectChain::add(const ProcessingContext& context) {
+    std::unique_lock<std::mutex> lock(mLock);
+    if (mThreadFailed || mMembers.size() >= kMaxMembers) return false;
+    if (mThread == nullptr) {
+        sp<Thread> thread = new ChainThread(this);
+        status_t status = thread->run("effect chain", PRIORITY_URGENT_AUDIO);
+        if (status != OK) {
+            ALOGW("failed to start effect chain thread: %s", strerror(-status));
+            return false;
+        }
+        mThread = thread;
+    }
+    mMembers.push_back(context);
+    wakeThread();
+    return true;
+}
+
+void EffectChain::remove(effect_handle_t effect) {
+    std::unique_lock<std::mutex> lock(mLock);
+    auto it = mMembers.begin();
+    while (it != mMembers.end() && it->effect != effect) ++it;
+    if (it == mMembers.end()) return;
+    mMembers.erase(it);
+    wakeThread();
+    // The thread holds on to a copy of the members until it reloads them.
+    const uint32_t generation = mGeneration.load(std::memory_order_acquire);
+    mServed.wait(lock, [&] {
+        return static_cast<int32_t>(mServedGeneration - generation) >= 0 || mThreadFailed;
+    });
+}
+
+pid_t EffectChain::getTid() const {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mThread != nullptr ? mThread->getTid() : -1;
+}
+
+}  // namespace implementation
+}  // namespace CPP_VERSION
+}  // namespace effect
+}  // namespace audio
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_AUDIO_EFFECT_EFFECT_CHAIN_H
+#define ANDROID_HARDWARE_AUDIO_EFFECT_EFFECT_CHAIN_H
+
+#include PATH(android/hardware/audio/effect/FILE_VERSION/types.h)
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fmq/EventFlag.h>
+#include <fmq/MessageQueue.h>
+#include <mediautils/MethodStatistics.h>
+#include <utils/RefBase.h>
+#include <utils/Thread.h>
+
+#include <hardware/audio_effect.h>
+
+namespace android {
+namespace hardware {
+namespace audio {
+namespace effect {
+namespace CPP_VERSION {
+namespace implementation {
+
+using ::android::sp;
+using namespace ::android::hardware::audio::effect::CPP_VERSION;
+
+typedef MessageQueue<Result, kSynchronizedReadWrite> EffectStatusMQ;
+
+// What a processing thread needs to serve the requests of one effect.
+// All pointers are owned by the Effect, which outlives the thread serving it.
+struct ProcessingContext {
+    effect_handle_t effect;
+    bool hasProcessReverse;
+    std::atomic<audio_buffer_t*>* inBuffer;
+    std::atomic<audio_buffer_t*>* outBuffer;
+    EffectStatusMQ* statusMQ;
+    EventFlag* efGroup;
+    std::shared_ptr<mediautils::MethodStatistics<std::string>> statistics;
+};
+
+// Runs the request described by 'efState' and reports the result to the client.
+void processRequest(const ProcessingContext& context, uint32_t efState);
+
+// Serves the requests of a single effect.
+class ProcessThread : public Thread {
+   public:
+    // ProcessThread's lifespan never exceeds Effect's lifespan.
+    ProcessThread(std::atomic<bool>* stop, const ProcessingContext& context)
+        : Thread(false /*canCallJava*/), mStop(stop), mContext(context) {}
+    virtual ~ProcessThread() {}
+
+   private:
+    std::atomic<bool>* mStop;
+    const ProcessingContext mContext;
+
+    bool threadLoop() override;
+};
+
+// Serves the requests of all the effects of a session on one real-time thread.
+//
+// The client protocol is unchanged: every effect keeps its own status queue and
+// event flag. The chain thread sleeps on the event flag words of all its members
+// at once, and runs every pending request back to back before sleeping again.
+// Effects of a session usually process the same buffer in place, which stays hot
+// in the cache of the single thread.
+class EffectChain : public RefBase {
+   public:
+    // Whether the kernel can wait on several event flags at once.
+    static bool isSupported();
+
+    // Makes the effect join the chain of its session when it starts processing.
+    static void assign(effect_handle_t effect, int32_t session, int32_t ioHandle);
+    static void unassign(effect_handle_t effect);
+    // Returns the chain the effect was assigned to, nullptr if none.
+    static sp<EffectChain> getForEffect(effect_handle_t effect);
+
+    EffectChain();
+    virtual ~EffectChain();
+
+    // Returns false if the chain can't take more members.
+    bool add(const ProcessingContext& context);
+    // After this returns, the chain thread doesn't access the effect anymore.
+    void remove(effect_handle_t effect);
+    pid_t getTid() const;
+
+   private:
+    friend class ChainThread;
+
+    mutable std::mutex mLock;
+    std::condition_variable mServed;
+    std::vector<ProcessingContext> mMembers;  // guarded by mLock
+    uint32_t mServedGeneration = 0;           // guarded by mLock
+    sp<Thread> mThread;                       // guarded by mLock
+    bool mThreadFailed = false;               // guarded by mLock
+    // Bumped on every change of mMembers, the chain thread also sleeps on it.
+    std::atomic<uint32_t> mGeneration{0};
+    std::atomic<bool> mStop{false};
+
+    void wakeThread();
+};
+
+}  // namespace implementation
+}  // namespace CPP_VERSION
+}  // namespace effect
+}  // namespace audio
+}  // namespace hardware
+}  // namespace android
+
+#endif  // ANDROID_HARDWARE_AUDIO_EFFECT_EFFECT_CHAIN_H
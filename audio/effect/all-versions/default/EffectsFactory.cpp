@@ -21,6 +21,7 @@
 #include "BassBoostEffect.h"
 #include "DownmixEffect.h"
 #include "Effect.h"
+#include "EffectChain.h"
 #include "EnvironmentalReverbEffect.h"
 #include "EqualizerEffect.h"
 #include "LoudnessEnhancerEffect.h"
@@ -32,6 +33,7 @@
 
 #include <UuidUtils.h>
 #include <android/log.h>
+#include <cutils/properties.h>
 #include <media/EffectsFactoryApi.h>
 #include <system/audio_effects/effect_aec.h>
 #include <system/audio_effects/effect_agc.h>
@@ -55,6 +57,11 @@ namespace implementation {
 
 using ::android::hardware::audio::common::COMMON_TYPES_CPP_VERSION::implementation::UuidUtils;
 
+EffectsFactory::EffectsFactory(bool chainMode)
+    : mChainMode(chainMode && EffectChain::isSupported()) {
+    ALOGW_IF(chainMode && !mChainMode, "effect chains are not supported by the kernel");
+}
+
 // static
 sp<IEffect> EffectsFactory::dispatchEffectInstanceCreation(const effect_descriptor_t& halDescriptor,
                                                            effect_handle_t handle) {
@@ -190,6 +197,7 @@ Return<void> EffectsFactory::createEffectImpl(const Uuid& uuid, int32_t session,
         if (status == OK) {
             effect = dispatchEffectInstanceCreation(halDescriptor, handle);
             effectId = EffectMap::getInstance().add(handle);
+            if (mChainMode) EffectChain::assign(handle, session, ioHandle);
         } else {
             ALOGE("Error querying effect descriptor for %s: %s",
                   UuidUtils::uuidToString(halUuid).c_str(), strerror(-status));
@@ -222,7 +230,10 @@ Return<void> EffectsFactory::debug(const hidl_handle& fd,
 }
 
 IEffectsFactory* HIDL_FETCH_IEffectsFactory(const char* name) {
-    return strcmp(name, "default") == 0 ? new EffectsFactory() : nullptr;
+    return strcmp(name, "default") == 0
+                   ? new EffectsFactory(property_get_bool("ro.vendor.audio.effect.chain_mode",
+                                                          false /*default_value*/))
+                   : nullptr;
 }
 
 }  // namespace implementation
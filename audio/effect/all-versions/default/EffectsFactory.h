@@ -45,6 +45,9 @@ using namespace ::android::hardware::audio::common::COMMON_TYPES_CPP_VERSION;
 using namespace ::android::hardware::audio::effect::CPP_VERSION;
 
 struct EffectsFactory : public IEffectsFactory {
+    // In chain mode, the effects of a session are processed on a shared thread.
+    explicit EffectsFactory(bool chainMode = false);
+
     // Methods from ::android::hardware::audio::effect::CPP_VERSION::IEffectsFactory follow.
     Return<void> getAllDescriptors(getAllDescriptors_cb _hidl_cb) override;
     Return<void> getDescriptor(const Uuid& uuid, getDescriptor_cb _hidl_cb) override;
@@ -65,6 +68,8 @@ struct EffectsFactory : public IEffectsFactory {
                                                       effect_handle_t handle);
     Return<void> createEffectImpl(const Uuid& uuid, int32_t session, int32_t ioHandle,
                                   int32_t device, createEffect_cb _hidl_cb);
+
+    const bool mChainMode;
 };
 
 extern "C" IEffectsFactory* HIDL_FETCH_IEffectsFactory(const char* name);
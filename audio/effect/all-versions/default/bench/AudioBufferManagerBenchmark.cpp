@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures AudioBufferManager the way Effect::setProcessBuffers uses it.
+// BM_WrapHeld wraps buffers whose wrappers are still held by their effect, from
+// several threads at once. BM_Rewrap cycles through more buffers than an effect
+// holds, like a client reconfiguring its effects, with the mapping pool disabled
+// (argument 0) and enabled. BM_WrapBatch wraps an input and output pair at once.
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <vector>
+
+#include <android/hidl/allocator/1.0/IAllocator.h>
+
+#include "AudioBufferManager.h"
+
+using ::android::AudioBufferManager;
+using ::android::sp;
+using ::android::hardware::hidl_memory;
+using ::android::hidl::allocator::V1_0::IAllocator;
+using ::benchmark::Counter;
+using ::benchmark::State;
+
+namespace {
+
+// 20 ms of 48 kHz stereo float.
+constexpr uint32_t kFrames = 960;
+constexpr size_t kBufferSize = kFrames * 2 * sizeof(float);
+
+std::atomic<uint64_t> gNextBufferId{1};
+
+// Allocates buffers the way the framework does, each with a unique id.
+bool allocateBuffers(size_t count, std::vector<AudioBuffer>* buffers) {
+    sp<IAllocator> allocator = IAllocator::getService("ashmem");
+    if (allocator == nullptr) return false;
+    for (size_t i = 0; i < count; ++i) {
+        bool success = false;
+        AudioBuffer buffer;
+        allocator->allocate(kBufferSize, [&](bool s, const hidl_memory& memory) {
+            success = s;
+            buffer.data = memory;
+        });
+        if (!success) return false;
+        buffer.id = gNextBufferId.fetch_add(1);
+        buffer.frameCount = kFrames;
+        buffers->push_back(std::move(buffer));
+    }
+    return true;
+}
+
+void reportMappings(State& state, const AudioBufferManager::Statistics& before) {
+    auto after = AudioBufferManager::getInstance().getStatistics();
+    const double wraps = after.wraps - before.wraps;
+    if (wraps == 0) return;
+    state.counters["mappings_per_wrap"] = (after.mappings - before.mappings) / wraps;
+    state.counters["pool_hits_per_wrap"] = (after.poolHits - before.poolHits) / wraps;
+}
+
+void BM_WrapHeld(State& state) {
+    auto& manager = AudioBufferManager::getInstance();
+    std::vector<AudioBuffer> buffers;
+    std::vector<sp<AudioBufferWrapper>> held;
+    if (!allocateBuffers(2, &buffers) || !manager.wrap(buffers, &held)) {
+        state.SkipWithError("buffer allocation failed");
+        return;
+    }
+    for (auto _ : state) {
+        sp<AudioBufferWrapper> wrapper;
+        if (!manager.wrap(buffers[state.iterations() % buffers.size()], &wrapper)) {
+            state.SkipWithError("wrap failed");
+            return;
+        }
+    }
+    state.counters["wraps_per_second"] = Counter(state.iterations(), Counter::kIsRate);
+}
+
+void BM_Rewrap(State& state) {
+    auto& manager = AudioBufferManager::getInstance();
+    manager.setPoolCapacity(state.range(0));
+    std::vector<AudioBuffer> buffers;
+    if (!allocateBuffers(8, &buffers)) {
+        state.SkipWithError("buffer allocation failed");
+        return;
+    }
+    auto before = manager.getStatistics();
+    for (auto _ : state) {
+        // The previous wrapper is released by the assignment.
+        sp<AudioBufferWrapper> wrapper;
+        for (const auto& buffer : buffers) {
+            if (!manager.wrap(buffer, &wrapper)) {
+                state.SkipWithError("wrap failed");
+                return;
+            }
+        }
+    }
+    reportMappings(state, before);
+    manager.setPoolCapacity(AudioBufferManager::kDefaultPoolCapacity);
+}
+
+void BM_WrapBatch(State& state) {
+    auto& manager = AudioBufferManager::getInstance();
+    std::vector<AudioBuffer> buffers;
+    if (!allocateBuffers(2, &buffers)) {
+        state.SkipWithError("buffer allocation failed");
+        return;
+    }
+    auto before = manager.getStatistics();
+    for (auto _ : state) {
+        std::vector<sp<AudioBufferWrapper>> wrappers;
+        if (!manager.wrap(buffers, &wrappers)) {
+            state.SkipWithError("wrap failed");
+            return;
+        }
+    }
+    reportMappings(state, before);
+}
+
+BENCHMARK(BM_WrapHeld)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_Rewrap)->Arg(0)->Arg(AudioBufferManager::kDefaultPoolCapacity);
+BENCHMARK(BM_WrapBatch);
+
+}  // namespace
+
+BENCHMARK_MAIN();
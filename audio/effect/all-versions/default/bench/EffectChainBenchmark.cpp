@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the time to pass one buffer through 1 to 8 effects of a session the
+// way the framework does it: request processing from each effect in turn over
+// its event flag and wait for its status. The effects apply a gain in place.
+// BM_ThreadPerEffect serves every effect on its own ProcessThread, BM_Chain
+// serves all of them on the thread of one EffectChain.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "EffectChain.h"
+
+using namespace ::android::hardware::audio::effect::CPP_VERSION::implementation;
+using ::android::sp;
+using ::android::hardware::EventFlag;
+using ::benchmark::Counter;
+using ::benchmark::State;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 5 ms of 48 kHz stereo float.
+constexpr size_t kFrames = 240;
+constexpr size_t kChannels = 2;
+
+struct GainEffect {
+    const effect_interface_s* itfe;
+    float gain;
+
+    static int32_t process(effect_handle_t self, audio_buffer_t* in, audio_buffer_t* out) {
+        auto effect = reinterpret_cast<GainEffect*>(self);
+        for (size_t i = 0; i < in->frameCount * kChannels; i++) {
+            out->f32[i] = in->f32[i] * effect->gain;
+        }
+        return 0;
+    }
+};
+
+const effect_interface_s kGainInterface = {.process = GainEffect::process};
+
+// The server side state of an effect, and the event flag of its client.
+struct Member {
+    GainEffect effect{&kGainInterface, 0.999f};
+    std::atomic<audio_buffer_t*> inBuffer;
+    std::atomic<audio_buffer_t*> outBuffer;
+    std::unique_ptr<EffectStatusMQ> statusMQ{new EffectStatusMQ(1, true /*EventFlag*/)};
+    EventFlag* efGroup = nullptr;
+    EventFlag* clientEfGroup = nullptr;
+    std::atomic<bool> stop = false;
+    sp<ProcessThread> thread;
+
+    explicit Member(audio_buffer_t* buffer) : inBuffer(buffer), outBuffer(buffer) {
+        EventFlag::createEventFlag(statusMQ->getEventFlagWord(), &efGroup);
+        EventFlag::createEventFlag(statusMQ->getEventFlagWord(), &clientEfGroup);
+    }
+    ~Member() {
+        EventFlag::deleteEventFlag(&clientEfGroup);
+        EventFlag::deleteEventFlag(&efGroup);
+    }
+
+    ProcessingContext getContext() {
+        return {reinterpret_cast<effect_handle_t>(&effect),
+                false /*hasProcessReverse*/,
+                &inBuffer,
+                &outBuffer,
+                statusMQ.get(),
+                efGroup,
+                nullptr /*statistics*/};
+    }
+
+    // Same as EffectHalHidl::processImpl.
+    bool process() {
+        clientEfGroup->wake(static_cast<uint32_t>(MessageQueueFlagBits::REQUEST_PROCESS));
+        uint32_t efState = 0;
+        while (!(efState & static_cast<uint32_t>(MessageQueueFlagBits::DONE_PROCESSING))) {
+            clientEfGroup->wait(static_cast<uint32_t>(MessageQueueFlagBits::DONE_PROCESSING),
+                                &efState);
+        }
+        Result retval;
+        return statusMQ->read(&retval) && retval == Result::OK;
+    }
+};
+
+void runBuffers(State& state, std::vector<std::unique_ptr<Member>>& members) {
+    std::vector<int64_t> latencies;
+    for (auto _ : state) {
+        auto start = Clock::now();
+        for (auto& member : members) {
+            if (!member->process()) {
+                state.SkipWithError("processing failed");
+                return;
+            }
+        }
+        latencies.push_back(std::chrono::nanoseconds(Clock::now() - start).count());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    state.counters["p50_ns"] = latencies[latencies.size() / 2];
+    state.counters["p99_ns"] = latencies[latencies.size() * 99 / 100];
+    state.counters["max_ns"] = latencies.back();
+    state.counters["buffers_per_second"] = Counter(latencies.size(), Counter::kIsRate);
+}
+
+void BM_ThreadPerEffect(State& state) {
+    std::vector<float> samples(kFrames * kChannels, 1.0f);
+    audio_buffer_t buffer = {kFrames, {samples.data()}};
+    std::vector<std::unique_ptr<Member>> members;
+    for (int64_t i = 0; i < state.range(0); i++) {
+        auto& member = members.emplace_back(new Member(&buffer));
+        member->thread = new ProcessThread(&member->stop, member->getContext());
+        member->thread->run("effect", ::android::PRIORITY_URGENT_AUDIO);
+    }
+
+    runBuffers(state, members);
+
+    for (auto& member : members) {
+        member->stop.store(true, std::memory_order_release);
+        member->clientEfGroup->wake(static_cast<uint32_t>(MessageQueueFlagBits::REQUEST_QUIT));
+        member->thread->join();
+    }
+}
+
+void BM_Chain(State& state) {
+    std::vector<float> samples(kFrames * kChannels, 1.0f);
+    audio_buffer_t buffer = {kFrames, {samples.data()}};
+    std::vector<std::unique_ptr<Member>> members;
+    sp<EffectChain> chain = new EffectChain();
+    for (int64_t i = 0; i < state.range(0); i++) {
+        auto& member = members.emplace_back(new Member(&buffer));
+        if (!chain->add(member->getContext())) {
+            state.SkipWithError("effect chains are not supported");
+            return;
+        }
+    }
+
+    runBuffers(state, members);
+
+    for (auto& member : members) chain->remove(member->getContext().effect);
+}
+
+BENCHMARK(BM_ThreadPerEffect)->DenseRange(1, 8)->UseRealTime();
+BENCHMARK(BM_Chain)->DenseRange(1, 8)->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
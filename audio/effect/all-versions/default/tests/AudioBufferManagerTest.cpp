@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#define LOG_TAG "AudioBufferManager_Test"
+#include <log/log.h>
+
+#include <cutils/ashmem.h>
+#include <cutils/native_handle.h>
+
+#include "AudioBufferManager.h"
+
+using ::android::AudioBufferManager;
+using ::android::sp;
+using ::android::hardware::hidl_memory;
+
+static constexpr size_t kBufferSize = 4096;
+
+class AudioBufferManagerTest : public ::testing::Test {
+  protected:
+    void TearDown() override {
+        for (native_handle_t* handle : mHandles) {
+            native_handle_close(handle);
+            native_handle_delete(handle);
+        }
+    }
+
+    // Creates an ashmem region whose bytes are all |value|. The region is
+    // owned by the test, buffers passed to the manager refer to it.
+    bool createBuffer(uint64_t id, uint8_t value, AudioBuffer* buffer) {
+        int fd = ashmem_create_region("AudioBufferManagerTest", kBufferSize);
+        if (fd < 0) return false;
+        void* data = mmap(nullptr, kBufferSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+        memset(data, value, kBufferSize);
+        munmap(data, kBufferSize);
+        native_handle_t* handle = native_handle_create(1, 0);
+        handle->data[0] = fd;
+        mHandles.push_back(handle);
+        buffer->id = id;
+        buffer->frameCount = kBufferSize / sizeof(float);
+        buffer->data = hidl_memory("ashmem", handle, kBufferSize);
+        return true;
+    }
+
+    static uint8_t firstByte(const sp<AudioBufferWrapper>& wrapper) {
+        return *static_cast<uint8_t*>(wrapper->getHalBuffer()->raw);
+    }
+
+    AudioBufferManager& mManager = AudioBufferManager::getInstance();
+    std::vector<native_handle_t*> mHandles;
+};
+
+TEST_F(AudioBufferManagerTest, ReusesPooledMappingOfSameRegion) {
+    AudioBuffer buffer;
+    ASSERT_TRUE(createBuffer(1000, 0x11, &buffer));
+    sp<AudioBufferWrapper> wrapper;
+    ASSERT_TRUE(mManager.wrap(buffer, &wrapper));
+    wrapper.clear();
+
+    auto before = mManager.getStatistics();
+    ASSERT_TRUE(mManager.wrap(buffer, &wrapper));
+    auto after = mManager.getStatistics();
+    EXPECT_EQ(before.mappings, after.mappings);
+    EXPECT_EQ(before.poolHits + 1, after.poolHits);
+    EXPECT_EQ(0x11, firstByte(wrapper));
+}
+
+TEST_F(AudioBufferManagerTest, MapsRegionReusingIdAndSize) {
+    AudioBuffer first, second;
+    ASSERT_TRUE(createBuffer(2000, 0x11, &first));
+    ASSERT_TRUE(createBuffer(2000, 0x22, &second));
+    ASSERT_EQ(first.data.size(), second.data.size());
+    ASSERT_EQ(first.data.name(), second.data.name());
+
+    sp<AudioBufferWrapper> wrapper;
+    ASSERT_TRUE(mManager.wrap(first, &wrapper));
+    EXPECT_EQ(0x11, firstByte(wrapper));
+    wrapper.clear();
+
+    // The pooled mapping of the first region must not be handed out for the second.
+    auto before = mManager.getStatistics();
+    ASSERT_TRUE(mManager.wrap(second, &wrapper));
+    auto after = mManager.getStatistics();
+    EXPECT_EQ(before.mappings + 1, after.mappings);
+    EXPECT_EQ(before.poolHits, after.poolHits);
+    EXPECT_EQ(0x22, firstByte(wrapper));
+    wrapper.clear();
+
+    // Nor the mapping of the second region for the first.
+    ASSERT_TRUE(mManager.wrap(first, &wrapper));
+    EXPECT_EQ(0x11, firstByte(wrapper));
+}
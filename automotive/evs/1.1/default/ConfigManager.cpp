@@ -16,13 +16,21 @@
 
 #include "ConfigManager.h"
 
+#include <android-base/file.h>
+#include <android-base/unique_fd.h>
 #include <android/hardware/camera/device/3.2/ICameraDevice.h>
 #include <hardware/gralloc.h>
 #include <utils/SystemClock.h>
 
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include <fstream>
 #include <sstream>
 #include <thread>
+#include <type_traits>
 
 namespace android::hardware::automotive::evs::V1_1::implementation {
 
@@ -30,8 +38,190 @@ using namespace std;
 using namespace tinyxml2;
 using hardware::camera::device::V3_2::StreamRotation;
 
+namespace {
+
+/*
+ * Binary snapshot of a parsed configuration
+ *
+ * The snapshot starts with SnapshotHeader, followed by the system
+ * information, display devices and camera positions, which are read when the
+ * snapshot is loaded.  Each camera device or group is stored as a record of
+ * its controls and stream configurations, plus its camera_metadata_t as is;
+ * an index at the end of the file locates them so that they can be read
+ * when a camera is first asked for.  Values are stored in native byte order
+ * since a snapshot is only ever read by the device that wrote it.
+ */
+constexpr uint32_t kSnapshotMagic = 0x43535645;  // "EVSC"
+constexpr uint32_t kSnapshotVersion = 1;
+
+/* camera_metadata_t requires 8-byte alignment */
+constexpr size_t kSnapshotAlignment = 8;
+
+struct SnapshotHeader {
+    uint32_t magic;
+    uint32_t version;
+    int64_t xmlMtimeNs;
+    uint64_t xmlSize;
+    uint64_t xmlHash;
+    uint64_t fileSize;
+    uint64_t indexOffset;
+};
+
+enum SnapshotEntryType : uint8_t {
+    kCameraDevice = 0,
+    kCameraGroup = 1,
+};
+
+/* 64-bit FNV-1a hash of the configuration file */
+uint64_t hashConfigData(const string& data) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const unsigned char c : data) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+class SnapshotWriter {
+  public:
+    template <typename T>
+    void put(const T& value) {
+        static_assert(is_trivially_copyable_v<T>);
+        mBuffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void putString(const string& value) {
+        put<uint32_t>(value.size());
+        mBuffer.append(value);
+    }
+
+    void putBytes(const void* data, size_t size) {
+        mBuffer.append(static_cast<const char*>(data), size);
+    }
+
+    void align() {
+        mBuffer.resize((mBuffer.size() + kSnapshotAlignment - 1) & ~(kSnapshotAlignment - 1));
+    }
+
+    size_t size() const { return mBuffer.size(); }
+    string& buffer() { return mBuffer; }
+
+  private:
+    string mBuffer;
+};
+
+class SnapshotReader {
+  public:
+    SnapshotReader(const uint8_t* data, size_t size) : mPos(data), mEnd(data + size) {}
+
+    template <typename T>
+    bool get(T* value) {
+        static_assert(is_trivially_copyable_v<T>);
+        if (static_cast<size_t>(mEnd - mPos) < sizeof(T)) {
+            return false;
+        }
+        memcpy(value, mPos, sizeof(T));
+        mPos += sizeof(T);
+        return true;
+    }
+
+    bool getString(string* value) {
+        uint32_t len;
+        if (!get(&len) || static_cast<size_t>(mEnd - mPos) < len) {
+            return false;
+        }
+        value->assign(reinterpret_cast<const char*>(mPos), len);
+        mPos += len;
+        return true;
+    }
+
+  private:
+    const uint8_t* mPos;
+    const uint8_t* const mEnd;
+};
+
+void writeStreamConfigurations(SnapshotWriter& writer,
+                               const unordered_map<int32_t, RawStreamConfiguration>& configs) {
+    writer.put<uint32_t>(configs.size());
+    for (auto& [id, cfg] : configs) {
+        writer.put(cfg);
+    }
+}
+
+bool readStreamConfigurations(SnapshotReader& reader,
+                              unordered_map<int32_t, RawStreamConfiguration>* configs) {
+    uint32_t count;
+    if (!reader.get(&count)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        RawStreamConfiguration cfg;
+        if (!reader.get(&cfg)) {
+            return false;
+        }
+        configs->insert_or_assign(cfg[0], cfg);
+    }
+    return true;
+}
+
+}  // namespace
+
 ConfigManager::~ConfigManager() {
-    /* Nothing to do */
+    if (mSnapshot != nullptr) {
+        munmap(const_cast<uint8_t*>(mSnapshot), mSnapshotSize);
+    }
+}
+
+unique_ptr<ConfigManager::CameraGroupInfo>& ConfigManager::getCameraGroupInfo(const string& gid) {
+    lock_guard<mutex> lock(mCacheLock);
+    auto cached = mCachedCameraGroups.find(gid);
+    if (cached != mCachedCameraGroups.end()) {
+        unique_ptr<CameraGroupInfo> aGroup(new CameraGroupInfo());
+        if (!readCachedCameraInfo(aGroup.get(), cached->second, aGroup.get())) {
+            ALOGE("Failed to read camera group %s from the configuration snapshot", gid.c_str());
+            aGroup.reset();
+        }
+        mCachedCameraGroups.erase(cached);
+        mCameraGroupInfos.insert_or_assign(gid, std::move(aGroup));
+    }
+
+    return mCameraGroupInfos[gid];
+}
+
+unique_ptr<ConfigManager::CameraInfo>& ConfigManager::getCameraInfo(
+        const string cameraId) noexcept {
+    lock_guard<mutex> lock(mCacheLock);
+    auto cached = mCachedCameras.find(cameraId);
+    if (cached != mCachedCameras.end()) {
+        unique_ptr<CameraInfo> aCamera(new CameraInfo());
+        if (!readCachedCameraInfo(aCamera.get(), cached->second)) {
+            ALOGE("Failed to read camera %s from the configuration snapshot", cameraId.c_str());
+            aCamera.reset();
+        }
+        mCachedCameras.erase(cached);
+        mCameraInfo.insert_or_assign(cameraId, std::move(aCamera));
+    }
+
+    return mCameraInfo[cameraId];
+}
+
+const camera_metadata_t* ConfigManager::getCameraCharacteristics(const string& cameraId) noexcept {
+    lock_guard<mutex> lock(mCacheLock);
+    auto cached = mCachedCameras.find(cameraId);
+    if (cached != mCachedCameras.end()) {
+        /* refer to the snapshot rather than reading the whole camera entry */
+        if (cached->second.metadataSize == 0) {
+            return nullptr;
+        }
+        return reinterpret_cast<const camera_metadata_t*>(mSnapshot +
+                                                          cached->second.metadataOffset);
+    }
+
+    auto it = mCameraInfo.find(cameraId);
+    if (it == mCameraInfo.end() || !it->second) {
+        return nullptr;
+    }
+    return it->second->characteristics;
 }
 
 void ConfigManager::readCameraInfo(const XMLElement* const aCameraElem) {
@@ -406,13 +596,13 @@ void ConfigManager::readDisplayInfo(const XMLElement* const aDisplayElem) {
     return;
 }
 
-bool ConfigManager::readConfigDataFromXML() noexcept {
+bool ConfigManager::readConfigDataFromXML(const string& xmlData) noexcept {
     XMLDocument xmlDoc;
 
     const int64_t parsingStart = android::elapsedRealtimeNano();
 
-    /* load and parse a configuration file */
-    xmlDoc.LoadFile(mConfigFilePath);
+    /* parse a configuration file */
+    xmlDoc.Parse(xmlData.c_str(), xmlData.size());
     if (xmlDoc.ErrorID() != XML_SUCCESS) {
         ALOGE("Failed to load and/or parse a configuration file, %s", xmlDoc.ErrorStr());
         return false;
@@ -438,6 +628,10 @@ bool ConfigManager::readConfigDataFromXML() noexcept {
     /* parse display information */
     readDisplayInfo(rootElem->FirstChildElement("display"));
 
+    for (auto& [id, info] : mCameraInfo) {
+        mCameraIds.push_back(id);
+    }
+
     const int64_t parsingEnd = android::elapsedRealtimeNano();
     ALOGI("Parsing configuration file takes %lf (ms)",
           (double)(parsingEnd - parsingStart) / 1000000.0);
@@ -445,22 +639,343 @@ bool ConfigManager::readConfigDataFromXML() noexcept {
     return true;
 }
 
-std::unique_ptr<ConfigManager> ConfigManager::Create(const char* path) {
+bool ConfigManager::writeConfigDataToBinary(const char* cachePath,
+                                            const ConfigFileStamp& stamp) const {
+    SnapshotWriter writer;
+    writer.put(SnapshotHeader{});
+
+    /* system information */
+    writer.put(mSystemInfo.numCameras);
+
+    /* display devices */
+    writer.put<uint32_t>(mDisplayInfo.size());
+    for (auto& [id, dpy] : mDisplayInfo) {
+        writer.putString(id);
+        writeStreamConfigurations(writer, dpy->streamConfigurations);
+    }
+
+    /* camera positions */
+    writer.put<uint32_t>(mCameraPosition.size());
+    for (auto& [pos, ids] : mCameraPosition) {
+        writer.putString(pos);
+        writer.put<uint32_t>(ids.size());
+        for (auto& id : ids) {
+            writer.putString(id);
+        }
+    }
+
+    /* camera devices and groups, followed by their index */
+    struct IndexEntry {
+        SnapshotEntryType type;
+        const string* id;
+        CachedCameraEntry entry;
+    };
+    vector<IndexEntry> index;
+    auto writeCamera = [&](SnapshotEntryType type, const string& id, const CameraInfo& aCamera,
+                           const CameraGroupInfo* aGroup) {
+        CachedCameraEntry entry = {};
+        entry.recordOffset = writer.size();
+        writer.put<uint32_t>(aCamera.controls.size());
+        for (auto& [param, range] : aCamera.controls) {
+            writer.put(static_cast<uint32_t>(param));
+            writer.put(get<0>(range));
+            writer.put(get<1>(range));
+            writer.put(get<2>(range));
+        }
+        writeStreamConfigurations(writer, aCamera.streamConfigurations);
+        if (aGroup != nullptr) {
+            writer.put<uint8_t>(aGroup->synchronized);
+            writer.put<uint32_t>(aGroup->devices.size());
+            for (auto& device : aGroup->devices) {
+                writer.putString(device);
+            }
+        }
+        entry.recordSize = writer.size() - entry.recordOffset;
+
+        if (aCamera.characteristics != nullptr) {
+            writer.align();
+            entry.metadataOffset = writer.size();
+            entry.metadataSize = get_camera_metadata_size(aCamera.characteristics);
+            writer.putBytes(aCamera.characteristics, entry.metadataSize);
+        }
+        index.push_back({type, &id, entry});
+    };
+
+    for (auto& id : mCameraIds) {
+        auto it = mCameraInfo.find(id);
+        if (it != mCameraInfo.end() && it->second) {
+            writeCamera(kCameraDevice, id, *it->second, nullptr);
+        }
+    }
+    for (auto& [id, aGroup] : mCameraGroupInfos) {
+        if (aGroup) {
+            writeCamera(kCameraGroup, id, *aGroup, aGroup.get());
+        }
+    }
+
+    writer.align();
+    const size_t indexOffset = writer.size();
+    writer.put<uint32_t>(index.size());
+    for (auto& [type, id, entry] : index) {
+        writer.put(type);
+        writer.putString(*id);
+        writer.put<uint64_t>(entry.recordOffset);
+        writer.put<uint64_t>(entry.recordSize);
+        writer.put<uint64_t>(entry.metadataOffset);
+        writer.put<uint64_t>(entry.metadataSize);
+    }
+
+    SnapshotHeader header = {
+            .magic = kSnapshotMagic,
+            .version = kSnapshotVersion,
+            .xmlMtimeNs = stamp.mtimeNs,
+            .xmlSize = stamp.size,
+            .xmlHash = stamp.hash,
+            .fileSize = writer.size(),
+            .indexOffset = indexOffset,
+    };
+    memcpy(writer.buffer().data(), &header, sizeof(header));
+
+    /* replace the snapshot atomically so that a reader never sees a partial one */
+    const string tmpPath = string(cachePath) + ".tmp";
+    if (!android::base::WriteStringToFile(writer.buffer(), tmpPath)) {
+        ALOGW("Failed to write a configuration snapshot to %s", tmpPath.c_str());
+        return false;
+    }
+    if (rename(tmpPath.c_str(), cachePath) != 0) {
+        ALOGW("Failed to rename a configuration snapshot to %s", cachePath);
+        unlink(tmpPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool ConfigManager::readConfigDataFromBinary(const char* cachePath,
+                                             const ConfigFileStamp& stamp) noexcept {
+    const int64_t readStart = android::elapsedRealtimeNano();
+
+    android::base::unique_fd fd(open(cachePath, O_RDONLY | O_CLOEXEC));
+    if (fd.get() < 0) {
+        ALOGI("No configuration snapshot is found at %s", cachePath);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd.get(), &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+        ALOGW("Configuration snapshot %s is too small", cachePath);
+        return false;
+    }
+
+    const size_t fileSize = st.st_size;
+    void* addr = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+    if (addr == MAP_FAILED) {
+        ALOGW("Failed to map a configuration snapshot %s", cachePath);
+        return false;
+    }
+    mSnapshot = static_cast<const uint8_t*>(addr);
+    mSnapshotSize = fileSize;
+
+    auto fail = [this](const char* reason) {
+        ALOGW("Ignoring a configuration snapshot: %s", reason);
+        munmap(const_cast<uint8_t*>(mSnapshot), mSnapshotSize);
+        mSnapshot = nullptr;
+        mSnapshotSize = 0;
+        mSystemInfo = {};
+        mDisplayInfo.clear();
+        mCameraPosition.clear();
+        mCameraIds.clear();
+        mCachedCameras.clear();
+        mCachedCameraGroups.clear();
+        return false;
+    };
+
+    SnapshotHeader header;
+    memcpy(&header, mSnapshot, sizeof(header));
+    if (header.magic != kSnapshotMagic || header.version != kSnapshotVersion) {
+        return fail("unknown format");
+    }
+    if (header.xmlMtimeNs != stamp.mtimeNs || header.xmlSize != stamp.size ||
+        header.xmlHash != stamp.hash) {
+        return fail("configuration file has changed");
+    }
+    if (header.fileSize != fileSize || header.indexOffset > fileSize) {
+        return fail("truncated");
+    }
+
+    SnapshotReader reader(mSnapshot + sizeof(header), header.indexOffset - sizeof(header));
+
+    /* system information */
+    if (!reader.get(&mSystemInfo.numCameras)) {
+        return fail("malformed system information");
+    }
+
+    /* display devices */
+    uint32_t count;
+    if (!reader.get(&count)) {
+        return fail("malformed display information");
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        string id;
+        unique_ptr<DisplayInfo> dpy(new DisplayInfo());
+        if (!reader.getString(&id) ||
+            !readStreamConfigurations(reader, &dpy->streamConfigurations)) {
+            return fail("malformed display information");
+        }
+        mDisplayInfo.insert_or_assign(id, std::move(dpy));
+    }
+
+    /* camera positions */
+    if (!reader.get(&count)) {
+        return fail("malformed camera positions");
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        string pos;
+        uint32_t numIds;
+        if (!reader.getString(&pos) || !reader.get(&numIds)) {
+            return fail("malformed camera positions");
+        }
+        for (uint32_t j = 0; j < numIds; ++j) {
+            string id;
+            if (!reader.getString(&id)) {
+                return fail("malformed camera positions");
+            }
+            mCameraPosition[pos].emplace(id);
+        }
+    }
+
+    /* camera index */
+    SnapshotReader indexReader(mSnapshot + header.indexOffset, fileSize - header.indexOffset);
+    if (!indexReader.get(&count)) {
+        return fail("malformed camera index");
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        SnapshotEntryType type;
+        string id;
+        uint64_t recordOffset, recordSize, metadataOffset, metadataSize;
+        if (!indexReader.get(&type) || !indexReader.getString(&id) ||
+            !indexReader.get(&recordOffset) || !indexReader.get(&recordSize) ||
+            !indexReader.get(&metadataOffset) || !indexReader.get(&metadataSize)) {
+            return fail("malformed camera index");
+        }
+        if (recordOffset > fileSize || recordSize > fileSize - recordOffset ||
+            metadataOffset > fileSize || metadataSize > fileSize - metadataOffset ||
+            metadataOffset % kSnapshotAlignment != 0) {
+            return fail("camera entry out of bounds");
+        }
+        if (metadataSize > 0) {
+            size_t expectedSize = metadataSize;
+            if (validate_camera_metadata_structure(
+                        reinterpret_cast<const camera_metadata_t*>(mSnapshot + metadataOffset),
+                        &expectedSize) != 0) {
+                return fail("malformed camera metadata");
+            }
+        }
+
+        const CachedCameraEntry entry = {recordOffset, recordSize, metadataOffset, metadataSize};
+        if (type == kCameraDevice) {
+            mCameraIds.push_back(id);
+            mCachedCameras.insert_or_assign(id, entry);
+        } else if (type == kCameraGroup) {
+            mCachedCameraGroups.insert_or_assign(id, entry);
+        } else {
+            return fail("unknown camera entry");
+        }
+    }
+
+    const int64_t readEnd = android::elapsedRealtimeNano();
+    ALOGI("Reading configuration snapshot takes %lf (ms)",
+          (double)(readEnd - readStart) / 1000000.0);
+
+    return true;
+}
+
+bool ConfigManager::readCachedCameraInfo(CameraInfo* aCamera, const CachedCameraEntry& entry,
+                                         CameraGroupInfo* aGroup) {
+    SnapshotReader reader(mSnapshot + entry.recordOffset, entry.recordSize);
+
+    uint32_t count;
+    if (!reader.get(&count)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t param;
+        int32_t minVal, maxVal, stepVal;
+        if (!reader.get(&param) || !reader.get(&minVal) || !reader.get(&maxVal) ||
+            !reader.get(&stepVal)) {
+            return false;
+        }
+        aCamera->controls.emplace(static_cast<CameraParam>(param),
+                                  make_tuple(minVal, maxVal, stepVal));
+    }
+
+    if (!readStreamConfigurations(reader, &aCamera->streamConfigurations)) {
+        return false;
+    }
+
+    if (aGroup != nullptr) {
+        uint8_t synchronized;
+        if (!reader.get(&synchronized) || !reader.get(&count)) {
+            return false;
+        }
+        aGroup->synchronized = synchronized;
+        for (uint32_t i = 0; i < count; ++i) {
+            string device;
+            if (!reader.getString(&device)) {
+                return false;
+            }
+            aGroup->devices.emplace(device);
+        }
+    }
+
+    if (entry.metadataSize > 0) {
+        aCamera->characteristics = allocate_copy_camera_metadata_checked(
+                reinterpret_cast<const camera_metadata_t*>(mSnapshot + entry.metadataOffset),
+                entry.metadataSize);
+        if (aCamera->characteristics == nullptr) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::unique_ptr<ConfigManager> ConfigManager::Create(const char* path, const char* cachePath) {
     unique_ptr<ConfigManager> cfgMgr(new ConfigManager(path));
 
+    /* identify the configuration file so that a snapshot of it can be validated */
+    string xmlData;
+    struct stat st;
+    if (stat(path, &st) != 0 || !android::base::ReadFileToString(path, &xmlData)) {
+        ALOGE("Failed to read a configuration file %s", path);
+        return nullptr;
+    }
+    const ConfigFileStamp stamp = {
+            .mtimeNs = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec,
+            .size = xmlData.size(),
+            .hash = hashConfigData(xmlData),
+    };
+
     /*
-     * Read a configuration from XML file
-     *
-     * If this is too slow, ConfigManager::readConfigDataFromBinary() and
-     * ConfigManager::writeConfigDataToBinary()can serialize CameraInfo object
-     * to the filesystem and construct CameraInfo instead; this was
-     * evaluated as 10x faster.
+     * Read a configuration from a binary snapshot if one is made from the
+     * same XML file; camera entries are only read when a camera is opened.
+     * Otherwise, read a configuration from XML file and store a snapshot of
+     * it for the next time.
      */
-    if (!cfgMgr->readConfigDataFromXML()) {
-        return nullptr;
-    } else {
+    const bool useSnapshot = cachePath != nullptr && cachePath[0] != '\0';
+    if (useSnapshot && cfgMgr->readConfigDataFromBinary(cachePath, stamp)) {
         return cfgMgr;
     }
+
+    if (!cfgMgr->readConfigDataFromXML(xmlData)) {
+        return nullptr;
+    }
+
+    if (useSnapshot && !cfgMgr->writeConfigDataToBinary(cachePath, stamp)) {
+        ALOGW("Configuration will be read from XML file again on next start");
+    }
+
+    return cfgMgr;
 }
 
 }  // namespace android::hardware::automotive::evs::V1_1::implementation
@@ -23,6 +23,7 @@
 #include <system/camera_metadata.h>
 #include <tinyxml2.h>
 
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -44,7 +45,20 @@ typedef std::array<int32_t, kStreamCfgSz> RawStreamConfiguration;
 
 class ConfigManager {
   public:
-    static std::unique_ptr<ConfigManager> Create(const char* path = "");
+    /*
+     * Create a configuration manager
+     *
+     * @param  path
+     *         A path to XML configuration file.
+     * @param  cachePath
+     *         A path to a binary snapshot of the parsed configuration.  If
+     *         the snapshot matches the XML file, camera entries are read from
+     *         it when they are first asked for instead of parsing the XML
+     *         file; otherwise, the XML file is parsed and the snapshot is
+     *         written again.  No snapshot is used if this is empty.
+     */
+    static std::unique_ptr<ConfigManager> Create(const char* path = "",
+                                                 const char* cachePath = "");
     ConfigManager(const ConfigManager&) = delete;
     ConfigManager& operator=(const ConfigManager&) = delete;
 
@@ -88,7 +102,12 @@ class ConfigManager {
         std::unordered_map<camera_metadata_tag_t, std::pair<std::unique_ptr<void*>, size_t>>
                 cameraMetadata;
 
-        /* Camera module characteristics */
+        /*
+         * Camera module characteristics
+         *
+         * Please note that cameraMetadata above is only filled when the
+         * camera is read from XML; this is complete either way.
+         */
         camera_metadata_t* characteristics;
     };
 
@@ -134,14 +153,7 @@ class ConfigManager {
      * @return std::vector<std::string>
      *         A vector that contains unique camera device identifiers.
      */
-    std::vector<std::string> getCameraList() {
-        std::vector<std::string> aList;
-        for (auto& v : mCameraInfo) {
-            aList.push_back(v.first);
-        }
-
-        return aList;
-    }
+    std::vector<std::string> getCameraList() { return mCameraIds; }
 
     /*
      * Return a list of cameras
@@ -149,9 +161,7 @@ class ConfigManager {
      * @return CameraGroupInfo
      *         A pointer to a camera group identified by a given id.
      */
-    std::unique_ptr<CameraGroupInfo>& getCameraGroupInfo(const std::string& gid) {
-        return mCameraGroupInfos[gid];
-    }
+    std::unique_ptr<CameraGroupInfo>& getCameraGroupInfo(const std::string& gid);
 
     /*
      * Return a camera metadata
@@ -164,14 +174,41 @@ class ConfigManager {
      *         ID.  This returns a null pointer if this does not recognize a
      *         given camera identifier.
      */
-    std::unique_ptr<CameraInfo>& getCameraInfo(const std::string cameraId) noexcept {
-        return mCameraInfo[cameraId];
-    }
+    std::unique_ptr<CameraInfo>& getCameraInfo(const std::string cameraId) noexcept;
+
+    /*
+     * Return camera characteristics without reading the rest of the camera
+     * information if it comes from a binary snapshot
+     *
+     * @param  cameraId
+     *         Unique camera node identifier in std::string
+     *
+     * @return const camera_metadata_t*
+     *         Camera characteristics that remain valid as long as this
+     *         object does, or a null pointer if this does not recognize a
+     *         given camera identifier.
+     */
+    const camera_metadata_t* getCameraCharacteristics(const std::string& cameraId) noexcept;
 
   private:
     /* Constructors */
     ConfigManager(const char* xmlPath) : mConfigFilePath(xmlPath) {}
 
+    /* Location of a camera entry in a binary snapshot that is not read yet */
+    struct CachedCameraEntry {
+        size_t recordOffset;
+        size_t recordSize;
+        size_t metadataOffset;
+        size_t metadataSize;
+    };
+
+    /* Identity of the XML configuration file a binary snapshot is made from */
+    struct ConfigFileStamp {
+        int64_t mtimeNs;
+        uint64_t size;
+        uint64_t hash;
+    };
+
     /* System configuration */
     SystemInfo mSystemInfo;
 
@@ -193,6 +230,24 @@ class ConfigManager {
     /* A path to XML configuration file */
     const char* mConfigFilePath;
 
+    /* Camera device identifiers in the order they are configured */
+    std::vector<std::string> mCameraIds;
+
+    /*
+     * Camera devices and groups that are in the binary snapshot but not read
+     * yet; they are moved to mCameraInfo and mCameraGroupInfos as they are
+     * asked for.
+     */
+    std::unordered_map<std::string, CachedCameraEntry> mCachedCameras;
+    std::unordered_map<std::string, CachedCameraEntry> mCachedCameraGroups;
+
+    /* Read-only mapping of the binary snapshot */
+    const uint8_t* mSnapshot = nullptr;
+    size_t mSnapshotSize = 0;
+
+    /* Serializes reading camera entries from the binary snapshot */
+    std::mutex mCacheLock;
+
     /*
      * Parse a given EVS configuration file and store the information
      * internally.
@@ -200,7 +255,53 @@ class ConfigManager {
      * @return bool
      *         True if it completes parsing a file successfully.
      */
-    bool readConfigDataFromXML() noexcept;
+    bool readConfigDataFromXML(const std::string& xmlData) noexcept;
+
+    /*
+     * Map a binary snapshot and read everything but camera entries from it.
+     *
+     * @param  cachePath
+     *         A path to the binary snapshot.
+     * @param  stamp
+     *         Identity of the XML configuration file the snapshot must have
+     *         been made from.
+     *
+     * @return bool
+     *         False if the snapshot does not exist, is malformed or is made
+     *         from a different configuration file.
+     */
+    bool readConfigDataFromBinary(const char* cachePath, const ConfigFileStamp& stamp) noexcept;
+
+    /*
+     * Write a binary snapshot of the configuration parsed from XML.
+     *
+     * @param  cachePath
+     *         A path to the binary snapshot.
+     * @param  stamp
+     *         Identity of the XML configuration file.
+     *
+     * @return bool
+     *         True if the snapshot is written successfully.
+     */
+    bool writeConfigDataToBinary(const char* cachePath, const ConfigFileStamp& stamp) const;
+
+    /*
+     * Read a camera device or group from the binary snapshot
+     *
+     * @param  aCamera
+     *         A pointer to CameraInfo that will be completed by this
+     *         method.
+     * @param  entry
+     *         Location of the camera entry in the snapshot.
+     * @param  aGroup
+     *         If not null, the same object as aCamera, to read group
+     *         information into.
+     *
+     * @return bool
+     *         False if the entry is malformed.
+     */
+    bool readCachedCameraInfo(CameraInfo* aCamera, const CachedCameraEntry& entry,
+                              CameraGroupInfo* aGroup = nullptr);
 
     /*
      * read the information of the vehicle
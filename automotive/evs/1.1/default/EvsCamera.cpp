@@ -18,10 +18,16 @@
 #include "ConfigManager.h"
 #include "EvsEnumerator.h"
 
+#include <FramePacer.h>
 #include <ui/GraphicBufferAllocator.h>
 #include <ui/GraphicBufferMapper.h>
 #include <utils/SystemClock.h>
 
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <algorithm>
+
 namespace {
 
 // Arbitrary limit on number of graphics buffers allowed to be allocated
@@ -31,18 +37,10 @@ constexpr unsigned kMaxBuffersInFlight = 100;
 // Minimum number of buffers to run a video stream
 constexpr int kMinimumBuffersInFlight = 1;
 
-// Colors for the colorbar test pattern in ABGR format
-constexpr uint32_t kColors[] = {
-        0xFFFFFFFF,  // white
-        0xFF00FFFF,  // yellow
-        0xFFFFFF00,  // cyan
-        0xFF00FF00,  // green
-        0xFFFF00FF,  // fuchsia
-        0xFF0000FF,  // red
-        0xFFFF0000,  // blue
-        0xFF000000,  // black
-};
-constexpr uint32_t kNumColors = sizeof(kColors) / sizeof(kColors[0]);
+// We arbitrarily choose to generate frames at 15 fps to ensure we pass the 10fps test
+// requirement
+constexpr int kTargetFrameRate = 15;
+constexpr nsecs_t kTargetFrameIntervalNs = 1'000'000'000 / kTargetFrameRate;
 
 }  // namespace
 
@@ -535,10 +533,13 @@ unsigned EvsCamera::decreaseAvailableFrames_Locked(unsigned numToRemove) {
 void EvsCamera::generateFrames() {
     ALOGD("Frame generation loop started");
 
+    common::FramePacer pacer(kTargetFrameIntervalNs);
+    pacer.start();
+    mFrameNumber = 0;
+
     unsigned idx;
     while (true) {
         bool timeForFrame = false;
-        nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
 
         // Lock scope for updating shared state
         {
@@ -549,10 +550,13 @@ void EvsCamera::generateFrames() {
                 break;
             }
 
+            mFramePattern = mPattern;
+
             // Are we allowed to issue another buffer?
             if (mFramesInUse >= mFramesAllowed) {
                 // Can't do anything right now -- skip this frame
                 ALOGW("Skipped a frame because too many are in flight\n");
+                mFrameStats.framesDropped++;
             } else {
                 // Identify an available buffer to fill
                 for (idx = 0; idx < mBuffers.size(); idx++) {
@@ -566,6 +570,7 @@ void EvsCamera::generateFrames() {
                 if (idx >= mBuffers.size()) {
                     // This shouldn't happen since we already checked mFramesInUse vs mFramesAllowed
                     ALOGE("Failed to find an available buffer slot\n");
+                    mFrameStats.framesDropped++;
                 } else {
                     // We're going to make the frame busy
                     mBuffers[idx].inUse = true;
@@ -593,7 +598,16 @@ void EvsCamera::generateFrames() {
             newBuffer.timestamp = elapsedRealtimeNano() * 1e+3;  // timestamps is in microseconds
 
             // Write test data into the image buffer
+            const nsecs_t fillStart = systemTime(SYSTEM_TIME_MONOTONIC);
             fillTestFrame(newBuffer);
+            const nsecs_t fillTime = systemTime(SYSTEM_TIME_MONOTONIC) - fillStart;
+            {
+                std::lock_guard<std::mutex> lock(mAccessLock);
+                mFrameStats.framesGenerated++;
+                mFrameStats.totalFillTimeNs += fillTime;
+                mFrameStats.lastFillTimeNs = fillTime;
+                mFrameStats.maxFillTimeNs = std::max(mFrameStats.maxFillTimeNs, fillTime);
+            }
 
             // Issue the (asynchronous) callback to the client -- can't be holding the lock
             auto result = mStream->deliverFrame_1_1({newBuffer});
@@ -616,15 +630,11 @@ void EvsCamera::generateFrames() {
             }
         }
 
-        // We arbitrarily choose to generate frames at 15 fps to ensure we pass the 10fps test
-        // requirement
-        static const int kTargetFrameRate = 15;
-        static const nsecs_t kTargetFrameIntervalUs = 1000 * 1000 / kTargetFrameRate;
-        const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
-        const nsecs_t elapsedTimeUs = (now - startTime) / 1000;
-        const nsecs_t sleepDurationUs = kTargetFrameIntervalUs - elapsedTimeUs;
-        if (sleepDurationUs > 0) {
-            usleep(sleepDurationUs);
+        // Sleep until the next frame is due
+        mFrameNumber++;
+        if (!pacer.waitForNextFrame()) {
+            std::lock_guard<std::mutex> lock(mAccessLock);
+            mFrameStats.missedDeadlines++;
         }
     }
 
@@ -655,16 +665,9 @@ void EvsCamera::fillTestFrame(const BufferDesc& buff) {
         return;
     }
 
-    // Fill in the test pixels; the colorbar in ABGR format
-    for (unsigned row = 0; row < pDesc->height; row++) {
-        for (unsigned col = 0; col < pDesc->width; col++) {
-            const uint32_t index = col * kNumColors / pDesc->width;
-            pixels[col] = kColors[index];
-        }
-        // Point to the next row
-        // NOTE:  stride retrieved from gralloc is in units of pixels
-        pixels = pixels + pDesc->stride;
-    }
+    // Fill in the test pixels in ABGR format
+    mTestPattern.fill(pixels, pDesc->width, pDesc->height, pDesc->stride, mFramePattern,
+                      mFrameNumber);
 
     // Release our output buffer
     mapper.unlock(buff.buffer.nativeHandle);
@@ -691,6 +694,44 @@ void EvsCamera::fillTestFrame(const V1_0::BufferDesc& buff) {
     return fillTestFrame(newBuffer);
 }
 
+Return<void> EvsCamera::debug(const hidl_handle& fd, const hidl_vec<hidl_string>& options) {
+    if (fd.getNativeHandle() == nullptr || fd->numFds < 1) {
+        ALOGE("%s: Invalid parameters", __FUNCTION__);
+        return {};
+    }
+    const int fdNum = fd->data[0];
+
+    std::lock_guard<std::mutex> lock(mAccessLock);
+    if (options.size() > 0 && options[0] == "--pattern") {
+        const auto pattern = options.size() > 1
+                                     ? TestPatternGenerator::parsePattern(options[1].c_str())
+                                     : std::nullopt;
+        if (!pattern) {
+            dprintf(fdNum, "Usage: --pattern colorbars|moving\n");
+            return {};
+        }
+        mPattern = *pattern;
+        dprintf(fdNum, "Camera %s: test pattern set to %s\n",
+                mDescription.v1.cameraId.c_str(), TestPatternGenerator::patternName(mPattern));
+        return {};
+    }
+
+    const auto& stats = mFrameStats;
+    const nsecs_t averageFillTimeNs =
+            stats.framesGenerated > 0 ? stats.totalFillTimeNs / stats.framesGenerated : 0;
+    dprintf(fdNum,
+            "Camera %s: %ux%u, %s pattern at %d fps\n"
+            "    frames generated: %" PRIu64 ", dropped: %" PRIu64 ", missed deadlines: %" PRIu64
+            "\n"
+            "    fill time (us): last %" PRId64 ", average %" PRId64 ", max %" PRId64 "\n",
+            mDescription.v1.cameraId.c_str(), mWidth, mHeight,
+            TestPatternGenerator::patternName(mPattern), kTargetFrameRate,
+            stats.framesGenerated, stats.framesDropped, stats.missedDeadlines,
+            ns2us(stats.lastFillTimeNs),
+            ns2us(averageFillTimeNs), ns2us(stats.maxFillTimeNs));
+    return {};
+}
+
 void EvsCamera::returnBufferLocked(const uint32_t bufferId, const buffer_handle_t memHandle) {
     if (memHandle == nullptr) {
         ALOGE("ignoring doneWithFrame called with null handle");
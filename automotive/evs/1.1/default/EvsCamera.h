@@ -18,6 +18,7 @@
 #define ANDROID_HARDWARE_AUTOMOTIVE_EVS_V1_1_EVSCAMERA_H
 
 #include "ConfigManager.h"
+#include "TestPatternGenerator.h"
 
 #include <android/hardware/automotive/evs/1.1/IEvsCamera.h>
 #include <android/hardware/automotive/evs/1.1/IEvsCameraStream.h>
@@ -67,6 +68,12 @@ class EvsCamera : public IEvsCamera {
     Return<void> importExternalBuffers(const hidl_vec<BufferDesc>& buffers,
                                        importExternalBuffers_cb _hidl_cb) override;
 
+    // Methods from ::android.hidl.base::V1_0::IBase follow.
+    //
+    // "--pattern colorbars|moving" selects the test pattern, and any other options dump the
+    // frame generation statistics.
+    Return<void> debug(const hidl_handle& fd, const hidl_vec<hidl_string>& options) override;
+
     static sp<EvsCamera> Create(const char* deviceName);
     static sp<EvsCamera> Create(const char* deviceName,
                                 std::unique_ptr<ConfigManager::CameraInfo>& camInfo,
@@ -134,6 +141,26 @@ class EvsCamera : public IEvsCamera {
     // For the extended info
     std::unordered_map<uint32_t, hidl_vec<uint8_t>> mExtInfo;
     std::unordered_map<CameraParam, int32_t> mParams;
+
+    // Test pattern requested through debug(), protected by mAccessLock
+    TestPatternGenerator::Pattern mPattern = TestPatternGenerator::Pattern::kColorBars;
+
+    // Frame generation statistics reported by debug(), protected by mAccessLock
+    struct FrameStats {
+        uint64_t framesGenerated = 0;
+        uint64_t framesDropped = 0;  // No free buffer when a frame was due
+        uint64_t missedDeadlines = 0;
+        nsecs_t totalFillTimeNs = 0;
+        nsecs_t lastFillTimeNs = 0;
+        nsecs_t maxFillTimeNs = 0;
+    };
+    FrameStats mFrameStats;
+
+    // Only used by mCaptureThread: the generator, and the pattern and frame number of the frame
+    // being generated
+    TestPatternGenerator mTestPattern;
+    TestPatternGenerator::Pattern mFramePattern = TestPatternGenerator::Pattern::kColorBars;
+    uint64_t mFrameNumber = 0;
 };
 
 }  // namespace android::hardware::automotive::evs::V1_1::implementation
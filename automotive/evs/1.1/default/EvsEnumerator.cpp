@@ -19,6 +19,8 @@
 #include "EvsDisplay.h"
 #include "EvsUltrasonicsArray.h"
 
+#include <stdio.h>
+
 using android::frameworks::automotive::display::V1_0::IAutomotiveDisplayProxyService;
 using android::hardware::automotive::evs::V1_0::EvsResult;
 
@@ -43,15 +45,18 @@ EvsEnumerator::EvsEnumerator(sp<IAutomotiveDisplayProxyService>& windowService)
     // Add sample camera data to our list of cameras
     // In a real driver, this would be expected to can the available hardware
     sConfigManager =
-            ConfigManager::Create("/vendor/etc/automotive/evs/evs_default_configuration.xml");
+            ConfigManager::Create("/vendor/etc/automotive/evs/evs_default_configuration.xml",
+                                  "/data/vendor/automotive/evs/evs_configuration.bin");
 
-    // Add available cameras
+    // Add available cameras; the rest of the camera information is read when
+    // a camera is opened.
     for (auto v : sConfigManager->getCameraList()) {
         CameraRecord rec(v.data());
-        std::unique_ptr<ConfigManager::CameraInfo>& pInfo = sConfigManager->getCameraInfo(v);
-        if (pInfo) {
-            rec.desc.metadata.setToExternal(reinterpret_cast<uint8_t*>(pInfo->characteristics),
-                                            get_camera_metadata_size(pInfo->characteristics));
+        const camera_metadata_t* characteristics = sConfigManager->getCameraCharacteristics(v);
+        if (characteristics != nullptr) {
+            rec.desc.metadata.setToExternal(
+                    reinterpret_cast<uint8_t*>(const_cast<camera_metadata_t*>(characteristics)),
+                    get_camera_metadata_size(characteristics));
         }
         sCameraList.push_back(std::move(rec));
     }
@@ -429,4 +434,34 @@ Return<void> EvsEnumerator::closeUltrasonicsArray(
     return {};
 }
 
+Return<void> EvsEnumerator::debug(const hidl_handle& fd, const hidl_vec<hidl_string>& options) {
+    if (fd.getNativeHandle() == nullptr || fd->numFds < 1) {
+        ALOGE("%s: Invalid parameters", __FUNCTION__);
+        return {};
+    }
+
+    // Only the enumerator is registered with the service manager, so pass the request on to
+    // every camera and ultrasonics array that is currently open.
+    bool anyActive = false;
+    for (auto&& cam : sCameraList) {
+        sp<EvsCamera> pActiveCamera = cam.activeInstance.promote();
+        if (pActiveCamera != nullptr) {
+            pActiveCamera->debug(fd, options);
+            anyActive = true;
+        }
+    }
+    for (auto&& array : sUltrasonicsArrayRecordList) {
+        sp<EvsUltrasonicsArray> pActiveArray = array.activeInstance.promote();
+        if (pActiveArray != nullptr) {
+            pActiveArray->debug(fd, options);
+            anyActive = true;
+        }
+    }
+    if (!anyActive) {
+        dprintf(fd->data[0], "No camera or ultrasonics array is open\n");
+    }
+
+    return {};
+}
+
 }  // namespace android::hardware::automotive::evs::V1_1::implementation
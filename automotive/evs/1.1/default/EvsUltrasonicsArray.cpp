@@ -16,9 +16,12 @@
 
 #include "EvsUltrasonicsArray.h"
 
+#include <FramePacer.h>
 #include <android-base/logging.h>
 #include <hidlmemory/mapping.h>
+#include <inttypes.h>
 #include <log/log.h>
+#include <stdio.h>
 #include <time.h>
 #include <utils/SystemClock.h>
 #include <utils/Timers.h>
@@ -37,11 +40,13 @@ const unsigned int kMaximumDataFramesInFlight = 100;
 const uint32_t kMaxReadingsPerSensor = 5;
 const uint32_t kMaxReceiversCount = 3;
 
+// Each receiver's id followed by up to kMaxReadingsPerSensor pairs of time of flight and resonance.
 const unsigned int kSharedMemoryMaxSize =
-        kMaxReadingsPerSensor * kMaxReceiversCount * 2 * sizeof(float);
+        kMaxReceiversCount * (sizeof(uint8_t) + kMaxReadingsPerSensor * 2 * sizeof(float));
 
 // Target frame rate in frames per second.
 const int kTargetFrameRate = 10;
+const nsecs_t kTargetFrameIntervalNs = 1'000'000'000 / kTargetFrameRate;
 
 namespace {
 
@@ -79,55 +84,65 @@ struct WaveformData {
     std::vector<std::pair<float, float>> readings;
 };
 
-// Serializes data provided in waveformDataList to a shared memory data pointer.
+// Serializes data provided in waveformDataList in the layout of the shared memory data: each
+// receiver's id followed by its readings as pairs of time of flight and resonance.
 // TODO(b/149950362): Add a common library for serialiazing and deserializing waveform data.
-void SerializeWaveformData(const std::vector<WaveformData>& waveformDataList, uint8_t* pData) {
+std::vector<uint8_t> SerializeWaveformData(const std::vector<WaveformData>& waveformDataList) {
+    static_assert(sizeof(std::pair<float, float>) == 2 * sizeof(float),
+                  "readings must be laid out as pairs of floats");
+
+    size_t size = 0;
+    for (auto& waveformData : waveformDataList) {
+        size += sizeof(uint8_t) + waveformData.readings.size() * sizeof(std::pair<float, float>);
+    }
+
+    std::vector<uint8_t> data(size);
+    uint8_t* pData = data.data();
     for (auto& waveformData : waveformDataList) {
         // Set Id
-        memcpy(pData, &waveformData.receiverId, sizeof(uint8_t));
+        *pData = waveformData.receiverId;
         pData += sizeof(uint8_t);
 
-        for (auto& reading : waveformData.readings) {
-            // Set the time of flight.
-            memcpy(pData, &reading.first, sizeof(float));
-            pData += sizeof(float);
-
-            // Set the resonance.
-            memcpy(pData, &reading.second, sizeof(float));
-            pData += sizeof(float);
-        }
+        // Set the time of flight and the resonance of all readings at once.
+        const size_t readingsSize = waveformData.readings.size() * sizeof(std::pair<float, float>);
+        memcpy(pData, waveformData.readings.data(), readingsSize);
+        pData += readingsSize;
     }
-}
-
-// Fills dataFrameDesc with mock data.
-bool fillMockDataFrame(UltrasonicsDataFrameDesc& dataFrameDesc, sp<IMemory> pIMemory) {
-    dataFrameDesc.timestampNs = elapsedRealtimeNano();
 
-    const std::vector<uint8_t> transmittersIdList = {0};
-    dataFrameDesc.transmittersIdList = transmittersIdList;
+    return data;
+}
 
-    const std::vector<uint8_t> recvIdList = {0, 1, 2};
-    dataFrameDesc.receiversIdList = recvIdList;
+// Mock data frame description and the waveform data it refers to.
+struct MockDataFrame {
+    UltrasonicsDataFrameDesc desc;
+    std::vector<uint8_t> waveformsData;
+};
 
-    const std::vector<uint32_t> receiversReadingsCountList = {2, 2, 4};
-    dataFrameDesc.receiversReadingsCountList = receiversReadingsCountList;
+// Returns the mock data frame, which is the same for every frame but its id, timestamp and
+// shared memory.
+const MockDataFrame& GetMockDataFrame() {
+    static const MockDataFrame* const kMockDataFrame = [] {
+        MockDataFrame* mockDataFrame = new MockDataFrame();
+        UltrasonicsDataFrameDesc& dataFrameDesc = mockDataFrame->desc;
 
-    const std::vector<WaveformData> waveformDataList = {
-            {recvIdList[0], {{1000, 0.1f}, {2000, 0.8f}}},
-            {recvIdList[1], {{1000, 0.1f}, {2000, 1.0f}}},
-            {recvIdList[2], {{1000, 0.1f}, {2000, 0.2f}, {4000, 0.2f}, {5000, 0.1f}}}};
+        const std::vector<uint8_t> transmittersIdList = {0};
+        dataFrameDesc.transmittersIdList = transmittersIdList;
 
-    if (pIMemory.get() == nullptr) {
-        return false;
-    }
+        const std::vector<uint8_t> recvIdList = {0, 1, 2};
+        dataFrameDesc.receiversIdList = recvIdList;
 
-    uint8_t* pData = (uint8_t*)((void*)pIMemory->getPointer());
+        const std::vector<uint32_t> receiversReadingsCountList = {2, 2, 4};
+        dataFrameDesc.receiversReadingsCountList = receiversReadingsCountList;
 
-    pIMemory->update();
-    SerializeWaveformData(waveformDataList, pData);
-    pIMemory->commit();
+        const std::vector<WaveformData> waveformDataList = {
+                {recvIdList[0], {{1000, 0.1f}, {2000, 0.8f}}},
+                {recvIdList[1], {{1000, 0.1f}, {2000, 1.0f}}},
+                {recvIdList[2], {{1000, 0.1f}, {2000, 0.2f}, {4000, 0.2f}, {5000, 0.1f}}}};
+        mockDataFrame->waveformsData = SerializeWaveformData(waveformDataList);
 
-    return true;
+        return mockDataFrame;
+    }();
+    return *kMockDataFrame;
 }
 
 }  // namespace
@@ -175,6 +190,7 @@ void EvsUltrasonicsArray::forceShutdown() {
         dataFrame.sharedMemory.clear();
     }
     mDataFrames.clear();
+    mFreeDataFrames.clear();
 
     // Put this object into an unrecoverable error state since somebody else
     // is going to own the underlying ultrasonic array now
@@ -244,15 +260,17 @@ Return<void> EvsUltrasonicsArray::doneWithDataFrame(const UltrasonicsDataFrameDe
     // to improve locality after mFramesAllowed has been reduced.
     if (dataFrameDesc.dataFrameId >= mFramesAllowed) {
         // Find an empty slot lower in the array (which should always exist in this case)
-        for (auto&& dataFrame : mDataFrames) {
-            if (!dataFrame.sharedMemory.IsValid()) {
-                dataFrame.sharedMemory = mDataFrames[dataFrameDesc.dataFrameId].sharedMemory;
+        for (unsigned idx = 0; idx < mDataFrames.size(); idx++) {
+            if (!mDataFrames[idx].sharedMemory.IsValid()) {
+                mDataFrames[idx].sharedMemory = mDataFrames[dataFrameDesc.dataFrameId].sharedMemory;
                 mDataFrames[dataFrameDesc.dataFrameId].sharedMemory.clear();
+                mFreeDataFrames.push_back(idx);
                 return Void();
             }
         }
     }
 
+    mFreeDataFrames.push_back(dataFrameDesc.dataFrameId);
     return Void();
 }
 
@@ -281,6 +299,7 @@ Return<EvsResult> EvsUltrasonicsArray::startStream(
 
     // Start the frame generation thread
     mStreamState = RUNNING;
+    mDataFrameStats = {};
     mCaptureThread = std::thread([this]() { generateDataFrames(); });
 
     return EvsResult::OK;
@@ -389,6 +408,14 @@ EvsUltrasonicsArray::SharedMemory EvsUltrasonicsArray::allocateAndMapSharedMemor
         return SharedMemory();
     }
 
+    // The mock waveform data never changes, so it is written once here rather than every time
+    // the data frame is delivered.
+    const std::vector<uint8_t>& waveformsData = GetMockDataFrame().waveformsData;
+    sharedMemory.pIMemory->update();
+    memcpy(static_cast<void*>(sharedMemory.pIMemory->getPointer()), waveformsData.data(),
+           waveformsData.size());
+    sharedMemory.pIMemory->commit();
+
     // Return success.
     return sharedMemory;
 }
@@ -405,21 +432,21 @@ unsigned EvsUltrasonicsArray::increaseAvailableFrames_Locked(unsigned numToAdd)
         }
 
         // Find a place to store the new buffer
-        bool stored = false;
-        for (auto&& dataFrame : mDataFrames) {
-            if (!dataFrame.sharedMemory.IsValid()) {
+        unsigned idx;
+        for (idx = 0; idx < mDataFrames.size(); idx++) {
+            if (!mDataFrames[idx].sharedMemory.IsValid()) {
                 // Use this existing entry
-                dataFrame.sharedMemory = sharedMemory;
-                dataFrame.inUse = false;
-                stored = true;
+                mDataFrames[idx].sharedMemory = sharedMemory;
+                mDataFrames[idx].inUse = false;
                 break;
             }
         }
 
-        if (!stored) {
+        if (idx == mDataFrames.size()) {
             // Add a BufferRecord wrapping this handle to our set of available buffers
             mDataFrames.emplace_back(sharedMemory);
         }
+        mFreeDataFrames.push_back(idx);
 
         mFramesAllowed++;
         added++;
@@ -431,19 +458,14 @@ unsigned EvsUltrasonicsArray::increaseAvailableFrames_Locked(unsigned numToAdd)
 unsigned EvsUltrasonicsArray::decreaseAvailableFrames_Locked(unsigned numToRemove) {
     unsigned removed = 0;
 
-    for (auto&& dataFrame : mDataFrames) {
-        // Is this record not in use, but holding a buffer that we can free?
-        if (!dataFrame.inUse && dataFrame.sharedMemory.IsValid()) {
-            // Release buffer and update the record so we can recognize it as "empty"
-            dataFrame.sharedMemory.clear();
-
-            mFramesAllowed--;
-            removed++;
+    // Only data frames that are not in use hold a buffer that we can free.
+    while (removed < numToRemove && !mFreeDataFrames.empty()) {
+        // Release buffer and update the record so we can recognize it as "empty"
+        mDataFrames[mFreeDataFrames.back()].sharedMemory.clear();
+        mFreeDataFrames.pop_back();
 
-            if (removed == numToRemove) {
-                break;
-            }
-        }
+        mFramesAllowed--;
+        removed++;
     }
 
     return removed;
@@ -454,13 +476,14 @@ unsigned EvsUltrasonicsArray::decreaseAvailableFrames_Locked(unsigned numToRemov
 void EvsUltrasonicsArray::generateDataFrames() {
     LOG(DEBUG) << "Data frame generation loop started";
 
+    common::FramePacer pacer(kTargetFrameIntervalNs);
+    pacer.start();
+
     unsigned idx = 0;
 
     while (true) {
         bool timeForFrame = false;
 
-        nsecs_t startTime = elapsedRealtimeNano();
-
         // Lock scope for updating shared state
         {
             std::lock_guard<std::mutex> lock(mAccessLock);
@@ -471,42 +494,36 @@ void EvsUltrasonicsArray::generateDataFrames() {
             }
 
             // Are we allowed to issue another buffer?
-            if (mFramesInUse >= mFramesAllowed) {
+            if (mFramesInUse >= mFramesAllowed || mFreeDataFrames.empty()) {
                 // Can't do anything right now -- skip this frame
                 LOG(WARNING) << "Skipped a frame because too many are in flight";
+                mDataFrameStats.framesDropped++;
             } else {
-                // Identify an available buffer to fill
-                for (idx = 0; idx < mDataFrames.size(); idx++) {
-                    if (!mDataFrames[idx].inUse && mDataFrames[idx].sharedMemory.IsValid()) {
-                        // Found an available record, so stop looking
-                        break;
-                    }
-                }
-                if (idx >= mDataFrames.size()) {
-                    // This shouldn't happen since we already checked mFramesInUse vs mFramesAllowed
-                    LOG(ERROR) << "Failed to find an available buffer slot";
-                } else {
-                    // We're going to make the frame busy
-                    mDataFrames[idx].inUse = true;
-                    mFramesInUse++;
-                    timeForFrame = true;
-                }
+                // Take the data frame that has been free the longest
+                idx = mFreeDataFrames.front();
+                mFreeDataFrames.pop_front();
+
+                // We're going to make the frame busy
+                mDataFrames[idx].inUse = true;
+                mFramesInUse++;
+                timeForFrame = true;
             }
         }
 
         if (timeForFrame) {
-            // Assemble the buffer description we'll transmit below
-            UltrasonicsDataFrameDesc mockDataFrameDesc;
+            // Assemble the buffer description we'll transmit below; the waveform data is
+            // already in the shared memory.
+            UltrasonicsDataFrameDesc mockDataFrameDesc = GetMockDataFrame().desc;
             mockDataFrameDesc.dataFrameId = idx;
+            mockDataFrameDesc.timestampNs = elapsedRealtimeNano();
             mockDataFrameDesc.waveformsData = mDataFrames[idx].sharedMemory.hidlMemory;
 
-            // Fill mock waveform data.
-            fillMockDataFrame(mockDataFrameDesc, mDataFrames[idx].sharedMemory.pIMemory);
-
             // Issue the (asynchronous) callback to the client -- can't be holding the lock
             auto result = mStream->deliverDataFrame(mockDataFrameDesc);
             if (result.isOk()) {
                 LOG(DEBUG) << "Delivered data frame id: " << mockDataFrameDesc.dataFrameId;
+                std::lock_guard<std::mutex> lock(mAccessLock);
+                mDataFrameStats.framesDelivered++;
             } else {
                 // This can happen if the client dies and is likely unrecoverable.
                 // To avoid consuming resources generating failing calls, we stop sending
@@ -518,18 +535,16 @@ void EvsUltrasonicsArray::generateDataFrames() {
                 std::lock_guard<std::mutex> lock(mAccessLock);
                 mDataFrames[idx].inUse = false;
                 mFramesInUse--;
+                mFreeDataFrames.push_front(idx);
 
                 break;
             }
         }
 
-        // Sleep to generate frames at kTargetFrameRate.
-        static const nsecs_t kTargetFrameTimeUs = 1000 * 1000 / kTargetFrameRate;
-        const nsecs_t now = elapsedRealtimeNano();
-        const nsecs_t workTimeUs = (now - startTime) / 1000;
-        const nsecs_t sleepDurationUs = kTargetFrameTimeUs - workTimeUs;
-        if (sleepDurationUs > 0) {
-            usleep(sleepDurationUs);
+        // Sleep until the next frame is due
+        if (!pacer.waitForNextFrame()) {
+            std::lock_guard<std::mutex> lock(mAccessLock);
+            mDataFrameStats.framesLate++;
         }
     }
 
@@ -542,6 +557,23 @@ void EvsUltrasonicsArray::generateDataFrames() {
     }
 }
 
+Return<void> EvsUltrasonicsArray::debug(const hidl_handle& fd,
+                                        const hidl_vec<hidl_string>& /* options */) {
+    if (fd.getNativeHandle() == nullptr || fd->numFds < 1) {
+        LOG(ERROR) << __FUNCTION__ << ": Invalid parameters";
+        return Void();
+    }
+
+    std::lock_guard<std::mutex> lock(mAccessLock);
+    dprintf(fd->data[0],
+            "Ultrasonics array %s: %u data frames allocated, %u in use, at %d fps\n"
+            "    frames delivered: %" PRIu64 ", dropped: %" PRIu64 ", late: %" PRIu64 "\n",
+            mArrayDesc.ultrasonicsArrayId.c_str(), mFramesAllowed, mFramesInUse,
+            kTargetFrameRate, mDataFrameStats.framesDelivered, mDataFrameStats.framesDropped,
+            mDataFrameStats.framesLate);
+    return Void();
+}
+
 }  // namespace implementation
 }  // namespace V1_1
 }  // namespace evs
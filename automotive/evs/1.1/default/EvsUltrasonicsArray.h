@@ -17,8 +17,10 @@
 #ifndef ANDROID_HARDWARE_AUTOMOTIVE_EVS_V1_1_EVSULTRASONICSARRAY_H
 #define ANDROID_HARDWARE_AUTOMOTIVE_EVS_V1_1_EVSULTRASONICSARRAY_H
 
+#include <deque>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include <android-base/macros.h>
 #include <android/hidl/allocator/1.0/IAllocator.h>
@@ -54,6 +56,9 @@ class EvsUltrasonicsArray : public IEvsUltrasonicsArray {
     Return<EvsResult> startStream(const ::android::sp<IEvsUltrasonicsArrayStream>& stream) override;
     Return<void> stopStream() override;
 
+    // Methods from ::android.hidl.base::V1_0::IBase follow.
+    Return<void> debug(const hidl_handle& fd, const hidl_vec<hidl_string>& options) override;
+
     // Factory function to create a array.
     static sp<EvsUltrasonicsArray> Create(const char* deviceName);
 
@@ -83,13 +88,21 @@ class EvsUltrasonicsArray : public IEvsUltrasonicsArray {
         }
     };
 
-    // Struct for a data frame record.
+    // Struct for a data frame record.  Data frames are allocated up front by
+    // setMaxFramesInFlight() and come back to mFreeDataFrames when the client returns them.
     struct DataFrameRecord {
         SharedMemory sharedMemory;
         bool inUse;
         explicit DataFrameRecord(SharedMemory shMem) : sharedMemory(shMem), inUse(false){};
     };
 
+    // Data frame generation statistics reported by debug()
+    struct DataFrameStats {
+        uint64_t framesDelivered = 0;
+        uint64_t framesDropped = 0;  // No free data frame when one was due
+        uint64_t framesLate = 0;     // Generated after the next one was already due
+    };
+
     enum StreamStateValues {
         STOPPED,
         RUNNING,
@@ -118,10 +131,13 @@ class EvsUltrasonicsArray : public IEvsUltrasonicsArray {
 
     std::mutex mAccessLock;
     std::vector<DataFrameRecord> mDataFrames GUARDED_BY(mAccessLock);  // Shared memory buffers.
+    // Indices of allocated data frames that are not in use, oldest returned first.
+    std::deque<unsigned> mFreeDataFrames GUARDED_BY(mAccessLock);
     unsigned mFramesAllowed GUARDED_BY(mAccessLock);  // How many buffers are we currently using.
     unsigned mFramesInUse GUARDED_BY(mAccessLock);    // How many buffers are currently outstanding.
 
     StreamStateValues mStreamState GUARDED_BY(mAccessLock);
+    DataFrameStats mDataFrameStats GUARDED_BY(mAccessLock);
 };
 
 }  // namespace implementation
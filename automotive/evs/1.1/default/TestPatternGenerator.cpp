@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TestPatternGenerator.h"
+
+#include <cstring>
+
+namespace {
+
+// Colors for the colorbar test pattern in ABGR format
+constexpr uint32_t kColors[] = {
+        0xFFFFFFFF,  // white
+        0xFF00FFFF,  // yellow
+        0xFFFFFF00,  // cyan
+        0xFF00FF00,  // green
+        0xFFFF00FF,  // fuchsia
+        0xFF0000FF,  // red
+        0xFFFF0000,  // blue
+        0xFF000000,  // black
+};
+constexpr uint32_t kNumColors = sizeof(kColors) / sizeof(kColors[0]);
+
+// Horizontal distance moving patterns travel in each frame
+constexpr uint64_t kScrollPixelsPerFrame = 8;
+
+}  // namespace
+
+namespace android::hardware::automotive::evs::V1_1::implementation {
+
+std::optional<TestPatternGenerator::Pattern> TestPatternGenerator::parsePattern(
+        std::string_view name) {
+    if (name == "colorbars") {
+        return Pattern::kColorBars;
+    } else if (name == "moving") {
+        return Pattern::kMovingColorBars;
+    }
+    return std::nullopt;
+}
+
+const char* TestPatternGenerator::patternName(Pattern pattern) {
+    switch (pattern) {
+        case Pattern::kColorBars:
+            return "colorbars";
+        case Pattern::kMovingColorBars:
+            return "moving";
+    }
+    return "unknown";
+}
+
+void TestPatternGenerator::prepareRow(uint32_t width) {
+    if (mRowWidth == width) {
+        return;
+    }
+
+    mRow.resize(2 * static_cast<size_t>(width));
+    for (uint32_t col = 0; col < width; col++) {
+        const uint32_t index = col * kNumColors / width;
+        mRow[col] = kColors[index];
+    }
+    memcpy(mRow.data() + width, mRow.data(), width * sizeof(uint32_t));
+    mRowWidth = width;
+}
+
+void TestPatternGenerator::fill(uint32_t* pixels, uint32_t width, uint32_t height, uint32_t stride,
+                                Pattern pattern, uint64_t frameNumber) {
+    if (width == 0) {
+        return;
+    }
+    prepareRow(width);
+
+    size_t offset = 0;
+    if (pattern == Pattern::kMovingColorBars) {
+        offset = (frameNumber * kScrollPixelsPerFrame) % width;
+    }
+
+    // NOTE:  stride retrieved from gralloc is in units of pixels
+    const uint32_t* row = mRow.data() + offset;
+    const size_t rowSize = width * sizeof(uint32_t);
+    for (uint32_t line = 0; line < height; line++) {
+        memcpy(pixels, row, rowSize);
+        pixels += stride;
+    }
+}
+
+}  // namespace android::hardware::automotive::evs::V1_1::implementation
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_AUTOMOTIVE_EVS_V1_1_TESTPATTERNGENERATOR_H
+#define ANDROID_HARDWARE_AUTOMOTIVE_EVS_V1_1_TESTPATTERNGENERATOR_H
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace android::hardware::automotive::evs::V1_1::implementation {
+
+// Synthesizes the ABGR test frames delivered by EvsCamera.
+//
+// Every row of a colour bar frame is the same, so the generator builds one row when the frame
+// width changes and copies it into each line of the buffer instead of computing every pixel.
+class TestPatternGenerator {
+  public:
+    enum class Pattern {
+        // Vertical colour bars.
+        kColorBars,
+        // Colour bars scrolling horizontally from frame to frame.
+        kMovingColorBars,
+    };
+
+    static std::optional<Pattern> parsePattern(std::string_view name);
+    static const char* patternName(Pattern pattern);
+
+    // Fills |height| rows of |width| pixels, |stride| pixels apart.  |frameNumber| positions
+    // moving patterns.
+    void fill(uint32_t* pixels, uint32_t width, uint32_t height, uint32_t stride, Pattern pattern,
+              uint64_t frameNumber);
+
+  private:
+    void prepareRow(uint32_t width);
+
+    // Two copies of a colour bar row back to back, so that the row of a moving pattern is a
+    // contiguous window of it whatever the offset.
+    std::vector<uint32_t> mRow;
+    uint32_t mRowWidth = 0;
+};
+
+}  // namespace android::hardware::automotive::evs::V1_1::implementation
+
+#endif  // ANDROID_HARDWARE_AUTOMOTIVE_EVS_V1_1_TESTPATTERNGENERATOR_H
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures how long ConfigManager takes to come up from a configuration with a given number of
+// camera devices, parsing the XML file every time or reading a binary snapshot of it, and how long
+// it then takes to open one camera or all of them.
+
+#include <benchmark/benchmark.h>
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+
+#include <unistd.h>
+
+#include <string>
+
+#include "ConfigManager.h"
+
+namespace android::hardware::automotive::evs::V1_1::implementation {
+namespace {
+
+using ::android::base::StringPrintf;
+using ::benchmark::State;
+
+// A configuration like evs_default_configuration.xml with |numCameras| devices.
+std::string makeConfiguration(int numCameras) {
+    std::string xml = StringPrintf(
+            "<?xml version='1.0' encoding='utf-8'?>\n"
+            "<configuration>\n"
+            "    <system>\n"
+            "        <num_cameras value='%d'/>\n"
+            "    </system>\n"
+            "    <camera>\n",
+            numCameras);
+    for (int i = 0; i < numCameras; ++i) {
+        xml += StringPrintf(
+                "        <device id='/dev/video%d' position='rear'>\n"
+                "            <caps>\n"
+                "                <supported_controls>\n"
+                "                    <control name='BRIGHTNESS' min='0' max='255'/>\n"
+                "                    <control name='CONTRAST' min='0' max='255'/>\n"
+                "                </supported_controls>\n"
+                "                <stream id='0' width='640'  height='360'  format='RGBA_8888' "
+                "framerate='30'/>\n"
+                "                <stream id='1' width='1280' height='720'  format='RGBA_8888' "
+                "framerate='30'/>\n"
+                "                <stream id='2' width='1920' height='1080' format='RGBA_8888' "
+                "framerate='30'/>\n"
+                "            </caps>\n"
+                "            <characteristics>\n"
+                "                <parameter name='LENS_INTRINSIC_CALIBRATION' type='float' "
+                "size='5' value='%d.0,1.0,2.0,3.0,4.0'/>\n"
+                "                <parameter name='LENS_POSE_ROTATION' type='float' size='4' "
+                "value='0.0,0.0,0.0,1.0'/>\n"
+                "                <parameter name='LENS_POSE_TRANSLATION' type='float' size='3' "
+                "value='0.0,%d.0,0.0'/>\n"
+                "            </characteristics>\n"
+                "        </device>\n",
+                i, i, i);
+    }
+    xml += "    </camera>\n"
+           "    <display>\n"
+           "        <device id='display0' position='driver'>\n"
+           "            <caps>\n"
+           "                <stream id='0' width='1280' height='720' format='RGBA_8888' "
+           "framerate='30'/>\n"
+           "            </caps>\n"
+           "        </device>\n"
+           "    </display>\n"
+           "</configuration>\n";
+    return xml;
+}
+
+class Configuration {
+  public:
+    explicit Configuration(int numCameras)
+        : mXmlPath(std::string(mDir.path) + "/evs_configuration.xml"),
+          mSnapshotPath(std::string(mDir.path) + "/evs_configuration.bin") {
+        android::base::WriteStringToFile(makeConfiguration(numCameras), mXmlPath);
+    }
+
+    ~Configuration() { unlink(mSnapshotPath.c_str()); }
+
+    const char* xmlPath() const { return mXmlPath.c_str(); }
+    const char* snapshotPath() const { return mSnapshotPath.c_str(); }
+
+  private:
+    TemporaryDir mDir;
+    const std::string mXmlPath;
+    const std::string mSnapshotPath;
+};
+
+void BM_CreateFromXml(State& state) {
+    Configuration config(state.range(0));
+    for (auto _ : state) {
+        auto cfgMgr = ConfigManager::Create(config.xmlPath());
+        benchmark::DoNotOptimize(cfgMgr.get());
+    }
+}
+
+void BM_CreateFromSnapshot(State& state) {
+    Configuration config(state.range(0));
+    ConfigManager::Create(config.xmlPath(), config.snapshotPath());
+    for (auto _ : state) {
+        auto cfgMgr = ConfigManager::Create(config.xmlPath(), config.snapshotPath());
+        benchmark::DoNotOptimize(cfgMgr.get());
+    }
+}
+
+// Start up and open the first camera, as a rear view client does.
+void BM_CreateAndOpenFirstCamera(State& state, bool useSnapshot) {
+    Configuration config(state.range(0));
+    const char* snapshotPath = useSnapshot ? config.snapshotPath() : "";
+    ConfigManager::Create(config.xmlPath(), snapshotPath);
+    for (auto _ : state) {
+        auto cfgMgr = ConfigManager::Create(config.xmlPath(), snapshotPath);
+        for (auto& id : cfgMgr->getCameraList()) {
+            benchmark::DoNotOptimize(cfgMgr->getCameraCharacteristics(id));
+        }
+        benchmark::DoNotOptimize(cfgMgr->getCameraInfo("/dev/video0").get());
+    }
+}
+
+void BM_CreateAndOpenAllCameras(State& state, bool useSnapshot) {
+    Configuration config(state.range(0));
+    const char* snapshotPath = useSnapshot ? config.snapshotPath() : "";
+    ConfigManager::Create(config.xmlPath(), snapshotPath);
+    for (auto _ : state) {
+        auto cfgMgr = ConfigManager::Create(config.xmlPath(), snapshotPath);
+        for (auto& id : cfgMgr->getCameraList()) {
+            benchmark::DoNotOptimize(cfgMgr->getCameraInfo(id).get());
+        }
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_CreateFromXml)->Arg(1)->Arg(8)->Arg(32);
+BENCHMARK(BM_CreateFromSnapshot)->Arg(1)->Arg(8)->Arg(32);
+BENCHMARK_CAPTURE(BM_CreateAndOpenFirstCamera, xml, false)->Arg(8)->Arg(32);
+BENCHMARK_CAPTURE(BM_CreateAndOpenFirstCamera, snapshot, true)->Arg(8)->Arg(32);
+BENCHMARK_CAPTURE(BM_CreateAndOpenAllCameras, xml, false)->Arg(8)->Arg(32);
+BENCHMARK_CAPTURE(BM_CreateAndOpenAllCameras, snapshot, true)->Arg(8)->Arg(32);
+
+}  // namespace android::hardware::automotive::evs::V1_1::implementation
+
+BENCHMARK_MAIN();
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <utils/Timers.h>
+
+#include <errno.h>
+#include <time.h>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace evs {
+namespace common {
+
+// Paces mock frames on a schedule of absolute deadlines, so that the time spent generating
+// and delivering a frame doesn't make the stream drift below its frame rate.
+class FramePacer {
+public:
+    explicit FramePacer(nsecs_t frameIntervalNs) : mFrameIntervalNs(frameIntervalNs) {}
+
+    // Starts a new schedule with the first frame due one interval from now.
+    void start() {
+        mDeadlineNs = systemTime(SYSTEM_TIME_MONOTONIC);
+    }
+
+    // Sleeps until the next frame is due.  Returns false if that deadline has already passed, in
+    // which case the schedule starts over from now rather than bursting frames to catch up.
+    bool waitForNextFrame() {
+        mDeadlineNs += mFrameIntervalNs;
+        const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        if (now >= mDeadlineNs) {
+            mDeadlineNs = now;
+            return false;
+        }
+
+        const struct timespec wakeTime = {
+            .tv_sec = static_cast<time_t>(mDeadlineNs / 1000000000),
+            .tv_nsec = static_cast<long>(mDeadlineNs % 1000000000),
+        };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeTime, nullptr) == EINTR) {
+        }
+        return true;
+    }
+
+private:
+    const nsecs_t mFrameIntervalNs;
+    nsecs_t mDeadlineNs = 0;
+};
+
+}  // namespace common
+}  // namespace evs
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
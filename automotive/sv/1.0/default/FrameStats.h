@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <utils/Timers.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <algorithm>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace sv {
+namespace V1_0 {
+namespace implementation {
+
+// Frame generation statistics of a session, reported by debug().
+struct FrameStats {
+    uint64_t framesDelivered = 0;
+    uint64_t framesDropped = 0;
+    uint64_t missedDeadlines = 0;
+    nsecs_t totalGenerationTimeNs = 0;
+    nsecs_t lastGenerationTimeNs = 0;
+    nsecs_t maxGenerationTimeNs = 0;
+
+    void addGenerationTime(nsecs_t generationTimeNs) {
+        totalGenerationTimeNs += generationTimeNs;
+        lastGenerationTimeNs = generationTimeNs;
+        maxGenerationTimeNs = std::max(maxGenerationTimeNs, generationTimeNs);
+    }
+
+    void dump(int fd) const {
+        const uint64_t frames = framesDelivered + framesDropped;
+        const nsecs_t averageNs = frames > 0 ? totalGenerationTimeNs / frames : 0;
+        dprintf(fd,
+                "    frames delivered: %" PRIu64 ", dropped: %" PRIu64
+                ", missed deadlines: %" PRIu64 "\n"
+                "    generation time (us): last %" PRId64 ", average %" PRId64
+                ", max %" PRId64 "\n",
+                framesDelivered, framesDropped, missedDeadlines, ns2us(lastGenerationTimeNs),
+                ns2us(averageNs), ns2us(maxGenerationTimeNs));
+    }
+};
+
+}  // namespace implementation
+}  // namespace V1_0
+}  // namespace sv
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -16,9 +16,12 @@
 
 #include "SurroundView2dSession.h"
 
+#include <FramePacer.h>
 #include <utils/Log.h>
 #include <utils/SystemClock.h>
 
+#include <stdio.h>
+
 namespace android {
 namespace hardware {
 namespace automotive {
@@ -26,6 +29,11 @@ namespace sv {
 namespace V1_0 {
 namespace implementation {
 
+using ::android::hardware::automotive::evs::common::FramePacer;
+
+// Synthetic frames are generated at 10 fps.
+static const nsecs_t kFrameIntervalNs = 100 * 1000 * 1000;
+
 SurroundView2dSession::SurroundView2dSession() :
     mStreamState(STOPPED) {
     mEvsCameraIds = {"0" , "1", "2", "3"};
@@ -187,10 +195,26 @@ Return<void> SurroundView2dSession::projectCameraPoints(
     return android::hardware::Void();
 }
 
+Return<void> SurroundView2dSession::debug(const hidl_handle& fd,
+                                         const hidl_vec<hidl_string>& options) {
+    (void)options;
+    if (fd.getNativeHandle() == nullptr || fd->numFds < 1) {
+        ALOGE("SurroundView2dSession::debug: invalid file descriptor");
+        return android::hardware::Void();
+    }
+
+    std::lock_guard<std::mutex> lock(mAccessLock);
+    dprintf(fd->data[0], "2D session, %s\n", mStreamState == RUNNING ? "streaming" : "idle");
+    mFrameStats.dump(fd->data[0]);
+    return android::hardware::Void();
+}
+
 void SurroundView2dSession::generateFrames() {
     ALOGD("SurroundView2dSession::generateFrames");
 
     int sequenceId = 0;
+    FramePacer pacer(kFrameIntervalNs);
+    pacer.start();
 
     while(true) {
         {
@@ -200,6 +224,13 @@ void SurroundView2dSession::generateFrames() {
                 // Break out of our main thread loop
                 break;
             }
+        }
+
+        const bool onTime = pacer.waitForNextFrame();
+        const nsecs_t generationStart = systemTime(SYSTEM_TIME_MONOTONIC);
+
+        {
+            std::lock_guard<std::mutex> lock(mAccessLock);
 
             framesRecord.frames.svBuffers[0].hardwareBuffer.description[0] =
                 mConfig.width;
@@ -207,19 +238,25 @@ void SurroundView2dSession::generateFrames() {
                 mConfig.width * 3 / 4;
         }
 
-        usleep(100 * 1000);
-
         framesRecord.frames.timestampNs = elapsedRealtimeNano();
         framesRecord.frames.sequenceId = sequenceId++;
 
         {
             std::lock_guard<std::mutex> lock(mAccessLock);
 
+            if (!onTime) {
+                mFrameStats.missedDeadlines++;
+            }
+            mFrameStats.addGenerationTime(
+                systemTime(SYSTEM_TIME_MONOTONIC) - generationStart);
+
             if (framesRecord.inUse) {
                 ALOGD("Notify SvEvent::FRAME_DROPPED");
+                mFrameStats.framesDropped++;
                 mStream->notify(SvEvent::FRAME_DROPPED);
             } else {
                 framesRecord.inUse = true;
+                mFrameStats.framesDelivered++;
                 mStream->receiveFrames(framesRecord.frames);
             }
         }
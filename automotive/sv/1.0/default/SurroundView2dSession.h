@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include "FrameStats.h"
+
 #include <android/hardware/automotive/sv/1.0/types.h>
 #include <android/hardware/automotive/sv/1.0/ISurroundViewStream.h>
 #include <android/hardware/automotive/sv/1.0/ISurroundView2dSession.h>
@@ -27,6 +29,8 @@
 using namespace ::android::hardware::automotive::sv::V1_0;
 using ::android::hardware::Return;
 using ::android::hardware::Void;
+using ::android::hardware::hidl_handle;
+using ::android::hardware::hidl_string;
 using ::android::hardware::hidl_vec;
 using ::android::sp;
 using ::std::mutex;
@@ -61,6 +65,11 @@ public:
     // Stream subscribed for the session.
     sp<ISurroundViewStream> mStream;
 
+    // Methods from ::android::hidl::base::V1_0::IBase follow.
+    // Dumps the frame generation statistics.
+    Return<void> debug(const hidl_handle& fd,
+                       const hidl_vec<hidl_string>& options) override;
+
 private:
     void generateFrames();
 
@@ -86,6 +95,9 @@ private:
     // Synchronization necessary to deconflict mCaptureThread from the main service thread
     std::mutex mAccessLock;
 
+    // Protected by mAccessLock
+    FrameStats mFrameStats;
+
     std::vector<std::string> mEvsCameraIds;
 };
 
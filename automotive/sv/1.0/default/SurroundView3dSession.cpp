@@ -18,14 +18,18 @@
 
 #include <set>
 
+#include <FramePacer.h>
 #include <utils/Log.h>
 #include <utils/SystemClock.h>
 
+#include <stdio.h>
+
 #include <android/hidl/memory/1.0/IMemory.h>
 #include <hidlmemory/mapping.h>
 
 using ::android::hidl::memory::V1_0::IMemory;
 using ::android::hardware::hidl_memory;
+using ::android::hardware::automotive::evs::common::FramePacer;
 
 namespace android {
 namespace hardware {
@@ -34,6 +38,9 @@ namespace sv {
 namespace V1_0 {
 namespace implementation {
 
+// Synthetic frames are generated at 10 fps.
+static const nsecs_t kFrameIntervalNs = 100 * 1000 * 1000;
+
 SurroundView3dSession::SurroundView3dSession() :
     mStreamState(STOPPED){
 
@@ -255,10 +262,26 @@ Return<void> SurroundView3dSession::projectCameraPointsTo3dSurface(
     return android::hardware::Void();
 }
 
+Return<void> SurroundView3dSession::debug(const hidl_handle& fd,
+                                         const hidl_vec<hidl_string>& options) {
+    (void)options;
+    if (fd.getNativeHandle() == nullptr || fd->numFds < 1) {
+        ALOGE("SurroundView3dSession::debug: invalid file descriptor");
+        return android::hardware::Void();
+    }
+
+    std::lock_guard<std::mutex> lock(mAccessLock);
+    dprintf(fd->data[0], "3D session, %s\n", mStreamState == RUNNING ? "streaming" : "idle");
+    mFrameStats.dump(fd->data[0]);
+    return android::hardware::Void();
+}
+
 void SurroundView3dSession::generateFrames() {
     ALOGD("SurroundView3dSession::generateFrames");
 
     int sequenceId = 0;
+    FramePacer pacer(kFrameIntervalNs);
+    pacer.start();
 
     while(true) {
         {
@@ -270,15 +293,22 @@ void SurroundView3dSession::generateFrames() {
             }
         }
 
-        usleep(100 * 1000);
+        const bool onTime = pacer.waitForNextFrame();
+        const nsecs_t generationStart = systemTime(SYSTEM_TIME_MONOTONIC);
 
         framesRecord.frames.timestampNs = elapsedRealtimeNano();
         framesRecord.frames.sequenceId = sequenceId++;
 
+        // Buffers are only added when views are, so that their handles aren't allocated again
+        // for every frame.
+        const size_t numBuffers = framesRecord.frames.svBuffers.size();
         framesRecord.frames.svBuffers.resize(mViews.size());
-        for (int i=0; i<mViews.size(); i++) {
+        for (size_t i = 0; i < mViews.size(); i++) {
             framesRecord.frames.svBuffers[i].viewId = mViews[i].viewId;
-            framesRecord.frames.svBuffers[i].hardwareBuffer.nativeHandle = new native_handle_t();
+            if (i >= numBuffers) {
+                framesRecord.frames.svBuffers[i].hardwareBuffer.nativeHandle =
+                    new native_handle_t();
+            }
             framesRecord.frames.svBuffers[i].hardwareBuffer.description[0] = mConfig.width; // width
             framesRecord.frames.svBuffers[i].hardwareBuffer.description[1] = mConfig.height; // height
         }
@@ -286,11 +316,18 @@ void SurroundView3dSession::generateFrames() {
         {
             std::lock_guard<std::mutex> lock(mAccessLock);
 
+            if (!onTime) {
+                mFrameStats.missedDeadlines++;
+            }
+            mFrameStats.addGenerationTime(systemTime(SYSTEM_TIME_MONOTONIC) - generationStart);
+
             if (framesRecord.inUse) {
                 ALOGD("Notify SvEvent::FRAME_DROPPED");
+                mFrameStats.framesDropped++;
                 mStream->notify(SvEvent::FRAME_DROPPED);
             } else {
                 framesRecord.inUse = true;
+                mFrameStats.framesDelivered++;
                 mStream->receiveFrames(framesRecord.frames);
             }
         }
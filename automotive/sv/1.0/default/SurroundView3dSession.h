@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include "FrameStats.h"
+
 #include <android/hardware/automotive/sv/1.0/types.h>
 #include <android/hardware/automotive/sv/1.0/ISurroundViewStream.h>
 #include <android/hardware/automotive/sv/1.0/ISurroundView3dSession.h>
@@ -27,6 +29,8 @@
 using namespace ::android::hardware::automotive::sv::V1_0;
 using ::android::hardware::Return;
 using ::android::hardware::Void;
+using ::android::hardware::hidl_handle;
+using ::android::hardware::hidl_string;
 using ::android::hardware::hidl_vec;
 using ::android::sp;
 using ::std::mutex;
@@ -62,6 +66,11 @@ public:
     // TODO(tanmayp): Make private and add set/get method.
     sp<ISurroundViewStream> mStream;
 
+    // Methods from ::android::hidl::base::V1_0::IBase follow.
+    // Dumps the frame generation statistics.
+    Return<void> debug(const hidl_handle& fd,
+                       const hidl_vec<hidl_string>& options) override;
+
 private:
     void generateFrames();
 
@@ -85,6 +94,9 @@ private:
     // Synchronization necessary to deconflict mCaptureThread from the main service thread
     std::mutex mAccessLock;
 
+    // Protected by mAccessLock
+    FrameStats mFrameStats;
+
     std::vector<View3d> mViews;
 
     Sv3dConfig mConfig;
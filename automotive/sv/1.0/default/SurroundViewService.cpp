@@ -18,6 +18,8 @@
 
 #include <utils/Log.h>
 
+#include <stdio.h>
+
 namespace android {
 namespace hardware {
 namespace automotive {
@@ -82,6 +84,25 @@ Return<SvResult> SurroundViewService::stop3dSession(
     }
 }
 
+Return<void> SurroundViewService::debug(const hidl_handle& fd,
+                                        const hidl_vec<hidl_string>& options) {
+    if (fd.getNativeHandle() == nullptr || fd->numFds < 1) {
+        ALOGE("SurroundViewService::debug: invalid file descriptor");
+        return android::hardware::Void();
+    }
+
+    if (mSurroundView2dSession == nullptr && mSurroundView3dSession == nullptr) {
+        dprintf(fd->data[0], "No active session\n");
+    }
+    if (mSurroundView2dSession != nullptr) {
+        mSurroundView2dSession->debug(fd, options);
+    }
+    if (mSurroundView3dSession != nullptr) {
+        mSurroundView3dSession->debug(fd, options);
+    }
+    return android::hardware::Void();
+}
+
 }  // namespace implementation
 }  // namespace V1_0
 }  // namespace sv
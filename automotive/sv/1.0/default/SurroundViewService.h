@@ -51,6 +51,11 @@ public:
     Return<SvResult> stop3dSession(
         const sp<ISurroundView3dSession>& sv3dSession) override;
 
+    // Methods from ::android::hidl::base::V1_0::IBase follow.
+    // Dumps the frame generation statistics of the active sessions.
+    Return<void> debug(const hidl_handle& fd,
+                       const hidl_vec<hidl_string>& options) override;
+
 private:
     sp<SurroundView2dSession> mSurroundView2dSession;
     sp<SurroundView3dSession> mSurroundView3dSession;
@@ -27,11 +27,14 @@
 #include <thread>
 #include <vector>
 #include "fcntl.h"
-#include "sys/select.h"
+#include "sys/epoll.h"
 #include "unistd.h"
 
 static const int INVALID_FD = -1;
 
+// Maximum number of ready file descriptors handled per wakeup.
+static const int MAX_EPOLL_EVENTS = 8;
+
 static const int BT_RT_PRIORITY = 1;
 
 namespace android {
@@ -44,7 +47,12 @@ int AsyncFdWatcher::WatchFdForNonBlockingReads(
   // Add file descriptor and callback
   {
     std::unique_lock<std::mutex> guard(internal_mutex_);
+    bool already_watched = watched_fds_.count(file_descriptor) != 0;
     watched_fds_[file_descriptor] = on_read_fd_ready_callback;
+    if (epoll_fd_ != INVALID_FD && !already_watched &&
+        addToEpoll(file_descriptor)) {
+      return -1;
+    }
   }
 
   // Start the thread if not started yet
@@ -76,13 +84,44 @@ int AsyncFdWatcher::tryStartThread() {
 
   // Set up the communication channel
   int pipe_fds[2];
-  if (pipe2(pipe_fds, O_NONBLOCK)) return -1;
+  if (pipe2(pipe_fds, O_NONBLOCK)) {
+    running_ = false;
+    return -1;
+  }
 
   notification_listen_fd_ = pipe_fds[0];
   notification_write_fd_ = pipe_fds[1];
 
+  // Undo the setup on failure, so that the next call can try again.
+  // Call with internal_mutex_ held.
+  auto fail = [this]() {
+    if (epoll_fd_ != INVALID_FD) {
+      close(epoll_fd_);
+      epoll_fd_ = INVALID_FD;
+    }
+    close(notification_listen_fd_);
+    close(notification_write_fd_);
+    notification_listen_fd_ = INVALID_FD;
+    notification_write_fd_ = INVALID_FD;
+    running_ = false;
+    return -1;
+  };
+
+  {
+    std::unique_lock<std::mutex> guard(internal_mutex_);
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ == INVALID_FD) return fail();
+    if (addToEpoll(notification_listen_fd_)) return fail();
+    for (auto& it : watched_fds_) {
+      if (addToEpoll(it.first)) return fail();
+    }
+  }
+
   thread_ = std::thread([this]() { ThreadRoutine(); });
-  if (!thread_.joinable()) return -1;
+  if (!thread_.joinable()) {
+    std::unique_lock<std::mutex> guard(internal_mutex_);
+    return fail();
+  }
 
   return 0;
 }
@@ -98,6 +137,8 @@ int AsyncFdWatcher::stopThread() {
   {
     std::unique_lock<std::mutex> guard(internal_mutex_);
     watched_fds_.clear();
+    close(epoll_fd_);
+    epoll_fd_ = INVALID_FD;
   }
 
   {
@@ -111,6 +152,18 @@ int AsyncFdWatcher::stopThread() {
   return 0;
 }
 
+int AsyncFdWatcher::addToEpoll(int file_descriptor) {
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = file_descriptor;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, file_descriptor, &event)) {
+    ALOGE("%s unable to watch fd %d: %s", __func__, file_descriptor,
+          strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
 int AsyncFdWatcher::notifyThread() {
   uint8_t buffer[] = {0};
   if (TEMP_FAILURE_RETRY(write(notification_write_fd_, &buffer, 1)) < 0) {
@@ -128,27 +181,15 @@ void AsyncFdWatcher::ThreadRoutine() {
           getpid(), gettid(), strerror(errno));
   }
 
+  struct epoll_event events[MAX_EPOLL_EVENTS];
   while (running_) {
-    fd_set read_fds;
-    FD_ZERO(&read_fds);
-    FD_SET(notification_listen_fd_, &read_fds);
-    int max_read_fd = INVALID_FD;
-    for (auto& it : watched_fds_) {
-      FD_SET(it.first, &read_fds);
-      max_read_fd = std::max(max_read_fd, it.first);
-    }
-
-    struct timeval timeout;
-    struct timeval* timeout_ptr = NULL;
+    int timeout = -1;
     if (timeout_ms_ > std::chrono::milliseconds(0)) {
-      timeout.tv_sec = timeout_ms_.count() / 1000;
-      timeout.tv_usec = (timeout_ms_.count() % 1000) * 1000;
-      timeout_ptr = &timeout;
+      timeout = timeout_ms_.count();
     }
 
     // Wait until there is data available to read on some FD.
-    int nfds = std::max(notification_listen_fd_, max_read_fd);
-    int retval = select(nfds + 1, &read_fds, NULL, NULL, timeout_ptr);
+    int retval = epoll_wait(epoll_fd_, events, MAX_EPOLL_EVENTS, timeout);
 
     // There was some error.
     if (retval < 0) continue;
@@ -166,19 +207,24 @@ void AsyncFdWatcher::ThreadRoutine() {
     }
 
     // Read data from the notification FD.
-    if (FD_ISSET(notification_listen_fd_, &read_fds)) {
-      char buffer[] = {0};
-      TEMP_FAILURE_RETRY(read(notification_listen_fd_, buffer, 1));
-      continue;
+    bool notified = false;
+    for (int i = 0; i < retval; i++) {
+      if (events[i].data.fd == notification_listen_fd_) {
+        char buffer[] = {0};
+        TEMP_FAILURE_RETRY(read(notification_listen_fd_, buffer, 1));
+        notified = true;
+      }
     }
+    if (notified) continue;
 
     // Invoke the data ready callbacks if appropriate.
     {
       // Hold the mutex to make sure that the callbacks are still valid.
       std::unique_lock<std::mutex> guard(internal_mutex_);
-      for (auto& it : watched_fds_) {
-        if (FD_ISSET(it.first, &read_fds)) {
-          it.second(it.first);
+      for (int i = 0; i < retval; i++) {
+        auto it = watched_fds_.find(events[i].data.fd);
+        if (it != watched_fds_.end()) {
+          it->second(it->first);
         }
       }
     }
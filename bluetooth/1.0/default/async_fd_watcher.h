@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <functional>
 #include <map>
 #include <mutex>
 #include <thread>
@@ -44,6 +46,7 @@ class AsyncFdWatcher {
   AsyncFdWatcher& operator=(const AsyncFdWatcher&) = delete;
 
   int tryStartThread();
+  int addToEpoll(int file_descriptor);
   int stopThread();
   int notifyThread();
   void ThreadRoutine();
@@ -54,6 +57,7 @@ class AsyncFdWatcher {
   std::mutex timeout_mutex_;
 
   std::map<int, ReadCallback> watched_fds_;
+  int epoll_fd_{-1};
   int notification_listen_fd_;
   int notification_write_fd_;
   TimeoutCallback timeout_cb_;
@@ -0,0 +1,156 @@
+//
+// Copyright 2022 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Measures inbound H4 packets per second over a loopback pty, comparing the
+// buffered reader with the per-packet HciPacketizer.
+
+#include <benchmark/benchmark.h>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <thread>
+#include <vector>
+
+#include "hci_buffered_reader.h"
+#include "hci_packetizer.h"
+
+using ::android::hardware::hidl_vec;
+using ::android::hardware::bluetooth::hci::HciBufferedReader;
+using ::android::hardware::bluetooth::hci::HciPacketizer;
+using ::benchmark::Counter;
+using ::benchmark::State;
+
+namespace {
+
+const size_t kPacketsPerBurst = 1000;
+
+class LoopbackPty {
+ public:
+  LoopbackPty() {
+    master_ = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master_ < 0 || grantpt(master_) || unlockpt(master_)) return;
+    slave_ = open(ptsname(master_), O_RDWR | O_NOCTTY);
+    if (slave_ < 0) return;
+    struct termios tio;
+    tcgetattr(slave_, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave_, TCSANOW, &tio);
+  }
+  ~LoopbackPty() {
+    if (slave_ >= 0) close(slave_);
+    if (master_ >= 0) close(master_);
+  }
+
+  bool ok() const { return master_ >= 0 && slave_ >= 0; }
+  // The "controller" side.
+  int controller() const { return master_; }
+  // The side the HAL reads from.
+  int host() const { return slave_; }
+
+ private:
+  int master_{-1};
+  int slave_{-1};
+};
+
+std::vector<uint8_t> AclBurst(size_t payload_length) {
+  std::vector<uint8_t> burst;
+  for (size_t i = 0; i < kPacketsPerBurst; i++) {
+    uint8_t header[] = {HCI_PACKET_TYPE_ACL_DATA, 0x01, 0x20,
+                        static_cast<uint8_t>(payload_length & 0xFF),
+                        static_cast<uint8_t>(payload_length >> 8)};
+    burst.insert(burst.end(), header, header + sizeof(header));
+    burst.insert(burst.end(), payload_length, static_cast<uint8_t>(i));
+  }
+  return burst;
+}
+
+void WriteAll(int fd, const std::vector<uint8_t>& data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t ret = TEMP_FAILURE_RETRY(
+        write(fd, data.data() + written, data.size() - written));
+    if (ret <= 0) return;
+    written += ret;
+  }
+}
+
+template <typename ReadOnce>
+void RunBursts(State& state, const LoopbackPty& pty,
+               const std::vector<uint8_t>& burst, size_t& received,
+               ReadOnce read_once) {
+  for (auto _ : state) {
+    received = 0;
+    std::thread writer([&]() { WriteAll(pty.controller(), burst); });
+    while (received < kPacketsPerBurst) read_once();
+    writer.join();
+  }
+  state.SetItemsProcessed(state.iterations() * kPacketsPerBurst);
+  state.SetBytesProcessed(state.iterations() * burst.size());
+  state.counters["packets_per_second"] =
+      Counter(state.iterations() * kPacketsPerBurst, Counter::kIsRate);
+}
+
+void BM_BufferedReader(State& state) {
+  LoopbackPty pty;
+  if (!pty.ok()) {
+    state.SkipWithError("Unable to open a pty");
+    return;
+  }
+  std::vector<uint8_t> burst = AclBurst(state.range(0));
+  size_t received = 0;
+  HciBufferedReader reader(
+      HCI_PACKET_TYPE_UNKNOWN,
+      [&received](HciPacketType, const hidl_vec<uint8_t>&) { received++; });
+  RunBursts(state, pty, burst, received, [&]() {
+    reader.OnDataReady(pty.host());
+  });
+}
+
+void BM_Packetizer(State& state) {
+  LoopbackPty pty;
+  if (!pty.ok()) {
+    state.SkipWithError("Unable to open a pty");
+    return;
+  }
+  std::vector<uint8_t> burst = AclBurst(state.range(0));
+  size_t received = 0;
+  HciPacketType type = HCI_PACKET_TYPE_UNKNOWN;
+  HciPacketizer packetizer([&]() {
+    received++;
+    type = HCI_PACKET_TYPE_UNKNOWN;
+  });
+  RunBursts(state, pty, burst, received, [&]() {
+    if (type == HCI_PACKET_TYPE_UNKNOWN) {
+      uint8_t indicator;
+      if (TEMP_FAILURE_RETRY(read(pty.host(), &indicator, 1)) == 1) {
+        type = static_cast<HciPacketType>(indicator);
+      }
+    } else {
+      packetizer.OnDataReady(pty.host(), type);
+    }
+  });
+}
+
+}  // namespace
+
+// Payload sizes: small LE audio frames, LE max, BR/EDR 3-DH5.
+BENCHMARK(BM_BufferedReader)->Arg(40)->Arg(251)->Arg(1021)->UseRealTime();
+BENCHMARK(BM_Packetizer)->Arg(40)->Arg(251)->Arg(1021)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -20,6 +20,7 @@
 
 #include "async_fd_watcher.h"
 #include "bt_vendor_lib.h"
+#include "hci_buffered_reader.h"
 #include "hci_internals.h"
 #include "hci_protocol.h"
 
@@ -37,11 +38,14 @@ class H4Protocol : public HciProtocol {
         acl_cb_(acl_cb),
         sco_cb_(sco_cb),
         iso_cb_(iso_cb),
-        hci_packetizer_([this]() { OnPacketReady(); }) {}
+        hci_reader_(HCI_PACKET_TYPE_UNKNOWN,
+                    [this](HciPacketType type, const hidl_vec<uint8_t>& packet) {
+                      OnPacketReady(type, packet);
+                    }) {}
 
   size_t Send(uint8_t type, const uint8_t* data, size_t length);
 
-  void OnPacketReady();
+  void OnPacketReady(HciPacketType type, const hidl_vec<uint8_t>& packet);
 
   void OnDataReady(int fd);
 
@@ -53,8 +57,7 @@ class H4Protocol : public HciProtocol {
   PacketReadCallback sco_cb_;
   PacketReadCallback iso_cb_;
 
-  HciPacketType hci_packet_type_{HCI_PACKET_TYPE_UNKNOWN};
-  hci::HciPacketizer hci_packetizer_;
+  hci::HciBufferedReader hci_reader_;
 };
 
 }  // namespace hci
@@ -0,0 +1,124 @@
+//
+// Copyright 2022 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "hci_buffered_reader.h"
+
+#define LOG_TAG "android.hardware.bluetooth.hci_buffered_reader"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <utils/Log.h>
+
+#include <algorithm>
+
+#include "hci_packetizer.h"
+
+namespace {
+
+// H4 type indicator + largest preamble + largest (ACL) payload.
+const size_t kMaxPacketSize = 1 + HCI_PREAMBLE_SIZE_MAX + 0xFFFF;
+
+}  // namespace
+
+namespace android {
+namespace hardware {
+namespace bluetooth {
+namespace hci {
+
+static_assert(HciBufferedReader::kBufferSize > kMaxPacketSize,
+              "The read buffer must hold the largest possible packet");
+
+HciBufferedReader::HciBufferedReader(HciPacketType stream_type,
+                                     HciPacketViewCallback packet_cb)
+    : stream_type_(stream_type),
+      packet_cb_(packet_cb),
+      buffer_(new uint8_t[kBufferSize]) {}
+
+void HciBufferedReader::OnDataReady(int fd) {
+  ssize_t bytes_read = TEMP_FAILURE_RETRY(
+      read(fd, buffer_.get() + end_, kBufferSize - end_));
+  if (bytes_read == 0) {
+    // This is only expected if the UART got closed when shutting down.
+    ALOGE("%s: Unexpected EOF reading from the UART!", __func__);
+    sleep(5);  // Expect to be shut down within 5 seconds.
+    return;
+  }
+  if (bytes_read < 0) {
+    LOG_ALWAYS_FATAL("%s: Read error: %s", __func__, strerror(errno));
+  }
+  end_ += bytes_read;
+  DispatchPackets();
+}
+
+void HciBufferedReader::OnDataReceived(const uint8_t* data, size_t length) {
+  while (length > 0) {
+    size_t chunk = std::min(length, kBufferSize - end_);
+    memcpy(buffer_.get() + end_, data, chunk);
+    end_ += chunk;
+    data += chunk;
+    length -= chunk;
+    DispatchPackets();
+  }
+}
+
+void HciBufferedReader::DispatchPackets() {
+  while (begin_ < end_) {
+    uint8_t* packet = buffer_.get() + begin_;
+    size_t available = end_ - begin_;
+    HciPacketType type = stream_type_;
+    size_t indicator_size = 0;
+
+    if (type == HCI_PACKET_TYPE_UNKNOWN) {
+      type = static_cast<HciPacketType>(packet[0]);
+      if (type != HCI_PACKET_TYPE_ACL_DATA &&
+          type != HCI_PACKET_TYPE_SCO_DATA &&
+          type != HCI_PACKET_TYPE_ISO_DATA && type != HCI_PACKET_TYPE_EVENT) {
+        LOG_ALWAYS_FATAL("%s: Unimplemented packet type %d", __func__,
+                         static_cast<int>(type));
+      }
+      indicator_size = 1;
+      packet++;
+      available--;
+    }
+
+    size_t preamble_size = HciGetPreambleSizeForType(type);
+    if (available < preamble_size) break;
+    size_t packet_size =
+        preamble_size + HciGetPacketLengthForType(type, packet);
+    if (available < packet_size) break;
+
+    view_.setToExternal(packet, packet_size);
+    packet_cb_(type, view_);
+    begin_ += indicator_size + packet_size;
+  }
+
+  if (begin_ == end_) {
+    begin_ = 0;
+    end_ = 0;
+  } else if (begin_ + kMaxPacketSize > kBufferSize) {
+    // Only the tail of one packet is left; move it to the front so that the
+    // rest of the packet can be read contiguously.
+    memmove(buffer_.get(), buffer_.get() + begin_, end_ - begin_);
+    end_ -= begin_;
+    begin_ = 0;
+  }
+}
+
+}  // namespace hci
+}  // namespace bluetooth
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,78 @@
+//
+// Copyright 2022 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include <functional>
+#include <memory>
+
+#include <hidl/HidlSupport.h>
+
+#include "hci_internals.h"
+
+namespace android {
+namespace hardware {
+namespace bluetooth {
+namespace hci {
+
+using ::android::hardware::hidl_vec;
+
+// Called once per complete packet.  The packet is a view into the reader's
+// buffer and is only valid for the duration of the call.
+using HciPacketViewCallback =
+    std::function<void(HciPacketType, const hidl_vec<uint8_t>&)>;
+
+// Reads an HCI byte stream with one read() per wakeup and dispatches every
+// complete packet found in the buffer.
+//
+// If constructed with HCI_PACKET_TYPE_UNKNOWN the stream is treated as H4, and
+// each packet is expected to be prefixed with its packet type indicator.
+// Otherwise the stream carries packets of a single type (MCT channels).
+class HciBufferedReader {
+ public:
+  // Large enough to hold the biggest possible ACL packet plus the tail of a
+  // previous read.
+  static constexpr size_t kBufferSize = 128 * 1024;
+
+  HciBufferedReader(HciPacketType stream_type, HciPacketViewCallback packet_cb);
+
+  // Reads whatever is available on |fd| and dispatches complete packets.
+  void OnDataReady(int fd);
+
+  // Parses |length| bytes as if they had been read from the stream.  Used when
+  // the bytes do not come from a file descriptor.
+  void OnDataReceived(const uint8_t* data, size_t length);
+
+ private:
+  HciBufferedReader(const HciBufferedReader&) = delete;
+  HciBufferedReader& operator=(const HciBufferedReader&) = delete;
+
+  // Dispatches all complete packets in [begin_, end_) and moves the trailing
+  // partial packet, if any, to the start of the buffer.
+  void DispatchPackets();
+
+  HciPacketType stream_type_;
+  HciPacketViewCallback packet_cb_;
+  std::unique_ptr<uint8_t[]> buffer_;
+  size_t begin_{0};
+  size_t end_{0};
+  hidl_vec<uint8_t> view_;
+};
+
+}  // namespace hci
+}  // namespace bluetooth
+}  // namespace hardware
+}  // namespace android
@@ -39,6 +39,17 @@ const size_t packet_length_offset_for_type[] = {0,
                                                 HCI_LENGTH_OFFSET_EVT,
                                                 HCI_LENGTH_OFFSET_ISO};
 
+}  // namespace
+
+namespace android {
+namespace hardware {
+namespace bluetooth {
+namespace hci {
+
+size_t HciGetPreambleSizeForType(HciPacketType type) {
+  return preamble_size_for_type[type];
+}
+
 size_t HciGetPacketLengthForType(HciPacketType type, const uint8_t* preamble) {
   size_t offset = packet_length_offset_for_type[type];
   if (type == HCI_PACKET_TYPE_ACL_DATA) {
@@ -49,13 +60,6 @@ size_t HciGetPacketLengthForType(HciPacketType type, const uint8_t* preamble) {
   return preamble[offset];
 }
 
-}  // namespace
-
-namespace android {
-namespace hardware {
-namespace bluetooth {
-namespace hci {
-
 const hidl_vec<uint8_t>& HciPacketizer::GetPacket() const { return packet_; }
 
 void HciPacketizer::OnDataReady(int fd, HciPacketType packet_type) {
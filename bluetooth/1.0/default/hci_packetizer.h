@@ -30,6 +30,11 @@ namespace hci {
 using ::android::hardware::hidl_vec;
 using HciPacketReadyCallback = std::function<void(void)>;
 
+// Size of the preamble (header) for packets of |type|.
+size_t HciGetPreambleSizeForType(HciPacketType type);
+// Payload length encoded in the |preamble| of a packet of |type|.
+size_t HciGetPacketLengthForType(HciPacketType type, const uint8_t* preamble);
+
 class HciPacketizer {
  public:
   HciPacketizer(HciPacketReadyCallback packet_cb)
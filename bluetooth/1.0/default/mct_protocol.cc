@@ -32,8 +32,14 @@ MctProtocol::MctProtocol(int* fds, PacketReadCallback event_cb,
                          PacketReadCallback acl_cb)
     : event_cb_(event_cb),
       acl_cb_(acl_cb),
-      event_packetizer_([this]() { OnEventPacketReady(); }),
-      acl_packetizer_([this]() { OnAclDataPacketReady(); }) {
+      event_reader_(HCI_PACKET_TYPE_EVENT,
+                    [this](HciPacketType, const hidl_vec<uint8_t>& packet) {
+                      OnEventPacketReady(packet);
+                    }),
+      acl_reader_(HCI_PACKET_TYPE_ACL_DATA,
+                  [this](HciPacketType, const hidl_vec<uint8_t>& packet) {
+                    OnAclDataPacketReady(packet);
+                  }) {
   for (int i = 0; i < CH_MAX; i++) {
     uart_fds_[i] = fds[i];
   }
@@ -48,21 +54,17 @@ size_t MctProtocol::Send(uint8_t type, const uint8_t* data, size_t length) {
   return 0;
 }
 
-void MctProtocol::OnEventPacketReady() {
-  event_cb_(event_packetizer_.GetPacket());
+void MctProtocol::OnEventPacketReady(const hidl_vec<uint8_t>& packet) {
+  event_cb_(packet);
 }
 
-void MctProtocol::OnAclDataPacketReady() {
-  acl_cb_(acl_packetizer_.GetPacket());
+void MctProtocol::OnAclDataPacketReady(const hidl_vec<uint8_t>& packet) {
+  acl_cb_(packet);
 }
 
-void MctProtocol::OnEventDataReady(int fd) {
-  event_packetizer_.OnDataReady(fd, HCI_PACKET_TYPE_EVENT);
-}
+void MctProtocol::OnEventDataReady(int fd) { event_reader_.OnDataReady(fd); }
 
-void MctProtocol::OnAclDataReady(int fd) {
-  acl_packetizer_.OnDataReady(fd, HCI_PACKET_TYPE_ACL_DATA);
-}
+void MctProtocol::OnAclDataReady(int fd) { acl_reader_.OnDataReady(fd); }
 
 }  // namespace hci
 }  // namespace bluetooth
@@ -20,6 +20,7 @@
 
 #include "async_fd_watcher.h"
 #include "bt_vendor_lib.h"
+#include "hci_buffered_reader.h"
 #include "hci_internals.h"
 #include "hci_protocol.h"
 
@@ -34,8 +35,8 @@ class MctProtocol : public HciProtocol {
 
   size_t Send(uint8_t type, const uint8_t* data, size_t length);
 
-  void OnEventPacketReady();
-  void OnAclDataPacketReady();
+  void OnEventPacketReady(const hidl_vec<uint8_t>& packet);
+  void OnAclDataPacketReady(const hidl_vec<uint8_t>& packet);
 
   void OnEventDataReady(int fd);
   void OnAclDataReady(int fd);
@@ -46,8 +47,8 @@ class MctProtocol : public HciProtocol {
   PacketReadCallback event_cb_;
   PacketReadCallback acl_cb_;
 
-  hci::HciPacketizer event_packetizer_;
-  hci::HciPacketizer acl_packetizer_;
+  hci::HciBufferedReader event_reader_;
+  hci::HciBufferedReader acl_reader_;
 };
 
 }  // namespace hci
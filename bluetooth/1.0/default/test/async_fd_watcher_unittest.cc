@@ -22,6 +22,7 @@
 #include <cstring>
 #include <vector>
 
+#include <dirent.h>
 #include <log/log.h>
 #include <netdb.h>
 #include <netinet/in.h>
@@ -385,6 +386,32 @@ TEST_F(AsyncFdWatcherSocketTest, RepeatedTimeOutTest) {
   CleanUpServer();
 }
 
+// Counts the open file descriptors of this process.
+static int CountOpenFds() {
+  int count = 0;
+  DIR* dir = opendir("/proc/self/fd");
+  while (readdir(dir) != nullptr) count++;
+  closedir(dir);
+  return count;
+}
+
+// epoll cannot watch a regular file, so starting the thread fails. The failed
+// start must not leak descriptors, and the next attempt must not assume that
+// the thread is running.
+TEST(AsyncFdWatcherTest, FailedStartReleasesFds) {
+  FILE* file = tmpfile();
+  ASSERT_NE(file, nullptr);
+  int fds_before = CountOpenFds();
+
+  AsyncFdWatcher watcher;
+  EXPECT_EQ(-1, watcher.WatchFdForNonBlockingReads(fileno(file), [](int) {}));
+  EXPECT_EQ(fds_before, CountOpenFds());
+  EXPECT_EQ(-1, watcher.WatchFdForNonBlockingReads(fileno(file), [](int) {}));
+  EXPECT_EQ(fds_before, CountOpenFds());
+
+  fclose(file);
+}
+
 }  // namespace implementation
 }  // namespace V1_0
 }  // namespace bluetooth
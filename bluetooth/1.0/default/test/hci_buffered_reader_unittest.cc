@@ -0,0 +1,158 @@
+//
+// Copyright 2022 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#define LOG_TAG "bt_hci_buffered_reader_unittest"
+
+#include "hci_buffered_reader.h"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace android {
+namespace hardware {
+namespace bluetooth {
+namespace V1_0 {
+namespace implementation {
+
+using hci::HciBufferedReader;
+
+struct ReceivedPacket {
+  HciPacketType type;
+  std::vector<uint8_t> bytes;
+};
+
+class HciBufferedReaderTest : public ::testing::Test {
+ protected:
+  void OnPacket(HciPacketType type, const hidl_vec<uint8_t>& packet) {
+    packets_.push_back(
+        {type, std::vector<uint8_t>(packet.data(), packet.data() + packet.size())});
+  }
+
+  // h4 type[1] + handle[2] + size[2] + payload
+  static std::vector<uint8_t> H4AclPacket(size_t payload_length, uint8_t fill) {
+    std::vector<uint8_t> packet = {HCI_PACKET_TYPE_ACL_DATA, 19, 92,
+                                   static_cast<uint8_t>(payload_length & 0xFF),
+                                   static_cast<uint8_t>(payload_length >> 8)};
+    packet.insert(packet.end(), payload_length, fill);
+    return packet;
+  }
+
+  // h4 type[1] + event_code[1] + size[1] + payload
+  static std::vector<uint8_t> H4Event(size_t payload_length, uint8_t fill) {
+    std::vector<uint8_t> packet = {HCI_PACKET_TYPE_EVENT, 9,
+                                   static_cast<uint8_t>(payload_length)};
+    packet.insert(packet.end(), payload_length, fill);
+    return packet;
+  }
+
+  std::vector<ReceivedPacket> packets_;
+};
+
+// Several packets delivered in one read are all dispatched.
+TEST_F(HciBufferedReaderTest, MultiplePacketsInOneRead) {
+  HciBufferedReader reader(
+      HCI_PACKET_TYPE_UNKNOWN,
+      [this](HciPacketType type, const hidl_vec<uint8_t>& packet) {
+        OnPacket(type, packet);
+      });
+
+  std::vector<uint8_t> stream = H4AclPacket(27, 0xa1);
+  std::vector<uint8_t> event = H4Event(4, 0xe1);
+  stream.insert(stream.end(), event.begin(), event.end());
+  std::vector<uint8_t> acl = H4AclPacket(251, 0xa2);
+  stream.insert(stream.end(), acl.begin(), acl.end());
+
+  int sockfd[2];
+  ASSERT_EQ(0, socketpair(AF_LOCAL, SOCK_STREAM, 0, sockfd));
+  ASSERT_EQ(static_cast<ssize_t>(stream.size()),
+            write(sockfd[1], stream.data(), stream.size()));
+  reader.OnDataReady(sockfd[0]);
+  close(sockfd[0]);
+  close(sockfd[1]);
+
+  ASSERT_EQ(3u, packets_.size());
+  EXPECT_EQ(HCI_PACKET_TYPE_ACL_DATA, packets_[0].type);
+  EXPECT_EQ(4u + 27u, packets_[0].bytes.size());
+  EXPECT_EQ(HCI_PACKET_TYPE_EVENT, packets_[1].type);
+  EXPECT_EQ(std::vector<uint8_t>(event.begin() + 1, event.end()),
+            packets_[1].bytes);
+  EXPECT_EQ(HCI_PACKET_TYPE_ACL_DATA, packets_[2].type);
+  EXPECT_EQ(std::vector<uint8_t>(acl.begin() + 1, acl.end()),
+            packets_[2].bytes);
+}
+
+// Packets split at every possible offset are reassembled.
+TEST_F(HciBufferedReaderTest, PacketsSplitAcrossReads) {
+  HciBufferedReader reader(
+      HCI_PACKET_TYPE_UNKNOWN,
+      [this](HciPacketType type, const hidl_vec<uint8_t>& packet) {
+        OnPacket(type, packet);
+      });
+
+  std::vector<uint8_t> stream = H4Event(12, 0xe2);
+  std::vector<uint8_t> acl = H4AclPacket(40, 0xa3);
+  stream.insert(stream.end(), acl.begin(), acl.end());
+
+  for (size_t i = 0; i < stream.size(); i++) {
+    reader.OnDataReceived(&stream[i], 1);
+  }
+
+  ASSERT_EQ(2u, packets_.size());
+  EXPECT_EQ(HCI_PACKET_TYPE_EVENT, packets_[0].type);
+  EXPECT_EQ(HCI_PACKET_TYPE_ACL_DATA, packets_[1].type);
+  EXPECT_EQ(std::vector<uint8_t>(acl.begin() + 1, acl.end()),
+            packets_[1].bytes);
+}
+
+// A stream of maximum-size packets forces the partial tail to be compacted.
+TEST_F(HciBufferedReaderTest, LargePacketsWrapBuffer) {
+  HciBufferedReader reader(
+      HCI_PACKET_TYPE_ACL_DATA,
+      [this](HciPacketType type, const hidl_vec<uint8_t>& packet) {
+        OnPacket(type, packet);
+      });
+
+  const size_t kPackets = 8;
+  std::vector<uint8_t> stream;
+  for (size_t i = 0; i < kPackets; i++) {
+    std::vector<uint8_t> acl = H4AclPacket(0xFFFF, static_cast<uint8_t>(i));
+    // MCT channels carry no packet type indicator.
+    stream.insert(stream.end(), acl.begin() + 1, acl.end());
+  }
+
+  const size_t kChunk = 10000;
+  for (size_t offset = 0; offset < stream.size(); offset += kChunk) {
+    reader.OnDataReceived(stream.data() + offset,
+                          std::min(kChunk, stream.size() - offset));
+  }
+
+  ASSERT_EQ(kPackets, packets_.size());
+  for (size_t i = 0; i < kPackets; i++) {
+    EXPECT_EQ(4u + 0xFFFF, packets_[i].bytes.size());
+    EXPECT_EQ(static_cast<uint8_t>(i), packets_[i].bytes.back());
+  }
+}
+
+}  // namespace implementation
+}  // namespace V1_0
+}  // namespace bluetooth
+}  // namespace hardware
+}  // namespace android
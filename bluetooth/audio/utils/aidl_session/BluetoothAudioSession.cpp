@@ -21,6 +21,8 @@
 #include <android-base/stringprintf.h>
 #include <android/binder_manager.h>
 
+#include <algorithm>
+
 #include "BluetoothAudioSession.h"
 
 namespace aidl {
@@ -32,8 +34,14 @@ namespace audio {
 static constexpr int kFmqSendTimeoutMs = 1000;  // 1000 ms timeout for sending
 static constexpr int kFmqReceiveTimeoutMs =
     1000;                               // 1000 ms timeout for receiving
+// Wait slice used until the peer is seen signalling the EventFlag; peers that
+// only use the non-blocking FMQ read / write never wake us up.
 static constexpr int kWritePollMs = 1;  // polled non-blocking interval
 static constexpr int kReadPollMs = 1;   // polled non-blocking interval
+// Same bits as the libfmq readBlocking / writeBlocking defaults, so a peer
+// using those interoperates with this session.
+static constexpr uint32_t kFmqNotEmpty = 1 << 0;
+static constexpr uint32_t kFmqNotFull = 1 << 1;
 
 BluetoothAudioSession::BluetoothAudioSession(const SessionType& session_type)
     : session_type_(session_type), stack_iface_(nullptr), data_mq_(nullptr) {}
@@ -74,7 +82,15 @@ void BluetoothAudioSession::OnSessionStarted(
 void BluetoothAudioSession::OnSessionEnded() {
   std::lock_guard<std::recursive_mutex> guard(mutex_);
   bool toggled = IsSessionReady();
-  LOG(INFO) << __func__ << " - SessionType=" << toString(session_type_);
+  LOG(INFO) << __func__ << " - SessionType=" << toString(session_type_)
+            << ", bytes=" << data_path_stats_.bytes_transferred
+            << ", waits=" << data_path_stats_.waits
+            << ", overruns=" << data_path_stats_.overruns
+            << ", underruns=" << data_path_stats_.underruns
+            << ", max_wait_us="
+            << std::chrono::duration_cast<std::chrono::microseconds>(
+                   data_path_stats_.max_wait)
+                   .count();
   audio_config_ = nullptr;
   leaudio_connection_map_ = nullptr;
   stack_iface_ = nullptr;
@@ -310,17 +326,34 @@ void BluetoothAudioSession::StopStream() {
  ***/
 
 bool BluetoothAudioSession::UpdateDataPath(const DataMQDesc* mq_desc) {
+  if (data_mq_ev_flag_ != nullptr) {
+    // release any writer / reader still waiting on the old data path
+    data_mq_ev_flag_->wake(kFmqNotEmpty | kFmqNotFull);
+  }
+  data_mq_ev_flag_ = nullptr;
+  data_mq_peer_signals_ = false;
+  data_path_stats_ = DataPathStatistics();
   if (mq_desc == nullptr) {
     // usecase of reset by nullptr
     data_mq_ = nullptr;
     return true;
   }
-  std::unique_ptr<DataMQ> temp_mq;
-  temp_mq.reset(new DataMQ(*mq_desc));
+  std::shared_ptr<DataMQ> temp_mq = std::make_shared<DataMQ>(*mq_desc);
   if (!temp_mq || !temp_mq->isValid()) {
     data_mq_ = nullptr;
     return false;
   }
+  EventFlag* ev_flag = nullptr;
+  if (temp_mq->getEventFlagWord() != nullptr &&
+      EventFlag::createEventFlag(temp_mq->getEventFlagWord(), &ev_flag) ==
+          ::android::OK) {
+    // the EventFlag word lives in the FMQ, so hold on to it until deleted
+    data_mq_ev_flag_ = std::shared_ptr<EventFlag>(
+        ev_flag, [temp_mq](EventFlag* ef) { EventFlag::deleteEventFlag(&ef); });
+  } else {
+    LOG(WARNING) << __func__ << " - SessionType=" << toString(session_type_)
+                 << " has no EventFlag, polling the data path";
+  }
   data_mq_ = std::move(temp_mq);
   return true;
 }
@@ -391,15 +424,52 @@ void BluetoothAudioSession::ReportSessionStatus() {
  *
  ***/
 
+void BluetoothAudioSession::WaitForDataPath(
+    std::unique_lock<std::recursive_mutex>& lock, uint32_t event_bit,
+    std::chrono::nanoseconds time_left) {
+  std::shared_ptr<EventFlag> ev_flag = data_mq_ev_flag_;
+  int poll_ms = (event_bit == kFmqNotFull) ? kWritePollMs : kReadPollMs;
+  std::chrono::nanoseconds wait_time =
+      data_mq_peer_signals_
+          ? time_left
+          : std::min(time_left, std::chrono::nanoseconds(
+                                    std::chrono::milliseconds(poll_ms)));
+  lock.unlock();
+
+  auto start = std::chrono::steady_clock::now();
+  bool signalled = false;
+  if (ev_flag != nullptr) {
+    uint32_t ef_state = 0;
+    ev_flag->wait(event_bit, &ef_state, wait_time.count());
+    signalled = (ef_state & event_bit) != 0;
+  } else {
+    usleep(std::chrono::duration_cast<std::chrono::microseconds>(wait_time)
+               .count());
+  }
+  auto waited = std::chrono::steady_clock::now() - start;
+
+  lock.lock();
+  if (ev_flag != data_mq_ev_flag_) {
+    // the data path was replaced while waiting
+    return;
+  }
+  if (signalled) data_mq_peer_signals_ = true;
+  data_path_stats_.waits++;
+  data_path_stats_.max_wait = std::max(
+      data_path_stats_.max_wait,
+      std::chrono::duration_cast<std::chrono::nanoseconds>(waited));
+}
+
 size_t BluetoothAudioSession::OutWritePcmData(const void* buffer,
                                               size_t bytes) {
   if (buffer == nullptr || bytes <= 0) {
     return 0;
   }
   size_t total_written = 0;
-  int timeout_ms = kFmqSendTimeoutMs;
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(kFmqSendTimeoutMs);
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
   do {
-    std::unique_lock<std::recursive_mutex> lock(mutex_);
     if (!IsSessionReady()) {
       break;
     }
@@ -417,13 +487,19 @@ size_t BluetoothAudioSession::OutWritePcmData(const void* buffer,
         return total_written;
       }
       total_written += num_bytes_to_write;
-    } else if (timeout_ms >= kWritePollMs) {
-      lock.unlock();
-      usleep(kWritePollMs * 1000);
-      timeout_ms -= kWritePollMs;
+      data_path_stats_.bytes_transferred += num_bytes_to_write;
+      if (data_mq_ev_flag_ != nullptr) {
+        data_mq_ev_flag_->wake(kFmqNotEmpty);
+      }
+      continue;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now < deadline) {
+      WaitForDataPath(lock, kFmqNotFull, deadline - now);
     } else {
+      data_path_stats_.overruns++;
       LOG(DEBUG) << "Data " << total_written << "/" << bytes << " overflow "
-                 << (kFmqSendTimeoutMs - timeout_ms) << " ms";
+                 << kFmqSendTimeoutMs << " ms";
       return total_written;
     }
   } while (total_written < bytes);
@@ -435,9 +511,10 @@ size_t BluetoothAudioSession::InReadPcmData(void* buffer, size_t bytes) {
     return 0;
   }
   size_t total_read = 0;
-  int timeout_ms = kFmqReceiveTimeoutMs;
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(kFmqReceiveTimeoutMs);
+  std::unique_lock<std::recursive_mutex> lock(mutex_);
   do {
-    std::unique_lock<std::recursive_mutex> lock(mutex_);
     if (!IsSessionReady()) {
       break;
     }
@@ -453,20 +530,30 @@ size_t BluetoothAudioSession::InReadPcmData(void* buffer, size_t bytes) {
         return total_read;
       }
       total_read += num_bytes_to_read;
-    } else if (timeout_ms >= kReadPollMs) {
-      lock.unlock();
-      usleep(kReadPollMs * 1000);
-      timeout_ms -= kReadPollMs;
+      data_path_stats_.bytes_transferred += num_bytes_to_read;
+      if (data_mq_ev_flag_ != nullptr) {
+        data_mq_ev_flag_->wake(kFmqNotFull);
+      }
       continue;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now < deadline) {
+      WaitForDataPath(lock, kFmqNotEmpty, deadline - now);
     } else {
+      data_path_stats_.underruns++;
       LOG(DEBUG) << "Data " << total_read << "/" << bytes << " overflow "
-                 << (kFmqReceiveTimeoutMs - timeout_ms) << " ms";
+                 << kFmqReceiveTimeoutMs << " ms";
       return total_read;
     }
   } while (total_read < bytes);
   return total_read;
 }
 
+DataPathStatistics BluetoothAudioSession::GetDataPathStatistics() {
+  std::lock_guard<std::recursive_mutex> guard(mutex_);
+  return data_path_stats_;
+}
+
 /***
  *
  * Other methods
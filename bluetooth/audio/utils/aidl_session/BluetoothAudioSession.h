@@ -23,8 +23,10 @@
 #include <aidl/android/hardware/bluetooth/audio/LatencyMode.h>
 #include <aidl/android/hardware/bluetooth/audio/SessionType.h>
 #include <fmq/AidlMessageQueue.h>
+#include <fmq/EventFlag.h>
 #include <hardware/audio.h>
 
+#include <chrono>
 #include <mutex>
 #include <unordered_map>
 #include <vector>
@@ -38,6 +40,7 @@ namespace audio {
 using ::aidl::android::hardware::common::fmq::MQDescriptor;
 using ::aidl::android::hardware::common::fmq::SynchronizedReadWrite;
 using ::android::AidlMessageQueue;
+using ::android::hardware::EventFlag;
 
 using ::aidl::android::hardware::audio::common::SinkMetadata;
 using ::aidl::android::hardware::audio::common::SourceMetadata;
@@ -111,6 +114,23 @@ struct PortStatusCallbacks {
   std::function<void(uint16_t cookie)> soft_audio_configuration_changed_cb_;
 };
 
+/***
+ * Software data path (FMQ) statistics of one session. They are reset every
+ * time the Bluetooth stack starts a new session.
+ ***/
+struct DataPathStatistics {
+  // bytes moved through the FMQ
+  uint64_t bytes_transferred = 0;
+  // times OutWritePcmData / InReadPcmData had to wait for the peer
+  uint64_t waits = 0;
+  // OutWritePcmData calls that timed out with the FMQ still full
+  uint64_t overruns = 0;
+  // InReadPcmData calls that timed out with the FMQ still empty
+  uint64_t underruns = 0;
+  // longest single wait for the peer
+  std::chrono::nanoseconds max_wait{0};
+};
+
 class BluetoothAudioSession {
  public:
   BluetoothAudioSession(const SessionType& session_type);
@@ -204,6 +224,8 @@ class BluetoothAudioSession {
   size_t OutWritePcmData(const void* buffer, size_t bytes);
   // The control function read stream from FMQ
   size_t InReadPcmData(void* buffer, size_t bytes);
+  // The control function returns the FMQ statistics of the current session
+  DataPathStatistics GetDataPathStatistics();
 
   // Return if IBluetoothAudioProviderFactory implementation existed
   static bool IsAidlAvailable();
@@ -216,7 +238,12 @@ class BluetoothAudioSession {
   // audio control path to use for both software and offloading
   std::shared_ptr<IBluetoothAudioPort> stack_iface_;
   // audio data path (FMQ) for software encoding
-  std::unique_ptr<DataMQ> data_mq_;
+  std::shared_ptr<DataMQ> data_mq_;
+  // EventFlag of data_mq_; keeps data_mq_ alive while a writer / reader waits
+  std::shared_ptr<EventFlag> data_mq_ev_flag_;
+  // whether the peer has been seen waking us through the EventFlag
+  bool data_mq_peer_signals_ = false;
+  DataPathStatistics data_path_stats_;
   // audio data configuration for both software and offloading
   std::unique_ptr<AudioConfiguration> audio_config_;
   std::unique_ptr<AudioConfiguration> leaudio_connection_map_;
@@ -230,6 +257,10 @@ class BluetoothAudioSession {
       observers_;
 
   bool UpdateDataPath(const DataMQDesc* mq_desc);
+  // waits until the peer signals |event_bit| or |time_left| elapses; the lock
+  // is released while waiting
+  void WaitForDataPath(std::unique_lock<std::recursive_mutex>& lock,
+                       uint32_t event_bit, std::chrono::nanoseconds time_left);
   bool UpdateAudioConfig(const AudioConfiguration& audio_config);
   // invoking the registered session_changed_cb_
   void ReportSessionStatus();
@@ -219,6 +219,19 @@ class BluetoothAudioSessionControl {
     }
     return 0;
   }
+
+  /***
+   * The control API returns the FMQ statistics of the session
+   ***/
+  static DataPathStatistics GetDataPathStatistics(
+      const SessionType& session_type) {
+    std::shared_ptr<BluetoothAudioSession> session_ptr =
+        BluetoothAudioSessionInstance::GetSessionInstance(session_type);
+    if (session_ptr != nullptr) {
+      return session_ptr->GetDataPathStatistics();
+    }
+    return DataPathStatistics();
+  }
 };
 
 }  // namespace audio
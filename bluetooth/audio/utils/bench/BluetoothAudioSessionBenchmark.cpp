@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the latency of BluetoothAudioSession::OutWritePcmData over a
+// loopback provider: the time from handing a buffer to the session until the
+// provider side has consumed it.
+
+#include <aidl/android/hardware/bluetooth/audio/BnBluetoothAudioPort.h>
+#include <benchmark/benchmark.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "BluetoothAudioSession.h"
+
+using ::aidl::android::hardware::bluetooth::audio::AudioConfiguration;
+using ::aidl::android::hardware::bluetooth::audio::BluetoothAudioSession;
+using ::aidl::android::hardware::bluetooth::audio::BnBluetoothAudioPort;
+using ::aidl::android::hardware::bluetooth::audio::ChannelMode;
+using ::aidl::android::hardware::bluetooth::audio::DataMQ;
+using ::aidl::android::hardware::bluetooth::audio::DataPathStatistics;
+using ::aidl::android::hardware::bluetooth::audio::LatencyMode;
+using ::aidl::android::hardware::bluetooth::audio::PcmConfiguration;
+using ::aidl::android::hardware::bluetooth::audio::PresentationPosition;
+using ::aidl::android::hardware::bluetooth::audio::SessionType;
+using ::aidl::android::hardware::audio::common::SinkMetadata;
+using ::aidl::android::hardware::audio::common::SourceMetadata;
+using ::android::hardware::EventFlag;
+using ::benchmark::Counter;
+using ::benchmark::State;
+using ::ndk::ScopedAStatus;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Same bits as BluetoothAudioSession.
+constexpr uint32_t kFmqNotEmpty = 1 << 0;
+constexpr uint32_t kFmqNotFull = 1 << 1;
+// 20 ms of 48 kHz stereo 16-bit PCM.
+constexpr size_t kDataMqSize = 4 * 48 * 20 * 4;
+
+class LoopbackAudioPort : public BnBluetoothAudioPort {
+ public:
+  ScopedAStatus startStream(bool) override { return ScopedAStatus::ok(); }
+  ScopedAStatus suspendStream() override { return ScopedAStatus::ok(); }
+  ScopedAStatus stopStream() override { return ScopedAStatus::ok(); }
+  ScopedAStatus getPresentationPosition(PresentationPosition*) override {
+    return ScopedAStatus::ok();
+  }
+  ScopedAStatus updateSourceMetadata(const SourceMetadata&) override {
+    return ScopedAStatus::ok();
+  }
+  ScopedAStatus updateSinkMetadata(const SinkMetadata&) override {
+    return ScopedAStatus::ok();
+  }
+  ScopedAStatus setLatencyMode(const LatencyMode) override {
+    return ScopedAStatus::ok();
+  }
+};
+
+// The provider side of the FMQ, standing in for the Bluetooth stack encoder.
+// Each buffer written by the session starts with its submission timestamp.
+class LoopbackProvider {
+ public:
+  LoopbackProvider(size_t buffer_size, bool signals)
+      : buffer_size_(buffer_size),
+        signals_(signals),
+        data_mq_(kDataMqSize, /* EventFlag */ true) {
+    EventFlag::createEventFlag(data_mq_.getEventFlagWord(), &ev_flag_);
+    thread_ = std::thread([this]() { Consume(); });
+  }
+
+  ~LoopbackProvider() {
+    running_ = false;
+    ev_flag_->wake(kFmqNotEmpty);
+    thread_.join();
+    EventFlag::deleteEventFlag(&ev_flag_);
+  }
+
+  DataMQ& queue() { return data_mq_; }
+
+  // Latencies of consumed buffers, in nanoseconds.
+  std::vector<int64_t> TakeLatencies() {
+    while (consumed_ < expected_) std::this_thread::yield();
+    return std::move(latencies_);
+  }
+  void Expect(size_t buffers) { expected_ = buffers; }
+
+ private:
+  void Consume() {
+    std::vector<int8_t> buffer(buffer_size_);
+    size_t filled = 0;
+    while (running_) {
+      size_t available = data_mq_.availableToRead();
+      if (available == 0) {
+        if (signals_) {
+          uint32_t ef_state = 0;
+          ev_flag_->wait(kFmqNotEmpty, &ef_state);
+        } else {
+          // Behaves like a peer that polls the non-blocking FMQ API.
+          usleep(1000);
+        }
+        continue;
+      }
+      size_t n = std::min(available, buffer_size_ - filled);
+      data_mq_.read(buffer.data() + filled, n);
+      filled += n;
+      if (signals_) ev_flag_->wake(kFmqNotFull);
+      if (filled == buffer_size_) {
+        int64_t submitted;
+        memcpy(&submitted, buffer.data(), sizeof(submitted));
+        latencies_.push_back(Clock::now().time_since_epoch().count() -
+                             submitted);
+        filled = 0;
+        consumed_++;
+      }
+    }
+  }
+
+  const size_t buffer_size_;
+  const bool signals_;
+  DataMQ data_mq_;
+  EventFlag* ev_flag_ = nullptr;
+  std::atomic<bool> running_{true};
+  std::atomic<size_t> consumed_{0};
+  std::atomic<size_t> expected_{0};
+  std::vector<int64_t> latencies_;
+  std::thread thread_;
+};
+
+int64_t Percentile(std::vector<int64_t>& values, double percentile) {
+  if (values.empty()) return 0;
+  size_t index = std::min(values.size() - 1,
+                          static_cast<size_t>(values.size() * percentile));
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
+
+// Args: PCM buffer size in bytes, whether the provider signals the EventFlag.
+void BM_OutWritePcmDataLatency(State& state) {
+  const size_t buffer_size = state.range(0);
+  const bool signals = state.range(1) != 0;
+  LoopbackProvider provider(buffer_size, signals);
+  auto session = std::make_shared<BluetoothAudioSession>(
+      SessionType::A2DP_SOFTWARE_ENCODING_DATAPATH);
+  PcmConfiguration pcm_config{.sampleRateHz = 48000,
+                              .channelMode = ChannelMode::STEREO,
+                              .bitsPerSample = 16,
+                              .dataIntervalUs = 20000};
+  auto desc = provider.queue().dupeDesc();
+  session->OnSessionStarted(ndk::SharedRefBase::make<LoopbackAudioPort>(),
+                            &desc, AudioConfiguration(pcm_config), {});
+  if (!session->IsSessionReady()) {
+    state.SkipWithError("Unable to start the loopback session");
+    return;
+  }
+
+  std::vector<int8_t> buffer(buffer_size);
+  size_t buffers = 0;
+  for (auto _ : state) {
+    int64_t now = Clock::now().time_since_epoch().count();
+    memcpy(buffer.data(), &now, sizeof(now));
+    session->OutWritePcmData(buffer.data(), buffer.size());
+    buffers++;
+  }
+  provider.Expect(buffers);
+  std::vector<int64_t> latencies = provider.TakeLatencies();
+  DataPathStatistics stats = session->GetDataPathStatistics();
+  session->OnSessionEnded();
+
+  state.SetBytesProcessed(buffers * buffer_size);
+  state.counters["p50_latency_us"] = Percentile(latencies, 0.50) / 1000.0;
+  state.counters["p99_latency_us"] = Percentile(latencies, 0.99) / 1000.0;
+  state.counters["waits"] = Counter(stats.waits, Counter::kAvgIterations);
+  state.counters["overruns"] = stats.overruns;
+}
+
+}  // namespace
+
+BENCHMARK(BM_OutWritePcmDataLatency)
+    ->ArgNames({"bytes", "signals"})
+    ->ArgsProduct({{480, 1920, 3840}, {0, 1}})
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -35,6 +35,7 @@ using std::lock_guard;
 using std::move;
 using std::mutex;
 using std::sort;
+using std::unique_lock;
 using std::vector;
 
 namespace delay {
@@ -52,6 +53,15 @@ TunerSession::TunerSession(BroadcastRadio& module, const sp<ITunerCallback>& cal
     if (ranges.size() > 0) {
         tuneInternalLocked(utils::make_selector_amfm(ranges[0].lowerBound));
     }
+    virtualRadio().addListListener(this, [this]() { signalListThread(false); });
+    mListThread = std::thread(&TunerSession::listThreadLoop, this);
+}
+
+TunerSession::~TunerSession() {
+    // The list thread uses the cursor and callback, so it must be gone before they are.
+    virtualRadio().removeListListener(this);
+    stopListThread();
+    mListThread.join();
 }
 
 // makes ProgramInfo that points to no program
@@ -229,35 +239,62 @@ Return<void> TunerSession::cancel() {
     return {};
 }
 
+void TunerSession::signalListThread(bool started) {
+    lock_guard<mutex> lk(mListMut);
+    mListChanged = true;
+    if (started) mListStarted = true;
+    mListCond.notify_one();
+}
+
+void TunerSession::stopListThread() {
+    lock_guard<mutex> lk(mListMut);
+    mListThreadExit = true;
+    mListCond.notify_one();
+}
+
+void TunerSession::listThreadLoop() {
+    unique_lock<mutex> listLk(mListMut);
+    while (true) {
+        mListCond.wait(listLk, [this]() { return mListChanged || mListThreadExit; });
+        if (mListThreadExit) return;
+        if (mListStarted) {
+            // Pretend to scan before the first list of a stream.
+            mListStarted = false;
+            if (mListCond.wait_for(listLk, delay::list, [this]() { return mListThreadExit; })) {
+                return;
+            }
+        }
+        mListChanged = false;
+        listLk.unlock();
+        {
+            lock_guard<mutex> lk(mMut);
+            if (mProgramListCursor) {
+                for (auto&& chunk : virtualRadio().getProgramListUpdates(*mProgramListCursor)) {
+                    mCallback->onProgramListUpdated(chunk);
+                }
+            }
+        }
+        listLk.lock();
+    }
+}
+
 Return<Result> TunerSession::startProgramListUpdates(const ProgramFilter& filter) {
     LOG(DEBUG) << "requested program list updates, filter=" << toString(filter);
     lock_guard<mutex> lk(mMut);
     if (mIsClosed) return Result::INVALID_STATE;
 
-    auto list = virtualRadio().getProgramList();
-    vector<VirtualProgram> filteredList;
-    auto filterCb = [&filter](const VirtualProgram& program) {
-        return utils::satisfies(filter, program.selector);
-    };
-    std::copy_if(list.begin(), list.end(), std::back_inserter(filteredList), filterCb);
-
-    auto task = [this, list]() {
-        lock_guard<mutex> lk(mMut);
-
-        ProgramListChunk chunk = {};
-        chunk.purge = true;
-        chunk.complete = true;
-        chunk.modified = hidl_vec<ProgramInfo>(list.begin(), list.end());
-
-        mCallback->onProgramListUpdated(chunk);
-    };
-    mThread.schedule(task, delay::list);
+    // A new cursor gets the whole filtered list first, then only what changed since.
+    mProgramListCursor.emplace(filter);
+    signalListThread(true);
 
     return Result::OK;
 }
 
 Return<void> TunerSession::stopProgramListUpdates() {
     LOG(DEBUG) << "requested program list updates to stop";
+    lock_guard<mutex> lk(mMut);
+
+    mProgramListCursor.reset();
     return {};
 }
 
@@ -293,6 +330,8 @@ Return<void> TunerSession::close() {
 
     mIsClosed = true;
     mThread.cancelAll();
+    mProgramListCursor.reset();
+    stopListThread();
     return {};
 }
 
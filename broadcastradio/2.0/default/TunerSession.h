@@ -22,7 +22,9 @@
 #include <android/hardware/broadcastradio/2.0/ITunerSession.h>
 #include <broadcastradio-utils/WorkerThread.h>
 
+#include <condition_variable>
 #include <optional>
+#include <thread>
 
 namespace android {
 namespace hardware {
@@ -34,6 +36,7 @@ struct BroadcastRadio;
 
 struct TunerSession : public ITunerSession {
     TunerSession(BroadcastRadio& module, const sp<ITunerCallback>& callback);
+    ~TunerSession();
 
     // V2_0::ITunerSession methods
     virtual Return<Result> tune(const ProgramSelector& program) override;
@@ -63,8 +66,28 @@ struct TunerSession : public ITunerSession {
     bool mIsTuneCompleted = false;
     ProgramSelector mCurrentProgram = {};
 
+    std::optional<utils::ProgramListCursor> mProgramListCursor;
+
+    /**
+     * Program list thread state, guarded by mListMut.
+     *
+     * The list thread sleeps until the virtual radio list changes, an updates
+     * stream starts or the session goes away. mListMut is never held while
+     * taking mMut.
+     */
+    std::mutex mListMut;
+    std::condition_variable mListCond;
+    bool mListChanged = false;
+    bool mListStarted = false;
+    bool mListThreadExit = false;
+    /** Declared last, so everything it uses is constructed before it starts. */
+    std::thread mListThread;
+
     void cancelLocked();
     void tuneInternalLocked(const ProgramSelector& sel);
+    void signalListThread(bool started);
+    void stopListThread();
+    void listThreadLoop();
     const VirtualRadio& virtualRadio() const;
     const BroadcastRadio& module() const;
 };
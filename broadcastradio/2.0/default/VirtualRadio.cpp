@@ -17,6 +17,8 @@
 
 #include <broadcastradio-utils-2x/Utils.h>
 
+#include <algorithm>
+
 namespace android {
 namespace hardware {
 namespace broadcastradio {
@@ -53,7 +55,9 @@ VirtualRadio gDabRadio(
 // clang-format on
 
 VirtualRadio::VirtualRadio(const std::string& name, const vector<VirtualProgram>& initialList)
-    : mName(name), mPrograms(initialList) {}
+    : mName(name), mPrograms(initialList) {
+    for (auto&& program : mPrograms) mProgramList.update(program);
+}
 
 std::string VirtualRadio::getName() const {
     return mName;
@@ -75,6 +79,56 @@ bool VirtualRadio::getProgram(const ProgramSelector& selector, VirtualProgram& p
     return false;
 }
 
+void VirtualRadio::updateProgram(const VirtualProgram& program) {
+    {
+        lock_guard<mutex> lk(mMut);
+        auto it = std::find_if(mPrograms.begin(), mPrograms.end(), [&](const VirtualProgram& p) {
+            return p.selector.primaryId == program.selector.primaryId;
+        });
+        if (it != mPrograms.end()) {
+            *it = program;
+        } else {
+            it = mPrograms.insert(mPrograms.end(), program);
+        }
+        mProgramList.update(*it);
+    }
+    notifyListListeners();
+}
+
+void VirtualRadio::removeProgram(const ProgramSelector& selector) {
+    {
+        lock_guard<mutex> lk(mMut);
+        auto it = std::find_if(mPrograms.begin(), mPrograms.end(), [&](const VirtualProgram& p) {
+            return p.selector.primaryId == selector.primaryId;
+        });
+        if (it == mPrograms.end()) return;
+        mPrograms.erase(it);
+        mProgramList.remove(selector.primaryId);
+    }
+    notifyListListeners();
+}
+
+vector<ProgramListChunk> VirtualRadio::getProgramListUpdates(
+    utils::ProgramListCursor& cursor) const {
+    return mProgramList.getUpdates(cursor);
+}
+
+void VirtualRadio::addListListener(const void* owner, std::function<void()> listener) const {
+    lock_guard<mutex> lk(mListenersMut);
+    mListListeners[owner] = move(listener);
+}
+
+void VirtualRadio::removeListListener(const void* owner) const {
+    lock_guard<mutex> lk(mListenersMut);
+    mListListeners.erase(owner);
+}
+
+void VirtualRadio::notifyListListeners() const {
+    // Called without mMut, so listeners may take locks held while querying this radio.
+    lock_guard<mutex> lk(mListenersMut);
+    for (auto&& entry : mListListeners) entry.second();
+}
+
 }  // namespace implementation
 }  // namespace V2_0
 }  // namespace broadcastradio
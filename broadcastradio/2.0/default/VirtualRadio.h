@@ -18,6 +18,10 @@
 
 #include "VirtualProgram.h"
 
+#include <broadcastradio-utils-2x/ProgramListStore.h>
+
+#include <functional>
+#include <map>
 #include <mutex>
 #include <vector>
 
@@ -43,10 +47,34 @@ class VirtualRadio {
     std::vector<VirtualProgram> getProgramList() const;
     bool getProgram(const ProgramSelector& selector, VirtualProgram& program) const;
 
+    /** Adds a program or replaces the one with the same primary identifier. */
+    void updateProgram(const VirtualProgram& program);
+    void removeProgram(const ProgramSelector& selector);
+
+    /** Returns the program list chunks a client at a given cursor is missing. */
+    std::vector<ProgramListChunk> getProgramListUpdates(utils::ProgramListCursor& cursor) const;
+
+    /**
+     * Registers a callback run after every program list change.
+     *
+     * It runs on the thread that changed the list and must not call back into
+     * this radio. Listeners are not radio state, so const users may register.
+     */
+    void addListListener(const void* owner, std::function<void()> listener) const;
+
+    /** Unregisters a callback; once this returns it's not running and won't run again. */
+    void removeListListener(const void* owner) const;
+
    private:
     mutable std::mutex mMut;
     std::string mName;
     std::vector<VirtualProgram> mPrograms;
+    utils::ProgramListStore mProgramList;
+
+    mutable std::mutex mListenersMut;
+    mutable std::map<const void*, std::function<void()>> mListListeners;
+
+    void notifyListListeners() const;
 };
 
 /** AM/FM virtual radio space. */
@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <broadcastradio-utils-2x/ProgramListStore.h>
+#include <broadcastradio-utils-2x/Utils.h>
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace {
+
+namespace V2_0 = android::hardware::broadcastradio::V2_0;
+namespace utils = android::hardware::broadcastradio::utils;
+
+using V2_0::IdentifierType;
+using V2_0::MetadataKey;
+using V2_0::ProgramFilter;
+using V2_0::ProgramInfo;
+using V2_0::ProgramListChunk;
+
+using std::vector;
+
+ProgramInfo makeDab(uint32_t sidExt, uint32_t ensemble, const std::string& title = "") {
+    ProgramInfo info = {};
+    info.selector = utils::make_selector_dab(sidExt, ensemble);
+    info.metadata = vector<V2_0::Metadata>({utils::make_metadata(MetadataKey::SONG_TITLE, title)});
+    return info;
+}
+
+ProgramInfo makeFm(uint32_t frequency) {
+    ProgramInfo info = {};
+    info.selector = utils::make_selector_amfm(frequency);
+    return info;
+}
+
+ProgramFilter makeTypeFilter(IdentifierType type) {
+    ProgramFilter filter = {};
+    filter.identifierTypes = vector<uint32_t>({static_cast<uint32_t>(type)});
+    return filter;
+}
+
+utils::ProgramInfoSet applyChunks(utils::ProgramInfoSet list,
+                                  const vector<ProgramListChunk>& chunks) {
+    for (size_t i = 0; i < chunks.size(); i++) {
+        EXPECT_TRUE(i == 0 || !chunks[i].purge);
+        EXPECT_EQ(i + 1 == chunks.size(), chunks[i].complete);
+        EXPECT_TRUE(!chunks[i].purge || chunks[i].removed.size() == 0);
+        utils::updateProgramList(list, chunks[i]);
+    }
+    return list;
+}
+
+TEST(ProgramListStoreTest, fullListThenNothing) {
+    utils::ProgramListStore store;
+    store.update(makeDab(0x1001, 0x100));
+    store.update(makeFm(94900));
+
+    utils::ProgramListCursor cursor;
+    auto chunks = store.getUpdates(cursor);
+    ASSERT_EQ(1u, chunks.size());
+    EXPECT_TRUE(chunks[0].purge);
+    EXPECT_TRUE(chunks[0].complete);
+    EXPECT_EQ(2u, chunks[0].modified.size());
+
+    EXPECT_EQ(0u, store.getUpdates(cursor).size());
+}
+
+TEST(ProgramListStoreTest, emptyStoreStillCompletes) {
+    utils::ProgramListStore store;
+    utils::ProgramListCursor cursor;
+
+    auto chunks = store.getUpdates(cursor);
+    ASSERT_EQ(1u, chunks.size());
+    EXPECT_TRUE(chunks[0].purge);
+    EXPECT_TRUE(chunks[0].complete);
+    EXPECT_EQ(0u, chunks[0].modified.size());
+}
+
+TEST(ProgramListStoreTest, onlyChangesAreSent) {
+    utils::ProgramListStore store;
+    auto first = makeDab(0x1001, 0x100, "a");
+    auto second = makeDab(0x1002, 0x100, "b");
+    store.update(first);
+    store.update(second);
+    store.update(makeFm(94900));
+
+    utils::ProgramListCursor cursor;
+    store.getUpdates(cursor);
+
+    // Unchanged content doesn't bump the version
+    auto version = store.getVersion();
+    store.update(first);
+    EXPECT_EQ(version, store.getVersion());
+
+    second = makeDab(0x1002, 0x100, "c");
+    store.update(second);
+    store.remove(first.selector.primaryId);
+
+    auto chunks = store.getUpdates(cursor);
+    ASSERT_EQ(1u, chunks.size());
+    EXPECT_FALSE(chunks[0].purge);
+    ASSERT_EQ(1u, chunks[0].modified.size());
+    EXPECT_EQ(second, chunks[0].modified[0]);
+    ASSERT_EQ(1u, chunks[0].removed.size());
+    EXPECT_EQ(first.selector.primaryId, chunks[0].removed[0]);
+}
+
+TEST(ProgramListStoreTest, filterByType) {
+    utils::ProgramListStore store;
+    auto dab = makeDab(0x1001, 0x100);
+    store.update(dab);
+    store.update(makeFm(94900));
+
+    utils::ProgramListCursor cursor(makeTypeFilter(IdentifierType::DAB_ENSEMBLE));
+    auto chunks = store.getUpdates(cursor);
+    ASSERT_EQ(1u, chunks.size());
+    ASSERT_EQ(1u, chunks[0].modified.size());
+    EXPECT_EQ(dab, chunks[0].modified[0]);
+
+    // Changes of programs the client doesn't have don't generate updates
+    store.remove(utils::make_selector_amfm(94900).primaryId);
+    EXPECT_EQ(0u, store.getUpdates(cursor).size());
+}
+
+TEST(ProgramListStoreTest, filterByIdentifier) {
+    utils::ProgramListStore store;
+    store.update(makeDab(0x1001, 0x100));
+    store.update(makeDab(0x1002, 0x100));
+    store.update(makeDab(0x1003, 0x200));
+
+    ProgramFilter filter = {};
+    filter.identifiers = vector<V2_0::ProgramIdentifier>(
+        {utils::make_identifier(IdentifierType::DAB_ENSEMBLE, 0x100)});
+    utils::ProgramListCursor cursor(filter);
+    auto list = applyChunks({}, store.getUpdates(cursor));
+    EXPECT_EQ(2u, list.size());
+
+    // A program moving out of the filtered ensemble is removed on the client
+    store.update(makeDab(0x1002, 0x200));
+    auto chunks = store.getUpdates(cursor);
+    ASSERT_EQ(1u, chunks.size());
+    EXPECT_EQ(0u, chunks[0].modified.size());
+    EXPECT_EQ(1u, chunks[0].removed.size());
+    EXPECT_EQ(1u, applyChunks(list, chunks).size());
+}
+
+TEST(ProgramListStoreTest, excludeModifications) {
+    utils::ProgramListStore store;
+    store.update(makeDab(0x1001, 0x100, "a"));
+
+    ProgramFilter filter = {};
+    filter.excludeModifications = true;
+    utils::ProgramListCursor cursor(filter);
+    store.getUpdates(cursor);
+
+    store.update(makeDab(0x1001, 0x100, "b"));
+    EXPECT_EQ(0u, store.getUpdates(cursor).size());
+
+    store.update(makeDab(0x1002, 0x100));
+    auto chunks = store.getUpdates(cursor);
+    ASSERT_EQ(1u, chunks.size());
+    EXPECT_EQ(1u, chunks[0].modified.size());
+}
+
+TEST(ProgramListStoreTest, chunksAreBounded) {
+    constexpr size_t maxChunkBytes = 4096;
+    utils::ProgramListStore store;
+    for (uint32_t i = 0; i < 200; i++) {
+        store.update(makeDab(0x1000 + i, 0x100, std::string(100, 'x')));
+    }
+
+    utils::ProgramListCursor cursor;
+    auto chunks = store.getUpdates(cursor, maxChunkBytes);
+    EXPECT_GT(chunks.size(), 1u);
+    EXPECT_TRUE(chunks[0].purge);
+    EXPECT_EQ(200u, applyChunks({}, chunks).size());
+
+    // Even an entry larger than the limit gets sent
+    store.update(makeDab(0x1001, 0x100, std::string(2 * maxChunkBytes, 'x')));
+    chunks = store.getUpdates(cursor, maxChunkBytes);
+    ASSERT_EQ(1u, chunks.size());
+    EXPECT_EQ(1u, chunks[0].modified.size());
+}
+
+TEST(ProgramListStoreTest, compactedCursorGetsFullList) {
+    utils::ProgramListStore store(4);
+    for (uint32_t i = 0; i < 20; i++) store.update(makeFm(87500 + i * 100));
+
+    utils::ProgramListCursor cursor;
+    store.getUpdates(cursor);
+    for (uint32_t i = 0; i < 10; i++) store.remove(makeFm(87500 + i * 100).selector.primaryId);
+
+    auto chunks = store.getUpdates(cursor);
+    ASSERT_EQ(1u, chunks.size());
+    EXPECT_TRUE(chunks[0].purge);
+    EXPECT_EQ(10u, chunks[0].modified.size());
+}
+
+TEST(ProgramListStoreTest, clientMatchesStore) {
+    std::mt19937 rng(42);
+    utils::ProgramListStore store(16);
+    vector<utils::ProgramListCursor> cursors;
+    cursors.emplace_back();
+    cursors.emplace_back(makeTypeFilter(IdentifierType::DAB_SID_EXT));
+    cursors.emplace_back(makeTypeFilter(IdentifierType::AMFM_FREQUENCY));
+    vector<utils::ProgramInfoSet> clients(cursors.size());
+    utils::ProgramInfoSet expected;
+
+    for (int round = 0; round < 200; round++) {
+        for (int i = 0; i < 10; i++) {
+            auto info = rng() % 2 ? makeDab(rng() % 50, rng() % 3, std::to_string(rng() % 4))
+                                  : makeFm(87500 + rng() % 50 * 100);
+            if (rng() % 3 == 0) {
+                store.remove(info.selector.primaryId);
+                expected.erase(info);
+            } else {
+                store.update(info);
+                expected.erase(info);
+                expected.insert(info);
+            }
+        }
+
+        for (size_t c = 0; c < cursors.size(); c++) {
+            clients[c] = applyChunks(clients[c], store.getUpdates(cursors[c], 1024));
+            size_t matching = 0;
+            for (auto&& info : expected) {
+                if (!utils::satisfies(cursors[c].filter, info.selector)) continue;
+                matching++;
+                auto it = clients[c].find(info);
+                ASSERT_NE(clients[c].end(), it);
+                EXPECT_EQ(info, *it);
+            }
+            EXPECT_EQ(matching, clients[c].size());
+        }
+    }
+}
+
+}  // anonymous namespace
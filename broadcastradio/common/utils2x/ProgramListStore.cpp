@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "BcRadioDef.utils"
+
+#include <broadcastradio-utils-2x/ProgramListStore.h>
+
+#include <broadcastradio-utils-2x/Utils.h>
+
+namespace android {
+namespace hardware {
+namespace broadcastradio {
+namespace utils {
+
+using V2_0::Metadata;
+using V2_0::ProgramFilter;
+using V2_0::ProgramIdentifier;
+using V2_0::ProgramInfo;
+using V2_0::ProgramListChunk;
+using V2_0::ProgramSelector;
+using V2_0::VendorKeyValue;
+
+using std::lock_guard;
+using std::mutex;
+using std::vector;
+
+size_t ProgramIdentifierHasher::operator()(const ProgramIdentifier& id) const {
+    // Same mixing as ProgramInfoHasher, which only hashes the primary identifier.
+    auto h = std::hash<uint32_t>{}(id.type);
+    h += 0x9e3779b9;
+    h ^= std::hash<uint64_t>{}(id.value);
+
+    return h;
+}
+
+ProgramListCursor::ProgramListCursor(const ProgramFilter& filter) : filter(filter) {}
+
+ProgramListStore::ProgramListStore(size_t maxTombstones) : mMaxTombstones(maxTombstones) {}
+
+void ProgramListStore::indexLocked(const ProgramSelector& sel) {
+    for (auto&& id : sel) {
+        mByType[id.type].insert(sel.primaryId);
+        mById[id].insert(sel.primaryId);
+    }
+}
+
+void ProgramListStore::unindexLocked(const ProgramSelector& sel) {
+    for (auto&& id : sel) {
+        auto byType = mByType.find(id.type);
+        if (byType != mByType.end()) {
+            byType->second.erase(sel.primaryId);
+            if (byType->second.empty()) mByType.erase(byType);
+        }
+        auto byId = mById.find(id);
+        if (byId != mById.end()) {
+            byId->second.erase(sel.primaryId);
+            if (byId->second.empty()) mById.erase(byId);
+        }
+    }
+}
+
+void ProgramListStore::update(const ProgramInfo& info) {
+    auto& primaryId = info.selector.primaryId;
+
+    lock_guard<mutex> lk(mMut);
+    auto it = mEntries.find(primaryId);
+    if (it != mEntries.end()) {
+        auto& entry = it->second;
+        if (!entry.removed && entry.info == info) return;
+
+        mChanges.erase(entry.version);
+        if (entry.removed) {
+            mTombstones--;
+        } else {
+            unindexLocked(entry.info.selector);
+        }
+        entry = {info, ++mVersion, false};
+    } else {
+        mEntries.emplace(primaryId, Entry{info, ++mVersion, false});
+    }
+
+    indexLocked(info.selector);
+    mChanges.emplace(mVersion, primaryId);
+}
+
+void ProgramListStore::remove(const ProgramIdentifier& primaryId) {
+    lock_guard<mutex> lk(mMut);
+    auto it = mEntries.find(primaryId);
+    if (it == mEntries.end() || it->second.removed) return;
+
+    auto& entry = it->second;
+    unindexLocked(entry.info.selector);
+    mChanges.erase(entry.version);
+    entry = {{}, ++mVersion, true};
+    mChanges.emplace(mVersion, primaryId);
+
+    if (++mTombstones > mMaxTombstones) compactLocked();
+}
+
+void ProgramListStore::compactLocked() {
+    // Drop the older half, so the next compaction is at least maxTombstones / 2 removals away.
+    auto it = mChanges.begin();
+    while (it != mChanges.end() && mTombstones > mMaxTombstones / 2) {
+        auto entry = mEntries.find(it->second);
+        if (!entry->second.removed) {
+            ++it;
+            continue;
+        }
+        mCompactedVersion = it->first;
+        mEntries.erase(entry);
+        it = mChanges.erase(it);
+        mTombstones--;
+    }
+}
+
+uint64_t ProgramListStore::getVersion() const {
+    lock_guard<mutex> lk(mMut);
+    return mVersion;
+}
+
+void ProgramListStore::collectAllLocked(ProgramListCursor& cursor,
+                                        vector<const ProgramInfo*>& modified) const {
+    auto& filter = cursor.filter;
+    auto add = [&](const ProgramIdentifier& primaryId) {
+        auto& entry = mEntries.at(primaryId);
+        if (!satisfies(filter, entry.info.selector)) return;
+        if (cursor.sent.insert(primaryId).second) modified.push_back(&entry.info);
+    };
+
+    // Candidates come from the most selective index, the filter is still checked as a whole.
+    if (filter.identifiers.size() > 0) {
+        for (auto&& id : filter.identifiers) {
+            auto it = mById.find(id);
+            if (it == mById.end()) continue;
+            for (auto&& primaryId : it->second) add(primaryId);
+        }
+    } else if (filter.identifierTypes.size() > 0) {
+        for (auto&& type : filter.identifierTypes) {
+            auto it = mByType.find(type);
+            if (it == mByType.end()) continue;
+            for (auto&& primaryId : it->second) add(primaryId);
+        }
+    } else {
+        for (auto&& [primaryId, entry] : mEntries) {
+            if (!entry.removed) add(primaryId);
+        }
+    }
+}
+
+static size_t estimateSize(const ProgramInfo& info) {
+    size_t size = sizeof(ProgramInfo);
+    size += info.selector.secondaryIds.size() * sizeof(ProgramIdentifier);
+    size += info.relatedContent.size() * sizeof(ProgramIdentifier);
+    for (auto&& item : info.metadata) {
+        size += sizeof(Metadata) + item.stringValue.size() + 1;
+    }
+    for (auto&& item : info.vendorInfo) {
+        size += sizeof(VendorKeyValue) + item.key.size() + item.value.size() + 2;
+    }
+    return size;
+}
+
+vector<ProgramListChunk> ProgramListStore::getUpdates(ProgramListCursor& cursor,
+                                                      size_t maxChunkBytes) const {
+    vector<const ProgramInfo*> modified;
+    vector<ProgramIdentifier> removed;
+
+    lock_guard<mutex> lk(mMut);
+    const bool purge = !cursor.synced || cursor.version < mCompactedVersion;
+    if (purge) {
+        cursor.sent.clear();
+        collectAllLocked(cursor, modified);
+    } else {
+        for (auto it = mChanges.upper_bound(cursor.version); it != mChanges.end(); ++it) {
+            auto& primaryId = it->second;
+            auto& entry = mEntries.at(primaryId);
+            if (!entry.removed && satisfies(cursor.filter, entry.info.selector)) {
+                bool added = cursor.sent.insert(primaryId).second;
+                if (added || !cursor.filter.excludeModifications) modified.push_back(&entry.info);
+            } else if (cursor.sent.erase(primaryId) > 0) {
+                removed.push_back(primaryId);
+            }
+        }
+    }
+    cursor.synced = true;
+    cursor.version = mVersion;
+
+    vector<ProgramListChunk> chunks;
+    if (!purge && modified.empty() && removed.empty()) return chunks;
+
+    // Removals go first, so a client never has both the old and the new entry of a program.
+    chunks.emplace_back();
+    chunks.back().purge = purge;
+    size_t chunkBytes = sizeof(ProgramListChunk);
+    size_t chunkRemoved = 0;
+    auto flushRemoved = [&](size_t end) {
+        chunks.back().removed = vector<ProgramIdentifier>(
+            removed.begin() + end - chunkRemoved, removed.begin() + end);
+        chunkRemoved = 0;
+    };
+    for (size_t i = 0; i < removed.size(); i++) {
+        if (chunkRemoved > 0 && chunkBytes + sizeof(ProgramIdentifier) > maxChunkBytes) {
+            flushRemoved(i);
+            chunks.emplace_back();
+            chunkBytes = sizeof(ProgramListChunk);
+        }
+        chunkBytes += sizeof(ProgramIdentifier);
+        chunkRemoved++;
+    }
+    if (chunkRemoved > 0) flushRemoved(removed.size());
+
+    size_t first = 0;
+    auto flushModified = [&](size_t end) {
+        auto& chunk = chunks.back();
+        chunk.modified.resize(end - first);
+        for (size_t i = first; i < end; i++) chunk.modified[i - first] = *modified[i];
+        first = end;
+    };
+    for (size_t i = 0; i < modified.size(); i++) {
+        auto size = estimateSize(*modified[i]);
+        bool chunkEmpty = chunks.back().removed.size() == 0 && first == i;
+        if (!chunkEmpty && chunkBytes + size > maxChunkBytes) {
+            flushModified(i);
+            chunks.emplace_back();
+            chunkBytes = sizeof(ProgramListChunk);
+        }
+        chunkBytes += size;
+    }
+    flushModified(modified.size());
+
+    chunks.back().complete = true;
+    return chunks;
+}
+
+}  // namespace utils
+}  // namespace broadcastradio
+}  // namespace hardware
+}  // namespace android
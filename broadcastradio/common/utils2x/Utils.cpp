@@ -371,7 +371,11 @@ bool ProgramInfoKeyEqual::operator()(const ProgramInfo& info1, const ProgramInfo
 void updateProgramList(ProgramInfoSet& list, const ProgramListChunk& chunk) {
     if (chunk.purge) list.clear();
 
-    list.insert(chunk.modified.begin(), chunk.modified.end());
+    // insert() would keep the stale copy of a modified entry
+    for (auto&& info : chunk.modified) {
+        list.erase(info);
+        list.insert(info);
+    }
 
     for (auto&& id : chunk.removed) {
         ProgramInfo info = {};
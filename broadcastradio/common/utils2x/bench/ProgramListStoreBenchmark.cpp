@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Program list updates with 10k DAB programs in 100 ensembles, a few of which
+ * change their song title between updates. BM_Rebuild* is what the default HAL
+ * did before ProgramListStore: filter the whole list and send it in one purging
+ * chunk, which the client applies from scratch.
+ */
+
+#include <benchmark/benchmark.h>
+#include <broadcastradio-utils-2x/ProgramListStore.h>
+#include <broadcastradio-utils-2x/Utils.h>
+
+namespace {
+
+namespace V2_0 = android::hardware::broadcastradio::V2_0;
+namespace utils = android::hardware::broadcastradio::utils;
+
+using ::benchmark::State;
+using V2_0::IdentifierType;
+using V2_0::MetadataKey;
+using V2_0::ProgramFilter;
+using V2_0::ProgramInfo;
+using V2_0::ProgramListChunk;
+
+using std::vector;
+
+constexpr uint32_t kPrograms = 10000;
+constexpr uint32_t kEnsembles = 100;
+
+ProgramInfo makeProgram(uint32_t index, uint32_t revision) {
+    ProgramInfo info = {};
+    info.selector = utils::make_selector_dab(0x10000 + index, 0x100 + index % kEnsembles);
+    info.metadata = vector<V2_0::Metadata>({
+        utils::make_metadata(MetadataKey::RDS_PS, "Station " + std::to_string(index)),
+        utils::make_metadata(MetadataKey::SONG_TITLE, "Song " + std::to_string(revision)),
+        utils::make_metadata(MetadataKey::SONG_ARTIST, "Artist"),
+    });
+    return info;
+}
+
+// Filter for a single ensemble, or for everything
+ProgramFilter makeFilter(bool oneEnsemble) {
+    ProgramFilter filter = {};
+    if (oneEnsemble) {
+        filter.identifiers = vector<V2_0::ProgramIdentifier>(
+            {utils::make_identifier(IdentifierType::DAB_ENSEMBLE, 0x100)});
+    }
+    return filter;
+}
+
+// Every update changes state.range(0) programs
+void BM_RebuildFullList(State& state, bool oneEnsemble) {
+    const uint32_t changes = state.range(0);
+    const auto filter = makeFilter(oneEnsemble);
+    vector<ProgramInfo> programs;
+    for (uint32_t i = 0; i < kPrograms; i++) programs.push_back(makeProgram(i, 0));
+    utils::ProgramInfoSet client;
+
+    uint32_t revision = 0;
+    for (auto _ : state) {
+        revision++;
+        for (uint32_t i = 0; i < changes; i++) {
+            auto index = (revision * changes + i) % kPrograms;
+            programs[index] = makeProgram(index, revision);
+        }
+
+        auto list = programs;
+        vector<ProgramInfo> filtered;
+        for (auto&& info : list) {
+            if (utils::satisfies(filter, info.selector)) filtered.push_back(info);
+        }
+        ProgramListChunk chunk = {};
+        chunk.purge = true;
+        chunk.complete = true;
+        chunk.modified = filtered;
+        utils::updateProgramList(client, chunk);
+    }
+    state.counters["entries"] = benchmark::Counter(client.size());
+}
+
+void BM_StoreUpdates(State& state, bool oneEnsemble) {
+    const uint32_t changes = state.range(0);
+    utils::ProgramListStore store;
+    for (uint32_t i = 0; i < kPrograms; i++) store.update(makeProgram(i, 0));
+    utils::ProgramListCursor cursor(makeFilter(oneEnsemble));
+    utils::ProgramInfoSet client;
+    for (auto&& chunk : store.getUpdates(cursor)) utils::updateProgramList(client, chunk);
+
+    uint32_t revision = 0;
+    size_t chunks = 0;
+    for (auto _ : state) {
+        revision++;
+        for (uint32_t i = 0; i < changes; i++) {
+            auto index = (revision * changes + i) % kPrograms;
+            store.update(makeProgram(index, revision));
+        }
+
+        for (auto&& chunk : store.getUpdates(cursor)) {
+            utils::updateProgramList(client, chunk);
+            chunks++;
+        }
+    }
+    state.counters["entries"] = benchmark::Counter(client.size());
+    state.counters["chunks"] = benchmark::Counter(chunks, benchmark::Counter::kAvgIterations);
+}
+
+// Initial list for a new session
+void BM_StoreFullList(State& state, bool oneEnsemble) {
+    utils::ProgramListStore store;
+    for (uint32_t i = 0; i < kPrograms; i++) store.update(makeProgram(i, 0));
+    const auto filter = makeFilter(oneEnsemble);
+
+    size_t chunks = 0;
+    for (auto _ : state) {
+        utils::ProgramListCursor cursor(filter);
+        utils::ProgramInfoSet client;
+        for (auto&& chunk : store.getUpdates(cursor)) {
+            utils::updateProgramList(client, chunk);
+            chunks++;
+        }
+        benchmark::DoNotOptimize(client);
+    }
+    state.counters["chunks"] = benchmark::Counter(chunks, benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK_CAPTURE(BM_RebuildFullList, all, false)->Arg(0)->Arg(10)->Arg(100);
+BENCHMARK_CAPTURE(BM_RebuildFullList, ensemble, true)->Arg(0)->Arg(10)->Arg(100);
+BENCHMARK_CAPTURE(BM_StoreUpdates, all, false)->Arg(0)->Arg(10)->Arg(100);
+BENCHMARK_CAPTURE(BM_StoreUpdates, ensemble, true)->Arg(0)->Arg(10)->Arg(100);
+BENCHMARK_CAPTURE(BM_StoreFullList, all, false);
+BENCHMARK_CAPTURE(BM_StoreFullList, ensemble, true);
+
+}  // anonymous namespace
+
+BENCHMARK_MAIN();
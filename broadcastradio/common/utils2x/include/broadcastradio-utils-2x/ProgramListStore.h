@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ANDROID_HARDWARE_BROADCASTRADIO_COMMON_UTILS_2X_PROGRAMLISTSTORE_H
+#define ANDROID_HARDWARE_BROADCASTRADIO_COMMON_UTILS_2X_PROGRAMLISTSTORE_H
+
+#include <android/hardware/broadcastradio/2.0/types.h>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace broadcastradio {
+namespace utils {
+
+struct ProgramIdentifierHasher {
+    size_t operator()(const V2_0::ProgramIdentifier& id) const;
+};
+
+typedef std::unordered_set<V2_0::ProgramIdentifier, ProgramIdentifierHasher> ProgramIdentifierSet;
+
+/**
+ * State of a single program list updates stream.
+ *
+ * A new cursor (or one with a new filter) gets the whole filtered list with the
+ * purge flag set, following ones only get what changed since.
+ */
+struct ProgramListCursor {
+    explicit ProgramListCursor(const V2_0::ProgramFilter& filter = {});
+
+    V2_0::ProgramFilter filter;
+
+    /** Whether the client got the whole list at least once. */
+    bool synced = false;
+
+    /** Store version the client is up to date with. */
+    uint64_t version = 0;
+
+    /** Primary identifiers of the programs the client has. */
+    ProgramIdentifierSet sent;
+};
+
+/**
+ * A versioned program list.
+ *
+ * Every change bumps the store version and tags the changed entry with it, so
+ * updates for a cursor are just the entries tagged with a newer version.
+ * Removed entries are kept as tombstones until there are more than
+ * maxTombstones of them; cursors older than the dropped tombstones get the
+ * whole list again.
+ *
+ * Entries are indexed by identifier type and by identifier, so a full list for
+ * a narrow filter doesn't have to check every program.
+ */
+class ProgramListStore {
+   public:
+    static constexpr size_t kDefaultMaxTombstones = 1024;
+
+    /** Keeps chunks well below the 1MB binder transaction buffer. */
+    static constexpr size_t kDefaultMaxChunkBytes = 128 * 1024;
+
+    explicit ProgramListStore(size_t maxTombstones = kDefaultMaxTombstones);
+
+    /** Adds a program or replaces the one with the same primary identifier. */
+    void update(const V2_0::ProgramInfo& info);
+
+    void remove(const V2_0::ProgramIdentifier& primaryId);
+
+    uint64_t getVersion() const;
+
+    /**
+     * Brings a cursor up to date with the store.
+     *
+     * Each chunk is estimated to take at most maxChunkBytes, unless a single
+     * entry doesn't fit. Only the first chunk may have the purge flag set and
+     * only the last one has the complete flag set.
+     *
+     * @param cursor Cursor to compute updates for, advanced to the current version.
+     * @param maxChunkBytes Size limit of a single chunk.
+     * @return Chunks to send, empty if nothing changed for this cursor.
+     */
+    std::vector<V2_0::ProgramListChunk> getUpdates(
+        ProgramListCursor& cursor, size_t maxChunkBytes = kDefaultMaxChunkBytes) const;
+
+   private:
+    struct Entry {
+        V2_0::ProgramInfo info;
+        uint64_t version;
+        bool removed;
+    };
+
+    mutable std::mutex mMut;
+    const size_t mMaxTombstones;
+
+    uint64_t mVersion = 0;
+    /** Cursors older than this may have missed dropped tombstones. */
+    uint64_t mCompactedVersion = 0;
+    size_t mTombstones = 0;
+
+    std::unordered_map<V2_0::ProgramIdentifier, Entry, ProgramIdentifierHasher> mEntries;
+    /** Primary identifier of every entry by its version. */
+    std::map<uint64_t, V2_0::ProgramIdentifier> mChanges;
+    /** Primary identifiers of live entries by the identifiers they contain. */
+    std::unordered_map<uint32_t, ProgramIdentifierSet> mByType;
+    std::unordered_map<V2_0::ProgramIdentifier, ProgramIdentifierSet, ProgramIdentifierHasher>
+        mById;
+
+    void indexLocked(const V2_0::ProgramSelector& sel);
+    void unindexLocked(const V2_0::ProgramSelector& sel);
+    void compactLocked();
+    void collectAllLocked(ProgramListCursor& cursor,
+                          std::vector<const V2_0::ProgramInfo*>& modified) const;
+};
+
+}  // namespace utils
+}  // namespace broadcastradio
+}  // namespace hardware
+}  // namespace android
+
+#endif  // ANDROID_HARDWARE_BROADCASTRADIO_COMMON_UTILS_2X_PROGRAMLISTSTORE_H
@@ -0,0 +1,398 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "ExtCamCapCache@3.4"
+//#define LOG_NDEBUG 0
+#include <log/log.h>
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+
+#include <cstring>
+#include <thread>
+
+#include "ExternalCameraCapabilityCache.h"
+#include "ExternalCameraDevice_3_4.h"
+
+namespace android {
+namespace hardware {
+namespace camera {
+namespace device {
+namespace V3_4 {
+namespace implementation {
+
+namespace {
+
+const uint32_t kCacheMagic = 0x50434345;  // 'ECCP'
+const uint32_t kCacheVersion = 1;
+
+// Upper bounds on what a cache file may claim, so a corrupt file can't make load() allocate
+// unbounded memory
+const uint32_t kMaxKeyLength = 4096;
+const uint32_t kMaxFormats = 4096;
+const uint32_t kMaxFrameRates = 256;
+
+uint64_t fnv1a(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ULL) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Reads a hexadecimal sysfs attribute, e.g. idVendor. Returns 0 if it doesn't exist
+uint32_t readSysfsHex(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "re");
+    if (file == nullptr) {
+        return 0;
+    }
+    unsigned int value = 0;
+    if (fscanf(file, "%x", &value) != 1) {
+        value = 0;
+    }
+    fclose(file);
+    return value;
+}
+
+std::string cString(const uint8_t* str, size_t maxLength) {
+    return std::string(reinterpret_cast<const char*>(str), strnlen(
+            reinterpret_cast<const char*>(str), maxLength));
+}
+
+bool sameFormats(const std::vector<SupportedV4L2Format>& a,
+        const std::vector<SupportedV4L2Format>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].fourcc != b[i].fourcc || a[i].width != b[i].width ||
+                a[i].height != b[i].height || a[i].frameRates.size() != b[i].frameRates.size()) {
+            return false;
+        }
+        for (size_t j = 0; j < a[i].frameRates.size(); j++) {
+            if (a[i].frameRates[j].durationNumerator != b[i].frameRates[j].durationNumerator ||
+                    a[i].frameRates[j].durationDenominator !=
+                    b[i].frameRates[j].durationDenominator) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Appends native-endian words; cache files never leave the device
+struct CacheWriter {
+    std::vector<uint8_t> buffer;
+
+    void put(uint32_t value) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+    }
+    void put(const std::string& str) {
+        put(static_cast<uint32_t>(str.size()));
+        buffer.insert(buffer.end(), str.begin(), str.end());
+    }
+};
+
+struct CacheReader {
+    const uint8_t* data;
+    size_t size;
+    size_t offset = 0;
+
+    bool get(uint32_t* value) {
+        if (size - offset < sizeof(*value)) {
+            return false;
+        }
+        memcpy(value, data + offset, sizeof(*value));
+        offset += sizeof(*value);
+        return true;
+    }
+    bool get(std::string* str) {
+        uint32_t length;
+        if (!get(&length) || length > kMaxKeyLength || size - offset < length) {
+            return false;
+        }
+        str->assign(reinterpret_cast<const char*>(data + offset), length);
+        offset += length;
+        return true;
+    }
+};
+
+} // anonymous namespace
+
+bool V4L2DeviceIdentity::query(int fd, const std::string& devicePath, V4L2DeviceIdentity* out) {
+    v4l2_capability capability{};
+    if (TEMP_FAILURE_RETRY(ioctl(fd, VIDIOC_QUERYCAP, &capability)) != 0) {
+        ALOGE("%s: VIDIOC_QUERYCAP on %s failed: %s", __FUNCTION__, devicePath.c_str(),
+                strerror(errno));
+        return false;
+    }
+    out->driver = cString(capability.driver, sizeof(capability.driver));
+    out->card = cString(capability.card, sizeof(capability.card));
+    out->busInfo = cString(capability.bus_info, sizeof(capability.bus_info));
+    out->driverVersion = capability.version;
+
+    // For UVC cameras the device link points at the USB interface, whose parent is the USB
+    // device. Other drivers have no such attributes and keep zeros.
+    const size_t slash = devicePath.rfind('/');
+    const std::string usbDevice = "/sys/class/video4linux/" + devicePath.substr(slash + 1) +
+            "/device/../";
+    out->vendorId = readSysfsHex(usbDevice + "idVendor");
+    out->productId = readSysfsHex(usbDevice + "idProduct");
+    out->firmwareVersion = readSysfsHex(usbDevice + "bcdDevice");
+    return true;
+}
+
+std::string V4L2DeviceIdentity::toString() const {
+    char ids[64];
+    snprintf(ids, sizeof(ids), "%" PRIu32 "|%04" PRIx32 ":%04" PRIx32 "|%04" PRIx32,
+            driverVersion, vendorId, productId, firmwareVersion);
+    return driver + "|" + card + "|" + busInfo + "|" + ids;
+}
+
+const char* ExternalCameraCapabilityCache::kDefaultCacheDir = "/data/vendor/external_camera";
+
+ExternalCameraCapabilityCache& ExternalCameraCapabilityCache::getInstance() {
+    // Never destroyed, since background refreshes may still be running at exit
+    static ExternalCameraCapabilityCache* sInstance = new ExternalCameraCapabilityCache(
+            kDefaultCacheDir, ExternalCameraDevice::probeSupportedFormats);
+    return *sInstance;
+}
+
+ExternalCameraCapabilityCache::ExternalCameraCapabilityCache(
+        const std::string& cacheDir, ProbeFn probe) :
+        mCacheDir(cacheDir),
+        mProbe(std::move(probe)) {}
+
+ExternalCameraCapabilityCache::~ExternalCameraCapabilityCache() {
+    waitForRefreshes();
+}
+
+std::string ExternalCameraCapabilityCache::pathFor(const V4L2DeviceIdentity& identity) const {
+    const std::string key = identity.toString();
+    char name[32];
+    snprintf(name, sizeof(name), "%016" PRIx64 ".bin", fnv1a(key.data(), key.size()));
+    return mCacheDir + "/" + name;
+}
+
+std::vector<SupportedV4L2Format> ExternalCameraCapabilityCache::getFormats(
+        int fd, const std::string& devicePath) {
+    V4L2DeviceIdentity identity;
+    if (!V4L2DeviceIdentity::query(fd, devicePath, &identity)) {
+        return mProbe(fd);
+    }
+    const std::string key = identity.toString();
+
+    std::vector<SupportedV4L2Format> formats;
+    bool needRefresh = false;
+    {
+        std::lock_guard<std::mutex> lk(mLock);
+        auto it = mEntries.find(key);
+        if (it != mEntries.end()) {
+            formats = it->second.formats;
+            needRefresh = !it->second.refreshed;
+            it->second.refreshed = true;
+        }
+    }
+
+    if (formats.empty() && load(identity, &formats)) {
+        ALOGV("%s: using formats of %s cached on disk", __FUNCTION__, key.c_str());
+        std::lock_guard<std::mutex> lk(mLock);
+        Entry& entry = mEntries[key];
+        needRefresh = !entry.refreshed;
+        entry.formats = formats;
+        entry.refreshed = true;
+    }
+
+    if (formats.empty()) {
+        formats = mProbe(fd);
+        if (formats.empty()) {
+            // Don't remember a device that failed to enumerate; it may be half way through a
+            // reset and report its formats next time
+            return formats;
+        }
+        {
+            std::lock_guard<std::mutex> lk(mLock);
+            mEntries[key] = {formats, /*refreshed*/true};
+        }
+        store(identity, formats);
+        return formats;
+    }
+
+    if (needRefresh) {
+        std::lock_guard<std::mutex> lk(mLock);
+        mPendingRefreshes++;
+        std::thread([this, identity, devicePath]() { refresh(identity, devicePath); }).detach();
+    }
+    return formats;
+}
+
+void ExternalCameraCapabilityCache::refresh(
+        const V4L2DeviceIdentity& identity, const std::string& devicePath) {
+    const std::string key = identity.toString();
+    unique_fd fd(::open(devicePath.c_str(), O_RDWR));
+    V4L2DeviceIdentity current;
+    if (fd.get() < 0) {
+        ALOGW("%s: cannot reopen %s to refresh its formats", __FUNCTION__, devicePath.c_str());
+    } else if (!V4L2DeviceIdentity::query(fd.get(), devicePath, &current) ||
+            current.toString() != key) {
+        ALOGV("%s: %s is no longer %s", __FUNCTION__, devicePath.c_str(), key.c_str());
+    } else {
+        std::vector<SupportedV4L2Format> formats = mProbe(fd.get());
+        bool changed = false;
+        if (!formats.empty()) {
+            std::lock_guard<std::mutex> lk(mLock);
+            Entry& entry = mEntries[key];
+            if (!sameFormats(entry.formats, formats)) {
+                entry.formats = formats;
+                changed = true;
+            }
+        }
+        if (changed) {
+            ALOGI("%s: formats of %s changed, they will be used from the next hotplug",
+                    __FUNCTION__, key.c_str());
+            store(identity, formats);
+        }
+    }
+
+    std::lock_guard<std::mutex> lk(mLock);
+    mPendingRefreshes--;
+    mRefreshDone.notify_all();
+}
+
+void ExternalCameraCapabilityCache::waitForRefreshes() {
+    std::unique_lock<std::mutex> lk(mLock);
+    mRefreshDone.wait(lk, [this]() { return mPendingRefreshes == 0; });
+}
+
+bool ExternalCameraCapabilityCache::load(const V4L2DeviceIdentity& identity,
+        std::vector<SupportedV4L2Format>* out) const {
+    unique_fd fd(::open(pathFor(identity).c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd.get() < 0) {
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t chunk[4096];
+    ssize_t n;
+    while ((n = TEMP_FAILURE_RETRY(read(fd.get(), chunk, sizeof(chunk)))) > 0) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    if (n < 0 || data.size() < sizeof(uint64_t)) {
+        return false;
+    }
+
+    // The file ends with a checksum of everything before it, so truncated or partially
+    // written files are rejected rather than half used
+    const size_t payloadSize = data.size() - sizeof(uint64_t);
+    uint64_t checksum;
+    memcpy(&checksum, data.data() + payloadSize, sizeof(checksum));
+    if (checksum != fnv1a(data.data(), payloadSize)) {
+        ALOGW("%s: discarding corrupt cache file %s", __FUNCTION__, pathFor(identity).c_str());
+        return false;
+    }
+
+    CacheReader reader{data.data(), payloadSize};
+    uint32_t magic, version, numFormats;
+    std::string key;
+    if (!reader.get(&magic) || magic != kCacheMagic || !reader.get(&version) ||
+            version != kCacheVersion || !reader.get(&key) || key != identity.toString() ||
+            !reader.get(&numFormats) || numFormats > kMaxFormats) {
+        return false;
+    }
+
+    std::vector<SupportedV4L2Format> formats(numFormats);
+    for (auto& format : formats) {
+        uint32_t numFrameRates;
+        if (!reader.get(&format.fourcc) || !reader.get(&format.width) ||
+                !reader.get(&format.height) || !reader.get(&numFrameRates) ||
+                numFrameRates > kMaxFrameRates) {
+            return false;
+        }
+        format.frameRates.resize(numFrameRates);
+        for (auto& fr : format.frameRates) {
+            if (!reader.get(&fr.durationNumerator) || !reader.get(&fr.durationDenominator) ||
+                    fr.durationNumerator == 0) {
+                return false;
+            }
+        }
+    }
+    if (reader.offset != payloadSize) {
+        return false;
+    }
+    *out = std::move(formats);
+    return true;
+}
+
+bool ExternalCameraCapabilityCache::store(const V4L2DeviceIdentity& identity,
+        const std::vector<SupportedV4L2Format>& formats) const {
+    CacheWriter writer;
+    writer.put(kCacheMagic);
+    writer.put(kCacheVersion);
+    writer.put(identity.toString());
+    writer.put(static_cast<uint32_t>(formats.size()));
+    for (const auto& format : formats) {
+        writer.put(format.fourcc);
+        writer.put(format.width);
+        writer.put(format.height);
+        writer.put(static_cast<uint32_t>(format.frameRates.size()));
+        for (const auto& fr : format.frameRates) {
+            writer.put(fr.durationNumerator);
+            writer.put(fr.durationDenominator);
+        }
+    }
+    const uint64_t checksum = fnv1a(writer.buffer.data(), writer.buffer.size());
+    const uint8_t* checksumBytes = reinterpret_cast<const uint8_t*>(&checksum);
+    writer.buffer.insert(writer.buffer.end(), checksumBytes, checksumBytes + sizeof(checksum));
+
+    // Write a temporary file and rename it, so readers never see a partial entry
+    const std::string path = pathFor(identity);
+    const std::string tmpPath = path + ".tmp";
+    unique_fd fd(::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640));
+    if (fd.get() < 0) {
+        ALOGV("%s: cannot create %s: %s", __FUNCTION__, tmpPath.c_str(), strerror(errno));
+        return false;
+    }
+    size_t written = 0;
+    while (written < writer.buffer.size()) {
+        ssize_t n = TEMP_FAILURE_RETRY(write(fd.get(), writer.buffer.data() + written,
+                writer.buffer.size() - written));
+        if (n <= 0) {
+            ALOGW("%s: writing %s failed: %s", __FUNCTION__, tmpPath.c_str(), strerror(errno));
+            unlink(tmpPath.c_str());
+            return false;
+        }
+        written += n;
+    }
+    fd.reset();
+    if (rename(tmpPath.c_str(), path.c_str()) != 0) {
+        ALOGW("%s: renaming %s failed: %s", __FUNCTION__, tmpPath.c_str(), strerror(errno));
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+}  // namespace implementation
+}  // namespace V3_4
+}  // namespace device
+}  // namespace camera
+}  // namespace hardware
+}  // namespace android
@@ -25,6 +25,7 @@
 #include "android-base/macros.h"
 #include "CameraMetadata.h"
 #include "../../3.2/default/include/convert.h"
+#include "ExternalCameraCapabilityCache.h"
 #include "ExternalCameraDevice_3_4.h"
 
 namespace android {
@@ -761,8 +762,7 @@ status_t ExternalCameraDevice::initOutputCharsKeys(
 #undef ARRAY_SIZE
 #undef UPDATE
 
-void ExternalCameraDevice::getFrameRateList(
-        int fd, double fpsUpperBound, SupportedV4L2Format* format) {
+void ExternalCameraDevice::getFrameRateList(int fd, SupportedV4L2Format* format) {
     format->frameRates.clear();
 
     v4l2_frmivalenum frameInterval{
@@ -781,9 +781,6 @@ void ExternalCameraDevice::getFrameRateList(
                         frameInterval.discrete.numerator,
                         frameInterval.discrete.denominator};
                 double framerate = fr.getDouble();
-                if (framerate > fpsUpperBound) {
-                    continue;
-                }
                 ALOGV("index:%d, format:%c%c%c%c, w %d, h %d, framerate %f",
                     frameInterval.index,
                     frameInterval.pixel_format & 0xFF,
@@ -857,12 +854,7 @@ void ExternalCameraDevice::trimSupportedFormats(
     sortedFmts = out;
 }
 
-std::vector<SupportedV4L2Format> ExternalCameraDevice::getCandidateSupportedFormatsLocked(
-    int fd, CroppingType cropType,
-    const std::vector<ExternalCameraConfig::FpsLimitation>& fpsLimits,
-    const std::vector<ExternalCameraConfig::FpsLimitation>& depthFpsLimits,
-    const Size& minStreamSize,
-    bool depthEnabled) {
+std::vector<SupportedV4L2Format> ExternalCameraDevice::probeSupportedFormats(int fd) {
     std::vector<SupportedV4L2Format> outFmts;
     struct v4l2_fmtdesc fmtdesc {
         .index = 0,
@@ -897,21 +889,14 @@ std::vector<SupportedV4L2Format> ExternalCameraDevice::getCandidateSupportedForm
                         if (frameSize.discrete.height > frameSize.discrete.width) {
                             continue;
                         }
-                        // Discard all formats which is smaller than minStreamSize
-                        if (frameSize.discrete.width < minStreamSize.width
-                            || frameSize.discrete.height < minStreamSize.height) {
-                            continue;
-                        }
                         SupportedV4L2Format format {
                             .width = frameSize.discrete.width,
                             .height = frameSize.discrete.height,
                             .fourcc = fmtdesc.pixelformat
                         };
-
-                        if (format.fourcc == V4L2_PIX_FMT_Z16 && depthEnabled) {
-                            updateFpsBounds(fd, cropType, depthFpsLimits, format, outFmts);
-                        } else {
-                            updateFpsBounds(fd, cropType, fpsLimits, format, outFmts);
+                        getFrameRateList(fd, &format);
+                        if (!format.frameRates.empty()) {
+                            outFmts.push_back(format);
                         }
                     }
                 }
@@ -919,12 +904,34 @@ std::vector<SupportedV4L2Format> ExternalCameraDevice::getCandidateSupportedForm
         }
         fmtdesc.index++;
     }
+    return outFmts;
+}
+
+std::vector<SupportedV4L2Format> ExternalCameraDevice::getCandidateSupportedFormatsLocked(
+    const std::vector<SupportedV4L2Format>& probedFmts, CroppingType cropType,
+    const std::vector<ExternalCameraConfig::FpsLimitation>& fpsLimits,
+    const std::vector<ExternalCameraConfig::FpsLimitation>& depthFpsLimits,
+    const Size& minStreamSize,
+    bool depthEnabled) {
+    std::vector<SupportedV4L2Format> outFmts;
+    for (const auto& format : probedFmts) {
+        // Discard all formats which is smaller than minStreamSize
+        if (format.width < minStreamSize.width || format.height < minStreamSize.height) {
+            continue;
+        }
+
+        if (format.fourcc == V4L2_PIX_FMT_Z16 && depthEnabled) {
+            updateFpsBounds(cropType, depthFpsLimits, format, outFmts);
+        } else {
+            updateFpsBounds(cropType, fpsLimits, format, outFmts);
+        }
+    }
     trimSupportedFormats(cropType, &outFmts);
     return outFmts;
 }
 
 void ExternalCameraDevice::updateFpsBounds(
-    int fd, CroppingType cropType,
+    CroppingType cropType,
     const std::vector<ExternalCameraConfig::FpsLimitation>& fpsLimits, SupportedV4L2Format format,
     std::vector<SupportedV4L2Format>& outFmts) {
     double fpsUpperBound = -1.0;
@@ -945,17 +952,28 @@ void ExternalCameraDevice::updateFpsBounds(
         return;
     }
 
-    getFrameRateList(fd, fpsUpperBound, &format);
+    format.frameRates.erase(
+            std::remove_if(format.frameRates.begin(), format.frameRates.end(),
+                    [fpsUpperBound](const SupportedV4L2Format::FrameRate& fr) {
+                        return fr.getDouble() > fpsUpperBound;
+                    }),
+            format.frameRates.end());
     if (!format.frameRates.empty()) {
         outFmts.push_back(format);
     }
 }
 
 void ExternalCameraDevice::initSupportedFormatsLocked(int fd) {
+    // Enumerating a camera can take seconds, so it is done once per device and shared by both
+    // cropping types, and by later instances for the same device
+    const std::vector<SupportedV4L2Format> probedFmts =
+            ExternalCameraCapabilityCache::getInstance().getFormats(fd, mDevicePath);
     std::vector<SupportedV4L2Format> horizontalFmts = getCandidateSupportedFormatsLocked(
-        fd, HORIZONTAL, mCfg.fpsLimits, mCfg.depthFpsLimits, mCfg.minStreamSize, mCfg.depthEnabled);
+        probedFmts, HORIZONTAL, mCfg.fpsLimits, mCfg.depthFpsLimits, mCfg.minStreamSize,
+        mCfg.depthEnabled);
     std::vector<SupportedV4L2Format> verticalFmts = getCandidateSupportedFormatsLocked(
-        fd, VERTICAL, mCfg.fpsLimits, mCfg.depthFpsLimits, mCfg.minStreamSize, mCfg.depthEnabled);
+        probedFmts, VERTICAL, mCfg.fpsLimits, mCfg.depthFpsLimits, mCfg.minStreamSize,
+        mCfg.depthEnabled);
 
     size_t horiSize = horizontalFmts.size();
     size_t vertSize = verticalFmts.size();
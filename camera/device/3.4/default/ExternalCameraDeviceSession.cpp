@@ -1022,6 +1022,91 @@ int ExternalCameraDeviceSession::OutputThread::cropAndScaleLocked(
     return 0;
 }
 
+int ExternalCameraDeviceSession::OutputThread::cropScaleConvertLocked(
+        sp<AllocatedFrame>& in, const Size& outSz,
+        const YCbCrLayout& outLayout, uint32_t outputFourcc) {
+    Size inSz = {in->mWidth, in->mHeight};
+
+    // Cropping to output aspect ratio
+    IMapper::Rect inputCrop = {0, 0,
+            static_cast<int32_t>(inSz.width), static_cast<int32_t>(inSz.height)};
+    int ret;
+    if (!(inSz == outSz)) {
+        ret = getCropRect(mCroppingType, inSz, outSz, &inputCrop);
+        if (ret != 0) {
+            ALOGE("%s: failed to compute crop rect for output size %dx%d",
+                    __FUNCTION__, outSz.width, outSz.height);
+            return ret;
+        }
+    }
+
+    YCbCrLayout croppedLayout;
+    ret = in->getCroppedLayout(inputCrop, &croppedLayout);
+    if (ret != 0) {
+        ALOGE("%s: failed to crop input image %dx%d to output size %dx%d",
+                __FUNCTION__, inSz.width, inSz.height, outSz.width, outSz.height);
+        return ret;
+    }
+
+    // Scale and convert straight into the output buffer instead of going
+    // through an intermediate YU12 frame
+    Size cropSz = {static_cast<uint32_t>(inputCrop.width),
+            static_cast<uint32_t>(inputCrop.height)};
+    return scaleAndFormatConvert(croppedLayout, cropSz, outLayout, outSz, outputFourcc,
+            &mConvertScratch);
+}
+
+int ExternalCameraDeviceSession::OutputThread::decodeMjpegLocked(
+        const uint8_t* inData, size_t inDataSize,
+        const std::vector<HalStreamBuffer>& buffers) {
+    // Pick the smallest downscaled frame that needs no upscaling for any output
+    sp<AllocatedFrame> decodeFrame;
+    int decodeScale = 1;
+    for (const auto& [scale, frame] : mDownscaledYu12Frames) {
+        if (scale <= decodeScale) {
+            continue;
+        }
+        bool largeEnough = true;
+        for (const auto& halBuf : buffers) {
+            if (halBuf.width > frame->mWidth || halBuf.height > frame->mHeight) {
+                largeEnough = false;
+                break;
+            }
+        }
+        if (largeEnough) {
+            decodeFrame = frame;
+            decodeScale = scale;
+        }
+    }
+
+    if (decodeFrame != nullptr) {
+        ATRACE_BEGIN("MJPGtoI420Scaled");
+        YCbCrLayout layout;
+        int res = decodeFrame->getLayout(&layout);
+        if (res == 0) {
+            res = decodeMjpegScaledToYU12(inData, inDataSize, decodeScale,
+                    Size {decodeFrame->mWidth, decodeFrame->mHeight}, layout, &mDecodeScratch);
+        }
+        ATRACE_END();
+        if (res == 0) {
+            mDecodedYu12Frame = decodeFrame;
+            return 0;
+        }
+        ALOGW("%s: scaled MJPEG decode failed, decoding full frame", __FUNCTION__);
+    }
+
+    ATRACE_BEGIN("MJPGtoI420");
+    int res = libyuv::MJPGToI420(
+            inData, inDataSize, static_cast<uint8_t*>(mYu12FrameLayout.y),
+            mYu12FrameLayout.yStride, static_cast<uint8_t*>(mYu12FrameLayout.cb),
+            mYu12FrameLayout.cStride, static_cast<uint8_t*>(mYu12FrameLayout.cr),
+            mYu12FrameLayout.cStride, mYu12Frame->mWidth, mYu12Frame->mHeight,
+            mYu12Frame->mWidth, mYu12Frame->mHeight);
+    ATRACE_END();
+    mDecodedYu12Frame = mYu12Frame;
+    return res;
+}
+
 
 int ExternalCameraDeviceSession::OutputThread::cropAndScaleThumbLocked(
         sp<AllocatedFrame>& in, const Size &outSz, YCbCrLayout* out) {
@@ -1258,7 +1343,7 @@ int ExternalCameraDeviceSession::OutputThread::createJpegLocked(
           halBuf.bufPtr);
     ALOGV("%s: YV12 buffer %d x %d",
           __FUNCTION__,
-          mYu12Frame->mWidth, mYu12Frame->mHeight);
+          mDecodedYu12Frame->mWidth, mDecodedYu12Frame->mHeight);
 
     int jpegQuality, thumbQuality;
     Size thumbSize;
@@ -1323,7 +1408,7 @@ int ExternalCameraDeviceSession::OutputThread::createJpegLocked(
 
     YCbCrLayout yu12Thumb;
     if (outputThumbnail) {
-        ret = cropAndScaleThumbLocked(mYu12Frame, thumbSize, &yu12Thumb);
+        ret = cropAndScaleThumbLocked(mDecodedYu12Frame, thumbSize, &yu12Thumb);
 
         if (ret != 0) {
             return lfail(
@@ -1332,7 +1417,7 @@ int ExternalCameraDeviceSession::OutputThread::createJpegLocked(
     }
 
     /* Scale and crop main jpeg */
-    ret = cropAndScaleLocked(mYu12Frame, jpegSize, &yu12Main);
+    ret = cropAndScaleLocked(mDecodedYu12Frame, jpegSize, &yu12Main);
 
     if (ret != 0) {
         return lfail("%s: crop and scale main failed!", __FUNCTION__);
@@ -1486,11 +1571,12 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
         }
     }
 
+    mDecodedYu12Frame = mYu12Frame;
     // TODO: in some special case maybe we can decode jpg directly to gralloc output?
     if (req->frameIn->mFourcc == V4L2_PIX_FMT_MJPEG) {
-        ATRACE_BEGIN("MJPGtoI420");
         int res = 0;
         if (mCameraMuted) {
+            ATRACE_BEGIN("MJPGtoI420");
             res = libyuv::ConvertToI420(
                     mMuteTestPatternFrame.data(), mMuteTestPatternFrame.size(),
                     static_cast<uint8_t*>(mYu12FrameLayout.y), mYu12FrameLayout.yStride,
@@ -1498,15 +1584,11 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
                     static_cast<uint8_t*>(mYu12FrameLayout.cr), mYu12FrameLayout.cStride, 0, 0,
                     mYu12Frame->mWidth, mYu12Frame->mHeight, mYu12Frame->mWidth,
                     mYu12Frame->mHeight, libyuv::kRotate0, libyuv::FOURCC_RAW);
+            ATRACE_END();
+            mDecodedYu12Frame = mYu12Frame;
         } else {
-            res = libyuv::MJPGToI420(
-                    inData, inDataSize, static_cast<uint8_t*>(mYu12FrameLayout.y),
-                    mYu12FrameLayout.yStride, static_cast<uint8_t*>(mYu12FrameLayout.cb),
-                    mYu12FrameLayout.cStride, static_cast<uint8_t*>(mYu12FrameLayout.cr),
-                    mYu12FrameLayout.cStride, mYu12Frame->mWidth, mYu12Frame->mHeight,
-                    mYu12Frame->mWidth, mYu12Frame->mHeight);
+            res = decodeMjpegLocked(inData, inDataSize, req->buffers);
         }
-        ATRACE_END();
 
         if (res != 0) {
             // For some webcam, the first few V4L2 frames might be malformed...
@@ -1591,25 +1673,16 @@ bool ExternalCameraDeviceSession::OutputThread::threadLoop() {
                         (outputFourcc >> 16) & 0xFF,
                         (outputFourcc >> 24) & 0xFF);
 
-                YCbCrLayout cropAndScaled;
-                ATRACE_BEGIN("cropAndScaleLocked");
-                int ret = cropAndScaleLocked(
-                        mYu12Frame,
+                ATRACE_BEGIN("cropScaleConvertLocked");
+                int ret = cropScaleConvertLocked(
+                        mDecodedYu12Frame,
                         Size { halBuf.width, halBuf.height },
-                        &cropAndScaled);
+                        outLayout, outputFourcc);
                 ATRACE_END();
                 if (ret != 0) {
                     lk.unlock();
-                    return onDeviceError("%s: crop and scale failed!", __FUNCTION__);
-                }
-
-                Size sz {halBuf.width, halBuf.height};
-                ATRACE_BEGIN("formatConvert");
-                ret = formatConvert(cropAndScaled, outLayout, sz, outputFourcc);
-                ATRACE_END();
-                if (ret != 0) {
-                    lk.unlock();
-                    return onDeviceError("%s: format coversion failed!", __FUNCTION__);
+                    return onDeviceError("%s: crop, scale and format conversion failed!",
+                            __FUNCTION__);
                 }
                 int relFence = sHandleImporter.unlock(*(halBuf.bufPtr));
                 if (relFence >= 0) {
@@ -1688,6 +1761,40 @@ Status ExternalCameraDeviceSession::OutputThread::allocateIntermediateBuffers(
         }
     }
 
+    // Allocating frames to decode MJPEG into at a reduced scale, for the scales at
+    // which some stream can be produced without upscaling
+    for (int scale : kMjpegDecodeScales) {
+        if (v4lSize.width % (2 * scale) != 0 || v4lSize.height % (2 * scale) != 0) {
+            mDownscaledYu12Frames.erase(scale);
+            continue;
+        }
+        Size sz = {v4lSize.width / scale, v4lSize.height / scale};
+        bool used = false;
+        for (const auto& stream : streams) {
+            if (stream.width <= sz.width && stream.height <= sz.height) {
+                used = true;
+                break;
+            }
+        }
+        if (!used) {
+            mDownscaledYu12Frames.erase(scale);
+            continue;
+        }
+
+        auto frameIt = mDownscaledYu12Frames.find(scale);
+        if (frameIt != mDownscaledYu12Frames.end() && frameIt->second->mWidth == sz.width &&
+                frameIt->second->mHeight == sz.height) {
+            continue;
+        }
+        sp<AllocatedFrame> buf = new AllocatedFrame(sz.width, sz.height);
+        int ret = buf->allocate();
+        if (ret != 0) {
+            ALOGE("%s: allocating 1/%d scale YU12 frame failed!", __FUNCTION__, scale);
+            return Status::INTERNAL_ERROR;
+        }
+        mDownscaledYu12Frames[scale] = buf;
+    }
+
     // Remove unconfigured buffers
     auto it = mIntermediateBuffers.begin();
     while (it != mIntermediateBuffers.end()) {
@@ -1717,6 +1824,8 @@ void ExternalCameraDeviceSession::OutputThread::clearIntermediateBuffers() {
     std::lock_guard<std::mutex> lk(mBufferLock);
     mYu12Frame.clear();
     mYu12ThumbFrame.clear();
+    mDownscaledYu12Frames.clear();
+    mDecodedYu12Frame.clear();
     mIntermediateBuffers.clear();
     mMuteTestPatternFrame.clear();
     mBlobBufferSize = 0;
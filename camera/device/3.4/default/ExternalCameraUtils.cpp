@@ -17,8 +17,15 @@
 //#define LOG_NDEBUG 0
 #include <log/log.h>
 
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <setjmp.h>
+#include <thread>
 #include <sys/mman.h>
 #include <linux/videodev2.h>
 
@@ -33,6 +40,13 @@ namespace {
 
 buffer_handle_t sEmptyBuffer = nullptr;
 
+/* libjpeg error manager that jumps back to the caller on fatal errors,
+ * since error_exit must not return to libjpeg */
+struct JpegErrorMgr {
+    struct jpeg_error_mgr mgr;
+    jmp_buf jumpBuffer;
+};
+
 } // Anonymous namespace
 
 namespace android {
@@ -382,11 +396,507 @@ int formatConvert(
     return 0;
 }
 
+int scaleAndFormatConvert(const YCbCrLayout& in, Size inSz, const YCbCrLayout& out, Size outSz,
+        uint32_t format, std::vector<uint8_t>* scratch) {
+    if (inSz == outSz) {
+        return formatConvert(in, out, outSz, format);
+    }
+
+    const int inCWidth = (inSz.width + 1) / 2;
+    const int inCHeight = (inSz.height + 1) / 2;
+    const int outCWidth = (outSz.width + 1) / 2;
+    const int outCHeight = (outSz.height + 1) / 2;
+    int ret = 0;
+    switch (format) {
+        case V4L2_PIX_FMT_NV21:
+        case V4L2_PIX_FMT_NV12: {
+            // Scale luma straight into the output buffer
+            libyuv::ScalePlane(
+                    static_cast<uint8_t*>(in.y), in.yStride, inSz.width, inSz.height,
+                    static_cast<uint8_t*>(out.y), out.yStride, outSz.width, outSz.height,
+                    libyuv::FilterMode::kFilterNone);
+
+            // Scale chroma planes at output size, then interleave them
+            scratch->resize(2 * outCWidth * outCHeight);
+            uint8_t* u = scratch->data();
+            uint8_t* v = u + outCWidth * outCHeight;
+            libyuv::ScalePlane(
+                    static_cast<uint8_t*>(in.cb), in.cStride, inCWidth, inCHeight,
+                    u, outCWidth, outCWidth, outCHeight, libyuv::FilterMode::kFilterNone);
+            libyuv::ScalePlane(
+                    static_cast<uint8_t*>(in.cr), in.cStride, inCWidth, inCHeight,
+                    v, outCWidth, outCWidth, outCHeight, libyuv::FilterMode::kFilterNone);
+            if (format == V4L2_PIX_FMT_NV21) {
+                libyuv::MergeUVPlane(v, outCWidth, u, outCWidth,
+                        static_cast<uint8_t*>(out.cr), out.cStride, outCWidth, outCHeight);
+            } else {
+                libyuv::MergeUVPlane(u, outCWidth, v, outCWidth,
+                        static_cast<uint8_t*>(out.cb), out.cStride, outCWidth, outCHeight);
+            }
+        } break;
+        case V4L2_PIX_FMT_YVU420: // YV12
+        case V4L2_PIX_FMT_YUV420: // YU12
+            // out.cb/out.cr already point to the right planes for either order
+            ret = libyuv::I420Scale(
+                    static_cast<uint8_t*>(in.y),
+                    in.yStride,
+                    static_cast<uint8_t*>(in.cb),
+                    in.cStride,
+                    static_cast<uint8_t*>(in.cr),
+                    in.cStride,
+                    inSz.width,
+                    inSz.height,
+                    static_cast<uint8_t*>(out.y),
+                    out.yStride,
+                    static_cast<uint8_t*>(out.cb),
+                    out.cStride,
+                    static_cast<uint8_t*>(out.cr),
+                    out.cStride,
+                    outSz.width,
+                    outSz.height,
+                    libyuv::FilterMode::kFilterNone);
+            if (ret != 0) {
+                ALOGE("%s: scale to YV12 or YU12 buffer failed! ret %d",
+                            __FUNCTION__, ret);
+                return ret;
+            }
+            break;
+        default:
+            // Flexible layouts are not supported either way; let formatConvert report it
+            return formatConvert(in, out, outSz, format);
+    }
+    return 0;
+}
+
+int decodeMjpegScaledToYU12(const uint8_t* in, size_t inSize, int scale, Size outSz,
+        const YCbCrLayout& out, std::vector<uint8_t>* scratch) {
+    if (outSz.width % 2 != 0 || outSz.height % 2 != 0) {
+        ALOGE("%s: output size %dx%d is not even", __FUNCTION__, outSz.width, outSz.height);
+        return -1;
+    }
+
+    jpeg_decompress_struct dinfo = {};
+    JpegErrorMgr jerr;
+
+    /* Row pointers are declared before setjmp so that longjmp does not
+     * skip their destructors */
+    std::vector<JSAMPROW> rows[3];
+
+    dinfo.err = jpeg_std_error(&jerr.mgr);
+    jerr.mgr.output_message = [](j_common_ptr cinfo) {
+        char buffer[JMSG_LENGTH_MAX];
+
+        /* Create the message */
+        (*cinfo->err->format_message)(cinfo, buffer);
+        ALOGE("libjpeg error: %s", buffer);
+    };
+    jerr.mgr.error_exit = [](j_common_ptr cinfo) {
+        (*cinfo->err->output_message)(cinfo);
+        longjmp(reinterpret_cast<JpegErrorMgr*>(cinfo->err)->jumpBuffer, 1);
+    };
+    jpeg_create_decompress(&dinfo);
+    if (setjmp(jerr.jumpBuffer)) {
+        jpeg_destroy_decompress(&dinfo);
+        return -1;
+    }
+
+    jpeg_mem_src(&dinfo, const_cast<uint8_t*>(in), inSize);
+    jpeg_read_header(&dinfo, TRUE);
+    if (dinfo.num_components != 3) {
+        ALOGE("%s: unsupported MJPEG frame with %d components", __FUNCTION__,
+                dinfo.num_components);
+        jpeg_destroy_decompress(&dinfo);
+        return -1;
+    }
+
+    /* Let the IDCT do the scaling, and get the subsampled planes as they
+     * are decoded rather than upsampled and color converted */
+    dinfo.scale_num = 1;
+    dinfo.scale_denom = scale;
+    dinfo.raw_data_out = TRUE;
+    dinfo.dct_method = JDCT_IFAST;
+    dinfo.do_fancy_upsampling = FALSE;
+    jpeg_start_decompress(&dinfo);
+
+    jpeg_component_info* comps = dinfo.comp_info;
+    if (dinfo.output_width != outSz.width || dinfo.output_height != outSz.height ||
+            comps[0].downsampled_width != outSz.width ||
+            comps[0].downsampled_height != outSz.height) {
+        ALOGE("%s: MJPEG frame decodes to %dx%d at 1/%d, expected %dx%d", __FUNCTION__,
+                dinfo.output_width, dinfo.output_height, scale, outSz.width, outSz.height);
+        jpeg_destroy_decompress(&dinfo);
+        return -1;
+    }
+
+    /* Each call decodes one iMCU row: v_samp_factor * DCT_scaled_size rows
+     * of width_in_blocks * DCT_scaled_size samples for each component */
+    size_t rowWidths[3];
+    size_t rowsPerIMCU[3];
+    size_t scratchSize = 0;
+    for (int ci = 0; ci < 3; ci++) {
+        rowWidths[ci] = comps[ci].width_in_blocks * comps[ci].DCT_scaled_size;
+        rowsPerIMCU[ci] = comps[ci].v_samp_factor * comps[ci].DCT_scaled_size;
+        scratchSize = std::max(scratchSize, rowWidths[ci]);
+    }
+
+    /* Luma is decoded straight into the output unless its rows are too wide
+     * for the output stride; chroma is decoded into scratch and resampled
+     * to 4:2:0 afterwards. Rows past the image bottom go to a spare row. */
+    const bool lumaInPlace = rowWidths[0] <= static_cast<size_t>(out.yStride);
+    size_t planeOffsets[3] = {0, 0, 0};
+    for (int ci = lumaInPlace ? 1 : 0; ci < 3; ci++) {
+        planeOffsets[ci] = scratchSize;
+        scratchSize += rowWidths[ci] * rowsPerIMCU[ci] * dinfo.total_iMCU_rows;
+    }
+    scratch->resize(scratchSize);
+    uint8_t* spareRow = scratch->data();
+
+    for (int ci = 0; ci < 3; ci++) {
+        const size_t numRows = rowsPerIMCU[ci] * dinfo.total_iMCU_rows;
+        rows[ci].resize(numRows);
+        for (size_t i = 0; i < numRows; i++) {
+            if (i >= comps[ci].downsampled_height) {
+                rows[ci][i] = spareRow;
+            } else if (ci == 0 && lumaInPlace) {
+                rows[ci][i] = static_cast<uint8_t*>(out.y) + i * out.yStride;
+            } else {
+                rows[ci][i] = scratch->data() + planeOffsets[ci] + i * rowWidths[ci];
+            }
+        }
+    }
+
+    const JDIMENSION linesPerIMCU = dinfo.max_v_samp_factor * dinfo.min_DCT_scaled_size;
+    for (JDIMENSION iMCURow = 0; dinfo.output_scanline < dinfo.output_height; iMCURow++) {
+        JSAMPARRAY planes[3] = {&rows[0][iMCURow * rowsPerIMCU[0]],
+                                &rows[1][iMCURow * rowsPerIMCU[1]],
+                                &rows[2][iMCURow * rowsPerIMCU[2]]};
+        if (jpeg_read_raw_data(&dinfo, planes, linesPerIMCU) != linesPerIMCU) {
+            ALOGE("%s: MJPEG frame ended at line %u of %u", __FUNCTION__,
+                    dinfo.output_scanline, dinfo.output_height);
+            jpeg_destroy_decompress(&dinfo);
+            return -1;
+        }
+    }
+
+    if (!lumaInPlace) {
+        libyuv::CopyPlane(scratch->data() + planeOffsets[0], rowWidths[0],
+                static_cast<uint8_t*>(out.y), out.yStride, outSz.width, outSz.height);
+    }
+
+    const int outCWidth = outSz.width / 2;
+    const int outCHeight = outSz.height / 2;
+    uint8_t* chromaPlanes[3] = {nullptr,
+                                static_cast<uint8_t*>(out.cb),
+                                static_cast<uint8_t*>(out.cr)};
+    for (int ci = 1; ci < 3; ci++) {
+        const uint8_t* src = scratch->data() + planeOffsets[ci];
+        const int srcWidth = comps[ci].downsampled_width;
+        const int srcHeight = comps[ci].downsampled_height;
+        if (srcWidth == outCWidth && srcHeight == outCHeight) {
+            libyuv::CopyPlane(src, rowWidths[ci], chromaPlanes[ci], out.cStride,
+                    outCWidth, outCHeight);
+        } else {
+            // e.g. 4:2:2, which most UVC cameras send
+            libyuv::ScalePlane(src, rowWidths[ci], srcWidth, srcHeight,
+                    chromaPlanes[ci], out.cStride, outCWidth, outCHeight,
+                    libyuv::FilterMode::kFilterBilinear);
+        }
+    }
+
+    jpeg_finish_decompress(&dinfo);
+    jpeg_destroy_decompress(&dinfo);
+    return 0;
+}
+
+namespace {
+
+/* Images with at least this many pixels are encoded in stripes */
+const size_t kParallelJpegMinPixels = 2 * 1000 * 1000;
+
+/* Stripes are 8 MCU rows of 16 lines, so that every stripe but the last
+ * has exactly 8 restart intervals. Each stripe then starts its own restart
+ * markers at RST0, which is also the next marker in the joined image once
+ * RST7 is put between stripes, and no marker needs to be renumbered. */
+const uint32_t kJpegStripeMcuRows = 8;
+const uint32_t kJpegStripeHeight = kJpegStripeMcuRows * 2 * DCTSIZE;
+
+/* Worker threads shared by all striped JPEG encodes of the process */
+class JpegEncodePool {
+public:
+    static JpegEncodePool& getInstance() {
+        // Never destroyed, as workers may still be waiting for tasks at exit
+        static JpegEncodePool* sPool = new JpegEncodePool(std::min<size_t>(
+                kJpegEncodeMaxThreads, std::max(1u, std::thread::hardware_concurrency())) - 1);
+        return *sPool;
+    }
+
+    size_t numWorkers() const { return mWorkers.size(); }
+
+    /* Runs fn on the calling thread and on up to helpers workers, and returns
+     * once all of them are done */
+    void run(size_t helpers, const std::function<void()>& fn) {
+        helpers = std::min(helpers, mWorkers.size());
+        std::mutex doneLock;
+        std::condition_variable doneCond;
+        size_t pending = helpers;
+        {
+            std::lock_guard<std::mutex> lk(mLock);
+            for (size_t i = 0; i < helpers; i++) {
+                mTasks.push_back([&]() {
+                    fn();
+                    std::lock_guard<std::mutex> doneLk(doneLock);
+                    if (--pending == 0) {
+                        doneCond.notify_one();
+                    }
+                });
+            }
+        }
+        mTaskCond.notify_all();
+
+        fn();
+        std::unique_lock<std::mutex> doneLk(doneLock);
+        doneCond.wait(doneLk, [&]() { return pending == 0; });
+    }
+
+private:
+    explicit JpegEncodePool(size_t numWorkers) {
+        for (size_t i = 0; i < numWorkers; i++) {
+            mWorkers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    void workerLoop() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lk(mLock);
+                mTaskCond.wait(lk, [this]() { return !mTasks.empty(); });
+                task = std::move(mTasks.front());
+                mTasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex mLock;
+    std::condition_variable mTaskCond;
+    std::deque<std::function<void()>> mTasks;
+    std::vector<std::thread> mWorkers;
+};
+
+/* Encodes lines [firstLine, firstLine + numLines) of a YU12 image as a
+ * standalone JPEG with one restart interval per MCU row, using the same
+ * settings as the single threaded path of encodeJpegYU12 */
+bool encodeJpegStripe(const Size& inSz, const YCbCrLayout& inLayout, int jpegQuality,
+        uint32_t firstLine, uint32_t numLines, const void* app1Buffer, size_t app1Size,
+        std::vector<uint8_t>* out) {
+    /* Destination manager growing a vector, as the size of each stripe
+     * isn't known in advance */
+    struct VectorDestMgr {
+        struct jpeg_destination_mgr mgr;
+        std::vector<uint8_t>* buffer;
+    } dmgr;
+
+    jpeg_compress_struct cinfo = {};
+    JpegErrorMgr jerr;
+    std::vector<JSAMPROW> yLines;
+    std::vector<JSAMPROW> cbLines;
+    std::vector<JSAMPROW> crLines;
+
+    cinfo.err = jpeg_std_error(&jerr.mgr);
+    jerr.mgr.output_message = [](j_common_ptr cinfo) {
+        char buffer[JMSG_LENGTH_MAX];
+
+        /* Create the message */
+        (*cinfo->err->format_message)(cinfo, buffer);
+        ALOGE("libjpeg error: %s", buffer);
+    };
+    jerr.mgr.error_exit = [](j_common_ptr cinfo) {
+        (*cinfo->err->output_message)(cinfo);
+        longjmp(reinterpret_cast<JpegErrorMgr*>(cinfo->err)->jumpBuffer, 1);
+    };
+    jpeg_create_compress(&cinfo);
+    if (setjmp(jerr.jumpBuffer)) {
+        jpeg_destroy_compress(&cinfo);
+        return false;
+    }
+
+    dmgr.buffer = out;
+    dmgr.mgr.init_destination = [](j_compress_ptr cinfo) {
+        auto& dmgr = reinterpret_cast<VectorDestMgr&>(*cinfo->dest);
+        dmgr.mgr.next_output_byte = dmgr.buffer->data();
+        dmgr.mgr.free_in_buffer = dmgr.buffer->size();
+    };
+    dmgr.mgr.empty_output_buffer = [](j_compress_ptr cinfo) -> boolean {
+        auto& dmgr = reinterpret_cast<VectorDestMgr&>(*cinfo->dest);
+        const size_t used = dmgr.buffer->size();
+        dmgr.buffer->resize(used * 2);
+        dmgr.mgr.next_output_byte = dmgr.buffer->data() + used;
+        dmgr.mgr.free_in_buffer = dmgr.buffer->size() - used;
+        return TRUE;
+    };
+    dmgr.mgr.term_destination = [](j_compress_ptr cinfo) {
+        auto& dmgr = reinterpret_cast<VectorDestMgr&>(*cinfo->dest);
+        dmgr.buffer->resize(dmgr.buffer->size() - dmgr.mgr.free_in_buffer);
+    };
+    cinfo.dest = reinterpret_cast<struct jpeg_destination_mgr*>(&dmgr);
+    /* Compressed stills rarely exceed a byte per pixel */
+    out->resize(std::max<size_t>(inSz.width * numLines, 4096));
+
+    cinfo.image_width = inSz.width;
+    cinfo.image_height = numLines;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_YCbCr;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, jpegQuality, 1);
+    jpeg_set_colorspace(&cinfo, JCS_YCbCr);
+    cinfo.raw_data_in = 1;
+    cinfo.dct_method = JDCT_IFAST;
+    cinfo.restart_in_rows = 1;
+    cinfo.comp_info[0].h_samp_factor = 2;
+    cinfo.comp_info[0].v_samp_factor = 2;
+    cinfo.comp_info[1].h_samp_factor = 1;
+    cinfo.comp_info[1].v_samp_factor = 1;
+    cinfo.comp_info[2].h_samp_factor = 1;
+    cinfo.comp_info[2].v_samp_factor = 1;
+    jpeg_start_compress(&cinfo, TRUE);
+
+    /* Pad the last stripe to whole MCU rows by repeating the last line, as
+     * the single threaded path does */
+    const uint32_t mcuV = 2 * DCTSIZE;
+    const uint32_t paddedLines = mcuV * ((numLines + mcuV - 1) / mcuV);
+    yLines.resize(paddedLines);
+    cbLines.resize(paddedLines / 2);
+    crLines.resize(paddedLines / 2);
+    uint8_t* py = static_cast<uint8_t*>(inLayout.y);
+    uint8_t* pcb = static_cast<uint8_t*>(inLayout.cb);
+    uint8_t* pcr = static_cast<uint8_t*>(inLayout.cr);
+    for (uint32_t i = 0; i < paddedLines; i++) {
+        uint32_t li = std::min(firstLine + i, inSz.height - 1);
+        yLines[i] = static_cast<JSAMPROW>(py + li * inLayout.yStride);
+        if (i < paddedLines / 2) {
+            li = std::min(firstLine / 2 + i, (inSz.height - 1) / 2);
+            cbLines[i] = static_cast<JSAMPROW>(pcb + li * inLayout.cStride);
+            crLines[i] = static_cast<JSAMPROW>(pcr + li * inLayout.cStride);
+        }
+    }
+
+    if (app1Buffer && app1Size) {
+        jpeg_write_marker(&cinfo, JPEG_APP0 + 1,
+                static_cast<const JOCTET*>(app1Buffer), app1Size);
+    }
+
+    while (cinfo.next_scanline < cinfo.image_height) {
+        const uint32_t nl = cinfo.next_scanline;
+        JSAMPARRAY planes[3]{ &yLines[nl], &cbLines[nl / 2], &crLines[nl / 2] };
+        if (jpeg_write_raw_data(&cinfo, planes, mcuV) != mcuV) {
+            ALOGE("%s: compressed fewer lines than expected at %u/%u",
+                    __FUNCTION__, nl, cinfo.image_height);
+            jpeg_destroy_compress(&cinfo);
+            return false;
+        }
+    }
+
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    return true;
+}
+
+/* Finds the SOF0 segment of a JPEG written by libjpeg, and the start of its
+ * entropy coded data, just past the SOS segment */
+bool findJpegScan(const std::vector<uint8_t>& jpeg, size_t* sofOffset, size_t* scanOffset) {
+    size_t i = 2; // SOI
+    *sofOffset = 0;
+    while (i + 4 <= jpeg.size()) {
+        if (jpeg[i] != 0xFF) {
+            return false;
+        }
+        const uint8_t marker = jpeg[i + 1];
+        const size_t length = (jpeg[i + 2] << 8) | jpeg[i + 3];
+        if (marker == 0xC0) {
+            *sofOffset = i;
+        } else if (marker == 0xDA) {
+            *scanOffset = i + 2 + length;
+            return *sofOffset != 0 && *scanOffset + 2 <= jpeg.size();
+        }
+        i += 2 + length;
+    }
+    return false;
+}
+
+int encodeJpegYU12Striped(
+        const Size& inSz, const YCbCrLayout& inLayout,
+        int jpegQuality, const void* app1Buffer, size_t app1Size,
+        void* out, const size_t maxOutSize, size_t& actualCodeSize, int maxThreads) {
+    const uint32_t numStripes = (inSz.height + kJpegStripeHeight - 1) / kJpegStripeHeight;
+    std::vector<std::vector<uint8_t>> stripes(numStripes);
+    std::atomic<uint32_t> nextStripe(0);
+    std::atomic<bool> failed(false);
+
+    JpegEncodePool::getInstance().run(std::min<uint32_t>(maxThreads, numStripes) - 1, [&]() {
+        for (uint32_t s = nextStripe++; s < numStripes && !failed; s = nextStripe++) {
+            const uint32_t firstLine = s * kJpegStripeHeight;
+            const uint32_t numLines = std::min(kJpegStripeHeight, inSz.height - firstLine);
+            /* Only the first stripe's headers are kept, so only it needs APP1 */
+            if (!encodeJpegStripe(inSz, inLayout, jpegQuality, firstLine, numLines,
+                    s == 0 ? app1Buffer : nullptr, s == 0 ? app1Size : 0, &stripes[s])) {
+                failed = true;
+            }
+        }
+    });
+    if (failed) {
+        return -1;
+    }
+
+    /* Join the stripes: headers of the first stripe with the full image
+     * height, then the entropy coded data of each stripe without its EOI,
+     * separated by RST7 */
+    uint8_t* dst = static_cast<uint8_t*>(out);
+    size_t written = 0;
+    for (uint32_t s = 0; s < numStripes; s++) {
+        const std::vector<uint8_t>& stripe = stripes[s];
+        size_t sofOffset, scanOffset;
+        if (!findJpegScan(stripe, &sofOffset, &scanOffset) ||
+                stripe[stripe.size() - 2] != 0xFF || stripe[stripe.size() - 1] != JPEG_EOI) {
+            ALOGE("%s: unexpected layout of stripe %u", __FUNCTION__, s);
+            return -1;
+        }
+        const size_t begin = s == 0 ? 0 : scanOffset;
+        const size_t length = stripe.size() - 2 - begin;
+        if (written + length + 2 > maxOutSize) {
+            ALOGE("%s: JPEG does not fit in %zu bytes", __FUNCTION__, maxOutSize);
+            return -1;
+        }
+        memcpy(dst + written, stripe.data() + begin, length);
+        if (s == 0) {
+            /* SOF0: marker, length, precision, then the 16 bit height */
+            dst[sofOffset + 5] = inSz.height >> 8;
+            dst[sofOffset + 6] = inSz.height & 0xFF;
+        }
+        written += length;
+        dst[written++] = 0xFF;
+        dst[written++] = s + 1 < numStripes ? JPEG_RST0 + 7 : JPEG_EOI;
+    }
+
+    actualCodeSize = written;
+    return 0;
+}
+
+} // anonymous namespace
+
 int encodeJpegYU12(
         const Size & inSz, const YCbCrLayout& inLayout,
         int jpegQuality, const void *app1Buffer, size_t app1Size,
-        void *out, const size_t maxOutSize, size_t &actualCodeSize)
+        void *out, const size_t maxOutSize, size_t &actualCodeSize,
+        int maxThreads)
 {
+    if (maxThreads > 1 && inSz.height > kJpegStripeHeight &&
+            static_cast<size_t>(inSz.width) * inSz.height >= kParallelJpegMinPixels &&
+            JpegEncodePool::getInstance().numWorkers() > 0) {
+        return encodeJpegYU12Striped(inSz, inLayout, jpegQuality, app1Buffer, app1Size,
+                out, maxOutSize, actualCodeSize, maxThreads);
+    }
+
     /* libjpeg is a C library so we use C-style "inheritance" by
      * putting libjpeg's jpeg_destination_mgr first in our custom
      * struct. This allows us to cast jpeg_destination_mgr* to
@@ -547,12 +1057,14 @@ int encodeJpegYU12(
             ALOGE("%s: compressed %u lines, expected %u (total %u/%u)",
               __FUNCTION__, done, batchSize, cinfo.next_scanline,
               cinfo.image_height);
+            jpeg_destroy_compress(&cinfo);
             return -1;
         }
     }
 
     /* This will flush everything */
     jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
 
     /* Grab the actual code size and set it */
     actualCodeSize = dmgr.mEncodedSize;
@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the two ways the output thread can turn a 1080p MJPEG frame into a smaller stream
+// buffer: decoding at full size, scaling and then converting, against decoding at a reduced size
+// in the DCT domain and scaling and converting in one pass.
+//
+// Also measures encoding stills on one thread against encoding them in stripes on several, with
+// the size and quality of the resulting JPEG.
+
+#include <benchmark/benchmark.h>
+
+#include <jpeglib.h>
+#include <libyuv.h>
+#include <linux/videodev2.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "ExternalCameraUtils.h"
+
+namespace android {
+namespace hardware {
+namespace camera {
+namespace device {
+namespace V3_4 {
+namespace implementation {
+namespace {
+
+using ::benchmark::State;
+
+const Size kSensorSize = {1920, 1080};
+
+// Output streams the benchmarks produce, as indices into this table
+const Size kOutputSizes[] = {{1280, 720}, {640, 360}, {320, 180}};
+
+const uint32_t kFormats[] = {V4L2_PIX_FMT_NV21, V4L2_PIX_FMT_NV12, V4L2_PIX_FMT_YVU420};
+
+// A YU12 image with tightly packed planes
+struct Yu12Image {
+    std::vector<uint8_t> data;
+    YCbCrLayout layout;
+
+    explicit Yu12Image(Size sz) : data(sz.width * sz.height * 3 / 2) {
+        layout.y = data.data();
+        layout.cb = data.data() + sz.width * sz.height;
+        layout.cr = data.data() + sz.width * sz.height * 5 / 4;
+        layout.yStride = sz.width;
+        layout.cStride = sz.width / 2;
+        layout.chromaStep = 1;
+    }
+};
+
+// A stream buffer laid out the way gralloc lays out |format|
+struct OutputBuffer {
+    std::vector<uint8_t> data;
+    YCbCrLayout layout;
+
+    OutputBuffer(Size sz, uint32_t format) : data(sz.width * sz.height * 3 / 2) {
+        uint8_t* y = data.data();
+        uint8_t* c = y + sz.width * sz.height;
+        layout.y = y;
+        layout.yStride = sz.width;
+        switch (format) {
+            case V4L2_PIX_FMT_NV21:
+                layout.cr = c;
+                layout.cb = c + 1;
+                layout.cStride = sz.width;
+                layout.chromaStep = 2;
+                break;
+            case V4L2_PIX_FMT_NV12:
+                layout.cb = c;
+                layout.cr = c + 1;
+                layout.cStride = sz.width;
+                layout.chromaStep = 2;
+                break;
+            default:  // YV12
+                layout.cr = c;
+                layout.cb = c + sz.width * sz.height / 4;
+                layout.cStride = sz.width / 2;
+                layout.chromaStep = 1;
+                break;
+        }
+    }
+};
+
+// A 4:2:2 frame, the sampling most UVC cameras use for MJPEG
+std::vector<uint8_t> encodeTestFrame(Size sz) {
+    jpeg_compress_struct cinfo;
+    jpeg_error_mgr jerr;
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_compress(&cinfo);
+
+    unsigned char* buffer = nullptr;
+    unsigned long bufferSize = 0;
+    jpeg_mem_dest(&cinfo, &buffer, &bufferSize);
+    cinfo.image_width = sz.width;
+    cinfo.image_height = sz.height;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, 90, TRUE);
+    cinfo.comp_info[0].h_samp_factor = 2;
+    cinfo.comp_info[0].v_samp_factor = 1;
+
+    jpeg_start_compress(&cinfo, TRUE);
+    std::vector<uint8_t> row(sz.width * 3);
+    while (cinfo.next_scanline < cinfo.image_height) {
+        const uint32_t y = cinfo.next_scanline;
+        for (uint32_t x = 0; x < sz.width; x++) {
+            row[3 * x] = x * 255 / sz.width;
+            row[3 * x + 1] = y * 255 / sz.height;
+            row[3 * x + 2] = ((x / 16 + y / 16) & 1) ? 200 : 60;
+        }
+        JSAMPROW rowPointer = row.data();
+        jpeg_write_scanlines(&cinfo, &rowPointer, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+
+    std::vector<uint8_t> frame(buffer, buffer + bufferSize);
+    free(buffer);
+    return frame;
+}
+
+// Largest DCT scale whose output still covers |outSz|
+int pickDecodeScale(Size outSz) {
+    int best = 1;
+    for (int scale : kMjpegDecodeScales) {
+        if (kSensorSize.width / scale >= outSz.width &&
+            kSensorSize.height / scale >= outSz.height) {
+            best = scale;
+        }
+    }
+    return best;
+}
+
+// The path taken before scaled decoding: full size decode, scale to YU12, convert.
+void BM_FullDecodeScaleConvert(State& state) {
+    const Size outSz = kOutputSizes[state.range(0)];
+    const uint32_t format = kFormats[state.range(1)];
+    const std::vector<uint8_t> frame = encodeTestFrame(kSensorSize);
+    Yu12Image decoded(kSensorSize);
+    Yu12Image scaled(outSz);
+    OutputBuffer out(outSz, format);
+
+    for (auto _ : state) {
+        const YCbCrLayout& in = decoded.layout;
+        libyuv::MJPGToI420(frame.data(), frame.size(), static_cast<uint8_t*>(in.y), in.yStride,
+                           static_cast<uint8_t*>(in.cb), in.cStride, static_cast<uint8_t*>(in.cr),
+                           in.cStride, kSensorSize.width, kSensorSize.height, kSensorSize.width,
+                           kSensorSize.height);
+        const YCbCrLayout& mid = scaled.layout;
+        libyuv::I420Scale(static_cast<uint8_t*>(in.y), in.yStride, static_cast<uint8_t*>(in.cb),
+                          in.cStride, static_cast<uint8_t*>(in.cr), in.cStride, kSensorSize.width,
+                          kSensorSize.height, static_cast<uint8_t*>(mid.y), mid.yStride,
+                          static_cast<uint8_t*>(mid.cb), mid.cStride,
+                          static_cast<uint8_t*>(mid.cr), mid.cStride, outSz.width, outSz.height,
+                          libyuv::FilterMode::kFilterNone);
+        formatConvert(mid, out.layout, outSz, format);
+        benchmark::DoNotOptimize(out.data.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Decode at the largest DCT scale covering the stream, then scale and convert in one pass.
+void BM_ScaledDecodeFusedConvert(State& state) {
+    const Size outSz = kOutputSizes[state.range(0)];
+    const uint32_t format = kFormats[state.range(1)];
+    const std::vector<uint8_t> frame = encodeTestFrame(kSensorSize);
+    const int scale = pickDecodeScale(outSz);
+    const Size decodedSz = {kSensorSize.width / scale, kSensorSize.height / scale};
+    Yu12Image decoded(decodedSz);
+    OutputBuffer out(outSz, format);
+    std::vector<uint8_t> decodeScratch;
+    std::vector<uint8_t> convertScratch;
+
+    for (auto _ : state) {
+        if (scale == 1) {
+            // No DCT scale covers the stream; the output thread decodes at full size
+            const YCbCrLayout& in = decoded.layout;
+            libyuv::MJPGToI420(frame.data(), frame.size(), static_cast<uint8_t*>(in.y),
+                               in.yStride, static_cast<uint8_t*>(in.cb), in.cStride,
+                               static_cast<uint8_t*>(in.cr), in.cStride, kSensorSize.width,
+                               kSensorSize.height, kSensorSize.width, kSensorSize.height);
+        } else if (decodeMjpegScaledToYU12(frame.data(), frame.size(), scale, decodedSz,
+                                           decoded.layout, &decodeScratch) != 0) {
+            state.SkipWithError("scaled decode failed");
+            break;
+        }
+        scaleAndFormatConvert(decoded.layout, decodedSz, out.layout, outSz, format,
+                              &convertScratch);
+        benchmark::DoNotOptimize(out.data.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["scale"] = scale;
+}
+
+// Stills the encode benchmarks produce, as indices into this table
+const Size kStillSizes[] = {{1920, 1080}, {4000, 3000}};
+
+// A still with smooth gradients, hard edges and some noise
+Yu12Image makeStill(Size sz) {
+    Yu12Image still(sz);
+    const YCbCrLayout& l = still.layout;
+    for (uint32_t y = 0; y < sz.height; y++) {
+        uint8_t* row = static_cast<uint8_t*>(l.y) + y * l.yStride;
+        for (uint32_t x = 0; x < sz.width; x++) {
+            row[x] = x * 192 / sz.width + ((x / 53 + y / 37) & 1) * 48 + rand() % 8;
+        }
+    }
+    for (uint32_t y = 0; y < sz.height / 2; y++) {
+        uint8_t* cb = static_cast<uint8_t*>(l.cb) + y * l.cStride;
+        uint8_t* cr = static_cast<uint8_t*>(l.cr) + y * l.cStride;
+        for (uint32_t x = 0; x < sz.width / 2; x++) {
+            cb[x] = 96 + y * 64 / sz.height;
+            cr[x] = 96 + x * 64 / sz.width;
+        }
+    }
+    return still;
+}
+
+// Luma PSNR of a JPEG against the still it was encoded from
+double lumaPsnr(const uint8_t* jpeg, size_t size, const Yu12Image& still, Size sz) {
+    Yu12Image decoded(sz);
+    const YCbCrLayout& d = decoded.layout;
+    libyuv::MJPGToI420(jpeg, size, static_cast<uint8_t*>(d.y), d.yStride,
+                       static_cast<uint8_t*>(d.cb), d.cStride, static_cast<uint8_t*>(d.cr),
+                       d.cStride, sz.width, sz.height, sz.width, sz.height);
+    double squaredError = 0;
+    for (size_t i = 0; i < static_cast<size_t>(sz.width) * sz.height; i++) {
+        const double diff = decoded.data[i] - still.data[i];
+        squaredError += diff * diff;
+    }
+    const double mse = squaredError / (static_cast<double>(sz.width) * sz.height);
+    return mse == 0 ? 99 : 10 * std::log10(255.0 * 255.0 / mse);
+}
+
+// Encodes a still at quality 95 on up to range(1) threads
+void BM_EncodeJpegYU12(State& state) {
+    const Size sz = kStillSizes[state.range(0)];
+    const int maxThreads = state.range(1);
+    const Yu12Image still = makeStill(sz);
+    std::vector<uint8_t> jpeg(sz.width * sz.height * 2);
+    size_t jpegSize = 0;
+
+    for (auto _ : state) {
+        if (encodeJpegYU12(sz, still.layout, 95, nullptr, 0, jpeg.data(), jpeg.size(), jpegSize,
+                           maxThreads) != 0) {
+            state.SkipWithError("encode failed");
+            break;
+        }
+        benchmark::DoNotOptimize(jpeg.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["bytes"] = jpegSize;
+    state.counters["psnr"] = lumaPsnr(jpeg.data(), jpegSize, still, sz);
+}
+
+// Output size index, then output format index (NV21, NV12, YV12)
+void outputArgs(benchmark::internal::Benchmark* b) {
+    for (int size = 0; size < 3; size++) {
+        for (int format = 0; format < 3; format++) {
+            b->Args({size, format});
+        }
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_FullDecodeScaleConvert)->Apply(outputArgs);
+BENCHMARK(BM_ScaledDecodeFusedConvert)->Apply(outputArgs);
+// Still size index, then maximum number of encoding threads
+BENCHMARK(BM_EncodeJpegYU12)->ArgsProduct({{0, 1}, {1, kJpegEncodeMaxThreads}})->UseRealTime();
+
+}  // namespace implementation
+}  // namespace V3_4
+}  // namespace device
+}  // namespace camera
+}  // namespace hardware
+}  // namespace android
+
+BENCHMARK_MAIN();
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_CAMERA_DEVICE_V3_4_EXTCAMCAPCACHE_H
+#define ANDROID_HARDWARE_CAMERA_DEVICE_V3_4_EXTCAMCAPCACHE_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ExternalCameraUtils.h"
+
+namespace android {
+namespace hardware {
+namespace camera {
+namespace device {
+namespace V3_4 {
+namespace implementation {
+
+// Identifies a V4L2 capture device closely enough to tell whether formats probed from it before
+// still apply: driver, card and bus location from VIDIOC_QUERYCAP, plus the USB vendor id,
+// product id and firmware revision of UVC cameras.
+struct V4L2DeviceIdentity {
+    std::string driver;
+    std::string card;
+    std::string busInfo;
+    uint32_t driverVersion = 0;
+    uint32_t vendorId = 0;
+    uint32_t productId = 0;
+    uint32_t firmwareVersion = 0;
+
+    // Queries the identity of the device node devicePath, open at fd. Caller still owns fd
+    static bool query(int fd, const std::string& devicePath, V4L2DeviceIdentity* out);
+
+    // Printable form, also the cache key
+    std::string toString() const;
+};
+
+/*
+ * Caches the formats, frame sizes and frame intervals enumerated from external cameras, since a
+ * full V4L2 enumeration takes seconds on some UVC cameras and hubs. Probes are kept in memory for
+ * the life of the provider and on disk across provider restarts, one file per device identity.
+ *
+ * The cache holds the raw enumeration, before ExternalCameraConfig limits are applied, so config
+ * changes never invalidate it.
+ *
+ * A cached probe is used as soon as the device identity matches. The first time a process uses a
+ * probe, it enumerates the device again on a background thread and replaces the entry if the
+ * device now reports something else; the new formats are published the next time the camera is
+ * plugged in.
+ */
+class ExternalCameraCapabilityCache {
+public:
+    // Enumerates the device open at fd. Caller still owns fd
+    using ProbeFn = std::function<std::vector<SupportedV4L2Format>(int fd)>;
+
+    static const char* kDefaultCacheDir;
+
+    // Process-wide cache probing devices with ExternalCameraDevice::probeSupportedFormats
+    static ExternalCameraCapabilityCache& getInstance();
+
+    ExternalCameraCapabilityCache(const std::string& cacheDir, ProbeFn probe);
+    ~ExternalCameraCapabilityCache();
+
+    // Returns the formats of device devicePath, open at fd, probing it only if it was never seen
+    // before. Caller still owns fd
+    std::vector<SupportedV4L2Format> getFormats(int fd, const std::string& devicePath);
+
+    // Disk entries, without the in-memory layer
+    bool load(const V4L2DeviceIdentity& identity, std::vector<SupportedV4L2Format>* out) const;
+    bool store(const V4L2DeviceIdentity& identity,
+            const std::vector<SupportedV4L2Format>& formats) const;
+
+    // Blocks until all background refreshes have finished
+    void waitForRefreshes();
+
+private:
+    struct Entry {
+        std::vector<SupportedV4L2Format> formats;
+        // Whether this process has re-probed the device, or is doing so
+        bool refreshed = false;
+    };
+
+    std::string pathFor(const V4L2DeviceIdentity& identity) const;
+    void refresh(const V4L2DeviceIdentity& identity, const std::string& devicePath);
+
+    const std::string mCacheDir;
+    const ProbeFn mProbe;
+
+    std::mutex mLock;
+    std::unordered_map<std::string, Entry> mEntries;  // keyed by V4L2DeviceIdentity::toString
+    int mPendingRefreshes = 0;
+    std::condition_variable mRefreshDone;
+};
+
+}  // namespace implementation
+}  // namespace V3_4
+}  // namespace device
+}  // namespace camera
+}  // namespace hardware
+}  // namespace android
+
+#endif  // ANDROID_HARDWARE_CAMERA_DEVICE_V3_4_EXTCAMCAPCACHE_H
@@ -149,6 +149,16 @@ struct ExternalCameraDeviceSession : public virtual RefBase,
                 sp<AllocatedFrame>& in, const Size& outSize,
                 YCbCrLayout* out);
 
+        // Crop to output aspect ratio, scale and format convert into the output buffer
+        int cropScaleConvertLocked(
+                sp<AllocatedFrame>& in, const Size& outSize,
+                const YCbCrLayout& outLayout, uint32_t outputFourcc);
+
+        // Decode MJPEG input to mDecodedYu12Frame: the smallest of mDownscaledYu12Frames
+        // that is still large enough for all output buffers, or else mYu12Frame
+        int decodeMjpegLocked(const uint8_t* inData, size_t inDataSize,
+                const std::vector<HalStreamBuffer>& buffers);
+
         int cropAndScaleThumbLocked(
                 sp<AllocatedFrame>& in, const Size& outSize,
                 YCbCrLayout* out);
@@ -171,11 +181,16 @@ struct ExternalCameraDeviceSession : public virtual RefBase,
         uint32_t mProcessingFrameNumer = 0;
 
         // V4L2 frameIn
-        // (MJPG decode)-> mYu12Frame
-        // (Scale)-> mScaledYu12Frames
-        // (Format convert) -> output gralloc frames
+        // (MJPG decode, maybe downscaled)-> mDecodedYu12Frame
+        // (Crop, scale and format convert) -> output YUV gralloc frames
+        // (Scale)-> mScaledYu12Frames -> JPEG encode
         mutable std::mutex mBufferLock; // Protect access to intermediate buffers
         sp<AllocatedFrame> mYu12Frame;
+        // Frames for MJPEG decoded at 1/2, 1/4 or 1/8 size, keyed by scale
+        std::unordered_map<int, sp<AllocatedFrame>> mDownscaledYu12Frames;
+        sp<AllocatedFrame> mDecodedYu12Frame; // mYu12Frame or one of mDownscaledYu12Frames
+        std::vector<uint8_t> mDecodeScratch;
+        std::vector<uint8_t> mConvertScratch;
         sp<AllocatedFrame> mYu12ThumbFrame;
         std::unordered_map<Size, sp<AllocatedFrame>, SizeHasher> mIntermediateBuffers;
         std::unordered_map<Size, sp<AllocatedFrame>, SizeHasher> mScaledYu12Frames;
@@ -87,6 +87,10 @@ struct ExternalCameraDevice : public virtual RefBase {
     Return<void> dumpState(const ::android::hardware::hidl_handle&);
     /* End of Methods from ::android::hardware::camera::device::V3_2::ICameraDevice */
 
+    // Enumerates every discrete size and frame interval of the supported pixel formats of the
+    // device open at fd, before any config limits are applied. Caller still owns fd
+    static std::vector<SupportedV4L2Format> probeSupportedFormats(int fd);
+
 protected:
     // Overridden by child implementations for returning different versions of
     // ExternalCameraDeviceSession
@@ -127,16 +131,18 @@ protected:
 
     bool calculateMinFps(::android::hardware::camera::common::V1_0::helper::CameraMetadata*);
 
-    static void getFrameRateList(int fd, double fpsUpperBound, SupportedV4L2Format* format);
+    static void getFrameRateList(int fd, SupportedV4L2Format* format);
 
-    static void updateFpsBounds(int fd, CroppingType cropType,
+    // Drops the frame rates of format above the limit for its size, and adds it to outFmts if
+    // any are left
+    static void updateFpsBounds(CroppingType cropType,
             const std::vector<ExternalCameraConfig::FpsLimitation>& fpsLimits,
             SupportedV4L2Format format,
             std::vector<SupportedV4L2Format>& outFmts);
 
-    // Get candidate supported formats list of input cropping type.
+    // Get candidate supported formats list of input cropping type from the probed formats.
     static std::vector<SupportedV4L2Format> getCandidateSupportedFormatsLocked(
-            int fd, CroppingType cropType,
+            const std::vector<SupportedV4L2Format>& probedFmts, CroppingType cropType,
             const std::vector<ExternalCameraConfig::FpsLimitation>& fpsLimits,
             const std::vector<ExternalCameraConfig::FpsLimitation>& depthFpsLimits,
             const Size& minStreamSize,
@@ -242,11 +242,29 @@ int getCropRect(CroppingType ct, const Size& inSize,
 
 int formatConvert(const YCbCrLayout& in, const YCbCrLayout& out, Size sz, uint32_t format);
 
+// Scales a YU12 image of size inSz and converts it to the output format in one pass per output
+// plane; chroma is scaled into scratch before being interleaved for NV12/NV21 outputs.
+int scaleAndFormatConvert(const YCbCrLayout& in, Size inSz, const YCbCrLayout& out, Size outSz,
+        uint32_t format, std::vector<uint8_t>* scratch);
+
+// MJPEG frames can be downscaled by 1/2, 1/4 or 1/8 in the DCT domain while being decoded
+static const int kMjpegDecodeScales[] = {2, 4, 8};
+
+// Decodes an MJPEG frame to a YU12 image downscaled by 1/scale, which must be one of
+// kMjpegDecodeScales, of size outSz. Returns non-zero for malformed frames.
+int decodeMjpegScaledToYU12(const uint8_t* in, size_t inSize, int scale, Size outSz,
+        const YCbCrLayout& out, std::vector<uint8_t>* scratch);
+
+// Large images are split into stripes encoded on up to maxThreads threads, including the calling
+// one, and joined into one baseline JPEG with a restart marker after every MCU row. Smaller
+// images, and all images when maxThreads is 1, are encoded on the calling thread only.
+static const int kJpegEncodeMaxThreads = 4;
+
 int encodeJpegYU12(const Size &inSz,
         const YCbCrLayout& inLayout, int jpegQuality,
         const void *app1Buffer, size_t app1Size,
         void *out, size_t maxOutSize,
-        size_t &actualCodeSize);
+        size_t &actualCodeSize, int maxThreads = kJpegEncodeMaxThreads);
 
 Size getMaxThumbnailResolution(const common::V1_0::helper::CameraMetadata&);
 
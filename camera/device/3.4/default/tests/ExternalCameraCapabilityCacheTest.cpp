@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/file.h>
+#include <android-base/unique_fd.h>
+#include <gtest/gtest.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <linux/videodev2.h>
+
+#include <atomic>
+#include <thread>
+
+#include "ExternalCameraCapabilityCache.h"
+
+using ::android::base::unique_fd;
+using ::android::hardware::camera::device::V3_4::implementation::ExternalCameraCapabilityCache;
+using ::android::hardware::camera::device::V3_4::implementation::SupportedV4L2Format;
+using ::android::hardware::camera::device::V3_4::implementation::V4L2DeviceIdentity;
+
+namespace {
+
+V4L2DeviceIdentity uvcIdentity() {
+    V4L2DeviceIdentity identity;
+    identity.driver = "uvcvideo";
+    identity.card = "USB Camera";
+    identity.busInfo = "usb-xhci-hcd.0.auto-1.2";
+    identity.driverVersion = 0x050f00;
+    identity.vendorId = 0x046d;
+    identity.productId = 0x0825;
+    identity.firmwareVersion = 0x0012;
+    return identity;
+}
+
+std::vector<SupportedV4L2Format> mjpegFormats() {
+    return {
+        {640, 480, V4L2_PIX_FMT_MJPEG, {{1, 30}, {1, 15}}},
+        {1280, 720, V4L2_PIX_FMT_MJPEG, {{1, 30}}},
+        {1920, 1080, V4L2_PIX_FMT_MJPEG, {{1, 30}, {1, 24}, {1001, 30000}}},
+    };
+}
+
+void expectSameFormats(const std::vector<SupportedV4L2Format>& expected,
+                       const std::vector<SupportedV4L2Format>& actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        EXPECT_EQ(expected[i].fourcc, actual[i].fourcc);
+        EXPECT_EQ(expected[i].width, actual[i].width);
+        EXPECT_EQ(expected[i].height, actual[i].height);
+        ASSERT_EQ(expected[i].frameRates.size(), actual[i].frameRates.size());
+        for (size_t j = 0; j < expected[i].frameRates.size(); j++) {
+            EXPECT_EQ(expected[i].frameRates[j].durationNumerator,
+                      actual[i].frameRates[j].durationNumerator);
+            EXPECT_EQ(expected[i].frameRates[j].durationDenominator,
+                      actual[i].frameRates[j].durationDenominator);
+        }
+    }
+}
+
+ExternalCameraCapabilityCache::ProbeFn unusedProbe() {
+    return [](int) {
+        ADD_FAILURE() << "unexpected probe";
+        return std::vector<SupportedV4L2Format>();
+    };
+}
+
+// The only cache file in dir, or an empty string
+std::string cacheFile(const std::string& dir) {
+    std::string path;
+    DIR* d = opendir(dir.c_str());
+    while (dirent* entry = readdir(d)) {
+        if (entry->d_name[0] != '.') path = dir + "/" + entry->d_name;
+    }
+    closedir(d);
+    return path;
+}
+
+// Enumerates every discrete size and interval of every format. vivid offers none of the formats
+// the HAL supports, so its latency is measured with this instead of the HAL's own probe, which
+// does the same ioctls for fewer formats.
+std::vector<SupportedV4L2Format> probeAllFormats(int fd) {
+    std::vector<SupportedV4L2Format> formats;
+    v4l2_fmtdesc fmtdesc{};
+    fmtdesc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    for (; ioctl(fd, VIDIOC_ENUM_FMT, &fmtdesc) == 0; fmtdesc.index++) {
+        v4l2_frmsizeenum frameSize{};
+        frameSize.pixel_format = fmtdesc.pixelformat;
+        for (; ioctl(fd, VIDIOC_ENUM_FRAMESIZES, &frameSize) == 0; frameSize.index++) {
+            if (frameSize.type != V4L2_FRMSIZE_TYPE_DISCRETE) break;
+            SupportedV4L2Format format{frameSize.discrete.width, frameSize.discrete.height,
+                                       fmtdesc.pixelformat, {}};
+            v4l2_frmivalenum interval{};
+            interval.pixel_format = format.fourcc;
+            interval.width = format.width;
+            interval.height = format.height;
+            for (; ioctl(fd, VIDIOC_ENUM_FRAMEINTERVALS, &interval) == 0; interval.index++) {
+                if (interval.type == V4L2_FRMIVAL_TYPE_DISCRETE) {
+                    format.frameRates.push_back(
+                            {interval.discrete.numerator, interval.discrete.denominator});
+                }
+            }
+            if (!format.frameRates.empty()) formats.push_back(format);
+        }
+    }
+    return formats;
+}
+
+// The first capture node of the vivid test driver, or an empty string
+std::string findVividDevice() {
+    for (int i = 0; i < 64; i++) {
+        const std::string path = "/dev/video" + std::to_string(i);
+        unique_fd fd(open(path.c_str(), O_RDWR));
+        v4l2_capability capability{};
+        if (fd.get() >= 0 && ioctl(fd.get(), VIDIOC_QUERYCAP, &capability) == 0 &&
+            std::string(reinterpret_cast<char*>(capability.driver)) == "vivid" &&
+            (capability.device_caps & V4L2_CAP_VIDEO_CAPTURE)) {
+            return path;
+        }
+    }
+    return "";
+}
+
+}  // namespace
+
+TEST(ExternalCameraCapabilityCacheTest, StoreThenLoad) {
+    TemporaryDir dir;
+    ExternalCameraCapabilityCache cache(dir.path, unusedProbe());
+    ASSERT_TRUE(cache.store(uvcIdentity(), mjpegFormats()));
+
+    std::vector<SupportedV4L2Format> loaded;
+    ASSERT_TRUE(cache.load(uvcIdentity(), &loaded));
+    expectSameFormats(mjpegFormats(), loaded);
+}
+
+TEST(ExternalCameraCapabilityCacheTest, OtherFirmwareMisses) {
+    TemporaryDir dir;
+    ExternalCameraCapabilityCache cache(dir.path, unusedProbe());
+    ASSERT_TRUE(cache.store(uvcIdentity(), mjpegFormats()));
+
+    V4L2DeviceIdentity updated = uvcIdentity();
+    updated.firmwareVersion++;
+    std::vector<SupportedV4L2Format> loaded;
+    EXPECT_FALSE(cache.load(updated, &loaded));
+
+    V4L2DeviceIdentity moved = uvcIdentity();
+    moved.busInfo = "usb-xhci-hcd.0.auto-1.3";
+    EXPECT_FALSE(cache.load(moved, &loaded));
+}
+
+TEST(ExternalCameraCapabilityCacheTest, CorruptFileIsIgnored) {
+    TemporaryDir dir;
+    ExternalCameraCapabilityCache cache(dir.path, unusedProbe());
+    ASSERT_TRUE(cache.store(uvcIdentity(), mjpegFormats()));
+    const std::string path = cacheFile(dir.path);
+    ASSERT_FALSE(path.empty());
+
+    std::string contents;
+    ASSERT_TRUE(android::base::ReadFileToString(path, &contents));
+    std::vector<SupportedV4L2Format> loaded;
+
+    // Truncated
+    ASSERT_TRUE(android::base::WriteStringToFile(contents.substr(0, contents.size() / 2), path));
+    EXPECT_FALSE(cache.load(uvcIdentity(), &loaded));
+
+    // Flipped bit in a frame rate
+    contents[contents.size() - 12] ^= 1;
+    ASSERT_TRUE(android::base::WriteStringToFile(contents, path));
+    EXPECT_FALSE(cache.load(uvcIdentity(), &loaded));
+}
+
+// Plugging vivid in with a cold cache, then again after a provider restart (warm disk cache) and
+// within the same provider (warm memory cache). Only the cold lookup may probe the device on the
+// calling thread.
+TEST(ExternalCameraCapabilityCacheTest, VividStartupProbes) {
+    const std::string devicePath = findVividDevice();
+    if (devicePath.empty()) {
+        GTEST_SKIP() << "vivid is not loaded";
+    }
+    unique_fd fd(open(devicePath.c_str(), O_RDWR));
+    ASSERT_GE(fd.get(), 0);
+
+    TemporaryDir dir;
+    const std::thread::id caller = std::this_thread::get_id();
+    std::atomic<int> probes = 0;
+    std::atomic<int> callerProbes = 0;
+    auto probe = [&](int probeFd) {
+        probes++;
+        if (std::this_thread::get_id() == caller) callerProbes++;
+        return probeAllFormats(probeFd);
+    };
+
+    std::vector<SupportedV4L2Format> cold;
+    {
+        ExternalCameraCapabilityCache cache(dir.path, probe);
+        cold = cache.getFormats(fd.get(), devicePath);
+    }
+    ASSERT_FALSE(cold.empty());
+    EXPECT_EQ(1, probes);
+    EXPECT_EQ(1, callerProbes);
+
+    ExternalCameraCapabilityCache restarted(dir.path, probe);
+    std::vector<SupportedV4L2Format> fromDisk = restarted.getFormats(fd.get(), devicePath);
+    expectSameFormats(cold, fromDisk);
+    EXPECT_EQ(1, callerProbes);
+
+    // The device is re-probed once in the background, and is unchanged
+    restarted.waitForRefreshes();
+    EXPECT_EQ(2, probes);
+
+    std::vector<SupportedV4L2Format> fromMemory = restarted.getFormats(fd.get(), devicePath);
+    expectSameFormats(cold, fromMemory);
+    restarted.waitForRefreshes();
+    EXPECT_EQ(2, probes);
+    EXPECT_EQ(1, callerProbes);
+}
@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <jpeglib.h>
+
+#include <thread>
+#include <vector>
+
+#include "ExternalCameraUtils.h"
+
+using ::android::hardware::camera::device::V3_4::implementation::decodeMjpegScaledToYU12;
+using ::android::hardware::camera::device::V3_4::implementation::encodeJpegYU12;
+using ::android::hardware::camera::device::V3_4::implementation::kMjpegDecodeScales;
+using ::android::hardware::camera::external::common::Size;
+
+namespace {
+
+// A YU12 image with padded strides, filled with gradients and noise so that every MCU has
+// non-trivial content.
+struct YU12Image {
+    explicit YU12Image(Size sz, uint32_t padding = 24)
+        : size(sz), yStride(sz.width + padding), cStride((sz.width + 1) / 2 + padding / 2),
+          cHeight((sz.height + 1) / 2), y(yStride * sz.height), cb(cStride * cHeight),
+          cr(cStride * cHeight) {
+        srand(sz.width * 31 + sz.height);
+        for (uint32_t r = 0; r < sz.height; r++) {
+            for (uint32_t c = 0; c < sz.width; c++) {
+                y[r * yStride + c] = (c * 200 / sz.width + ((r / 37 + c / 53) & 1) * 40 +
+                        rand() % 8) & 0xff;
+            }
+        }
+        for (uint32_t r = 0; r < cHeight; r++) {
+            for (uint32_t c = 0; c < cStride; c++) {
+                cb[r * cStride + c] = 128 + r % 50 - 25;
+                cr[r * cStride + c] = 100 + c % 70;
+            }
+        }
+    }
+
+    YCbCrLayout layout() {
+        YCbCrLayout layout;
+        layout.y = y.data();
+        layout.cb = cb.data();
+        layout.cr = cr.data();
+        layout.yStride = yStride;
+        layout.cStride = cStride;
+        layout.chromaStep = 1;
+        return layout;
+    }
+
+    const Size size;
+    const uint32_t yStride;
+    const uint32_t cStride;
+    const uint32_t cHeight;
+    std::vector<uint8_t> y;
+    std::vector<uint8_t> cb;
+    std::vector<uint8_t> cr;
+};
+
+std::vector<uint8_t> encode(YU12Image& image, int maxThreads) {
+    std::vector<uint8_t> jpeg(image.size.width * image.size.height * 2);
+    size_t jpegSize = 0;
+    EXPECT_EQ(0, encodeJpegYU12(image.size, image.layout(), 95, nullptr, 0, jpeg.data(),
+            jpeg.size(), jpegSize, maxThreads));
+    jpeg.resize(jpegSize);
+    return jpeg;
+}
+
+// Decodes a JPEG to interleaved YCbCr with the reference libjpeg decoder, failing on any
+// warning, e.g. a missing or out of sequence restart marker.
+std::vector<uint8_t> decode(const std::vector<uint8_t>& jpeg, Size* sz) {
+    jpeg_decompress_struct dinfo = {};
+    jpeg_error_mgr jerr;
+    dinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_decompress(&dinfo);
+    jpeg_mem_src(&dinfo, const_cast<uint8_t*>(jpeg.data()), jpeg.size());
+    jpeg_read_header(&dinfo, TRUE);
+    dinfo.out_color_space = JCS_YCbCr;
+    dinfo.dct_method = JDCT_ISLOW;
+    jpeg_start_decompress(&dinfo);
+    sz->width = dinfo.output_width;
+    sz->height = dinfo.output_height;
+    std::vector<uint8_t> pixels(static_cast<size_t>(sz->width) * sz->height * 3);
+    while (dinfo.output_scanline < dinfo.output_height) {
+        JSAMPROW row = &pixels[static_cast<size_t>(dinfo.output_scanline) * sz->width * 3];
+        jpeg_read_scanlines(&dinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&dinfo);
+    EXPECT_EQ(0, jerr.num_warnings);
+    jpeg_destroy_decompress(&dinfo);
+    return pixels;
+}
+
+// Checks the restart markers of a JPEG and returns its restart interval, 0 if it has no DRI
+// segment. Striped JPEGs restart after every MCU row: DRI holds the number of MCUs of a row,
+// and the entropy coded data contains one RST marker per row boundary, numbered in sequence.
+void expectValidRestarts(const std::vector<uint8_t>& jpeg, Size sz, uint32_t* restartInterval) {
+    const uint32_t mcusPerRow = (sz.width + 15) / 16;
+    const uint32_t mcuRows = (sz.height + 15) / 16;
+
+    ASSERT_GE(jpeg.size(), 4u);
+    ASSERT_EQ(0xFF, jpeg[0]);
+    ASSERT_EQ(0xD8, jpeg[1]);  // SOI
+    size_t i = 2;
+    *restartInterval = 0;
+    for (;;) {
+        ASSERT_LE(i + 4, jpeg.size());
+        ASSERT_EQ(0xFF, jpeg[i]);
+        const uint8_t marker = jpeg[i + 1];
+        const size_t length = (jpeg[i + 2] << 8) | jpeg[i + 3];
+        if (marker == 0xDD) {  // DRI
+            ASSERT_EQ(4u, length);
+            *restartInterval = (jpeg[i + 4] << 8) | jpeg[i + 5];
+        }
+        i += 2 + length;
+        if (marker == 0xDA) {  // SOS
+            break;
+        }
+    }
+    if (*restartInterval != 0) {
+        EXPECT_EQ(mcusPerRow, *restartInterval);
+    }
+
+    uint32_t restarts = 0;
+    for (; i + 1 < jpeg.size(); i++) {
+        if (jpeg[i] != 0xFF || jpeg[i + 1] == 0x00) {
+            continue;
+        }
+        const uint8_t marker = jpeg[i + 1];
+        if (marker == JPEG_EOI) {
+            break;
+        }
+        ASSERT_GE(marker, JPEG_RST0) << "unexpected marker at " << i;
+        ASSERT_LE(marker, JPEG_RST0 + 7) << "unexpected marker at " << i;
+        EXPECT_EQ(JPEG_RST0 + restarts % 8, marker) << "restart " << restarts;
+        restarts++;
+        i++;
+    }
+    EXPECT_EQ(jpeg.size() - 2, i) << "data after EOI";
+    EXPECT_EQ(*restartInterval != 0 ? mcuRows - 1 : 0, restarts);
+}
+
+// Mean absolute difference between the luma of a decoded image and the source.
+double meanLumaError(const std::vector<uint8_t>& decoded, const YU12Image& image) {
+    double total = 0;
+    for (uint32_t r = 0; r < image.size.height; r++) {
+        for (uint32_t c = 0; c < image.size.width; c++) {
+            total += abs(decoded[(static_cast<size_t>(r) * image.size.width + c) * 3] -
+                    image.y[r * image.yStride + c]);
+        }
+    }
+    return total / (static_cast<double>(image.size.width) * image.size.height);
+}
+
+// Encodes a YU12 image the way a UVC camera sends MJPEG frames, with 4:2:2 chroma when
+// vSampFactor is 1 and 4:2:0 chroma when it is 2.
+std::vector<uint8_t> encodeMjpeg(const YU12Image& image, int vSampFactor) {
+    const Size sz = image.size;
+    std::vector<uint8_t> ycbcr(static_cast<size_t>(sz.width) * sz.height * 3);
+    for (uint32_t r = 0; r < sz.height; r++) {
+        for (uint32_t c = 0; c < sz.width; c++) {
+            uint8_t* px = &ycbcr[(static_cast<size_t>(r) * sz.width + c) * 3];
+            px[0] = image.y[r * image.yStride + c];
+            px[1] = image.cb[r / 2 * image.cStride + c / 2];
+            px[2] = image.cr[r / 2 * image.cStride + c / 2];
+        }
+    }
+
+    jpeg_compress_struct cinfo = {};
+    jpeg_error_mgr jerr;
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_compress(&cinfo);
+    unsigned char* buffer = nullptr;
+    unsigned long bufferSize = 0;
+    jpeg_mem_dest(&cinfo, &buffer, &bufferSize);
+    cinfo.image_width = sz.width;
+    cinfo.image_height = sz.height;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_YCbCr;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, 90, TRUE);
+    cinfo.comp_info[0].h_samp_factor = 2;
+    cinfo.comp_info[0].v_samp_factor = vSampFactor;
+    jpeg_start_compress(&cinfo, TRUE);
+    while (cinfo.next_scanline < cinfo.image_height) {
+        JSAMPROW row = &ycbcr[static_cast<size_t>(cinfo.next_scanline) * sz.width * 3];
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    std::vector<uint8_t> jpeg(buffer, buffer + bufferSize);
+    free(buffer);
+    return jpeg;
+}
+
+// Mean absolute difference between a plane of a scaled decode and the box filtered plane of
+// the same index in an interleaved full size decode, each output sample covering
+// factor x factor input pixels.
+double meanPlaneError(const std::vector<uint8_t>& full, Size fullSz, int plane, int factor,
+        const uint8_t* out, uint32_t outStride, uint32_t outWidth, uint32_t outHeight) {
+    double total = 0;
+    for (uint32_t r = 0; r < outHeight; r++) {
+        for (uint32_t c = 0; c < outWidth; c++) {
+            int sum = 0;
+            for (int dr = 0; dr < factor; dr++) {
+                for (int dc = 0; dc < factor; dc++) {
+                    sum += full[((static_cast<size_t>(r) * factor + dr) * fullSz.width +
+                            c * factor + dc) * 3 + plane];
+                }
+            }
+            total += abs(sum / (factor * factor) - out[r * outStride + c]);
+        }
+    }
+    return total / (static_cast<double>(outWidth) * outHeight);
+}
+
+// Decodes a frame at every DCT scale giving an even output size, and checks that each plane
+// agrees with a full size decode downscaled by a box filter.
+void expectScaledDecodeMatchesFullDecode(const std::vector<uint8_t>& jpeg, Size sz,
+        uint32_t padding) {
+    Size fullSz;
+    const std::vector<uint8_t> full = decode(jpeg, &fullSz);
+    ASSERT_EQ(sz, fullSz);
+
+    std::vector<uint8_t> scratch;
+    for (int scale : kMjpegDecodeScales) {
+        const Size outSz = {sz.width / scale, sz.height / scale};
+        if (sz.width % scale != 0 || sz.height % scale != 0 || outSz.width % 2 != 0 ||
+                outSz.height % 2 != 0) {
+            continue;
+        }
+        SCOPED_TRACE(testing::Message() << "scale 1/" << scale);
+        YU12Image out(outSz, padding);
+        ASSERT_EQ(0, decodeMjpegScaledToYU12(jpeg.data(), jpeg.size(), scale, outSz,
+                out.layout(), &scratch));
+        EXPECT_LT(meanPlaneError(full, sz, 0, scale, out.y.data(), out.yStride, outSz.width,
+                outSz.height), 2.0);
+        EXPECT_LT(meanPlaneError(full, sz, 1, 2 * scale, out.cb.data(), out.cStride,
+                outSz.width / 2, outSz.height / 2), 2.0);
+        EXPECT_LT(meanPlaneError(full, sz, 2, 2 * scale, out.cr.data(), out.cStride,
+                outSz.width / 2, outSz.height / 2), 2.0);
+    }
+}
+
+class ExternalCameraJpegTest : public ::testing::TestWithParam<Size> {};
+
+// The multi threaded encode must produce the same image as the single threaded one, including
+// heights which aren't a multiple of the MCU or stripe height, and widths which aren't even.
+TEST_P(ExternalCameraJpegTest, StripedEncodeMatchesSingleThreaded) {
+    YU12Image image(GetParam());
+    std::vector<uint8_t> serial = encode(image, 1);
+    std::vector<uint8_t> striped = encode(image, 4);
+    ASSERT_FALSE(serial.empty());
+    ASSERT_FALSE(striped.empty());
+    uint32_t serialInterval, stripedInterval;
+    expectValidRestarts(serial, image.size, &serialInterval);
+    expectValidRestarts(striped, image.size, &stripedInterval);
+    EXPECT_EQ(0u, serialInterval);
+    if (image.size.width * image.size.height >= 2000000 &&
+            std::thread::hardware_concurrency() > 1) {
+        EXPECT_NE(0u, stripedInterval) << "large image was not encoded in stripes";
+    }
+
+    Size serialSize, stripedSize;
+    std::vector<uint8_t> serialPixels = decode(serial, &serialSize);
+    std::vector<uint8_t> stripedPixels = decode(striped, &stripedSize);
+    ASSERT_EQ(image.size, serialSize);
+    ASSERT_EQ(image.size, stripedSize);
+    EXPECT_LT(meanLumaError(serialPixels, image), 4.0);
+    EXPECT_TRUE(serialPixels == stripedPixels);
+}
+
+INSTANTIATE_TEST_SUITE_P(Sizes, ExternalCameraJpegTest,
+        ::testing::Values(Size{33, 17}, Size{640, 482}, Size{1921, 1083}, Size{2000, 1000},
+                Size{1601, 1601}));
+
+// MJPEG frames from cameras with 4:2:2 or 4:2:0 chroma, with heights that aren't a multiple of
+// the MCU height, decoded at reduced size.
+TEST(ExternalCameraMjpegTest, ScaledDecodeMatchesFullDecode) {
+    for (Size sz : {Size{640, 480}, Size{1280, 720}, Size{1920, 1080}}) {
+        for (int vSampFactor : {1, 2}) {
+            SCOPED_TRACE(testing::Message() << sz.width << "x" << sz.height << " v_samp_factor "
+                    << vSampFactor);
+            YU12Image image(sz);
+            expectScaledDecodeMatchesFullDecode(encodeMjpeg(image, vSampFactor), sz, 24);
+        }
+    }
+}
+
+// A width that isn't a multiple of the scaled block width and no stride padding, so luma rows
+// don't fit in the output and are decoded into scratch first.
+TEST(ExternalCameraMjpegTest, ScaledDecodeIntoUnpaddedBuffer) {
+    const Size sz = {1300, 740};
+    YU12Image image(sz);
+    expectScaledDecodeMatchesFullDecode(encodeMjpeg(image, 1), sz, 0);
+}
+
+TEST(ExternalCameraMjpegTest, ScaledDecodeRejectsBadFrames) {
+    const Size sz = {640, 480};
+    YU12Image image(sz);
+    std::vector<uint8_t> jpeg = encodeMjpeg(image, 1);
+    YU12Image out({320, 240});
+    std::vector<uint8_t> scratch;
+    ASSERT_EQ(0, decodeMjpegScaledToYU12(jpeg.data(), jpeg.size(), 2, {320, 240}, out.layout(),
+            &scratch));
+
+    // Output size that doesn't match the scale, or isn't even
+    EXPECT_NE(0, decodeMjpegScaledToYU12(jpeg.data(), jpeg.size(), 4, {320, 240}, out.layout(),
+            &scratch));
+    EXPECT_NE(0, decodeMjpegScaledToYU12(jpeg.data(), jpeg.size(), 2, {319, 240}, out.layout(),
+            &scratch));
+    // Not a JPEG, and a JPEG cut short before the headers end
+    std::vector<uint8_t> garbage(1024, 0x5a);
+    EXPECT_NE(0, decodeMjpegScaledToYU12(garbage.data(), garbage.size(), 2, {320, 240},
+            out.layout(), &scratch));
+    EXPECT_NE(0, decodeMjpegScaledToYU12(jpeg.data(), 100, 2, {320, 240}, out.layout(),
+            &scratch));
+}
+
+}  // namespace
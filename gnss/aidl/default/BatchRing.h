@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+namespace aidl::android::hardware::gnss {
+
+/*
+ * Fixed-capacity FIFO that overwrites its oldest entry when full.
+ *
+ * Entries live in a single vector. drain() hands that vector to the caller by
+ * swapping it with the caller's (empty) vector, so draining never copies
+ * entries and, once both vectors have reached the capacity, never allocates.
+ * The ring is not synchronized; callers hold their own lock around push() and
+ * drain() and can deliver the drained vector after releasing it.
+ */
+template <typename T>
+class BatchRing {
+  public:
+    explicit BatchRing(size_t capacity) : mCapacity(capacity) { mSlots.reserve(capacity); }
+
+    size_t capacity() const { return mCapacity; }
+    size_t size() const { return mSlots.size(); }
+    bool full() const { return mSlots.size() == mCapacity; }
+
+    // Adds |value|, overwriting the oldest entry if the ring is full. Returns
+    // true if an entry was overwritten.
+    bool push(T value) {
+        if (mSlots.size() < mCapacity) {
+            mSlots.push_back(std::move(value));
+            return false;
+        }
+        mSlots[mHead] = std::move(value);
+        mHead = (mHead + 1) % mCapacity;
+        return true;
+    }
+
+    // Moves all entries, oldest first, into |out|. The previous contents of
+    // |out| are discarded and its storage is recycled for the ring.
+    void drain(std::vector<T>& out) {
+        out.clear();
+        out.swap(mSlots);
+        std::rotate(out.begin(), out.begin() + mHead, out.end());
+        mHead = 0;
+        mSlots.reserve(mCapacity);
+    }
+
+  private:
+    const size_t mCapacity;
+    // Oldest entry once the ring has wrapped; 0 until then.
+    size_t mHead = 0;
+    std::vector<T> mSlots;
+};
+
+}  // namespace aidl::android::hardware::gnss
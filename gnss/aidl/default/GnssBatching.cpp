@@ -32,9 +32,12 @@ constexpr int BATCH_SIZE = 10;
 std::shared_ptr<IGnssBatchingCallback> GnssBatching::sCallback = nullptr;
 
 GnssBatching::GnssBatching()
-    : mMinIntervalMs(1000),
+    : mIsActive(false),
+      mPeriodNanos(1e9),
       mWakeUpOnFifoFull(false),
-      mBatchedLocations(std::vector<GnssLocation>()) {}
+      mBatchedLocations(BATCH_SIZE) {
+    mFlushBuffer.reserve(BATCH_SIZE);
+}
 GnssBatching::~GnssBatching() {
     cleanup();
 }
@@ -60,18 +63,24 @@ ndk::ScopedAStatus GnssBatching::start(const Options& options) {
         stop();
     }
 
-    // mMinIntervalMs is not smaller than 1 sec
-    long periodNanos = (options.periodNanos < 1e9) ? 1e9 : options.periodNanos;
-    mMinIntervalMs = periodNanos / 1e6;
+    // mPeriodNanos is not smaller than 1 sec
+    mPeriodNanos = (options.periodNanos < 1e9) ? 1e9 : options.periodNanos;
     mWakeUpOnFifoFull = (options.flags & IGnssBatching::WAKEUP_ON_FIFO_FULL) ? true : false;
     mMinDistanceMeters = options.minDistanceMeters;
 
     mIsActive = true;
     mThread = std::thread([this]() {
-        while (mIsActive == true) {
+        // Fixes are produced on absolute deadlines so that the time spent producing and
+        // delivering them does not accumulate into the period.
+        auto nextFix = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(mBatchMutex);
+        while (mIsActive) {
+            lock.unlock();
             const auto location = common::Utils::getMockLocation();
             this->batchLocation(location);
-            std::this_thread::sleep_for(std::chrono::milliseconds(mMinIntervalMs));
+            lock.lock();
+            nextFix += std::chrono::nanoseconds(mPeriodNanos.load());
+            mBatchCv.wait_until(lock, nextFix, [this]() { return !mIsActive; });
         }
     });
 
@@ -80,23 +89,17 @@ ndk::ScopedAStatus GnssBatching::start(const Options& options) {
 
 ndk::ScopedAStatus GnssBatching::flush() {
     ALOGD("flush");
-    std::vector<GnssLocation> copy = std::vector<GnssLocation>(mBatchedLocations);
-    ndk::ScopedAStatus status;
-    if (sCallback != nullptr) {
-        sCallback->gnssLocationBatchCb(copy);
-        status = ndk::ScopedAStatus::ok();
-    } else {
-        ALOGE("GnssBatchingCallback is null. flush() failed.");
-        status = ndk::ScopedAStatus::fromServiceSpecificError(IGnss::ERROR_GENERIC);
-    }
-    mBatchedLocations.clear();
-    return status;
+    return deliverBatch();
 }
 
 ndk::ScopedAStatus GnssBatching::stop() {
     ALOGD("stop");
     // Do not call flush() at stop()
-    mIsActive = false;
+    {
+        std::lock_guard<std::mutex> lock(mBatchMutex);
+        mIsActive = false;
+    }
+    mBatchCv.notify_all();
     if (mThread.joinable()) {
         mThread.join();
     }
@@ -116,13 +119,31 @@ ndk::ScopedAStatus GnssBatching::cleanup() {
 }
 
 void GnssBatching::batchLocation(const GnssLocation& location) {
-    if (mBatchedLocations.size() > BATCH_SIZE) {
-        mBatchedLocations.erase(mBatchedLocations.begin());
+    bool fifoFull;
+    {
+        std::lock_guard<std::mutex> lock(mBatchMutex);
+        // The oldest location is dropped once the FIFO is full
+        mBatchedLocations.push(location);
+        fifoFull = mBatchedLocations.full();
+    }
+    if (mWakeUpOnFifoFull && fifoFull) {
+        deliverBatch();
     }
-    mBatchedLocations.push_back(location);
-    if (mWakeUpOnFifoFull && mBatchedLocations.size() == BATCH_SIZE) {
-        flush();
+}
+
+ndk::ScopedAStatus GnssBatching::deliverBatch() {
+    std::lock_guard<std::mutex> flushLock(mFlushMutex);
+    {
+        // Only swaps storage; the producer is never blocked by the callback
+        std::lock_guard<std::mutex> lock(mBatchMutex);
+        mBatchedLocations.drain(mFlushBuffer);
     }
+    if (sCallback == nullptr) {
+        ALOGE("GnssBatchingCallback is null. flush() failed.");
+        return ndk::ScopedAStatus::fromServiceSpecificError(IGnss::ERROR_GENERIC);
+    }
+    sCallback->gnssLocationBatchCb(mFlushBuffer);
+    return ndk::ScopedAStatus::ok();
 }
 
 }  // namespace aidl::android::hardware::gnss
@@ -18,7 +18,9 @@
 
 #include <aidl/android/hardware/gnss/BnGnssBatching.h>
 #include <atomic>
+#include <condition_variable>
 #include <thread>
+#include "BatchRing.h"
 
 namespace aidl::android::hardware::gnss {
 
@@ -35,20 +37,28 @@ struct GnssBatching : public BnGnssBatching {
 
   private:
     void batchLocation(const GnssLocation&);
+    ndk::ScopedAStatus deliverBatch();
 
     // Guarded by mMutex
     static std::shared_ptr<IGnssBatchingCallback> sCallback;
 
     std::thread mThread;
     std::atomic<bool> mIsActive;
-    std::atomic<long> mMinIntervalMs;
+    std::atomic<int64_t> mPeriodNanos;
     std::atomic<float> mMinDistanceMeters;
     std::atomic<bool> mWakeUpOnFifoFull;
 
     // Synchronization lock for sCallback
     mutable std::mutex mMutex;
 
-    std::vector<GnssLocation> mBatchedLocations;
+    // Guards mBatchedLocations and wakes the producer thread on stop()
+    std::mutex mBatchMutex;
+    std::condition_variable mBatchCv;
+    BatchRing<GnssLocation> mBatchedLocations;
+    // Storage swapped with mBatchedLocations on flush; only used by
+    // deliverBatch(), which is serialized by mFlushMutex
+    std::mutex mFlushMutex;
+    std::vector<GnssLocation> mFlushBuffer;
 };
 
 }  // namespace aidl::android::hardware::gnss
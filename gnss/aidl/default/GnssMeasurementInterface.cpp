@@ -20,7 +20,6 @@
 #include <aidl/android/hardware/gnss/BnGnss.h>
 #include <log/log.h>
 #include "DeviceFileReader.h"
-#include "GnssRawMeasurementParser.h"
 #include "GnssReplayUtils.h"
 #include "Utils.h"
 
@@ -28,7 +27,6 @@ namespace aidl::android::hardware::gnss {
 
 using Utils = ::android::hardware::gnss::common::Utils;
 using ReplayUtils = ::android::hardware::gnss::common::ReplayUtils;
-using GnssRawMeasurementParser = ::android::hardware::gnss::common::GnssRawMeasurementParser;
 using DeviceFileReader = ::android::hardware::gnss::common::DeviceFileReader;
 
 std::shared_ptr<IGnssMeasurementCallback> GnssMeasurementInterface::sCallback = nullptr;
@@ -109,18 +107,13 @@ void GnssMeasurementInterface::start(const bool enableCorrVecOutputs) {
             if (!mIsActive) {
                 break;
             }
-            std::string rawMeasurementStr = "";
+            std::unique_ptr<GnssData> rawMeasurement;
             if (ReplayUtils::hasGnssDeviceFile() &&
-                ReplayUtils::isGnssRawMeasurement(
-                        rawMeasurementStr =
-                                DeviceFileReader::Instance().getGnssRawMeasurementData())) {
-                ALOGD("rawMeasurementStr(size: %zu) from device file: %s", rawMeasurementStr.size(),
-                      rawMeasurementStr.c_str());
-                auto measurement =
-                        GnssRawMeasurementParser::getMeasurementFromStrs(rawMeasurementStr);
-                if (measurement != nullptr) {
-                    this->reportMeasurement(*measurement);
-                }
+                (rawMeasurement = DeviceFileReader::Instance().getGnssRawMeasurementData()) !=
+                        nullptr) {
+                ALOGD("rawMeasurement(%zu measurements) from device file",
+                      rawMeasurement->measurements.size());
+                this->reportMeasurement(*rawMeasurement);
             } else {
                 auto measurement = Utils::getMockMeasurement(enableCorrVecOutputs);
                 this->reportMeasurement(measurement);
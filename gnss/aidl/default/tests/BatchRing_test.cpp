@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BatchRing.h"
+
+using aidl::android::hardware::gnss::BatchRing;
+
+TEST(BatchRingTest, DrainBeforeWrapKeepsOrder) {
+    BatchRing<int> ring(4);
+    EXPECT_FALSE(ring.push(1));
+    EXPECT_FALSE(ring.push(2));
+    EXPECT_FALSE(ring.full());
+
+    std::vector<int> out = {42};
+    ring.drain(out);
+    EXPECT_EQ(std::vector<int>({1, 2}), out);
+    EXPECT_EQ(0u, ring.size());
+}
+
+TEST(BatchRingTest, WraparoundOverwritesOldest) {
+    BatchRing<int> ring(4);
+    for (int i = 0; i < 4; i++) {
+        EXPECT_FALSE(ring.push(i));
+    }
+    EXPECT_TRUE(ring.full());
+    for (int i = 4; i < 11; i++) {
+        EXPECT_TRUE(ring.push(i));
+    }
+
+    std::vector<int> out;
+    ring.drain(out);
+    EXPECT_EQ(std::vector<int>({7, 8, 9, 10}), out);
+
+    // The ring starts over after a drain.
+    ring.push(11);
+    ring.drain(out);
+    EXPECT_EQ(std::vector<int>({11}), out);
+}
+
+TEST(BatchRingTest, DrainRecyclesStorage) {
+    BatchRing<int> ring(8);
+    std::vector<int> out;
+    out.reserve(8);
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 10; i++) ring.push(i);
+        const int* storage = out.data();
+        ring.drain(out);
+        ASSERT_EQ(8u, out.size());
+        // Storage ping-pongs between the ring and the caller.
+        if (round > 0) {
+            EXPECT_NE(storage, out.data());
+        }
+    }
+}
+
+TEST(BatchRingTest, FlushUnderConcurrency) {
+    constexpr int kCapacity = 10;
+    constexpr int kCount = 200000;
+    BatchRing<int> ring(kCapacity);
+    std::mutex mutex;
+    std::atomic<bool> done = false;
+
+    std::thread producer([&]() {
+        for (int i = 0; i < kCount; i++) {
+            std::lock_guard<std::mutex> lock(mutex);
+            ring.push(i);
+        }
+        done = true;
+    });
+
+    std::vector<int> out;
+    int last = -1;
+    size_t received = 0;
+    auto check = [&]() {
+        ASSERT_LE(out.size(), static_cast<size_t>(kCapacity));
+        for (int value : out) {
+            // Entries are delivered oldest first and never twice.
+            ASSERT_GT(value, last);
+            last = value;
+        }
+        received += out.size();
+    };
+    while (!done) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ring.drain(out);
+        }
+        check();
+    }
+    producer.join();
+    ring.drain(out);
+    check();
+
+    EXPECT_EQ(kCount - 1, last);
+    EXPECT_GT(received, 0u);
+}
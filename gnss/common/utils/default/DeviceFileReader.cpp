@@ -20,6 +20,8 @@ namespace hardware {
 namespace gnss {
 namespace common {
 
+using aidl::android::hardware::gnss::GnssData;
+
 void DeviceFileReader::getDataFromDeviceFile(const std::string& command, int mMinIntervalMs) {
     char inputBuffer[INPUT_BUFFER_SIZE];
     std::string deviceFilePath = "";
@@ -58,33 +60,63 @@ void DeviceFileReader::getDataFromDeviceFile(const std::string& command, int mMi
         return;
     }
     while (true) {
-        memset(inputBuffer, 0, INPUT_BUFFER_SIZE);
         bytes_read = read(mGnssFd, &inputBuffer, INPUT_BUFFER_SIZE);
         if (bytes_read <= 0) {
             break;
         }
-        s_buffer_ += std::string(inputBuffer, bytes_read);
+        if (command == CMD_GET_RAWMEASUREMENT) {
+            feedRawMeasurement(std::string_view(inputBuffer, bytes_read));
+        } else {
+            s_buffer_.append(inputBuffer, bytes_read);
+        }
     }
     close(mGnssFd);
 
+    if (command == CMD_GET_RAWMEASUREMENT) {
+        // Complete records have already been parsed and queued.
+        return;
+    }
+
     // Trim end of file mark(\n\n\n\n).
-    auto pos = s_buffer_.find("\n\n\n\n");
+    // Bytes before s_scanned_ were searched by an earlier call, so a long dump arriving over
+    // several calls is only scanned once.
+    auto pos = s_buffer_.find("\n\n\n\n", s_scanned_);
     if (pos != std::string::npos) {
-        inputStr = s_buffer_.substr(0, pos);
-        s_buffer_ = s_buffer_.substr(pos + 4);
+        inputStr.assign(s_buffer_, 0, pos);
+        s_buffer_.erase(0, pos + 4);
+        s_scanned_ = 0;
     } else {
+        // Keep the last 3 bytes in range in case they start a mark completed by the next read.
+        s_scanned_ = s_buffer_.size() < 3 ? 0 : s_buffer_.size() - 3;
         return;
     }
 
     // Cache the injected data.
-    if (command == CMD_GET_LOCATION) {
-        // TODO validate data
-        data_[CMD_GET_LOCATION] = inputStr;
-    } else if (command == CMD_GET_RAWMEASUREMENT) {
-        if (ReplayUtils::isGnssRawMeasurement(inputStr)) {
-            data_[CMD_GET_RAWMEASUREMENT] = inputStr;
+    // TODO validate data
+    data_[CMD_GET_LOCATION] = inputStr;
+}
+
+void DeviceFileReader::feedRawMeasurement(std::string_view chunk) {
+    // Records are separated by an end of file mark (\n\n\n\n), which may be split across
+    // chunks. The blank lines of the mark are ignored by the parser.
+    size_t start = 0;
+    for (size_t i = 0; i < chunk.size(); i++) {
+        if (chunk[i] != '\n') {
+            s_newlines_ = 0;
+            continue;
+        }
+        if (++s_newlines_ < 4) {
+            continue;
+        }
+        s_newlines_ = 0;
+        s_parser_.feed(chunk.substr(start, i + 1 - start));
+        start = i + 1;
+        std::unique_ptr<GnssData> gnssData = s_parser_.finish();
+        if (gnssData != nullptr) {
+            s_records_.push_back(std::move(*gnssData));
         }
     }
+    s_parser_.feed(chunk.substr(start));
 }
 
 std::string DeviceFileReader::getLocationData() {
@@ -93,10 +125,17 @@ std::string DeviceFileReader::getLocationData() {
     return data_[CMD_GET_LOCATION];
 }
 
-std::string DeviceFileReader::getGnssRawMeasurementData() {
+std::unique_ptr<GnssData> DeviceFileReader::getGnssRawMeasurementData() {
     std::unique_lock<std::mutex> lock(mMutex);
     getDataFromDeviceFile(CMD_GET_RAWMEASUREMENT, 20);
-    return data_[CMD_GET_RAWMEASUREMENT];
+    if (!s_records_.empty()) {
+        s_lastRecord_ = std::move(s_records_.front());
+        s_records_.pop_front();
+    }
+    if (!s_lastRecord_.has_value()) {
+        return nullptr;
+    }
+    return std::make_unique<GnssData>(s_lastRecord_.value());
 }
 
 DeviceFileReader::DeviceFileReader() {}
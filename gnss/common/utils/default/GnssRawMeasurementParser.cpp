@@ -16,6 +16,8 @@
 
 #include "GnssRawMeasurementParser.h"
 
+#include <algorithm>
+
 namespace android {
 namespace hardware {
 namespace gnss {
@@ -32,101 +34,153 @@ using aidl::android::hardware::gnss::GnssSignalType;
 using ParseUtils = ::android::hardware::gnss::common::ParseUtils;
 
 std::unordered_map<std::string, int> GnssRawMeasurementParser::getColumnIdNameMappingFromHeader(
-        const std::string& header) {
-    std::vector<std::string> columnNames;
+        std::string_view header) {
+    std::vector<std::string_view> columnNames;
     std::unordered_map<std::string, int> columnNameIdMapping;
-    std::string s = header;
+    std::string_view s = header;
     // Trim left spaces
-    s.erase(s.begin(),
-            std::find_if(s.begin(), s.end(), [](unsigned char ch) { return !std::isspace(ch); }));
+    while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front()))) {
+        s.remove_prefix(1);
+    }
     // Trim right spaces
-    s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char ch) { return !std::isspace(ch); })
-                    .base(),
-            s.end());
+    while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back()))) {
+        s.remove_suffix(1);
+    }
     // Remove comment symbol, start from `Raw`.
-    s = s.substr(s.find("Raw"));
+    size_t rawPos = s.find("Raw");
+    if (rawPos == std::string_view::npos) {
+        return columnNameIdMapping;
+    }
+    s.remove_prefix(rawPos);
 
     ParseUtils::splitStr(s, COMMA_SEPARATOR, columnNames);
     int columnId = 0;
     for (auto& name : columnNames) {
-        columnNameIdMapping[name] = columnId++;
+        columnNameIdMapping[std::string(name)] = columnId++;
     }
 
     return columnNameIdMapping;
 }
 
-int GnssRawMeasurementParser::getClockFlags(
-        const std::vector<std::string>& rawMeasurementRecordValues,
+RawMeasurementColumns RawMeasurementColumns::fromMapping(
         const std::unordered_map<std::string, int>& columnNameIdMapping) {
+    RawMeasurementColumns columns = {
+            .timeNanos = columnNameIdMapping.at("TimeNanos"),
+            .leapSecond = columnNameIdMapping.at("LeapSecond"),
+            .timeUncertaintyNanos = columnNameIdMapping.at("TimeUncertaintyNanos"),
+            .fullBiasNanos = columnNameIdMapping.at("FullBiasNanos"),
+            .biasNanos = columnNameIdMapping.at("BiasNanos"),
+            .biasUncertaintyNanos = columnNameIdMapping.at("BiasUncertaintyNanos"),
+            .driftNanosPerSecond = columnNameIdMapping.at("DriftNanosPerSecond"),
+            .driftUncertaintyNanosPerSecond =
+                    columnNameIdMapping.at("DriftUncertaintyNanosPerSecond"),
+            .hardwareClockDiscontinuityCount =
+                    columnNameIdMapping.at("HardwareClockDiscontinuityCount"),
+            .svid = columnNameIdMapping.at("Svid"),
+            .state = columnNameIdMapping.at("State"),
+            .receivedSvTimeNanos = columnNameIdMapping.at("ReceivedSvTimeNanos"),
+            .receivedSvTimeUncertaintyNanos =
+                    columnNameIdMapping.at("ReceivedSvTimeUncertaintyNanos"),
+            .cn0DbHz = columnNameIdMapping.at("Cn0DbHz"),
+            .pseudorangeRateMetersPerSecond =
+                    columnNameIdMapping.at("PseudorangeRateMetersPerSecond"),
+            .pseudorangeRateUncertaintyMetersPerSecond =
+                    columnNameIdMapping.at("PseudorangeRateUncertaintyMetersPerSecond"),
+            .accumulatedDeltaRangeState = columnNameIdMapping.at("AccumulatedDeltaRangeState"),
+            .accumulatedDeltaRangeMeters = columnNameIdMapping.at("AccumulatedDeltaRangeMeters"),
+            .accumulatedDeltaRangeUncertaintyMeters =
+                    columnNameIdMapping.at("AccumulatedDeltaRangeUncertaintyMeters"),
+            .carrierFrequencyHz = columnNameIdMapping.at("CarrierFrequencyHz"),
+            .carrierCycles = columnNameIdMapping.at("CarrierCycles"),
+            .carrierPhase = columnNameIdMapping.at("CarrierPhase"),
+            .carrierPhaseUncertainty = columnNameIdMapping.at("CarrierPhaseUncertainty"),
+            .snrInDb = columnNameIdMapping.at("SnrInDb"),
+            .constellationType = columnNameIdMapping.at("ConstellationType"),
+            .agcDb = columnNameIdMapping.at("AgcDb"),
+            .basebandCn0DbHz = columnNameIdMapping.at("BasebandCn0DbHz"),
+            .fullInterSignalBiasNanos = columnNameIdMapping.at("FullInterSignalBiasNanos"),
+            .fullInterSignalBiasUncertaintyNanos =
+                    columnNameIdMapping.at("FullInterSignalBiasUncertaintyNanos"),
+            .satelliteInterSignalBiasNanos =
+                    columnNameIdMapping.at("SatelliteInterSignalBiasNanos"),
+            .satelliteInterSignalBiasUncertaintyNanos =
+                    columnNameIdMapping.at("SatelliteInterSignalBiasUncertaintyNanos"),
+            .codeType = columnNameIdMapping.at("CodeType"),
+            .chipsetElapsedRealtimeNanos = columnNameIdMapping.at("ChipsetElapsedRealtimeNanos"),
+            .minFields = 0};
+    for (const auto& [name, id] : columnNameIdMapping) {
+        columns.minFields = std::max(columns.minFields, static_cast<size_t>(id) + 1);
+    }
+    return columns;
+}
+
+int GnssRawMeasurementParser::getClockFlags(
+        const std::vector<std::string_view>& rawMeasurementRecordValues,
+        const RawMeasurementColumns& columns) {
     int clockFlags = 0;
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("LeapSecond")].empty()) {
+    if (!rawMeasurementRecordValues[columns.leapSecond].empty()) {
         clockFlags |= GnssClock::HAS_LEAP_SECOND;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("FullBiasNanos")].empty()) {
+    if (!rawMeasurementRecordValues[columns.fullBiasNanos].empty()) {
         clockFlags |= GnssClock::HAS_FULL_BIAS;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("BiasNanos")].empty()) {
+    if (!rawMeasurementRecordValues[columns.biasNanos].empty()) {
         clockFlags |= GnssClock::HAS_BIAS;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("BiasUncertaintyNanos")].empty()) {
+    if (!rawMeasurementRecordValues[columns.biasUncertaintyNanos].empty()) {
         clockFlags |= GnssClock::HAS_BIAS_UNCERTAINTY;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("DriftNanosPerSecond")].empty()) {
+    if (!rawMeasurementRecordValues[columns.driftNanosPerSecond].empty()) {
         clockFlags |= GnssClock::HAS_DRIFT;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("DriftUncertaintyNanosPerSecond")]
-                 .empty()) {
+    if (!rawMeasurementRecordValues[columns.driftUncertaintyNanosPerSecond].empty()) {
         clockFlags |= GnssClock::HAS_DRIFT_UNCERTAINTY;
     }
     return clockFlags;
 }
 
 int GnssRawMeasurementParser::getElapsedRealtimeFlags(
-        const std::vector<std::string>& rawMeasurementRecordValues,
-        const std::unordered_map<std::string, int>& columnNameIdMapping) {
+        const std::vector<std::string_view>& rawMeasurementRecordValues,
+        const RawMeasurementColumns& columns) {
     int elapsedRealtimeFlags = ElapsedRealtime::HAS_TIMESTAMP_NS;
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("TimeUncertaintyNanos")].empty()) {
+    if (!rawMeasurementRecordValues[columns.timeUncertaintyNanos].empty()) {
         elapsedRealtimeFlags |= ElapsedRealtime::HAS_TIME_UNCERTAINTY_NS;
     }
     return elapsedRealtimeFlags;
 }
 
 int GnssRawMeasurementParser::getRawMeasurementFlags(
-        const std::vector<std::string>& rawMeasurementRecordValues,
-        const std::unordered_map<std::string, int>& columnNameIdMapping) {
+        const std::vector<std::string_view>& rawMeasurementRecordValues,
+        const RawMeasurementColumns& columns) {
     int rawMeasurementFlags = 0;
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("SnrInDb")].empty()) {
+    if (!rawMeasurementRecordValues[columns.snrInDb].empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_SNR;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("CarrierFrequencyHz")].empty()) {
+    if (!rawMeasurementRecordValues[columns.carrierFrequencyHz].empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_CARRIER_FREQUENCY;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("CarrierCycles")].empty()) {
+    if (!rawMeasurementRecordValues[columns.carrierCycles].empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_CARRIER_CYCLES;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("CarrierPhase")].empty()) {
+    if (!rawMeasurementRecordValues[columns.carrierPhase].empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_CARRIER_PHASE;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("CarrierPhaseUncertainty")].empty()) {
+    if (!rawMeasurementRecordValues[columns.carrierPhaseUncertainty].empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_CARRIER_PHASE_UNCERTAINTY;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("AgcDb")].empty()) {
+    if (!rawMeasurementRecordValues[columns.agcDb].empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_AUTOMATIC_GAIN_CONTROL;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("FullInterSignalBiasNanos")].empty()) {
+    if (!rawMeasurementRecordValues[columns.fullInterSignalBiasNanos].empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_FULL_ISB;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("FullInterSignalBiasUncertaintyNanos")]
-                 .empty()) {
+    if (!rawMeasurementRecordValues[columns.fullInterSignalBiasUncertaintyNanos].empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_FULL_ISB_UNCERTAINTY;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at("SatelliteInterSignalBiasNanos")]
-                 .empty()) {
+    if (!rawMeasurementRecordValues[columns.satelliteInterSignalBiasNanos].empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_SATELLITE_ISB;
     }
-    if (!rawMeasurementRecordValues[columnNameIdMapping.at(
-                                            "SatelliteInterSignalBiasUncertaintyNanos")]
-                 .empty()) {
+    if (!rawMeasurementRecordValues[columns.satelliteInterSignalBiasUncertaintyNanos].empty()) {
         rawMeasurementFlags |= GnssMeasurement::HAS_SATELLITE_ISB_UNCERTAINTY;
     }
     // HAS_SATELLITE_PVT and HAS_CORRELATION_VECTOR fields currently not in rawmeasurement
@@ -166,6 +220,88 @@ GnssConstellationType GnssRawMeasurementParser::getGnssConstellationType(int con
 
 std::unique_ptr<GnssData> GnssRawMeasurementParser::getMeasurementFromStrs(
         std::string& rawMeasurementStr) {
+    return getMeasurementFromStrs(std::string_view(rawMeasurementStr));
+}
+
+std::unique_ptr<GnssData> GnssRawMeasurementParser::getMeasurementFromStrs(
+        std::string_view rawMeasurementStr) {
+    ALOGD("Parsing %zu bytes rawMeasurementStr.", rawMeasurementStr.size());
+    if (rawMeasurementStr.empty()) {
+        return nullptr;
+    }
+    GnssRawMeasurementStreamParser parser;
+    parser.feed(rawMeasurementStr);
+    return parser.finish();
+}
+
+void GnssRawMeasurementStreamParser::feed(std::string_view chunk) {
+    if (!mPartialLine.empty()) {
+        // Complete the line left over from the previous chunk.
+        size_t end = chunk.find(LINE_SEPARATOR);
+        if (end == std::string_view::npos) {
+            mPartialLine.append(chunk);
+            return;
+        }
+        mPartialLine.append(chunk.substr(0, end));
+        chunk.remove_prefix(end + 1);
+        parseLine(mPartialLine);
+        mPartialLine.clear();
+    }
+    while (!chunk.empty()) {
+        if (chunk.find(LINE_SEPARATOR) == std::string_view::npos) {
+            mPartialLine.assign(chunk);
+            return;
+        }
+        parseLine(ParseUtils::nextLine(chunk));
+    }
+}
+
+std::unique_ptr<GnssData> GnssRawMeasurementStreamParser::finish() {
+    if (!mPartialLine.empty()) {
+        parseLine(mPartialLine);
+        mPartialLine.clear();
+    }
+    std::unique_ptr<GnssData> gnssData;
+    if (!mHeaderValid) {
+        ALOGE("Raw GNSS Measurements parser failed. (No header or missing columns.) ");
+    } else if (mMeasurements.empty()) {
+        ALOGE("Raw GNSS Measurements parser failed. (No records) ");
+    } else {
+        gnssData = std::make_unique<GnssData>();
+        gnssData->measurements = std::move(mMeasurements);
+        gnssData->clock = mClock;
+        gnssData->elapsedRealtime = mElapsedRealtime;
+    }
+    reset();
+    return gnssData;
+}
+
+void GnssRawMeasurementStreamParser::reset() {
+    mHasHeader = false;
+    mHeaderValid = false;
+    mHasClock = false;
+    mMeasurements.clear();
+}
+
+void GnssRawMeasurementStreamParser::parseLine(std::string_view line) {
+    if (!mHasHeader) {
+        parseHeader(line);
+    } else if (mHeaderValid) {
+        parseRecord(line);
+    }
+}
+
+void GnssRawMeasurementStreamParser::parseHeader(std::string_view line) {
+    mHasHeader = true;
+    std::unordered_map<std::string, int> columnNameIdMapping =
+            GnssRawMeasurementParser::getColumnIdNameMappingFromHeader(line);
+    mHeaderValid = columnNameIdMapping.size() >= 37 && ParseUtils::isValidHeader(columnNameIdMapping);
+    if (mHeaderValid) {
+        mColumns = RawMeasurementColumns::fromMapping(columnNameIdMapping);
+    }
+}
+
+void GnssRawMeasurementStreamParser::parseRecord(std::string_view line) {
     /*
      * Raw,utcTimeMillis,TimeNanos,LeapSecond,TimeUncertaintyNanos,FullBiasNanos,BiasNanos,
      * BiasUncertaintyNanos,DriftNanosPerSecond,DriftUncertaintyNanosPerSecond,
@@ -178,125 +314,74 @@ std::unique_ptr<GnssData> GnssRawMeasurementParser::getMeasurementFromStrs(
      * FullInterSignalBiasUncertaintyNanos,SatelliteInterSignalBiasNanos,
      * SatelliteInterSignalBiasUncertaintyNanos,CodeType,ChipsetElapsedRealtimeNanos
      */
-    ALOGD("Parsing %zu bytes rawMeasurementStr.", rawMeasurementStr.size());
-    if (rawMeasurementStr.empty()) {
-        return nullptr;
+    ParseUtils::splitStr(line, COMMA_SEPARATOR, mFields);
+    // The last column may be empty, which splitStr does not report.
+    if (mFields.size() + 1 < mColumns.minFields) {
+        return;
     }
-    std::vector<std::string> rawMeasurementStrRecords;
-    ParseUtils::splitStr(rawMeasurementStr, LINE_SEPARATOR, rawMeasurementStrRecords);
-    if (rawMeasurementStrRecords.size() <= 1) {
-        ALOGE("Raw GNSS Measurements parser failed. (No records) ");
-        return nullptr;
-    }
-
-    // Get the column name mapping from the header.
-    std::unordered_map<std::string, int> columnNameIdMapping =
-            getColumnIdNameMappingFromHeader(rawMeasurementStrRecords[0]);
-
-    if (columnNameIdMapping.size() < 37 || !ParseUtils::isValidHeader(columnNameIdMapping)) {
-        ALOGE("Raw GNSS Measurements parser failed. (No header or missing columns.) ");
-        return nullptr;
-    }
-
-    // Set GnssClock from 1st record.
-    std::size_t pointer = 1;
-    std::vector<std::string> firstRecordValues;
-    ParseUtils::splitStr(rawMeasurementStrRecords[pointer], COMMA_SEPARATOR, firstRecordValues);
-    GnssClock clock = {
-            .gnssClockFlags = getClockFlags(firstRecordValues, columnNameIdMapping),
-            .timeNs = ParseUtils::tryParseLongLong(
-                    firstRecordValues[columnNameIdMapping.at("TimeNanos")], 0),
-            .fullBiasNs = ParseUtils::tryParseLongLong(
-                    firstRecordValues[columnNameIdMapping.at("FullBiasNanos")], 0),
-            .biasNs = ParseUtils::tryParseDouble(
-                    firstRecordValues[columnNameIdMapping.at("BiasNanos")], 0),
-            .biasUncertaintyNs = ParseUtils::tryParseDouble(
-                    firstRecordValues[columnNameIdMapping.at("BiasUncertaintyNanos")], 0),
-            .driftNsps = ParseUtils::tryParseDouble(
-                    firstRecordValues[columnNameIdMapping.at("DriftNanosPerSecond")], 0),
-            .driftUncertaintyNsps = ParseUtils::tryParseDouble(
-                    firstRecordValues[columnNameIdMapping.at("DriftNanosPerSecond")], 0),
-            .hwClockDiscontinuityCount = ParseUtils::tryParseInt(
-                    firstRecordValues[columnNameIdMapping.at("HardwareClockDiscontinuityCount")],
-                    0)};
-
-    ElapsedRealtime timestamp = {
-            .flags = getElapsedRealtimeFlags(firstRecordValues, columnNameIdMapping),
-            .timestampNs = ParseUtils::tryParseLongLong(
-                    firstRecordValues[columnNameIdMapping.at("ChipsetElapsedRealtimeNanos")]),
-            .timeUncertaintyNs = ParseUtils::tryParseDouble(
-                    firstRecordValues[columnNameIdMapping.at("TimeUncertaintyNanos")], 0)};
+    mFields.resize(mColumns.minFields);
+    const auto& values = mFields;
+    const auto& columns = mColumns;
 
-    std::vector<GnssMeasurement> measurementsVec;
-    for (pointer = 1; pointer < rawMeasurementStrRecords.size(); pointer++) {
-        std::vector<std::string> rawMeasurementValues;
-        std::string line = rawMeasurementStrRecords[pointer];
-        ParseUtils::splitStr(line, COMMA_SEPARATOR, rawMeasurementValues);
-        GnssSignalType signalType = {
-                .constellation = getGnssConstellationType(ParseUtils::tryParseInt(
-                        rawMeasurementValues[columnNameIdMapping.at("ConstellationType")], 0)),
-                .carrierFrequencyHz = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at("CarrierFrequencyHz")], 0),
-                .codeType = rawMeasurementValues[columnNameIdMapping.at("CodeType")],
-        };
-        GnssMeasurement measurement = {
-                .flags = getRawMeasurementFlags(rawMeasurementValues, columnNameIdMapping),
-                .svid = ParseUtils::tryParseInt(
-                        rawMeasurementValues[columnNameIdMapping.at("Svid")], 0),
-                .signalType = signalType,
-                .receivedSvTimeInNs = ParseUtils::tryParseLongLong(
-                        rawMeasurementValues[columnNameIdMapping.at("ReceivedSvTimeNanos")], 0),
-                .receivedSvTimeUncertaintyInNs =
-                        ParseUtils::tryParseLongLong(rawMeasurementValues[columnNameIdMapping.at(
-                                                             "ReceivedSvTimeUncertaintyNanos")],
-                                                     0),
-                .antennaCN0DbHz = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at("Cn0DbHz")], 0),
-                .basebandCN0DbHz = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at("BasebandCn0DbHz")], 0),
-                .agcLevelDb = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at("AgcDb")], 0),
-                .pseudorangeRateMps =
-                        ParseUtils::tryParseDouble(rawMeasurementValues[columnNameIdMapping.at(
-                                                           "PseudorangeRateMetersPerSecond")],
-                                                   0),
-                .pseudorangeRateUncertaintyMps = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at(
-                                "PseudorangeRateUncertaintyMetersPerSecond")],
-                        0),
-                .accumulatedDeltaRangeState = ParseUtils::tryParseInt(
-                        rawMeasurementValues[columnNameIdMapping.at("AccumulatedDeltaRangeState")],
-                        0),
-                .accumulatedDeltaRangeM = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at("AccumulatedDeltaRangeMeters")],
-                        0),
-                .accumulatedDeltaRangeUncertaintyM = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at(
-                                "AccumulatedDeltaRangeUncertaintyMeters")],
-                        0),
-                .multipathIndicator = GnssMultipathIndicator::UNKNOWN,  // Not in GnssLogger yet.
-                .state = ParseUtils::tryParseInt(
-                        rawMeasurementValues[columnNameIdMapping.at("State")], 0),
-                .fullInterSignalBiasNs = ParseUtils::tryParseDouble(rawMeasurementValues[31], 0),
-                .fullInterSignalBiasUncertaintyNs = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at("FullInterSignalBiasNanos")],
-                        0),
-                .satelliteInterSignalBiasNs =
-                        ParseUtils::tryParseDouble(rawMeasurementValues[columnNameIdMapping.at(
-                                                           "SatelliteInterSignalBiasNanos")],
-                                                   0),
-                .satelliteInterSignalBiasUncertaintyNs = ParseUtils::tryParseDouble(
-                        rawMeasurementValues[columnNameIdMapping.at(
-                                "SatelliteInterSignalBiasUncertaintyNanos")],
-                        0),
-                .satellitePvt = {},
-                .correlationVectors = {}};
-        measurementsVec.push_back(measurement);
+    if (!mHasClock) {
+        // Set GnssClock from 1st record.
+        mHasClock = true;
+        mClock = {
+                .gnssClockFlags = GnssRawMeasurementParser::getClockFlags(values, columns),
+                .timeNs = ParseUtils::tryParseLongLong(values[columns.timeNanos], 0),
+                .fullBiasNs = ParseUtils::tryParseLongLong(values[columns.fullBiasNanos], 0),
+                .biasNs = ParseUtils::tryParseDouble(values[columns.biasNanos], 0),
+                .biasUncertaintyNs =
+                        ParseUtils::tryParseDouble(values[columns.biasUncertaintyNanos], 0),
+                .driftNsps = ParseUtils::tryParseDouble(values[columns.driftNanosPerSecond], 0),
+                .driftUncertaintyNsps =
+                        ParseUtils::tryParseDouble(values[columns.driftNanosPerSecond], 0),
+                .hwClockDiscontinuityCount = ParseUtils::tryParseInt(
+                        values[columns.hardwareClockDiscontinuityCount], 0)};
+        mElapsedRealtime = {
+                .flags = GnssRawMeasurementParser::getElapsedRealtimeFlags(values, columns),
+                .timestampNs = ParseUtils::tryParseLongLong(
+                        values[columns.chipsetElapsedRealtimeNanos], 0),
+                .timeUncertaintyNs =
+                        ParseUtils::tryParseDouble(values[columns.timeUncertaintyNanos], 0)};
     }
 
-    GnssData gnssData = {
-            .measurements = measurementsVec, .clock = clock, .elapsedRealtime = timestamp};
-    return std::make_unique<GnssData>(gnssData);
+    GnssMeasurement& measurement = mMeasurements.emplace_back();
+    measurement.flags = GnssRawMeasurementParser::getRawMeasurementFlags(values, columns);
+    measurement.svid = ParseUtils::tryParseInt(values[columns.svid], 0);
+    measurement.signalType = {
+            .constellation = GnssRawMeasurementParser::getGnssConstellationType(
+                    ParseUtils::tryParseInt(values[columns.constellationType], 0)),
+            .carrierFrequencyHz = ParseUtils::tryParseDouble(values[columns.carrierFrequencyHz], 0),
+            .codeType = std::string(values[columns.codeType]),
+    };
+    measurement.receivedSvTimeInNs =
+            ParseUtils::tryParseLongLong(values[columns.receivedSvTimeNanos], 0);
+    measurement.receivedSvTimeUncertaintyInNs =
+            ParseUtils::tryParseLongLong(values[columns.receivedSvTimeUncertaintyNanos], 0);
+    measurement.antennaCN0DbHz = ParseUtils::tryParseDouble(values[columns.cn0DbHz], 0);
+    measurement.basebandCN0DbHz = ParseUtils::tryParseDouble(values[columns.basebandCn0DbHz], 0);
+    measurement.agcLevelDb = ParseUtils::tryParseDouble(values[columns.agcDb], 0);
+    measurement.pseudorangeRateMps =
+            ParseUtils::tryParseDouble(values[columns.pseudorangeRateMetersPerSecond], 0);
+    measurement.pseudorangeRateUncertaintyMps = ParseUtils::tryParseDouble(
+            values[columns.pseudorangeRateUncertaintyMetersPerSecond], 0);
+    measurement.accumulatedDeltaRangeState =
+            ParseUtils::tryParseInt(values[columns.accumulatedDeltaRangeState], 0);
+    measurement.accumulatedDeltaRangeM =
+            ParseUtils::tryParseDouble(values[columns.accumulatedDeltaRangeMeters], 0);
+    measurement.accumulatedDeltaRangeUncertaintyM =
+            ParseUtils::tryParseDouble(values[columns.accumulatedDeltaRangeUncertaintyMeters], 0);
+    measurement.multipathIndicator = GnssMultipathIndicator::UNKNOWN;  // Not in GnssLogger yet.
+    measurement.state = ParseUtils::tryParseInt(values[columns.state], 0);
+    measurement.fullInterSignalBiasNs =
+            ParseUtils::tryParseDouble(values[columns.fullInterSignalBiasNanos], 0);
+    measurement.fullInterSignalBiasUncertaintyNs =
+            ParseUtils::tryParseDouble(values[columns.fullInterSignalBiasNanos], 0);
+    measurement.satelliteInterSignalBiasNs =
+            ParseUtils::tryParseDouble(values[columns.satelliteInterSignalBiasNanos], 0);
+    measurement.satelliteInterSignalBiasUncertaintyNs = ParseUtils::tryParseDouble(
+            values[columns.satelliteInterSignalBiasUncertaintyNanos], 0);
 }
 
 }  // namespace common
@@ -15,63 +15,103 @@
  */
 
 #include <ParseUtils.h>
+#include "Constants.h"
+#include <charconv>
+#include <cstdlib>
 #include <sstream>
-#include <stdexcept>
 
 namespace android {
 namespace hardware {
 namespace gnss {
 namespace common {
 
-int ParseUtils::tryParseInt(const std::string& s, int defaultVal) {
-    if (s.empty()) {
-        return defaultVal;
-    } else {
-        return std::stoi(s);
+void ParseUtils::splitStr(const std::string& line, const char& delimiter,
+                          std::vector<std::string>& out) {
+    std::istringstream iss(line);
+    std::string item;
+    while (std::getline(iss, item, delimiter)) {
+        out.push_back(item);
     }
 }
 
-float ParseUtils::tryParsefloat(const std::string& s, float defaultVal) {
-    if (s.empty()) {
+namespace {
+
+template <typename T>
+T parseInteger(std::string_view s, T defaultVal) {
+    // from_chars does not accept a leading '+'.
+    if (!s.empty() && s.front() == '+') {
+        s.remove_prefix(1);
+    }
+    T value;
+    auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+    if (ec != std::errc() || end == s.data()) {
         return defaultVal;
-    } else {
-        return std::stof(s);
     }
+    return value;
 }
 
-double ParseUtils::tryParseDouble(const std::string& s, double defaultVal) {
-    if (s.empty()) {
+template <typename T>
+T parseFloatingPoint(std::string_view s, T defaultVal, T (*parse)(const char*, char**)) {
+    // libc++ has no floating point from_chars yet; strtod and strtof need a terminated string,
+    // which a stack copy provides without allocating. Numeric fields in the replay files are short.
+    char buffer[64];
+    if (s.empty() || s.size() >= sizeof(buffer)) {
         return defaultVal;
-    } else {
-        return std::stod(s);
     }
+    s.copy(buffer, s.size());
+    buffer[s.size()] = '\0';
+    char* end;
+    T value = parse(buffer, &end);
+    return end == buffer ? defaultVal : value;
 }
 
-long ParseUtils::tryParseLong(const std::string& s, long defaultVal) {
-    if (s.empty()) {
-        return defaultVal;
-    } else {
-        return std::stol(s);
-    }
+}  // namespace
+
+int ParseUtils::tryParseInt(std::string_view s, int defaultVal) {
+    return parseInteger<int>(s, defaultVal);
 }
 
-long long ParseUtils::tryParseLongLong(const std::string& s, long long defaultVal) {
-    if (s.empty()) {
-        return defaultVal;
-    } else {
-        return std::stoll(s);
-    }
+float ParseUtils::tryParsefloat(std::string_view s, float defaultVal) {
+    return parseFloatingPoint<float>(s, defaultVal, strtof);
 }
 
-void ParseUtils::splitStr(const std::string& line, const char& delimiter,
-                          std::vector<std::string>& out) {
-    std::istringstream iss(line);
-    std::string item;
-    while (std::getline(iss, item, delimiter)) {
-        out.push_back(item);
+double ParseUtils::tryParseDouble(std::string_view s, double defaultVal) {
+    return parseFloatingPoint<double>(s, defaultVal, strtod);
+}
+
+long ParseUtils::tryParseLong(std::string_view s, long defaultVal) {
+    return parseInteger<long>(s, defaultVal);
+}
+
+long long ParseUtils::tryParseLongLong(std::string_view s, long long defaultVal) {
+    return parseInteger<long long>(s, defaultVal);
+}
+
+void ParseUtils::splitStr(std::string_view line, char delimiter,
+                          std::vector<std::string_view>& out) {
+    out.clear();
+    size_t start = 0;
+    while (start <= line.size()) {
+        size_t end = line.find(delimiter, start);
+        if (end == std::string_view::npos) {
+            // Like getline, do not report an empty field after a trailing delimiter.
+            if (start < line.size()) {
+                out.push_back(line.substr(start));
+            }
+            break;
+        }
+        out.push_back(line.substr(start, end - start));
+        start = end + 1;
     }
 }
 
+std::string_view ParseUtils::nextLine(std::string_view& input) {
+    size_t end = input.find(LINE_SEPARATOR);
+    std::string_view line = input.substr(0, end);
+    input.remove_prefix(end == std::string_view::npos ? input.size() : end + 1);
+    return line;
+}
+
 bool ParseUtils::isValidHeader(const std::unordered_map<std::string, int>& columnNameIdMapping) {
     std::vector<std::string> requiredHeaderColumns = {"Raw",
                                                       "utcTimeMillis",
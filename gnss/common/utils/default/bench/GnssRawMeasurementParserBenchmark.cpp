@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures parsing of GnssLogger raw measurement dumps, comparing the streaming parser with the
+// copy-per-line splitStr/stod path it replaced. Set GNSS_REPLAY_BENCH_FILE to a GnssLogger "Raw"
+// dump to use real data instead of the synthetic log.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "GnssRawMeasurementParser.h"
+#include "ParseUtils.h"
+
+using ::android::hardware::gnss::common::GnssRawMeasurementParser;
+using ::android::hardware::gnss::common::GnssRawMeasurementStreamParser;
+using ::android::hardware::gnss::common::ParseUtils;
+using ::benchmark::State;
+
+namespace {
+
+constexpr char kHeader[] =
+        "# Raw,utcTimeMillis,TimeNanos,LeapSecond,TimeUncertaintyNanos,FullBiasNanos,BiasNanos,"
+        "BiasUncertaintyNanos,DriftNanosPerSecond,DriftUncertaintyNanosPerSecond,"
+        "HardwareClockDiscontinuityCount,Svid,TimeOffsetNanos,State,ReceivedSvTimeNanos,"
+        "ReceivedSvTimeUncertaintyNanos,Cn0DbHz,PseudorangeRateMetersPerSecond,"
+        "PseudorangeRateUncertaintyMetersPerSecond,AccumulatedDeltaRangeState,"
+        "AccumulatedDeltaRangeMeters,AccumulatedDeltaRangeUncertaintyMeters,CarrierFrequencyHz,"
+        "CarrierCycles,CarrierPhase,CarrierPhaseUncertainty,MultipathIndicator,SnrInDb,"
+        "ConstellationType,AgcDb,BasebandCn0DbHz,FullInterSignalBiasNanos,"
+        "FullInterSignalBiasUncertaintyNanos,SatelliteInterSignalBiasNanos,"
+        "SatelliteInterSignalBiasUncertaintyNanos,CodeType,ChipsetElapsedRealtimeNanos\n";
+
+std::string syntheticLog(size_t records) {
+    std::ostringstream log;
+    log << kHeader;
+    for (size_t i = 0; i < records; i++) {
+        log << "Raw,1606857808000," << 1000000000 + i << ",18,,-1290554813291612669,"
+            << "0.5714349746704102,10.0,-2.2117498537809456,3.8960913345536434," << i % 3 << ","
+            << 1 + i % 32 << ",0.0,16431,2790449000002," << 12 + i % 7 << ","
+            << 25.0 + (i % 20) / 4.0 << ",-633.8428344726562,0.8271968364715576,16,"
+            << 3.5 * i << ",3.4028234663852886E38,1.57542003E9,,,,0,,1,"
+            << 1.37 << "," << 21.8 << ",,,,,C," << 1234567890123LL + i << "\n";
+    }
+    return log.str();
+}
+
+const std::string& benchLog() {
+    static const std::string log = []() {
+        const char* path = getenv("GNSS_REPLAY_BENCH_FILE");
+        if (path != nullptr) {
+            std::ifstream file(path);
+            std::ostringstream contents;
+            contents << file.rdbuf();
+            return contents.str();
+        }
+        return syntheticLog(20000);
+    }();
+    return log;
+}
+
+// The parsing steps the replay path used to take: a string per line, a string per field and
+// a throwing stod/stoll per value.
+size_t legacyParse(const std::string& log) {
+    std::vector<std::string> lines;
+    ParseUtils::splitStr(log, LINE_SEPARATOR, lines);
+    size_t measurements = 0;
+    double sum = 0;
+    for (size_t i = 1; i < lines.size(); i++) {
+        std::vector<std::string> values;
+        ParseUtils::splitStr(lines[i], COMMA_SEPARATOR, values);
+        if (values.size() < 36) {
+            continue;
+        }
+        sum += ParseUtils::tryParseLongLong(values[2], 0);
+        sum += ParseUtils::tryParseInt(values[11], 0);
+        sum += ParseUtils::tryParseLongLong(values[14], 0);
+        sum += ParseUtils::tryParseDouble(values[16], 0);
+        sum += ParseUtils::tryParseDouble(values[17], 0);
+        sum += ParseUtils::tryParseDouble(values[20], 0);
+        sum += ParseUtils::tryParseDouble(values[22], 0);
+        measurements++;
+    }
+    benchmark::DoNotOptimize(sum);
+    return measurements;
+}
+
+void BM_LegacySplitStr(State& state) {
+    const std::string& log = benchLog();
+    size_t measurements = 0;
+    for (auto _ : state) {
+        measurements = legacyParse(log);
+    }
+    state.SetBytesProcessed(state.iterations() * log.size());
+    state.SetItemsProcessed(state.iterations() * measurements);
+}
+
+void BM_GetMeasurementFromStrs(State& state) {
+    const std::string& log = benchLog();
+    size_t measurements = 0;
+    for (auto _ : state) {
+        auto gnssData = GnssRawMeasurementParser::getMeasurementFromStrs(std::string_view(log));
+        measurements = gnssData ? gnssData->measurements.size() : 0;
+    }
+    state.SetBytesProcessed(state.iterations() * log.size());
+    state.SetItemsProcessed(state.iterations() * measurements);
+}
+
+// Arg: chunk size, as the dump would arrive from the replay device file.
+void BM_StreamParserChunked(State& state) {
+    const std::string_view log = benchLog();
+    const size_t chunkSize = state.range(0);
+    GnssRawMeasurementStreamParser parser;
+    size_t measurements = 0;
+    for (auto _ : state) {
+        for (size_t offset = 0; offset < log.size(); offset += chunkSize) {
+            parser.feed(log.substr(offset, chunkSize));
+        }
+        auto gnssData = parser.finish();
+        measurements = gnssData ? gnssData->measurements.size() : 0;
+    }
+    state.SetBytesProcessed(state.iterations() * log.size());
+    state.SetItemsProcessed(state.iterations() * measurements);
+}
+
+}  // namespace
+
+BENCHMARK(BM_LegacySplitStr);
+BENCHMARK(BM_GetMeasurementFromStrs);
+BENCHMARK(BM_StreamParserChunked)->Arg(4096)->Arg(65536);
+
+BENCHMARK_MAIN();
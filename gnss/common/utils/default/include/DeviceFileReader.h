@@ -18,10 +18,15 @@
 #define android_hardware_gnss_common_default_DeviceFileReader_H_
 
 #include <log/log.h>
+#include <deque>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include "Constants.h"
+#include "GnssRawMeasurementParser.h"
 #include "GnssReplayUtils.h"
 
 namespace android {
@@ -35,14 +40,25 @@ class DeviceFileReader {
         return reader;
     }
     std::string getLocationData();
-    std::string getGnssRawMeasurementData();
+    // Returns the oldest raw measurement record not returned yet, the last returned one if no
+    // new record has arrived, or nullptr if no valid record has been read.
+    std::unique_ptr<aidl::android::hardware::gnss::GnssData> getGnssRawMeasurementData();
     void getDataFromDeviceFile(const std::string& command, int mMinIntervalMs);
 
   private:
     DeviceFileReader();
     ~DeviceFileReader();
+    void feedRawMeasurement(std::string_view chunk);
     std::unordered_map<std::string, std::string> data_;
     std::string s_buffer_;
+    // Prefix of s_buffer_ known not to contain an end of file mark.
+    size_t s_scanned_ = 0;
+    // Raw measurements are parsed as they are read rather than buffered.
+    GnssRawMeasurementStreamParser s_parser_;
+    // Number of consecutive newlines at the end of the data fed to s_parser_.
+    int s_newlines_ = 0;
+    std::deque<aidl::android::hardware::gnss::GnssData> s_records_;
+    std::optional<aidl::android::hardware::gnss::GnssData> s_lastRecord_;
     std::mutex mMutex;
 };
 }  // namespace common
@@ -21,7 +21,9 @@
 #include <log/log.h>
 #include <utils/SystemClock.h>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 #include "Constants.h"
 #include "ParseUtils.h"
@@ -31,23 +33,97 @@ namespace hardware {
 namespace gnss {
 namespace common {
 
+// Column indexes of a GnssLogger "Raw" record, resolved once from the header.
+struct RawMeasurementColumns {
+    int timeNanos;
+    int leapSecond;
+    int timeUncertaintyNanos;
+    int fullBiasNanos;
+    int biasNanos;
+    int biasUncertaintyNanos;
+    int driftNanosPerSecond;
+    int driftUncertaintyNanosPerSecond;
+    int hardwareClockDiscontinuityCount;
+    int svid;
+    int state;
+    int receivedSvTimeNanos;
+    int receivedSvTimeUncertaintyNanos;
+    int cn0DbHz;
+    int pseudorangeRateMetersPerSecond;
+    int pseudorangeRateUncertaintyMetersPerSecond;
+    int accumulatedDeltaRangeState;
+    int accumulatedDeltaRangeMeters;
+    int accumulatedDeltaRangeUncertaintyMeters;
+    int carrierFrequencyHz;
+    int carrierCycles;
+    int carrierPhase;
+    int carrierPhaseUncertainty;
+    int snrInDb;
+    int constellationType;
+    int agcDb;
+    int basebandCn0DbHz;
+    int fullInterSignalBiasNanos;
+    int fullInterSignalBiasUncertaintyNanos;
+    int satelliteInterSignalBiasNanos;
+    int satelliteInterSignalBiasUncertaintyNanos;
+    int codeType;
+    int chipsetElapsedRealtimeNanos;
+    // Number of fields a record needs for every column above to be present.
+    size_t minFields;
+
+    static RawMeasurementColumns fromMapping(
+            const std::unordered_map<std::string, int>& columnNameIdMapping);
+};
+
 struct GnssRawMeasurementParser {
     static std::unique_ptr<aidl::android::hardware::gnss::GnssData> getMeasurementFromStrs(
             std::string& rawMeasurementStr);
-    static int getClockFlags(const std::vector<std::string>& rawMeasurementRecordValues,
-                             const std::unordered_map<std::string, int>& columnNameIdMapping);
+    static std::unique_ptr<aidl::android::hardware::gnss::GnssData> getMeasurementFromStrs(
+            std::string_view rawMeasurementStr);
+    static int getClockFlags(const std::vector<std::string_view>& rawMeasurementRecordValues,
+                             const RawMeasurementColumns& columns);
     static int getElapsedRealtimeFlags(
-            const std::vector<std::string>& rawMeasurementRecordValues,
-            const std::unordered_map<std::string, int>& columnNameIdMapping);
+            const std::vector<std::string_view>& rawMeasurementRecordValues,
+            const RawMeasurementColumns& columns);
     static int getRawMeasurementFlags(
-            const std::vector<std::string>& rawMeasurementRecordValues,
-            const std::unordered_map<std::string, int>& columnNameIdMapping);
+            const std::vector<std::string_view>& rawMeasurementRecordValues,
+            const RawMeasurementColumns& columns);
     static std::unordered_map<std::string, int> getColumnIdNameMappingFromHeader(
-            const std::string& header);
+            std::string_view header);
     static aidl::android::hardware::gnss::GnssConstellationType getGnssConstellationType(
             int constellationType);
 };
 
+/*
+ * Incremental parser for GnssLogger raw measurement dumps: a "Raw,..." header line followed by
+ * one line per measurement. Input can be fed in arbitrary chunks; complete lines are parsed as
+ * they arrive and only a trailing partial line is buffered.
+ */
+class GnssRawMeasurementStreamParser {
+  public:
+    void feed(std::string_view chunk);
+    // Parses any buffered partial line and returns the measurements fed since the last call,
+    // or nullptr if there was no valid header or no record.
+    std::unique_ptr<aidl::android::hardware::gnss::GnssData> finish();
+
+  private:
+    void parseLine(std::string_view line);
+    void parseHeader(std::string_view line);
+    void parseRecord(std::string_view line);
+    void reset();
+
+    bool mHasHeader = false;
+    bool mHeaderValid = false;
+    bool mHasClock = false;
+    RawMeasurementColumns mColumns = {};
+    std::string mPartialLine;
+    // Reused between records to avoid reallocating.
+    std::vector<std::string_view> mFields;
+    aidl::android::hardware::gnss::GnssClock mClock;
+    aidl::android::hardware::gnss::ElapsedRealtime mElapsedRealtime;
+    std::vector<aidl::android::hardware::gnss::GnssMeasurement> mMeasurements;
+};
+
 }  // namespace common
 }  // namespace gnss
 }  // namespace hardware
@@ -19,6 +19,7 @@
 
 #include <log/log.h>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -28,13 +29,19 @@ namespace gnss {
 namespace common {
 
 struct ParseUtils {
-    static int tryParseInt(const std::string& s, int defaultVal = 0);
-    static float tryParsefloat(const std::string& s, float defaultVal = 0.0);
-    static double tryParseDouble(const std::string& s, double defaultVal = 0.0);
-    static long tryParseLong(const std::string& s, long defaultVal = 0);
-    static long long tryParseLongLong(const std::string& s, long long defaultVal = 0);
+    // These return defaultVal when the field is empty or is not a number. They neither throw nor
+    // allocate, so fields can be parsed in place from the replay files.
+    static int tryParseInt(std::string_view s, int defaultVal = 0);
+    static float tryParsefloat(std::string_view s, float defaultVal = 0.0);
+    static double tryParseDouble(std::string_view s, double defaultVal = 0.0);
+    static long tryParseLong(std::string_view s, long defaultVal = 0);
+    static long long tryParseLongLong(std::string_view s, long long defaultVal = 0);
     static void splitStr(const std::string& line, const char& delimiter,
                          std::vector<std::string>& out);
+    // Splits line into views over line; out is cleared first so it can be reused across calls.
+    static void splitStr(std::string_view line, char delimiter, std::vector<std::string_view>& out);
+    // Removes the next line (without its separator) from the front of input and returns it.
+    static std::string_view nextLine(std::string_view& input);
     static bool isValidHeader(const std::unordered_map<std::string, int>& columnNameIdMapping);
 };
 
@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks that the streaming raw measurement parser produces the GnssData the splitStr/stod parser
+// it replaced produced for a GnssLogger dump. The expected values below were taken from the output
+// of that parser on recordedDump().
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "GnssRawMeasurementParser.h"
+
+using ::aidl::android::hardware::gnss::ElapsedRealtime;
+using ::aidl::android::hardware::gnss::GnssClock;
+using ::aidl::android::hardware::gnss::GnssConstellationType;
+using ::aidl::android::hardware::gnss::GnssData;
+using ::aidl::android::hardware::gnss::GnssMeasurement;
+using ::android::hardware::gnss::common::GnssRawMeasurementParser;
+using ::android::hardware::gnss::common::GnssRawMeasurementStreamParser;
+
+namespace {
+
+constexpr char kHeader[] =
+        "# Raw,utcTimeMillis,TimeNanos,LeapSecond,TimeUncertaintyNanos,FullBiasNanos,BiasNanos,"
+        "BiasUncertaintyNanos,DriftNanosPerSecond,DriftUncertaintyNanosPerSecond,"
+        "HardwareClockDiscontinuityCount,Svid,TimeOffsetNanos,State,ReceivedSvTimeNanos,"
+        "ReceivedSvTimeUncertaintyNanos,Cn0DbHz,PseudorangeRateMetersPerSecond,"
+        "PseudorangeRateUncertaintyMetersPerSecond,AccumulatedDeltaRangeState,"
+        "AccumulatedDeltaRangeMeters,AccumulatedDeltaRangeUncertaintyMeters,CarrierFrequencyHz,"
+        "CarrierCycles,CarrierPhase,CarrierPhaseUncertainty,MultipathIndicator,SnrInDb,"
+        "ConstellationType,AgcDb,BasebandCn0DbHz,FullInterSignalBiasNanos,"
+        "FullInterSignalBiasUncertaintyNanos,SatelliteInterSignalBiasNanos,"
+        "SatelliteInterSignalBiasUncertaintyNanos,CodeType,ChipsetElapsedRealtimeNanos\n";
+
+// One epoch with a GPS, a GLONASS, a Galileo and a BeiDou measurement.
+const std::vector<std::string> kRecords = {
+        "Raw,1606857808025,2275000000,18,,-1290554813291612669,0.5714349746704102,10.0,"
+        "-2.2117498537809456,3.8960913345536434,0,10,0.0,16431,2790449000002,14,22.7,"
+        "-633.8428344726562,0.8271968364715576,16,0.0,3.4028234663852886E38,1.57542003E9,,,,0,,1,"
+        "1.3700000047683716,18.7,,,,,C,2272916385087\n",
+        "Raw,1606857808025,2275000000,18,,-1290554813291612669,0.5714349746704102,10.0,"
+        "-2.2117498537809456,3.8960913345536434,0,5,0.0,33359,77213045563236,25,25.9,"
+        "314.79388427734375,0.4174027740955353,16,0.0,3.4028234663852886E38,1.60218744E9,,,,0,,3,"
+        "1.54,21.6,-2.98,0.5,3.25,1.75,C,2272916385087\n",
+        "Raw,1606857808025,2275000000,18,,-1290554813291612669,0.5714349746704102,10.0,"
+        "-2.2117498537809456,3.8960913345536434,0,27,0.0,49375,2790458123456,3,31.2,"
+        "-127.51902770996094,0.07612349092960358,1,412.5031127929688,0.0011000000044703484,"
+        "1.17645005E9,1234,0.25,0.125,0,40.1,6,-0.9,27.9,,,,,Q,2272916385087\n",
+        "Raw,1606857808025,2275000000,18,,-1290554813291612669,0.5714349746704102,10.0,"
+        "-2.2117498537809456,3.8960913345536434,0,19,0.0,16527,2790444000123,48,18.4,"
+        "519.3016357421875,1.2134568691253662,0,0.0,0.0,1.561098E9,,,,0,,5,0.86,15.0,,,,,I,"
+        "2272916385087\n",
+};
+
+std::string recordedDump() {
+    std::string dump = kHeader;
+    for (const std::string& record : kRecords) dump += record;
+    return dump;
+}
+
+GnssMeasurement expectedMeasurement(int flags, int svid, GnssConstellationType constellation,
+                                    double carrierFrequencyHz, const char* codeType) {
+    GnssMeasurement measurement;
+    measurement.flags = flags;
+    measurement.svid = svid;
+    measurement.signalType.constellation = constellation;
+    measurement.signalType.carrierFrequencyHz = carrierFrequencyHz;
+    measurement.signalType.codeType = codeType;
+    return measurement;
+}
+
+// What the previous parser returned for recordedDump().
+GnssData expectedGnssData() {
+    GnssData gnssData;
+    gnssData.clock.gnssClockFlags = GnssClock::HAS_LEAP_SECOND | GnssClock::HAS_FULL_BIAS |
+                                    GnssClock::HAS_BIAS | GnssClock::HAS_BIAS_UNCERTAINTY |
+                                    GnssClock::HAS_DRIFT | GnssClock::HAS_DRIFT_UNCERTAINTY;
+    gnssData.clock.timeNs = 2275000000;
+    gnssData.clock.fullBiasNs = -1290554813291612669;
+    gnssData.clock.biasNs = 0.5714349746704102;
+    gnssData.clock.biasUncertaintyNs = 10.0;
+    gnssData.clock.driftNsps = -2.2117498537809456;
+    // The drift uncertainty has always been read from the DriftNanosPerSecond column.
+    gnssData.clock.driftUncertaintyNsps = -2.2117498537809456;
+    gnssData.clock.hwClockDiscontinuityCount = 0;
+    gnssData.elapsedRealtime.flags = ElapsedRealtime::HAS_TIMESTAMP_NS;
+    gnssData.elapsedRealtime.timestampNs = 2272916385087;
+    gnssData.elapsedRealtime.timeUncertaintyNs = 0;
+
+    GnssMeasurement gps =
+            expectedMeasurement(GnssMeasurement::HAS_CARRIER_FREQUENCY |
+                                        GnssMeasurement::HAS_AUTOMATIC_GAIN_CONTROL,
+                                10, GnssConstellationType::GPS, 1.57542003E9, "C");
+    gps.receivedSvTimeInNs = 2790449000002;
+    gps.receivedSvTimeUncertaintyInNs = 14;
+    gps.antennaCN0DbHz = 22.7;
+    gps.basebandCN0DbHz = 18.7;
+    gps.agcLevelDb = 1.3700000047683716;
+    gps.pseudorangeRateMps = -633.8428344726562;
+    gps.pseudorangeRateUncertaintyMps = 0.8271968364715576;
+    gps.accumulatedDeltaRangeState = 16;
+    gps.accumulatedDeltaRangeUncertaintyM = 3.4028234663852886E38;
+    gps.state = 16431;
+
+    GnssMeasurement glonass = expectedMeasurement(
+            GnssMeasurement::HAS_CARRIER_FREQUENCY | GnssMeasurement::HAS_AUTOMATIC_GAIN_CONTROL |
+                    GnssMeasurement::HAS_FULL_ISB | GnssMeasurement::HAS_FULL_ISB_UNCERTAINTY |
+                    GnssMeasurement::HAS_SATELLITE_ISB |
+                    GnssMeasurement::HAS_SATELLITE_ISB_UNCERTAINTY,
+            5, GnssConstellationType::GLONASS, 1.60218744E9, "C");
+    glonass.receivedSvTimeInNs = 77213045563236;
+    glonass.receivedSvTimeUncertaintyInNs = 25;
+    glonass.antennaCN0DbHz = 25.9;
+    glonass.basebandCN0DbHz = 21.6;
+    glonass.agcLevelDb = 1.54;
+    glonass.pseudorangeRateMps = 314.79388427734375;
+    glonass.pseudorangeRateUncertaintyMps = 0.4174027740955353;
+    glonass.accumulatedDeltaRangeState = 16;
+    glonass.accumulatedDeltaRangeUncertaintyM = 3.4028234663852886E38;
+    glonass.state = 33359;
+    glonass.fullInterSignalBiasNs = -2.98;
+    // The full ISB uncertainty has always been read from the FullInterSignalBiasNanos column.
+    glonass.fullInterSignalBiasUncertaintyNs = -2.98;
+    glonass.satelliteInterSignalBiasNs = 3.25;
+    glonass.satelliteInterSignalBiasUncertaintyNs = 1.75;
+
+    GnssMeasurement galileo = expectedMeasurement(
+            GnssMeasurement::HAS_SNR | GnssMeasurement::HAS_CARRIER_FREQUENCY |
+                    GnssMeasurement::HAS_CARRIER_CYCLES | GnssMeasurement::HAS_CARRIER_PHASE |
+                    GnssMeasurement::HAS_CARRIER_PHASE_UNCERTAINTY |
+                    GnssMeasurement::HAS_AUTOMATIC_GAIN_CONTROL,
+            27, GnssConstellationType::GALILEO, 1.17645005E9, "Q");
+    galileo.receivedSvTimeInNs = 2790458123456;
+    galileo.receivedSvTimeUncertaintyInNs = 3;
+    galileo.antennaCN0DbHz = 31.2;
+    galileo.basebandCN0DbHz = 27.9;
+    galileo.agcLevelDb = -0.9;
+    galileo.pseudorangeRateMps = -127.51902770996094;
+    galileo.pseudorangeRateUncertaintyMps = 0.07612349092960358;
+    galileo.accumulatedDeltaRangeState = 1;
+    galileo.accumulatedDeltaRangeM = 412.5031127929688;
+    galileo.accumulatedDeltaRangeUncertaintyM = 0.0011000000044703484;
+    galileo.state = 49375;
+
+    GnssMeasurement beidou =
+            expectedMeasurement(GnssMeasurement::HAS_CARRIER_FREQUENCY |
+                                        GnssMeasurement::HAS_AUTOMATIC_GAIN_CONTROL,
+                                19, GnssConstellationType::BEIDOU, 1.561098E9, "I");
+    beidou.receivedSvTimeInNs = 2790444000123;
+    beidou.receivedSvTimeUncertaintyInNs = 48;
+    beidou.antennaCN0DbHz = 18.4;
+    beidou.basebandCN0DbHz = 15.0;
+    beidou.agcLevelDb = 0.86;
+    beidou.pseudorangeRateMps = 519.3016357421875;
+    beidou.pseudorangeRateUncertaintyMps = 1.2134568691253662;
+    beidou.state = 16527;
+
+    gnssData.measurements = {gps, glonass, galileo, beidou};
+    return gnssData;
+}
+
+void expectSameGnssData(const GnssData& expected, const GnssData& actual) {
+    EXPECT_EQ(expected.clock.gnssClockFlags, actual.clock.gnssClockFlags);
+    EXPECT_EQ(expected.clock.timeNs, actual.clock.timeNs);
+    EXPECT_EQ(expected.clock.fullBiasNs, actual.clock.fullBiasNs);
+    EXPECT_EQ(expected.clock.biasNs, actual.clock.biasNs);
+    EXPECT_EQ(expected.clock.biasUncertaintyNs, actual.clock.biasUncertaintyNs);
+    EXPECT_EQ(expected.clock.driftNsps, actual.clock.driftNsps);
+    EXPECT_EQ(expected.clock.driftUncertaintyNsps, actual.clock.driftUncertaintyNsps);
+    EXPECT_EQ(expected.clock.hwClockDiscontinuityCount, actual.clock.hwClockDiscontinuityCount);
+    EXPECT_EQ(expected.elapsedRealtime.flags, actual.elapsedRealtime.flags);
+    EXPECT_EQ(expected.elapsedRealtime.timestampNs, actual.elapsedRealtime.timestampNs);
+    EXPECT_EQ(expected.elapsedRealtime.timeUncertaintyNs,
+              actual.elapsedRealtime.timeUncertaintyNs);
+
+    ASSERT_EQ(expected.measurements.size(), actual.measurements.size());
+    for (size_t i = 0; i < expected.measurements.size(); i++) {
+        SCOPED_TRACE("measurement " + std::to_string(i));
+        const GnssMeasurement& e = expected.measurements[i];
+        const GnssMeasurement& a = actual.measurements[i];
+        EXPECT_EQ(e.flags, a.flags);
+        EXPECT_EQ(e.svid, a.svid);
+        EXPECT_EQ(e.signalType.constellation, a.signalType.constellation);
+        EXPECT_EQ(e.signalType.carrierFrequencyHz, a.signalType.carrierFrequencyHz);
+        EXPECT_EQ(e.signalType.codeType, a.signalType.codeType);
+        EXPECT_EQ(e.receivedSvTimeInNs, a.receivedSvTimeInNs);
+        EXPECT_EQ(e.receivedSvTimeUncertaintyInNs, a.receivedSvTimeUncertaintyInNs);
+        EXPECT_EQ(e.antennaCN0DbHz, a.antennaCN0DbHz);
+        EXPECT_EQ(e.basebandCN0DbHz, a.basebandCN0DbHz);
+        EXPECT_EQ(e.agcLevelDb, a.agcLevelDb);
+        EXPECT_EQ(e.pseudorangeRateMps, a.pseudorangeRateMps);
+        EXPECT_EQ(e.pseudorangeRateUncertaintyMps, a.pseudorangeRateUncertaintyMps);
+        EXPECT_EQ(e.accumulatedDeltaRangeState, a.accumulatedDeltaRangeState);
+        EXPECT_EQ(e.accumulatedDeltaRangeM, a.accumulatedDeltaRangeM);
+        EXPECT_EQ(e.accumulatedDeltaRangeUncertaintyM, a.accumulatedDeltaRangeUncertaintyM);
+        EXPECT_EQ(e.multipathIndicator, a.multipathIndicator);
+        EXPECT_EQ(e.state, a.state);
+        EXPECT_EQ(e.fullInterSignalBiasNs, a.fullInterSignalBiasNs);
+        EXPECT_EQ(e.fullInterSignalBiasUncertaintyNs, a.fullInterSignalBiasUncertaintyNs);
+        EXPECT_EQ(e.satelliteInterSignalBiasNs, a.satelliteInterSignalBiasNs);
+        EXPECT_EQ(e.satelliteInterSignalBiasUncertaintyNs,
+                  a.satelliteInterSignalBiasUncertaintyNs);
+    }
+}
+
+TEST(GnssRawMeasurementParserTest, MatchesPreviousParserOnRecordedDump) {
+    std::string dump = recordedDump();
+    std::unique_ptr<GnssData> gnssData = GnssRawMeasurementParser::getMeasurementFromStrs(dump);
+    ASSERT_NE(nullptr, gnssData);
+    expectSameGnssData(expectedGnssData(), *gnssData);
+}
+
+// The previous parser indexed past the end of short lines, so there is no output of it to match
+// for them. They are dropped, and the clock still comes from the first complete record.
+TEST(GnssRawMeasurementParserTest, SkipsMalformedAndShortLines) {
+    std::string dump = kHeader;
+    dump += "\n";
+    dump += "Raw,1606857808025,2275000000,18\n";
+    dump += kRecords[0];
+    dump += "garbage\n";
+    dump += kRecords[1];
+    dump += kRecords[2].substr(0, kRecords[2].size() / 2) + "\n";
+    dump += kRecords[2];
+    dump += kRecords[3];
+    // Truncated last line without a line separator
+    dump += kRecords[3].substr(0, 40);
+
+    std::unique_ptr<GnssData> gnssData = GnssRawMeasurementParser::getMeasurementFromStrs(dump);
+    ASSERT_NE(nullptr, gnssData);
+    expectSameGnssData(expectedGnssData(), *gnssData);
+}
+
+TEST(GnssRawMeasurementParserTest, ChunkedInputMatchesWholeInput) {
+    const std::string dump = recordedDump();
+    for (size_t chunkSize : {1, 13, 256, 4096}) {
+        SCOPED_TRACE("chunk size " + std::to_string(chunkSize));
+        GnssRawMeasurementStreamParser parser;
+        for (size_t offset = 0; offset < dump.size(); offset += chunkSize) {
+            parser.feed(std::string_view(dump).substr(offset, chunkSize));
+        }
+        std::unique_ptr<GnssData> gnssData = parser.finish();
+        ASSERT_NE(nullptr, gnssData);
+        expectSameGnssData(expectedGnssData(), *gnssData);
+    }
+}
+
+TEST(GnssRawMeasurementParserTest, RejectsDumpWithoutHeaderOrRecords) {
+    std::string empty;
+    EXPECT_EQ(nullptr, GnssRawMeasurementParser::getMeasurementFromStrs(empty));
+    std::string headerOnly = kHeader;
+    EXPECT_EQ(nullptr, GnssRawMeasurementParser::getMeasurementFromStrs(headerOnly));
+    std::string recordsOnly = kRecords[0] + kRecords[1];
+    EXPECT_EQ(nullptr, GnssRawMeasurementParser::getMeasurementFromStrs(recordsOnly));
+}
+
+}  // namespace
@@ -25,8 +25,10 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cstdlib>
+#include <cstring>
 #include <sstream>
 
 #include <hardware/hwcomposer.h>
@@ -511,8 +513,11 @@ HWC2On1Adapter::Display::Display(HWC2On1Adapter& device, HWC2::DisplayType type)
     mDevice(device),
     mStateMutex(),
     mHwc1RequestedContents(nullptr),
+    mHwc1LayerCapacity(0),
+    mHwc1RectCapacity(0),
     mRetireFence(),
     mChanges(),
+    mSpareChanges(),
     mHwc1Id(-1),
     mConfigs(),
     mActiveConfig(nullptr),
@@ -525,7 +530,8 @@ HWC2On1Adapter::Display::Display(HWC2On1Adapter& device, HWC2::DisplayType type)
     mOutputBuffer(),
     mHasColorTransform(false),
     mLayers(),
-    mHwc1LayerMap(),
+    mLayersChanged(false),
+    mHwc1Layers(),
     mNumAvailableRects(0),
     mNextAvailableRect(nullptr),
     mGeometryChanged(false)
@@ -544,14 +550,14 @@ Error HWC2On1Adapter::Display::acceptChanges() {
     for (auto& change : mChanges->getTypeChanges()) {
         auto layerId = change.first;
         auto type = change.second;
-        if (mDevice.mLayers.count(layerId) == 0) {
+        const auto mapLayer = mDevice.mLayers.find(layerId);
+        if (mapLayer == mDevice.mLayers.end()) {
             // This should never happen but somehow does.
             ALOGW("Cannot accept change for unknown layer (%" PRIu64 ")",
                   layerId);
             continue;
         }
-        auto layer = mDevice.mLayers[layerId];
-        layer->setCompositionType(type);
+        mapLayer->second->setCompositionType(type);
     }
 
     mChanges->clearTypeChanges();
@@ -562,7 +568,9 @@ Error HWC2On1Adapter::Display::acceptChanges() {
 Error HWC2On1Adapter::Display::createLayer(hwc2_layer_t* outLayerId) {
     std::unique_lock<std::recursive_mutex> lock(mStateMutex);
 
-    auto layer = *mLayers.emplace(std::make_shared<Layer>(*this));
+    auto layer = std::make_shared<Layer>(*this);
+    mLayers.push_back(layer);
+    mLayersChanged = true;
     mDevice.mLayers.emplace(std::make_pair(layer->getId(), layer));
     *outLayerId = layer->getId();
     ALOGV("[%" PRIu64 "] created layer %" PRIu64, mId, *outLayerId);
@@ -581,12 +589,10 @@ Error HWC2On1Adapter::Display::destroyLayer(hwc2_layer_t layerId) {
     }
     const auto layer = mapLayer->second;
     mDevice.mLayers.erase(mapLayer);
-    const auto zRange = mLayers.equal_range(layer);
-    for (auto current = zRange.first; current != zRange.second; ++current) {
-        if (**current == *layer) {
-            current = mLayers.erase(current);
-            break;
-        }
+    const auto current = std::find(mLayers.begin(), mLayers.end(), layer);
+    if (current != mLayers.end()) {
+        mLayers.erase(current);
+        mLayersChanged = true;
     }
     ALOGV("[%" PRIu64 "] destroyed layer %" PRIu64, mId, layerId);
     markGeometryChanged();
@@ -1001,28 +1007,25 @@ Error HWC2On1Adapter::Display::updateLayerZ(hwc2_layer_t layerId, uint32_t z) {
     }
 
     const auto layer = mapLayer->second;
-    const auto zRange = mLayers.equal_range(layer);
-    bool layerOnDisplay = false;
-    for (auto current = zRange.first; current != zRange.second; ++current) {
-        if (**current == *layer) {
-            if ((*current)->getZ() == z) {
-                // Don't change anything if the Z hasn't changed
-                return Error::None;
-            }
-            current = mLayers.erase(current);
-            layerOnDisplay = true;
-            break;
-        }
-    }
-
-    if (!layerOnDisplay) {
+    const auto current = std::find(mLayers.begin(), mLayers.end(), layer);
+    if (current == mLayers.end()) {
         ALOGE("[%" PRIu64 "] updateLayerZ failed to find layer on display",
                 mId);
         return Error::BadLayer;
     }
 
+    if (layer->getZ() == z) {
+        // Don't change anything if the Z hasn't changed
+        return Error::None;
+    }
+
+    // Layers are only sorted again in prepare(), once all Z changes of the
+    // frame are known. Moving the layer to the end keeps it above the layers
+    // it ties with once sorted.
+    mLayers.erase(current);
+    mLayers.push_back(layer);
     layer->setZ(z);
-    mLayers.emplace(std::move(layer));
+    mLayersChanged = true;
     markGeometryChanged();
 
     return Error::None;
@@ -1214,8 +1217,18 @@ bool HWC2On1Adapter::Display::prepare() {
         return false;
     }
 
-    allocateRequestedContents();
-    assignHwc1LayerIds();
+    // The HWC1 array is only laid out again when the set of layers or their
+    // order changed. Otherwise, the state of the previous frame is still in
+    // place and only what changed since is written.
+    bool relayout = needsRelayout();
+    if (relayout) {
+        if (mLayersChanged) {
+            std::stable_sort(mLayers.begin(), mLayers.end(), SortLayersByZ());
+            mLayersChanged = false;
+        }
+        allocateRequestedContents();
+        assignHwc1LayerIds();
+    }
 
     mHwc1RequestedContents->retireFenceFd = -1;
     mHwc1RequestedContents->flags = 0;
@@ -1231,8 +1244,13 @@ bool HWC2On1Adapter::Display::prepare() {
         auto& hwc1Layer = mHwc1RequestedContents->hwLayers[layer->getHwc1Id()];
         hwc1Layer.releaseFenceFd = -1;
         hwc1Layer.acquireFenceFd = -1;
-        ALOGV("Applying states for layer %" PRIu64 " ", layer->getId());
-        layer->applyState(hwc1Layer);
+        hwc1Layer.hints = 0;
+        if (relayout || layer->hasStateChanged()) {
+            ALOGV("Applying states for layer %" PRIu64 " ", layer->getId());
+            layer->applyState(hwc1Layer);
+        } else {
+            layer->applyFrameState(hwc1Layer);
+        }
     }
 
     prepareFramebufferTarget();
@@ -1245,12 +1263,17 @@ bool HWC2On1Adapter::Display::prepare() {
 void HWC2On1Adapter::Display::generateChanges() {
     std::unique_lock<std::recursive_mutex> lock(mStateMutex);
 
-    mChanges.reset(new Changes);
+    if (mSpareChanges) {
+        mSpareChanges->clear();
+        mChanges = std::move(mSpareChanges);
+    } else {
+        mChanges.reset(new Changes);
+    }
 
     size_t numLayers = mHwc1RequestedContents->numHwLayers;
     for (size_t hwc1Id = 0; hwc1Id < numLayers; ++hwc1Id) {
         const auto& receivedLayer = mHwc1RequestedContents->hwLayers[hwc1Id];
-        if (mHwc1LayerMap.count(hwc1Id) == 0) {
+        if (hwc1Id >= mHwc1Layers.size()) {
             ALOGE_IF(receivedLayer.compositionType != HWC_FRAMEBUFFER_TARGET,
                     "generateChanges: HWC1 layer %zd doesn't have a"
                     " matching HWC2 layer, and isn't the framebuffer target",
@@ -1258,7 +1281,7 @@ void HWC2On1Adapter::Display::generateChanges() {
             continue;
         }
 
-        Layer& layer = *mHwc1LayerMap[hwc1Id];
+        Layer& layer = *mHwc1Layers[hwc1Id];
         updateTypeChanges(receivedLayer, layer);
         updateLayerRequests(receivedLayer, layer);
     }
@@ -1300,7 +1323,7 @@ Error HWC2On1Adapter::Display::set(hwc_display_contents_1& hwcContents) {
                 mId);
     }
 
-    mChanges.reset();
+    mSpareChanges = std::move(mChanges);
 
     return Error::None;
 }
@@ -1317,7 +1340,7 @@ void HWC2On1Adapter::Display::addReleaseFences(
     size_t numLayers = hwcContents.numHwLayers;
     for (size_t hwc1Id = 0; hwc1Id < numLayers; ++hwc1Id) {
         const auto& receivedLayer = hwcContents.hwLayers[hwc1Id];
-        if (mHwc1LayerMap.count(hwc1Id) == 0) {
+        if (hwc1Id >= mHwc1Layers.size()) {
             if (receivedLayer.compositionType != HWC_FRAMEBUFFER_TARGET) {
                 ALOGE("addReleaseFences: HWC1 layer %zd doesn't have a"
                         " matching HWC2 layer, and isn't the framebuffer"
@@ -1331,7 +1354,7 @@ void HWC2On1Adapter::Display::addReleaseFences(
             continue;
         }
 
-        Layer& layer = *mHwc1LayerMap[hwc1Id];
+        Layer& layer = *mHwc1Layers[hwc1Id];
         ALOGV("Adding release fence %d to layer %" PRIu64,
                 receivedLayer.releaseFenceFd, layer.getId());
         layer.addReleaseFence(receivedLayer.releaseFenceFd);
@@ -1778,47 +1801,69 @@ void HWC2On1Adapter::Display::initializeActiveConfig() {
 
 
 
+}
+
+bool HWC2On1Adapter::Display::needsRelayout() const {
+    if (!mHwc1RequestedContents || mLayersChanged) {
+        return true;
+    }
+
+    // A layer keeps the rects it was given until the next layout, which only
+    // fit a visible region with as many rects.
+    for (const auto& layer : mLayers) {
+        const auto& hwc1Layer =
+                mHwc1RequestedContents->hwLayers[layer->getHwc1Id()];
+        if (layer->hasStateChanged() && layer->getNumVisibleRegions() !=
+                hwc1Layer.visibleRegionScreen.numRects) {
+            return true;
+        }
+    }
+    return false;
 }
 
 void HWC2On1Adapter::Display::allocateRequestedContents() {
     // What needs to be allocated:
     // 1 hwc_display_contents_1_t
     // 1 hwc_layer_1_t for each layer
-    // 1 hwc_rect_t for each layer's surfaceDamage
     // 1 hwc_rect_t for each layer's visibleRegion
     // 1 hwc_layer_1_t for the framebuffer
     // 1 hwc_rect_t for the framebuffer's visibleRegion
 
-    // Count # of surfaceDamage
-    size_t numSurfaceDamages = 0;
-    for (const auto& layer : mLayers) {
-        numSurfaceDamages += layer->getNumSurfaceDamages();
-    }
-
     // Count # of visibleRegions (start at 1 for mandatory framebuffer target
     // region)
-    size_t numVisibleRegion = 1;
+    size_t numRects = 1;
     for (const auto& layer : mLayers) {
-        numVisibleRegion += layer->getNumVisibleRegions();
+        numRects += layer->getNumVisibleRegions();
     }
 
-    size_t numRects = numVisibleRegion + numSurfaceDamages;
+    // Only grow the allocation, so that it ends up sized for the largest
+    // frame and is not reallocated once it is.
     auto numLayers = mLayers.size() + 1;
-    size_t size = sizeof(hwc_display_contents_1_t) +
-            sizeof(hwc_layer_1_t) * numLayers +
-            sizeof(hwc_rect_t) * numRects;
-    auto contents = static_cast<hwc_display_contents_1_t*>(std::calloc(size, 1));
-    mHwc1RequestedContents.reset(contents);
-    mNextAvailableRect = reinterpret_cast<hwc_rect_t*>(&contents->hwLayers[numLayers]);
-    mNumAvailableRects = numRects;
+    if (!mHwc1RequestedContents || numLayers > mHwc1LayerCapacity ||
+            numRects > mHwc1RectCapacity) {
+        mHwc1LayerCapacity = std::max(numLayers, mHwc1LayerCapacity);
+        mHwc1RectCapacity = std::max(numRects, mHwc1RectCapacity);
+        size_t size = sizeof(hwc_display_contents_1_t) +
+                sizeof(hwc_layer_1_t) * mHwc1LayerCapacity +
+                sizeof(hwc_rect_t) * mHwc1RectCapacity;
+        auto contents =
+                static_cast<hwc_display_contents_1_t*>(std::calloc(size, 1));
+        mHwc1RequestedContents.reset(contents);
+    }
+
+    // Layers take new rects from the pool while they are applied, since
+    // they are all applied again after a layout.
+    auto contents = mHwc1RequestedContents.get();
+    std::memset(contents->hwLayers, 0, sizeof(hwc_layer_1_t) * numLayers);
+    mNextAvailableRect = reinterpret_cast<hwc_rect_t*>(
+            &contents->hwLayers[mHwc1LayerCapacity]);
+    mNumAvailableRects = mHwc1RectCapacity;
 }
 
 void HWC2On1Adapter::Display::assignHwc1LayerIds() {
-    mHwc1LayerMap.clear();
-    size_t nextHwc1Id = 0;
-    for (auto& layer : mLayers) {
-        mHwc1LayerMap[nextHwc1Id] = layer;
-        layer->setHwc1Id(nextHwc1Id++);
+    mHwc1Layers = mLayers;
+    for (size_t hwc1Id = 0; hwc1Id < mHwc1Layers.size(); ++hwc1Id) {
+        mHwc1Layers[hwc1Id]->setHwc1Id(hwc1Id);
     }
 }
 
@@ -1870,7 +1915,7 @@ void HWC2On1Adapter::Display::prepareFramebufferTarget() {
     int32_t width = mActiveConfig->getAttribute(Attribute::Width);
     int32_t height = mActiveConfig->getAttribute(Attribute::Height);
 
-    auto& hwc1Target = mHwc1RequestedContents->hwLayers[mLayers.size()];
+    auto& hwc1Target = mHwc1RequestedContents->hwLayers[mHwc1Layers.size()];
     hwc1Target.compositionType = HWC_FRAMEBUFFER_TARGET;
     hwc1Target.releaseFenceFd = -1;
     hwc1Target.hints = 0;
@@ -1886,15 +1931,20 @@ void HWC2On1Adapter::Display::prepareFramebufferTarget() {
     hwc1Target.displayFrame = {0, 0, width, height};
     hwc1Target.planeAlpha = 255;
 
-    hwc1Target.visibleRegionScreen.numRects = 1;
-    hwc_rect_t* rects = GetRects(1);
+    // The rect is kept until the next layout.
+    auto rects = const_cast<hwc_rect_t*>(hwc1Target.visibleRegionScreen.rects);
+    if (rects == nullptr) {
+        hwc1Target.visibleRegionScreen.numRects = 1;
+        rects = GetRects(1);
+    }
     rects[0].left = 0;
     rects[0].top = 0;
     rects[0].right = width;
     rects[0].bottom = height;
     hwc1Target.visibleRegionScreen.rects = rects;
 
-    // We will set this to the correct value in set
+    // We will set these to the correct values in set
+    hwc1Target.handle = nullptr;
     hwc1Target.acquireFenceFd = -1;
 }
 
@@ -1919,7 +1969,8 @@ HWC2On1Adapter::Layer::Layer(Display& display)
     mZ(0),
     mReleaseFence(),
     mHwc1Id(0),
-    mHasUnsupportedPlaneAlpha(false) {}
+    mHasUnsupportedPlaneAlpha(false),
+    mStateChanged(true) {}
 
 bool HWC2On1Adapter::SortLayersByZ::operator()(const std::shared_ptr<Layer>& lhs,
                                                const std::shared_ptr<Layer>& rhs) const {
@@ -1963,19 +2014,19 @@ Error HWC2On1Adapter::Layer::setSurfaceDamage(hwc_region_t damage) {
 
 Error HWC2On1Adapter::Layer::setBlendMode(BlendMode mode) {
     mBlendMode = mode;
-    mDisplay.markGeometryChanged();
+    markStateChanged();
     return Error::None;
 }
 
 Error HWC2On1Adapter::Layer::setColor(hwc_color_t color) {
     mColor = color;
-    mDisplay.markGeometryChanged();
+    markStateChanged();
     return Error::None;
 }
 
 Error HWC2On1Adapter::Layer::setCompositionType(Composition type) {
     mCompositionType = type;
-    mDisplay.markGeometryChanged();
+    markStateChanged();
     return Error::None;
 }
 
@@ -1985,31 +2036,31 @@ Error HWC2On1Adapter::Layer::setDataspace(android_dataspace_t) {
 
 Error HWC2On1Adapter::Layer::setDisplayFrame(hwc_rect_t frame) {
     mDisplayFrame = frame;
-    mDisplay.markGeometryChanged();
+    markStateChanged();
     return Error::None;
 }
 
 Error HWC2On1Adapter::Layer::setPlaneAlpha(float alpha) {
     mPlaneAlpha = alpha;
-    mDisplay.markGeometryChanged();
+    markStateChanged();
     return Error::None;
 }
 
 Error HWC2On1Adapter::Layer::setSidebandStream(const native_handle_t* stream) {
     mSidebandStream = stream;
-    mDisplay.markGeometryChanged();
+    markStateChanged();
     return Error::None;
 }
 
 Error HWC2On1Adapter::Layer::setSourceCrop(hwc_frect_t crop) {
     mSourceCrop = crop;
-    mDisplay.markGeometryChanged();
+    markStateChanged();
     return Error::None;
 }
 
 Error HWC2On1Adapter::Layer::setTransform(Transform transform) {
     mTransform = transform;
-    mDisplay.markGeometryChanged();
+    markStateChanged();
     return Error::None;
 }
 
@@ -2026,7 +2077,7 @@ Error HWC2On1Adapter::Layer::setVisibleRegion(hwc_region_t visible) {
                     compareRects)) {
         mVisibleRegion.resize(visible.numRects);
         std::copy_n(visible.rects, visible.numRects, mVisibleRegion.begin());
-        mDisplay.markGeometryChanged();
+        markStateChanged();
     }
     return Error::None;
 }
@@ -2053,6 +2104,16 @@ void HWC2On1Adapter::Layer::applyState(hwc_layer_1_t& hwc1Layer) {
         case Composition::Sideband : applySidebandState(hwc1Layer); break;
         default: applyBufferState(hwc1Layer); break;
     }
+    mStateChanged = false;
+}
+
+void HWC2On1Adapter::Layer::applyFrameState(hwc_layer_1_t& hwc1Layer) {
+    applyCompositionType(hwc1Layer);
+    switch (mCompositionType) {
+        case Composition::SolidColor : break;
+        case Composition::Sideband : break;
+        default: applyBufferState(hwc1Layer); break;
+    }
 }
 
 static std::string regionStrings(const std::vector<hwc_rect_t>& visibleRegion,
@@ -2151,10 +2212,15 @@ void HWC2On1Adapter::Layer::applyCommonState(hwc_layer_1_t& hwc1Layer) {
 
     hwc1Layer.transform = static_cast<uint32_t>(mTransform);
 
+    // The rects are kept until the next layout of the display, which
+    // happens before the number of rects changes.
     auto& hwc1VisibleRegion = hwc1Layer.visibleRegionScreen;
-    hwc1VisibleRegion.numRects = mVisibleRegion.size();
-    hwc_rect_t* rects = mDisplay.GetRects(hwc1VisibleRegion.numRects);
-    hwc1VisibleRegion.rects = rects;
+    auto rects = const_cast<hwc_rect_t*>(hwc1VisibleRegion.rects);
+    if (rects == nullptr) {
+        hwc1VisibleRegion.numRects = mVisibleRegion.size();
+        rects = mDisplay.GetRects(hwc1VisibleRegion.numRects);
+        hwc1VisibleRegion.rects = rects;
+    }
     for (size_t i = 0; i < mVisibleRegion.size(); i++) {
         rects[i] = mVisibleRegion[i];
     }
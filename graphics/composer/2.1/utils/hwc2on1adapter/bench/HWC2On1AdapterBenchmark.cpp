@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Time of one frame sent by a SurfaceFlinger-like client through
+// HWC2On1Adapter to a fake HWC1 device: a new buffer on every layer, then
+// validate, present and release fences. The fake device puts the first few
+// layers on overlays and does nothing else, so only the adapter is measured.
+//
+// BM_BufferOnlyFrame only changes buffers, as most frames do.
+// BM_GeometryFrame also moves one layer, and BM_ReorderFrame swaps the Z of
+// two layers.
+
+#include <hwc2on1adapter/HWC2On1Adapter.h>
+
+#include <hardware/hwcomposer.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+using ::android::HWC2On1Adapter;
+using ::benchmark::State;
+
+namespace {
+
+constexpr int32_t kWidth = 1080;
+constexpr int32_t kHeight = 1920;
+constexpr size_t kNumOverlays = 4;
+
+class FakeHwc1Device : public hwc_composer_device_1_t {
+  public:
+    FakeHwc1Device() : hwc_composer_device_1_t() {
+        common.tag = HARDWARE_DEVICE_TAG;
+        common.version = HWC_DEVICE_API_VERSION_1_5;
+        common.close = closeHook;
+        prepare = prepareHook;
+        set = setHook;
+        eventControl = eventControlHook;
+        setPowerMode = setPowerModeHook;
+        query = queryHook;
+        registerProcs = registerProcsHook;
+        getDisplayConfigs = getDisplayConfigsHook;
+        getDisplayAttributes = getDisplayAttributesHook;
+        getActiveConfig = getActiveConfigHook;
+        setActiveConfig = setActiveConfigHook;
+    }
+
+  private:
+    static int closeHook(hw_device_t*) { return 0; }
+
+    static int prepareHook(hwc_composer_device_1*, size_t numDisplays,
+                           hwc_display_contents_1_t** displays) {
+        for (size_t d = 0; d < numDisplays; ++d) {
+            if (displays[d] == nullptr) continue;
+            size_t numOverlays = 0;
+            for (size_t l = 0; l < displays[d]->numHwLayers; ++l) {
+                auto& layer = displays[d]->hwLayers[l];
+                if (layer.compositionType == HWC_FRAMEBUFFER &&
+                    (layer.flags & HWC_SKIP_LAYER) == 0 && numOverlays < kNumOverlays) {
+                    layer.compositionType = HWC_OVERLAY;
+                    ++numOverlays;
+                }
+            }
+        }
+        return 0;
+    }
+
+    static int setHook(hwc_composer_device_1*, size_t numDisplays,
+                       hwc_display_contents_1_t** displays) {
+        for (size_t d = 0; d < numDisplays; ++d) {
+            if (displays[d] == nullptr) continue;
+            for (size_t l = 0; l < displays[d]->numHwLayers; ++l) {
+                auto& layer = displays[d]->hwLayers[l];
+                if (layer.acquireFenceFd != -1) close(layer.acquireFenceFd);
+                layer.releaseFenceFd = -1;
+            }
+            displays[d]->retireFenceFd = -1;
+        }
+        return 0;
+    }
+
+    static int eventControlHook(hwc_composer_device_1*, int, int, int) { return 0; }
+    static int setPowerModeHook(hwc_composer_device_1*, int, int) { return 0; }
+    static int queryHook(hwc_composer_device_1*, int, int* value) {
+        *value = 0;
+        return 0;
+    }
+    static void registerProcsHook(hwc_composer_device_1*, hwc_procs_t const*) {}
+
+    static int getDisplayConfigsHook(hwc_composer_device_1*, int, uint32_t* configs,
+                                     size_t* numConfigs) {
+        configs[0] = 0;
+        *numConfigs = 1;
+        return 0;
+    }
+
+    static int getDisplayAttributesHook(hwc_composer_device_1*, int, uint32_t,
+                                        const uint32_t* attributes, int32_t* values) {
+        for (size_t i = 0; attributes[i] != HWC_DISPLAY_NO_ATTRIBUTE; ++i) {
+            switch (attributes[i]) {
+                case HWC_DISPLAY_VSYNC_PERIOD: values[i] = 16666666; break;
+                case HWC_DISPLAY_WIDTH: values[i] = kWidth; break;
+                case HWC_DISPLAY_HEIGHT: values[i] = kHeight; break;
+                case HWC_DISPLAY_DPI_X: values[i] = 420000; break;
+                case HWC_DISPLAY_DPI_Y: values[i] = 420000; break;
+                default: values[i] = 0; break;
+            }
+        }
+        return 0;
+    }
+
+    static int getActiveConfigHook(hwc_composer_device_1*, int) { return 0; }
+    static int setActiveConfigHook(hwc_composer_device_1*, int, int) { return 0; }
+};
+
+// A primary display with numLayers full width layers stacked vertically,
+// driven through the HWC2 function pointers like SurfaceFlinger does.
+class Composer {
+  public:
+    explicit Composer(size_t numLayers)
+        : mHwc1Device(), mAdapter(std::make_unique<HWC2On1Adapter>(&mHwc1Device)) {
+        auto registerCallback = get<HWC2_PFN_REGISTER_CALLBACK>(
+                HWC2::FunctionDescriptor::RegisterCallback);
+        registerCallback(mAdapter.get(), HWC2_CALLBACK_HOTPLUG, this,
+                         reinterpret_cast<hwc2_function_pointer_t>(hotplugHook));
+        get<HWC2_PFN_SET_POWER_MODE>(HWC2::FunctionDescriptor::SetPowerMode)(
+                mAdapter.get(), mDisplay, HWC2_POWER_MODE_ON);
+
+        mSetLayerBuffer = get<HWC2_PFN_SET_LAYER_BUFFER>(HWC2::FunctionDescriptor::SetLayerBuffer);
+        mSetLayerDisplayFrame =
+                get<HWC2_PFN_SET_LAYER_DISPLAY_FRAME>(HWC2::FunctionDescriptor::SetLayerDisplayFrame);
+        mSetLayerZOrder = get<HWC2_PFN_SET_LAYER_Z_ORDER>(HWC2::FunctionDescriptor::SetLayerZOrder);
+        mValidateDisplay = get<HWC2_PFN_VALIDATE_DISPLAY>(HWC2::FunctionDescriptor::ValidateDisplay);
+        mAcceptDisplayChanges =
+                get<HWC2_PFN_ACCEPT_DISPLAY_CHANGES>(HWC2::FunctionDescriptor::AcceptDisplayChanges);
+        mSetClientTarget = get<HWC2_PFN_SET_CLIENT_TARGET>(HWC2::FunctionDescriptor::SetClientTarget);
+        mPresentDisplay = get<HWC2_PFN_PRESENT_DISPLAY>(HWC2::FunctionDescriptor::PresentDisplay);
+        mGetReleaseFences =
+                get<HWC2_PFN_GET_RELEASE_FENCES>(HWC2::FunctionDescriptor::GetReleaseFences);
+
+        auto createLayer = get<HWC2_PFN_CREATE_LAYER>(HWC2::FunctionDescriptor::CreateLayer);
+        auto setCompositionType = get<HWC2_PFN_SET_LAYER_COMPOSITION_TYPE>(
+                HWC2::FunctionDescriptor::SetLayerCompositionType);
+        auto setBlendMode =
+                get<HWC2_PFN_SET_LAYER_BLEND_MODE>(HWC2::FunctionDescriptor::SetLayerBlendMode);
+        auto setPlaneAlpha =
+                get<HWC2_PFN_SET_LAYER_PLANE_ALPHA>(HWC2::FunctionDescriptor::SetLayerPlaneAlpha);
+        auto setSourceCrop =
+                get<HWC2_PFN_SET_LAYER_SOURCE_CROP>(HWC2::FunctionDescriptor::SetLayerSourceCrop);
+        auto setVisibleRegion = get<HWC2_PFN_SET_LAYER_VISIBLE_REGION>(
+                HWC2::FunctionDescriptor::SetLayerVisibleRegion);
+
+        const int32_t layerHeight = kHeight / static_cast<int32_t>(numLayers);
+        mLayers.resize(numLayers);
+        for (size_t i = 0; i < numLayers; ++i) {
+            hwc2_layer_t layer;
+            createLayer(mAdapter.get(), mDisplay, &layer);
+            mLayers[i] = layer;
+            const int32_t top = layerHeight * static_cast<int32_t>(i);
+            const hwc_rect_t frame = {0, top, kWidth, top + layerHeight};
+            hwc_region_t visible = {1, &frame};
+            setCompositionType(mAdapter.get(), mDisplay, layer, HWC2_COMPOSITION_DEVICE);
+            setBlendMode(mAdapter.get(), mDisplay, layer, HWC2_BLEND_MODE_PREMULTIPLIED);
+            setPlaneAlpha(mAdapter.get(), mDisplay, layer, 1.0f);
+            setSourceCrop(mAdapter.get(), mDisplay, layer,
+                          {0.0f, 0.0f, static_cast<float>(kWidth),
+                           static_cast<float>(layerHeight)});
+            mSetLayerDisplayFrame(mAdapter.get(), mDisplay, layer, frame);
+            setVisibleRegion(mAdapter.get(), mDisplay, layer, visible);
+            mSetLayerZOrder(mAdapter.get(), mDisplay, layer, static_cast<uint32_t>(i));
+        }
+        mReleasedLayers.resize(numLayers);
+        mReleaseFences.resize(numLayers);
+    }
+
+    size_t getNumLayers() const { return mLayers.size(); }
+
+    void setDisplayFrame(size_t index, hwc_rect_t frame) {
+        mSetLayerDisplayFrame(mAdapter.get(), mDisplay, mLayers[index], frame);
+    }
+
+    void setZ(size_t index, uint32_t z) {
+        mSetLayerZOrder(mAdapter.get(), mDisplay, mLayers[index], z);
+    }
+
+    void frame() {
+        ++mFrameNumber;
+        for (auto layer : mLayers) {
+            mSetLayerBuffer(mAdapter.get(), mDisplay, layer, bufferFor(layer), -1);
+        }
+
+        uint32_t numTypes = 0;
+        uint32_t numRequests = 0;
+        mValidateDisplay(mAdapter.get(), mDisplay, &numTypes, &numRequests);
+        if (numTypes > 0) {
+            mAcceptDisplayChanges(mAdapter.get(), mDisplay);
+        }
+        mSetClientTarget(mAdapter.get(), mDisplay, bufferFor(0), -1, HAL_DATASPACE_UNKNOWN,
+                         {0, nullptr});
+
+        int32_t presentFence = -1;
+        mPresentDisplay(mAdapter.get(), mDisplay, &presentFence);
+        uint32_t numFences = static_cast<uint32_t>(mReleaseFences.size());
+        mGetReleaseFences(mAdapter.get(), mDisplay, &numFences, mReleasedLayers.data(),
+                          mReleaseFences.data());
+        benchmark::DoNotOptimize(presentFence);
+    }
+
+  private:
+    template <typename PFN>
+    PFN get(HWC2::FunctionDescriptor descriptor) {
+        return reinterpret_cast<PFN>(
+                mAdapter->getFunction(mAdapter.get(), static_cast<int32_t>(descriptor)));
+    }
+
+    static void hotplugHook(hwc2_callback_data_t data, hwc2_display_t display, int32_t) {
+        static_cast<Composer*>(data)->mDisplay = display;
+    }
+
+    // Distinct handles which are never dereferenced, by the adapter nor the
+    // fake device.
+    buffer_handle_t bufferFor(hwc2_layer_t layer) const {
+        return reinterpret_cast<buffer_handle_t>(((mFrameNumber % 3) << 16) + layer + 1);
+    }
+
+    FakeHwc1Device mHwc1Device;
+    std::unique_ptr<HWC2On1Adapter> mAdapter;
+    hwc2_display_t mDisplay = 0;
+    std::vector<hwc2_layer_t> mLayers;
+    std::vector<hwc2_layer_t> mReleasedLayers;
+    std::vector<int32_t> mReleaseFences;
+    uintptr_t mFrameNumber = 0;
+
+    HWC2_PFN_SET_LAYER_BUFFER mSetLayerBuffer;
+    HWC2_PFN_SET_LAYER_DISPLAY_FRAME mSetLayerDisplayFrame;
+    HWC2_PFN_SET_LAYER_Z_ORDER mSetLayerZOrder;
+    HWC2_PFN_VALIDATE_DISPLAY mValidateDisplay;
+    HWC2_PFN_ACCEPT_DISPLAY_CHANGES mAcceptDisplayChanges;
+    HWC2_PFN_SET_CLIENT_TARGET mSetClientTarget;
+    HWC2_PFN_PRESENT_DISPLAY mPresentDisplay;
+    HWC2_PFN_GET_RELEASE_FENCES mGetReleaseFences;
+};
+
+void BM_BufferOnlyFrame(State& state) {
+    Composer composer(state.range(0));
+    for (auto _ : state) {
+        composer.frame();
+    }
+}
+BENCHMARK(BM_BufferOnlyFrame)->Arg(4)->Arg(16)->Arg(64);
+
+void BM_GeometryFrame(State& state) {
+    Composer composer(state.range(0));
+    int32_t offset = 0;
+    for (auto _ : state) {
+        offset = (offset + 1) % 64;
+        composer.setDisplayFrame(0, {offset, 0, offset + kWidth / 2, kHeight / 2});
+        composer.frame();
+    }
+}
+BENCHMARK(BM_GeometryFrame)->Arg(4)->Arg(16)->Arg(64);
+
+void BM_ReorderFrame(State& state) {
+    Composer composer(state.range(0));
+    const size_t top = composer.getNumLayers() - 1;
+    bool swapped = false;
+    for (auto _ : state) {
+        swapped = !swapped;
+        composer.setZ(top - 1, swapped ? top : top - 1);
+        composer.setZ(top, swapped ? top - 1 : top);
+        composer.frame();
+    }
+}
+BENCHMARK(BM_ReorderFrame)->Arg(4)->Arg(16)->Arg(64);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -358,6 +358,11 @@ private:
                         mLayerRequests.insert({layerId, request});
                     }
 
+                    void clear() {
+                        mTypeChanges.clear();
+                        mLayerRequests.clear();
+                    }
+
                 private:
                     std::unordered_map<hwc2_layer_t, HWC2::Composition>
                             mTypeChanges;
@@ -373,9 +378,14 @@ private:
 
             // Creates a bi-directional mapping between index in HWC1
             // prepare/set array and Layer object. Stores mapping in
-            // mHwc1LayerMap and also updates Layer's attribute mHwc1Id.
+            // mHwc1Layers and also updates Layer's attribute mHwc1Id.
             void assignHwc1LayerIds();
 
+            // Whether the HWC1 array must be laid out again before prepare():
+            // layers were added, removed or reordered, or a layer's visible
+            // region no longer fits the rects it was given.
+            bool needsRelayout() const;
+
             // Called after a response to prepare() has been received:
             // Ingest composition type changes requested by the device.
             void updateTypeChanges(const struct hwc_layer_1& hwc1Layer,
@@ -408,14 +418,21 @@ private:
             // which require locking.
             mutable std::recursive_mutex mStateMutex;
 
-            // Allocate RAM able to store all layers and rects used for
-            // communication with HWC1. Place allocated RAM in variable
-            // mHwc1RequestedContents.
+            // Make sure mHwc1RequestedContents is able to store all layers
+            // and rects used for communication with HWC1, growing it if
+            // needed, and clear it for a new layout.
             void allocateRequestedContents();
 
             // Array of structs exchanged between client and hwc1 device.
-            // Sent to device upon calling prepare().
+            // Sent to device upon calling prepare(). It is kept from frame to
+            // frame, so that layers whose state did not change since the
+            // last prepare() are not written again.
             std::unique_ptr<hwc_display_contents_1> mHwc1RequestedContents;
+
+            // Number of hwc_layer_1_t and hwc_rect_t that fit in
+            // mHwc1RequestedContents.
+            size_t mHwc1LayerCapacity;
+            size_t mHwc1RectCapacity;
     private:
             DeferredFence mRetireFence;
 
@@ -423,6 +440,10 @@ private:
             // before it has been presented
             std::unique_ptr<Changes> mChanges;
 
+            // The Changes of the last presented frame, reused by the next
+            // validate().
+            std::unique_ptr<Changes> mSpareChanges;
+
             int32_t mHwc1Id;
 
             std::vector<std::shared_ptr<Config>> mConfigs;
@@ -442,12 +463,17 @@ private:
 
             bool mHasColorTransform;
 
-            // All layers this Display is aware of.
-            std::multiset<std::shared_ptr<Layer>, SortLayersByZ> mLayers;
+            // All layers this Display is aware of, sorted by Z unless
+            // mLayersChanged is set.
+            std::vector<std::shared_ptr<Layer>> mLayers;
+
+            // True if layers were added, removed or had their Z changed since
+            // the last layout of the HWC1 array.
+            bool mLayersChanged;
 
             // Mapping between layer index in array of hwc_display_contents_1*
             // passed to HWC1 during validate/set and Layer object.
-            std::unordered_map<size_t, std::shared_ptr<Layer>> mHwc1LayerMap;
+            std::vector<std::shared_ptr<Layer>> mHwc1Layers;
 
             // All communication with HWC1 via prepare/set is done with one
             // alloc. This pointer is pointing to a pool of hwc_rect_t.
@@ -563,6 +589,14 @@ private:
             // Write state to HWC1 communication struct.
             void applyState(struct hwc_layer_1& hwc1Layer);
 
+            // Write only the state which must be sent on every frame, for
+            // layers whose other state is still in the HWC1 struct.
+            void applyFrameState(struct hwc_layer_1& hwc1Layer);
+
+            // True if state other than the buffer changed since the last call
+            // to applyState().
+            bool hasStateChanged() const { return mStateChanged; }
+
             std::string dump() const;
 
             std::size_t getNumVisibleRegions() { return mVisibleRegion.size(); }
@@ -576,6 +610,11 @@ private:
                         !mDisplay.getDevice().supportsBackgroundColor());
             }
         private:
+            void markStateChanged() {
+                mStateChanged = true;
+                mDisplay.markGeometryChanged();
+            }
+
             void applyCommonState(struct hwc_layer_1& hwc1Layer);
             void applySolidColorState(struct hwc_layer_1& hwc1Layer);
             void applySidebandState(struct hwc_layer_1& hwc1Layer);
@@ -605,6 +644,7 @@ private:
 
             size_t mHwc1Id;
             bool mHasUnsupportedPlaneAlpha;
+            bool mStateChanged;
     };
 
     // Utility tempate calling a Layer object method based on ID parameters:
@@ -700,7 +740,7 @@ private:
     // These are only accessed from the main SurfaceFlinger thread (not from
     // callbacks or dump
 
-    std::map<hwc2_layer_t, std::shared_ptr<Layer>> mLayers;
+    std::unordered_map<hwc2_layer_t, std::shared_ptr<Layer>> mLayers;
 
     // A HWC1 supports only one virtual display.
     std::shared_ptr<Display> mHwc1VirtualDisplay;
@@ -152,35 +152,9 @@ bool eicOpsEncryptAes128Gcm(
         size_t dataSize,
         const uint8_t* additionalAuthenticationData,  // May be NULL if size is 0
         size_t additionalAuthenticationDataSize, uint8_t* encryptedData) {
-    vector<uint8_t> cppKey;
-    cppKey.resize(16);
-    memcpy(cppKey.data(), key, 16);
-
-    vector<uint8_t> cppData;
-    cppData.resize(dataSize);
-    if (dataSize > 0) {
-        memcpy(cppData.data(), data, dataSize);
-    }
-
-    vector<uint8_t> cppAAD;
-    cppAAD.resize(additionalAuthenticationDataSize);
-    if (additionalAuthenticationDataSize > 0) {
-        memcpy(cppAAD.data(), additionalAuthenticationData, additionalAuthenticationDataSize);
-    }
-
-    vector<uint8_t> cppNonce;
-    cppNonce.resize(12);
-    memcpy(cppNonce.data(), nonce, 12);
-
-    optional<vector<uint8_t>> cppEncryptedData =
-            android::hardware::identity::support::encryptAes128Gcm(cppKey, cppNonce, cppData,
-                                                                   cppAAD);
-    if (!cppEncryptedData.has_value()) {
-        return false;
-    }
-
-    memcpy(encryptedData, cppEncryptedData.value().data(), cppEncryptedData.value().size());
-    return true;
+    return android::hardware::identity::support::encryptAes128Gcm(
+            key, nonce, data, dataSize, additionalAuthenticationData,
+            additionalAuthenticationDataSize, encryptedData);
 }
 
 // Decrypts |encryptedData| using |key| and |additionalAuthenticatedData|,
@@ -192,38 +166,12 @@ bool eicOpsDecryptAes128Gcm(const uint8_t* key,  // Must be 16 bytes
                             const uint8_t* encryptedData, size_t encryptedDataSize,
                             const uint8_t* additionalAuthenticationData,
                             size_t additionalAuthenticationDataSize, uint8_t* data) {
-    vector<uint8_t> keyVec;
-    keyVec.resize(16);
-    memcpy(keyVec.data(), key, 16);
-
-    vector<uint8_t> encryptedDataVec;
-    encryptedDataVec.resize(encryptedDataSize);
-    if (encryptedDataSize > 0) {
-        memcpy(encryptedDataVec.data(), encryptedData, encryptedDataSize);
-    }
-
-    vector<uint8_t> aadVec;
-    aadVec.resize(additionalAuthenticationDataSize);
-    if (additionalAuthenticationDataSize > 0) {
-        memcpy(aadVec.data(), additionalAuthenticationData, additionalAuthenticationDataSize);
-    }
-
-    optional<vector<uint8_t>> decryptedDataVec =
-            android::hardware::identity::support::decryptAes128Gcm(keyVec, encryptedDataVec,
-                                                                   aadVec);
-    if (!decryptedDataVec.has_value()) {
+    if (!android::hardware::identity::support::decryptAes128Gcm(
+                key, encryptedData, encryptedDataSize, additionalAuthenticationData,
+                additionalAuthenticationDataSize, data)) {
         eicDebug("Error decrypting data");
         return false;
     }
-    if (decryptedDataVec.value().size() != encryptedDataSize - 28) {
-        eicDebug("Decrypted data is size %zd, expected %zd", decryptedDataVec.value().size(),
-                 encryptedDataSize - 28);
-        return false;
-    }
-
-    if (decryptedDataVec.value().size() > 0) {
-        memcpy(data, decryptedDataVec.value().data(), decryptedDataVec.value().size());
-    }
     return true;
 }
 
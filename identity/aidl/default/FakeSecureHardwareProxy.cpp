@@ -655,12 +655,19 @@ optional<vector<uint8_t>> FakeSecureHardwarePresentationProxy::retrieveEntryValu
         return std::nullopt;
     }
 
+    if (encryptedContent.size() < 28) {
+        LOG(ERROR) << "encryptedContent too small";
+        return std::nullopt;
+    }
+
     uint8_t scratchSpace[512];
     vector<uint8_t> uint8AccessControlProfileIds;
+    uint8AccessControlProfileIds.reserve(accessControlProfileIds.size());
     for (size_t i = 0; i < accessControlProfileIds.size(); i++) {
         uint8AccessControlProfileIds.push_back(accessControlProfileIds[i] & 0xFF);
     }
 
+    // Decrypted directly into the returned buffer, see eicOpsDecryptAes128Gcm().
     vector<uint8_t> content;
     content.resize(encryptedContent.size() - 28);
     if (!eicPresentationRetrieveEntryValue(
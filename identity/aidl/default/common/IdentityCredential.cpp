@@ -871,6 +871,11 @@ ndk::ScopedAStatus IdentityCredential::startRetrieveEntryValue(
     currentAccessControlProfileIds_ = accessControlProfileIds;
     entryRemainingBytes_ = entrySize;
     entryValue_.resize(0);
+    // Only values spanning several chunks are assembled in entryValue_, reserve
+    // up front so appending chunks doesn't reallocate and copy.
+    if (entrySize > IdentityCredentialStore::kGcmChunkSize) {
+        entryValue_.reserve(entrySize);
+    }
 
     return ndk::ScopedAStatus::ok();
 }
@@ -908,19 +913,28 @@ ndk::ScopedAStatus IdentityCredential::retrieveEntryValue(const vector<uint8_t>&
         }
     }
 
-    entryValue_.insert(entryValue_.end(), content.value().begin(), content.value().end());
+    // A value which fits in a single chunk is parsed straight from the decrypted
+    // chunk, larger ones are assembled in entryValue_.
+    const vector<uint8_t>* entryValue = &content.value();
+    if (entryRemainingBytes_ > 0 || !entryValue_.empty()) {
+        entryValue_.insert(entryValue_.end(), content.value().begin(), content.value().end());
+        entryValue = &entryValue_;
+    }
 
     if (entryRemainingBytes_ == 0) {
-        auto [entryValueItem, _, message] = cppbor::parse(entryValue_);
+        auto [entryValueItem, _, message] = cppbor::parse(*entryValue);
         if (entryValueItem == nullptr) {
             return ndk::ScopedAStatus(AStatus_fromServiceSpecificErrorWithMessage(
                     IIdentityCredentialStore::STATUS_INVALID_DATA,
                     "Retrieved data which is invalid CBOR"));
         }
         currentNameSpaceDeviceNameSpacesMap_.add(currentName_, std::move(entryValueItem));
+        // Don't hold on to the buffer of a large value, e.g. a portrait, for the
+        // rest of the session.
+        vector<uint8_t>().swap(entryValue_);
     }
 
-    *outContent = content.value();
+    *outContent = std::move(content.value());
     return ndk::ScopedAStatus::ok();
 }
 
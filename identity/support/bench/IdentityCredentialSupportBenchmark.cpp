@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2022, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the vector based AES-GCM helpers, used the way EicOpsImpl and IdentityCredential
+// used to, with the in-place and chunked variants on entries the size of portraits and biometric
+// templates.  Besides time, each benchmark reports the number of heap allocations, the bytes
+// allocated and the peak heap usage per entry.  The COSE_Mac0 benchmarks compare coseMac0(),
+// which streams the MAC_structure into the HMAC, with encoding it first on DeviceAuthentication
+// payloads the size of a DeviceResponse.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <android/hardware/identity/support/IdentityCredentialSupport.h>
+
+#include <cppbor.h>
+
+using ::benchmark::State;
+using ::std::optional;
+using ::std::vector;
+
+namespace support = ::android::hardware::identity::support;
+
+namespace {
+
+// Heap accounting done by the operator new/delete replacements below.  Every allocation is
+// prefixed with its size so that live bytes can be tracked.
+size_t gAllocs = 0;
+size_t gAllocBytes = 0;
+size_t gLiveBytes = 0;
+size_t gPeakBytes = 0;
+
+constexpr size_t kHeaderSize = alignof(std::max_align_t);
+
+void resetCounters() {
+    gAllocs = 0;
+    gAllocBytes = 0;
+    gPeakBytes = gLiveBytes;
+}
+
+void reportCounters(State& state, size_t baseline) {
+    double iterations = state.iterations();
+    state.counters["allocs"] = gAllocs / iterations;
+    state.counters["allocBytes"] = gAllocBytes / iterations;
+    state.counters["peakBytes"] = gPeakBytes - baseline;
+}
+
+// Same chunk size as IdentityCredentialStore::kGcmChunkSize.
+constexpr size_t kChunkSize = 64 * 1024;
+
+struct Entry {
+    vector<uint8_t> key = vector<uint8_t>(support::kAes128GcmKeySize, 0x01);
+    vector<uint8_t> additionalData = vector<uint8_t>(120, 0x02);
+    vector<uint8_t> plainText;
+    vector<vector<uint8_t>> encryptedChunks;
+
+    explicit Entry(size_t size) : plainText(size, 0x03) {
+        vector<uint8_t> nonce(support::kAesGcmIvSize, 0x04);
+        for (size_t n = 0; n < size; n += kChunkSize) {
+            vector<uint8_t> chunk(plainText.begin() + n,
+                                  plainText.begin() + std::min(size, n + kChunkSize));
+            encryptedChunks.push_back(
+                    support::encryptAes128Gcm(key, nonce, chunk, additionalData).value());
+        }
+    }
+};
+
+// What eicOpsDecryptAes128Gcm() used to do: copy every argument into a vector, decrypt into a
+// new vector and copy the result out.
+bool decryptCopying(const uint8_t* key, const uint8_t* encryptedData, size_t encryptedDataSize,
+                    const uint8_t* aad, size_t aadSize, uint8_t* data) {
+    vector<uint8_t> keyVec(key, key + support::kAes128GcmKeySize);
+    vector<uint8_t> encryptedDataVec(encryptedData, encryptedData + encryptedDataSize);
+    vector<uint8_t> aadVec(aad, aad + aadSize);
+    optional<vector<uint8_t>> decrypted =
+            support::decryptAes128Gcm(keyVec, encryptedDataVec, aadVec);
+    if (!decrypted) {
+        return false;
+    }
+    memcpy(data, decrypted.value().data(), decrypted.value().size());
+    return true;
+}
+
+// Retrieves an entry chunk by chunk the way the presentation proxy and IdentityCredential do:
+// each chunk is decrypted into a vector which is handed back to the caller, and multi-chunk
+// values are also assembled for parsing.
+template <bool kInPlace>
+void BM_RetrieveEntry(State& state) {
+    Entry entry(state.range(0));
+    size_t baseline = gLiveBytes;
+    resetCounters();
+    for (auto _ : state) {
+        vector<uint8_t> entryValue;
+        if (kInPlace && entry.plainText.size() > kChunkSize) {
+            entryValue.reserve(entry.plainText.size());
+        }
+        for (const vector<uint8_t>& encrypted : entry.encryptedChunks) {
+            vector<uint8_t> content(encrypted.size() - 28);
+            bool ok = kInPlace ? support::decryptAes128Gcm(
+                                         entry.key.data(), encrypted.data(), encrypted.size(),
+                                         entry.additionalData.data(),
+                                         entry.additionalData.size(), content.data())
+                               : decryptCopying(entry.key.data(), encrypted.data(),
+                                                encrypted.size(), entry.additionalData.data(),
+                                                entry.additionalData.size(), content.data());
+            if (!ok) {
+                state.SkipWithError("Error decrypting");
+                return;
+            }
+            if (!kInPlace || entry.encryptedChunks.size() > 1) {
+                entryValue.insert(entryValue.end(), content.begin(), content.end());
+            }
+            vector<uint8_t> outContent;
+            if (kInPlace) {
+                outContent = std::move(content);
+            } else {
+                outContent = content;
+            }
+            benchmark::DoNotOptimize(outContent.data());
+        }
+        benchmark::DoNotOptimize(entryValue.data());
+    }
+    state.SetBytesProcessed(state.iterations() * entry.plainText.size());
+    reportCounters(state, baseline);
+}
+
+// Hashing a value which arrives in chunks: concatenate and call sha256(), or stream the chunks
+// through Sha256.
+template <bool kStreaming>
+void BM_HashEntry(State& state) {
+    Entry entry(state.range(0));
+    size_t baseline = gLiveBytes;
+    resetCounters();
+    for (auto _ : state) {
+        uint8_t digest[SHA256_DIGEST_LENGTH];
+        if (kStreaming) {
+            support::Sha256 sha256;
+            for (size_t n = 0; n < entry.plainText.size(); n += kChunkSize) {
+                sha256.update(entry.plainText.data() + n,
+                              std::min(kChunkSize, entry.plainText.size() - n));
+            }
+            sha256.finish(digest);
+        } else {
+            vector<uint8_t> assembled;
+            for (size_t n = 0; n < entry.plainText.size(); n += kChunkSize) {
+                assembled.insert(assembled.end(), entry.plainText.begin() + n,
+                                 entry.plainText.begin() +
+                                         std::min(entry.plainText.size(), n + kChunkSize));
+            }
+            memcpy(digest, support::sha256(assembled).data(), sizeof(digest));
+        }
+        benchmark::DoNotOptimize(digest);
+    }
+    state.SetBytesProcessed(state.iterations() * entry.plainText.size());
+    reportCounters(state, baseline);
+}
+
+// A DeviceAuthentication structure whose DeviceNameSpaces hold a 16 KiB portrait and
+// |numElements| small data elements.
+vector<uint8_t> deviceAuthentication(size_t numElements) {
+    cppbor::Map elements;
+    elements.add("portrait", vector<uint8_t>(16 * 1024, 0x05));
+    for (size_t n = 0; n < numElements; n++) {
+        elements.add("element_" + std::to_string(n), vector<uint8_t>(32, n & 0xff));
+    }
+    cppbor::Map nameSpaces;
+    nameSpaces.add("org.iso.18013.5.1", std::move(elements));
+    return cppbor::Array()
+            .add("DeviceAuthentication")
+            .add(vector<uint8_t>(200, 0x06))
+            .add("org.iso.18013.5.1.mDL")
+            .add(cppbor::SemanticTag(24, nameSpaces.encode()))
+            .encode();
+}
+
+// What coseMac0() used to do with detached content: encode the MAC_structure, MAC the encoding
+// and encode the COSE_Mac0.
+optional<vector<uint8_t>> coseMac0Encoding(const vector<uint8_t>& key,
+                                           const vector<uint8_t>& detachedContent) {
+    vector<uint8_t> encodedProtectedHeaders = cppbor::Map().add(1, 5).encode();
+    vector<uint8_t> toBeMaced = cppbor::Array()
+                                        .add("MAC0")
+                                        .add(encodedProtectedHeaders)
+                                        .add(vector<uint8_t>())
+                                        .add(detachedContent)
+                                        .encode();
+    optional<vector<uint8_t>> mac = support::hmacSha256(key, toBeMaced);
+    if (!mac) {
+        return {};
+    }
+    return cppbor::Array()
+            .add(encodedProtectedHeaders)
+            .add(cppbor::Map())
+            .add(cppbor::Null())
+            .add(mac.value())
+            .encode();
+}
+
+template <bool kStreaming>
+void BM_CoseMac0(State& state) {
+    vector<uint8_t> key(32, 0x07);
+    vector<uint8_t> detachedContent = deviceAuthentication(state.range(0));
+    size_t baseline = gLiveBytes;
+    resetCounters();
+    for (auto _ : state) {
+        optional<vector<uint8_t>> mac = kStreaming ? support::coseMac0(key, {}, detachedContent)
+                                                   : coseMac0Encoding(key, detachedContent);
+        if (!mac) {
+            state.SkipWithError("Error calculating MAC");
+            return;
+        }
+        benchmark::DoNotOptimize(mac.value().data());
+    }
+    state.SetBytesProcessed(state.iterations() * detachedContent.size());
+    reportCounters(state, baseline);
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+    void* p = malloc(size + kHeaderSize);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    *static_cast<size_t*>(p) = size;
+    gAllocs++;
+    gAllocBytes += size;
+    gLiveBytes += size;
+    gPeakBytes = std::max(gPeakBytes, gLiveBytes);
+    return static_cast<uint8_t*>(p) + kHeaderSize;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+    void* p = static_cast<uint8_t*>(ptr) - kHeaderSize;
+    gLiveBytes -= *static_cast<size_t*>(p);
+    free(p);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+// Small values, a 32 KiB portrait, a 512 KiB template and a 2 MiB full resolution portrait.
+BENCHMARK_TEMPLATE(BM_RetrieveEntry, false)->Arg(256)->Arg(32 << 10)->Arg(512 << 10)->Arg(2 << 20);
+BENCHMARK_TEMPLATE(BM_RetrieveEntry, true)->Arg(256)->Arg(32 << 10)->Arg(512 << 10)->Arg(2 << 20);
+BENCHMARK_TEMPLATE(BM_HashEntry, false)->Arg(32 << 10)->Arg(512 << 10)->Arg(2 << 20);
+BENCHMARK_TEMPLATE(BM_HashEntry, true)->Arg(32 << 10)->Arg(512 << 10)->Arg(2 << 20);
+
+BENCHMARK_TEMPLATE(BM_CoseMac0, false)->Arg(16)->Arg(256)->Arg(2048);
+BENCHMARK_TEMPLATE(BM_CoseMac0, true)->Arg(16)->Arg(256)->Arg(2048);
+
+BENCHMARK_MAIN();
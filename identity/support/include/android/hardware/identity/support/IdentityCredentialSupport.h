@@ -18,6 +18,8 @@
 #define IDENTITY_SUPPORT_INCLUDE_IDENTITY_CREDENTIAL_UTILS_H_
 
 #include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/sha.h>
 
 #include <cstdint>
 #include <map>
@@ -112,6 +114,80 @@ optional<vector<uint8_t>> encryptAes128Gcm(const vector<uint8_t>& key, const vec
                                            const vector<uint8_t>& data,
                                            const vector<uint8_t>& additionalAuthenticatedData);
 
+// Like encryptAes128Gcm() above but works on caller-provided buffers and does
+// not allocate. |key| must be kAes128GcmKeySize bytes, |nonce| must be
+// kAesGcmIvSize bytes and |encryptedData| must have room for |dataSize| +
+// kAesGcmIvSize + kAesGcmTagSize bytes. |data| and |additionalAuthenticatedData|
+// may be NULL if their size is 0.
+bool encryptAes128Gcm(const uint8_t* key, const uint8_t* nonce, const uint8_t* data,
+                      size_t dataSize, const uint8_t* additionalAuthenticatedData,
+                      size_t additionalAuthenticatedDataSize, uint8_t* encryptedData);
+
+// Like decryptAes128Gcm() above but works on caller-provided buffers and does
+// not allocate. |key| must be kAes128GcmKeySize bytes and |data| must have room
+// for |encryptedDataSize| - kAesGcmIvSize - kAesGcmTagSize bytes. The contents
+// of |data| are unspecified if false is returned.
+bool decryptAes128Gcm(const uint8_t* key, const uint8_t* encryptedData, size_t encryptedDataSize,
+                      const uint8_t* additionalAuthenticatedData,
+                      size_t additionalAuthenticatedDataSize, uint8_t* data);
+
+// Incremental AES-128-GCM encryption, for data which is produced in chunks.
+// The concatenation of the nonce, the output of all update() calls and the
+// tag written by finish() is in the format produced by encryptAes128Gcm().
+//
+class Aes128GcmEncrypter {
+  public:
+    // Starts encrypting with |key| (kAes128GcmKeySize bytes) and |nonce|
+    // (kAesGcmIvSize bytes), authenticating |additionalAuthenticatedData|.
+    bool init(const uint8_t* key, const uint8_t* nonce, const uint8_t* additionalAuthenticatedData,
+              size_t additionalAuthenticatedDataSize);
+
+    // Encrypts |size| bytes from |in| to |out|. The buffers may be the same.
+    bool update(const uint8_t* in, size_t size, uint8_t* out);
+
+    // Writes the kAesGcmTagSize bytes tag to |tag|.
+    bool finish(uint8_t* tag);
+
+  private:
+    bssl::UniquePtr<EVP_CIPHER_CTX> ctx_;
+};
+
+// Incremental AES-128-GCM decryption, the counterpart of Aes128GcmEncrypter.
+// Plaintext is released by update() before the tag is checked, so callers must
+// discard everything written if finish() returns false.
+//
+class Aes128GcmDecrypter {
+  public:
+    // Starts decrypting with |key| (kAes128GcmKeySize bytes) and |nonce|
+    // (kAesGcmIvSize bytes), authenticating |additionalAuthenticatedData|.
+    bool init(const uint8_t* key, const uint8_t* nonce, const uint8_t* additionalAuthenticatedData,
+              size_t additionalAuthenticatedDataSize);
+
+    // Decrypts |size| bytes from |in| to |out|. The buffers may be the same.
+    bool update(const uint8_t* in, size_t size, uint8_t* out);
+
+    // Checks the kAesGcmTagSize bytes |tag|, returns false if it doesn't match.
+    bool finish(const uint8_t* tag);
+
+  private:
+    bssl::UniquePtr<EVP_CIPHER_CTX> ctx_;
+};
+
+// Incremental SHA-256, for data which is produced or received in chunks.
+//
+class Sha256 {
+  public:
+    Sha256() { SHA256_Init(&ctx_); }
+
+    void update(const uint8_t* data, size_t size) { SHA256_Update(&ctx_, data, size); }
+
+    // Writes the SHA256_DIGEST_LENGTH bytes digest to |digest|.
+    void finish(uint8_t* digest) { SHA256_Final(digest, &ctx_); }
+
+  private:
+    SHA256_CTX ctx_;
+};
+
 // ---------------------------------------------------------------------------
 // EC crypto functionality / abstraction (only supports P-256).
 // ---------------------------------------------------------------------------
@@ -191,6 +267,22 @@ optional<vector<uint8_t>> signEcDsaDigest(const vector<uint8_t>& key,
 //
 optional<vector<uint8_t>> hmacSha256(const vector<uint8_t>& key, const vector<uint8_t>& data);
 
+// Incremental HMAC with SHA-256, for data which is produced or received in
+// chunks.
+//
+class HmacSha256 {
+  public:
+    bool init(const uint8_t* key, size_t keySize);
+
+    bool update(const uint8_t* data, size_t size);
+
+    // Writes the 32 bytes HMAC to |hmac|.
+    bool finish(uint8_t* hmac);
+
+  private:
+    bssl::UniquePtr<HMAC_CTX> ctx_;
+};
+
 // Checks that |signature| (in DER format) is a valid signature of |digest|,
 // made with |publicKey| (which must be in the format returned by
 // ecKeyPairGetPublicKey()).
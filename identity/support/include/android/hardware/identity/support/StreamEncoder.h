@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2022, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef IDENTITY_SUPPORT_INCLUDE_STREAM_ENCODER_H_
+#define IDENTITY_SUPPORT_INCLUDE_STREAM_ENCODER_H_
+
+#include <cppbor.h>
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace identity {
+namespace support {
+
+// StreamEncoder writes a CBOR encoding incrementally to a sink that accepts
+// byte ranges, such as Sha256 or HmacSha256, so that digests and MACs over
+// large structures can be computed without materializing the complete
+// encoding.
+//
+// Headers and other small values are collected in a fixed internal buffer;
+// byte and text string contents at least as large as the buffer are passed to
+// the sink directly.  Compound items are written as a header followed by their
+// entries, and it is up to the caller to add as many entries as the header
+// declares.  Call flush() (or destroy the encoder) before finalizing the sink.
+//
+class StreamEncoder {
+  public:
+    using Sink = std::function<void(const uint8_t* data, size_t size)>;
+
+    explicit StreamEncoder(Sink sink) : sink_(std::move(sink)) {}
+    ~StreamEncoder() { flush(); }
+
+    StreamEncoder(const StreamEncoder&) = delete;
+    StreamEncoder& operator=(const StreamEncoder&) = delete;
+
+    StreamEncoder& addHeader(cppbor::MajorType type, uint64_t addlInfo);
+
+    StreamEncoder& addUint(uint64_t value) { return addHeader(cppbor::UINT, value); }
+    StreamEncoder& addInt(int64_t value) {
+        return value < 0 ? addHeader(cppbor::NINT, -1LL - value) : addHeader(cppbor::UINT, value);
+    }
+    StreamEncoder& addBool(bool value) {
+        return addHeader(cppbor::SIMPLE, value ? cppbor::TRUE : cppbor::FALSE);
+    }
+    StreamEncoder& addNull() { return addHeader(cppbor::SIMPLE, cppbor::NULL_V); }
+
+    StreamEncoder& addBstr(const uint8_t* data, size_t size);
+    StreamEncoder& addBstr(const std::vector<uint8_t>& value) {
+        return addBstr(value.data(), value.size());
+    }
+    StreamEncoder& addTstr(std::string_view value);
+
+    StreamEncoder& beginArray(size_t entries) { return addHeader(cppbor::ARRAY, entries); }
+    StreamEncoder& beginMap(size_t pairs) { return addHeader(cppbor::MAP, pairs); }
+    StreamEncoder& addSemantic(uint64_t tag) { return addHeader(cppbor::SEMANTIC, tag); }
+
+    // Starts a byte string of the given size whose contents are supplied by
+    // following add() or addRaw() calls.  This is how bstr-wrapped CBOR, e.g.
+    // the tag 24 payloads used in ISO 18013-5 structures, is streamed.
+    //
+    StreamEncoder& beginBstr(size_t size) { return addHeader(cppbor::BSTR, size); }
+
+    // Writes the encoding of |item|.  Items which fit in the internal buffer
+    // are encoded directly into it, larger ones are encoded into a temporary
+    // vector first, so prefer the other methods for large strings.
+    //
+    StreamEncoder& add(const cppbor::Item& item);
+
+    // Writes |item| as a byte string containing its encoding, i.e. bstr .cbor.
+    //
+    StreamEncoder& addBstrWrapped(const cppbor::Item& item) {
+        beginBstr(item.encodedSize());
+        return add(item);
+    }
+
+    // Writes bytes that are already CBOR-encoded (or are the contents of a
+    // string started with beginBstr()) without interpreting them.
+    //
+    StreamEncoder& addRaw(const uint8_t* data, size_t size);
+
+    // Passes any buffered bytes to the sink.
+    //
+    void flush();
+
+    // Returns the number of bytes encoded so far, including any that are still
+    // buffered.
+    //
+    size_t bytesEncoded() const { return encoded_; }
+
+  private:
+    static constexpr size_t kBufferSize = 256;
+
+    Sink sink_;
+    uint8_t buffer_[kBufferSize];
+    size_t buffered_ = 0;
+    size_t encoded_ = 0;
+};
+
+}  // namespace support
+}  // namespace identity
+}  // namespace hardware
+}  // namespace android
+
+#endif  // IDENTITY_SUPPORT_INCLUDE_STREAM_ENCODER_H_
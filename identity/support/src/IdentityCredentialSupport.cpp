@@ -17,6 +17,7 @@
 #define LOG_TAG "IdentityCredentialSupport"
 
 #include <android/hardware/identity/support/IdentityCredentialSupport.h>
+#include <android/hardware/identity/support/StreamEncoder.h>
 
 #define _POSIX_C_SOURCE 199309L
 
@@ -26,6 +27,7 @@
 #include <time.h>
 #include <chrono>
 #include <iomanip>
+#include <string_view>
 
 #include <openssl/aes.h>
 #include <openssl/bn.h>
@@ -428,172 +430,233 @@ optional<vector<uint8_t>> getRandom(size_t numBytes) {
     return output;
 }
 
-optional<vector<uint8_t>> decryptAes128Gcm(const vector<uint8_t>& key,
-                                           const vector<uint8_t>& encryptedData,
-                                           const vector<uint8_t>& additionalAuthenticatedData) {
-    int cipherTextSize = int(encryptedData.size()) - kAesGcmIvSize - kAesGcmTagSize;
-    if (cipherTextSize < 0) {
-        LOG(ERROR) << "encryptedData too small";
-        return {};
+bool Aes128GcmEncrypter::init(const uint8_t* key, const uint8_t* nonce,
+                              const uint8_t* additionalAuthenticatedData,
+                              size_t additionalAuthenticatedDataSize) {
+    ctx_.reset(EVP_CIPHER_CTX_new());
+    if (ctx_.get() == nullptr) {
+        LOG(ERROR) << "EVP_CIPHER_CTX_new: failed";
+        return false;
     }
-    unsigned char* nonce = (unsigned char*)encryptedData.data();
-    unsigned char* cipherText = nonce + kAesGcmIvSize;
-    unsigned char* tag = cipherText + cipherTextSize;
 
-    vector<uint8_t> plainText;
-    plainText.resize(cipherTextSize);
+    if (EVP_EncryptInit_ex(ctx_.get(), EVP_aes_128_gcm(), NULL, NULL, NULL) != 1) {
+        LOG(ERROR) << "EVP_EncryptInit_ex: failed";
+        return false;
+    }
 
-    auto ctx = EvpCipherCtxPtr(EVP_CIPHER_CTX_new());
-    if (ctx.get() == nullptr) {
+    if (EVP_CIPHER_CTX_ctrl(ctx_.get(), EVP_CTRL_GCM_SET_IVLEN, kAesGcmIvSize, NULL) != 1) {
+        LOG(ERROR) << "EVP_CIPHER_CTX_ctrl: failed setting nonce length";
+        return false;
+    }
+
+    if (EVP_EncryptInit_ex(ctx_.get(), NULL, NULL, key, nonce) != 1) {
+        LOG(ERROR) << "EVP_EncryptInit_ex: failed";
+        return false;
+    }
+
+    int numWritten;
+    if (additionalAuthenticatedDataSize > 0) {
+        if (EVP_EncryptUpdate(ctx_.get(), NULL, &numWritten, additionalAuthenticatedData,
+                              additionalAuthenticatedDataSize) != 1) {
+            LOG(ERROR) << "EVP_EncryptUpdate: failed for additionalAuthenticatedData";
+            return false;
+        }
+        if ((size_t)numWritten != additionalAuthenticatedDataSize) {
+            LOG(ERROR) << "EVP_EncryptUpdate: Unexpected outl=" << numWritten << " (expected "
+                       << additionalAuthenticatedDataSize << ") for additionalAuthenticatedData";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Aes128GcmEncrypter::update(const uint8_t* in, size_t size, uint8_t* out) {
+    if (size == 0) {
+        return true;
+    }
+    int numWritten;
+    if (EVP_EncryptUpdate(ctx_.get(), out, &numWritten, in, size) != 1) {
+        LOG(ERROR) << "EVP_EncryptUpdate: failed";
+        return false;
+    }
+    if ((size_t)numWritten != size) {
+        LOG(ERROR) << "EVP_EncryptUpdate: Unexpected outl=" << numWritten << " (expected " << size
+                   << ")";
+        return false;
+    }
+    return true;
+}
+
+bool Aes128GcmEncrypter::finish(uint8_t* tag) {
+    // GCM is a stream mode so nothing is buffered and no output is produced here.
+    uint8_t unused[EVP_MAX_BLOCK_LENGTH];
+    int numWritten;
+    if (EVP_EncryptFinal_ex(ctx_.get(), unused, &numWritten) != 1) {
+        LOG(ERROR) << "EVP_EncryptFinal_ex: failed";
+        return false;
+    }
+    if (numWritten != 0) {
+        LOG(ERROR) << "EVP_EncryptFinal_ex: Unexpected non-zero outl=" << numWritten;
+        return false;
+    }
+
+    if (EVP_CIPHER_CTX_ctrl(ctx_.get(), EVP_CTRL_GCM_GET_TAG, kAesGcmTagSize, tag) != 1) {
+        LOG(ERROR) << "EVP_CIPHER_CTX_ctrl: failed getting tag";
+        return false;
+    }
+    return true;
+}
+
+bool Aes128GcmDecrypter::init(const uint8_t* key, const uint8_t* nonce,
+                              const uint8_t* additionalAuthenticatedData,
+                              size_t additionalAuthenticatedDataSize) {
+    ctx_.reset(EVP_CIPHER_CTX_new());
+    if (ctx_.get() == nullptr) {
         LOG(ERROR) << "EVP_CIPHER_CTX_new: failed";
-        return {};
+        return false;
     }
 
-    if (EVP_DecryptInit_ex(ctx.get(), EVP_aes_128_gcm(), NULL, NULL, NULL) != 1) {
+    if (EVP_DecryptInit_ex(ctx_.get(), EVP_aes_128_gcm(), NULL, NULL, NULL) != 1) {
         LOG(ERROR) << "EVP_DecryptInit_ex: failed";
-        return {};
+        return false;
     }
 
-    if (EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_IVLEN, kAesGcmIvSize, NULL) != 1) {
+    if (EVP_CIPHER_CTX_ctrl(ctx_.get(), EVP_CTRL_GCM_SET_IVLEN, kAesGcmIvSize, NULL) != 1) {
         LOG(ERROR) << "EVP_CIPHER_CTX_ctrl: failed setting nonce length";
-        return {};
+        return false;
     }
 
-    if (EVP_DecryptInit_ex(ctx.get(), NULL, NULL, (unsigned char*)key.data(), nonce) != 1) {
+    if (EVP_DecryptInit_ex(ctx_.get(), NULL, NULL, key, nonce) != 1) {
         LOG(ERROR) << "EVP_DecryptInit_ex: failed";
-        return {};
+        return false;
     }
 
     int numWritten;
-    if (additionalAuthenticatedData.size() > 0) {
-        if (EVP_DecryptUpdate(ctx.get(), NULL, &numWritten,
-                              (unsigned char*)additionalAuthenticatedData.data(),
-                              additionalAuthenticatedData.size()) != 1) {
+    if (additionalAuthenticatedDataSize > 0) {
+        if (EVP_DecryptUpdate(ctx_.get(), NULL, &numWritten, additionalAuthenticatedData,
+                              additionalAuthenticatedDataSize) != 1) {
             LOG(ERROR) << "EVP_DecryptUpdate: failed for additionalAuthenticatedData";
-            return {};
+            return false;
         }
-        if ((size_t)numWritten != additionalAuthenticatedData.size()) {
+        if ((size_t)numWritten != additionalAuthenticatedDataSize) {
             LOG(ERROR) << "EVP_DecryptUpdate: Unexpected outl=" << numWritten << " (expected "
-                       << additionalAuthenticatedData.size() << ") for additionalAuthenticatedData";
-            return {};
+                       << additionalAuthenticatedDataSize << ") for additionalAuthenticatedData";
+            return false;
         }
     }
+    return true;
+}
 
-    if (EVP_DecryptUpdate(ctx.get(), (unsigned char*)plainText.data(), &numWritten, cipherText,
-                          cipherTextSize) != 1) {
+bool Aes128GcmDecrypter::update(const uint8_t* in, size_t size, uint8_t* out) {
+    if (size == 0) {
+        return true;
+    }
+    int numWritten;
+    if (EVP_DecryptUpdate(ctx_.get(), out, &numWritten, in, size) != 1) {
         LOG(ERROR) << "EVP_DecryptUpdate: failed";
-        return {};
+        return false;
     }
-    if (numWritten != cipherTextSize) {
-        LOG(ERROR) << "EVP_DecryptUpdate: Unexpected outl=" << numWritten << " (expected "
-                   << cipherTextSize << ")";
-        return {};
+    if ((size_t)numWritten != size) {
+        LOG(ERROR) << "EVP_DecryptUpdate: Unexpected outl=" << numWritten << " (expected " << size
+                   << ")";
+        return false;
     }
+    return true;
+}
 
-    if (!EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_TAG, kAesGcmTagSize, tag)) {
+bool Aes128GcmDecrypter::finish(const uint8_t* tag) {
+    if (!EVP_CIPHER_CTX_ctrl(ctx_.get(), EVP_CTRL_GCM_SET_TAG, kAesGcmTagSize, (void*)tag)) {
         LOG(ERROR) << "EVP_CIPHER_CTX_ctrl: failed setting expected tag";
-        return {};
+        return false;
     }
 
-    int ret = EVP_DecryptFinal_ex(ctx.get(), (unsigned char*)plainText.data() + numWritten,
-                                  &numWritten);
-    if (ret != 1) {
+    uint8_t unused[EVP_MAX_BLOCK_LENGTH];
+    int numWritten;
+    if (EVP_DecryptFinal_ex(ctx_.get(), unused, &numWritten) != 1) {
         LOG(ERROR) << "EVP_DecryptFinal_ex: failed";
-        return {};
+        return false;
     }
     if (numWritten != 0) {
         LOG(ERROR) << "EVP_DecryptFinal_ex: Unexpected non-zero outl=" << numWritten;
-        return {};
+        return false;
     }
-
-    return plainText;
+    return true;
 }
 
-optional<vector<uint8_t>> encryptAes128Gcm(const vector<uint8_t>& key, const vector<uint8_t>& nonce,
-                                           const vector<uint8_t>& data,
-                                           const vector<uint8_t>& additionalAuthenticatedData) {
-    if (key.size() != kAes128GcmKeySize) {
-        LOG(ERROR) << "key is not kAes128GcmKeySize bytes";
-        return {};
-    }
-    if (nonce.size() != kAesGcmIvSize) {
-        LOG(ERROR) << "nonce is not kAesGcmIvSize bytes";
-        return {};
+bool decryptAes128Gcm(const uint8_t* key, const uint8_t* encryptedData, size_t encryptedDataSize,
+                      const uint8_t* additionalAuthenticatedData,
+                      size_t additionalAuthenticatedDataSize, uint8_t* data) {
+    if (encryptedDataSize < kAesGcmIvSize + kAesGcmTagSize) {
+        LOG(ERROR) << "encryptedData too small";
+        return false;
     }
+    size_t cipherTextSize = encryptedDataSize - kAesGcmIvSize - kAesGcmTagSize;
+    const uint8_t* nonce = encryptedData;
+    const uint8_t* cipherText = nonce + kAesGcmIvSize;
+    const uint8_t* tag = cipherText + cipherTextSize;
+
+    Aes128GcmDecrypter decrypter;
+    return decrypter.init(key, nonce, additionalAuthenticatedData,
+                          additionalAuthenticatedDataSize) &&
+           decrypter.update(cipherText, cipherTextSize, data) && decrypter.finish(tag);
+}
 
+bool encryptAes128Gcm(const uint8_t* key, const uint8_t* nonce, const uint8_t* data,
+                      size_t dataSize, const uint8_t* additionalAuthenticatedData,
+                      size_t additionalAuthenticatedDataSize, uint8_t* encryptedData) {
     // The result is the nonce (kAesGcmIvSize bytes), the ciphertext, and
     // finally the tag (kAesGcmTagSize bytes).
-    vector<uint8_t> encryptedData;
-    encryptedData.resize(data.size() + kAesGcmIvSize + kAesGcmTagSize);
-    unsigned char* noncePtr = (unsigned char*)encryptedData.data();
-    unsigned char* cipherText = noncePtr + kAesGcmIvSize;
-    unsigned char* tag = cipherText + data.size();
-    memcpy(noncePtr, nonce.data(), kAesGcmIvSize);
+    uint8_t* cipherText = encryptedData + kAesGcmIvSize;
+    uint8_t* tag = cipherText + dataSize;
+    memmove(encryptedData, nonce, kAesGcmIvSize);
 
-    auto ctx = EvpCipherCtxPtr(EVP_CIPHER_CTX_new());
-    if (ctx.get() == nullptr) {
-        LOG(ERROR) << "EVP_CIPHER_CTX_new: failed";
-        return {};
-    }
+    Aes128GcmEncrypter encrypter;
+    return encrypter.init(key, encryptedData, additionalAuthenticatedData,
+                          additionalAuthenticatedDataSize) &&
+           encrypter.update(data, dataSize, cipherText) && encrypter.finish(tag);
+}
 
-    if (EVP_EncryptInit_ex(ctx.get(), EVP_aes_128_gcm(), NULL, NULL, NULL) != 1) {
-        LOG(ERROR) << "EVP_EncryptInit_ex: failed";
+optional<vector<uint8_t>> decryptAes128Gcm(const vector<uint8_t>& key,
+                                           const vector<uint8_t>& encryptedData,
+                                           const vector<uint8_t>& additionalAuthenticatedData) {
+    if (key.size() != kAes128GcmKeySize) {
+        LOG(ERROR) << "key is not kAes128GcmKeySize bytes";
         return {};
     }
-
-    if (EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_IVLEN, kAesGcmIvSize, NULL) != 1) {
-        LOG(ERROR) << "EVP_CIPHER_CTX_ctrl: failed setting nonce length";
+    if (encryptedData.size() < kAesGcmIvSize + kAesGcmTagSize) {
+        LOG(ERROR) << "encryptedData too small";
         return {};
     }
 
-    if (EVP_EncryptInit_ex(ctx.get(), NULL, NULL, (unsigned char*)key.data(),
-                           (unsigned char*)nonce.data()) != 1) {
-        LOG(ERROR) << "EVP_EncryptInit_ex: failed";
+    vector<uint8_t> plainText;
+    plainText.resize(encryptedData.size() - kAesGcmIvSize - kAesGcmTagSize);
+    if (!decryptAes128Gcm(key.data(), encryptedData.data(), encryptedData.size(),
+                          additionalAuthenticatedData.data(), additionalAuthenticatedData.size(),
+                          plainText.data())) {
         return {};
     }
+    return plainText;
+}
 
-    int numWritten;
-    if (additionalAuthenticatedData.size() > 0) {
-        if (EVP_EncryptUpdate(ctx.get(), NULL, &numWritten,
-                              (unsigned char*)additionalAuthenticatedData.data(),
-                              additionalAuthenticatedData.size()) != 1) {
-            LOG(ERROR) << "EVP_EncryptUpdate: failed for additionalAuthenticatedData";
-            return {};
-        }
-        if ((size_t)numWritten != additionalAuthenticatedData.size()) {
-            LOG(ERROR) << "EVP_EncryptUpdate: Unexpected outl=" << numWritten << " (expected "
-                       << additionalAuthenticatedData.size() << ") for additionalAuthenticatedData";
-            return {};
-        }
-    }
-
-    if (data.size() > 0) {
-        if (EVP_EncryptUpdate(ctx.get(), cipherText, &numWritten, (unsigned char*)data.data(),
-                              data.size()) != 1) {
-            LOG(ERROR) << "EVP_EncryptUpdate: failed";
-            return {};
-        }
-        if ((size_t)numWritten != data.size()) {
-            LOG(ERROR) << "EVP_EncryptUpdate: Unexpected outl=" << numWritten << " (expected "
-                       << data.size() << ")";
-            return {};
-        }
-    }
-
-    if (EVP_EncryptFinal_ex(ctx.get(), cipherText + numWritten, &numWritten) != 1) {
-        LOG(ERROR) << "EVP_EncryptFinal_ex: failed";
+optional<vector<uint8_t>> encryptAes128Gcm(const vector<uint8_t>& key, const vector<uint8_t>& nonce,
+                                           const vector<uint8_t>& data,
+                                           const vector<uint8_t>& additionalAuthenticatedData) {
+    if (key.size() != kAes128GcmKeySize) {
+        LOG(ERROR) << "key is not kAes128GcmKeySize bytes";
         return {};
     }
-    if (numWritten != 0) {
-        LOG(ERROR) << "EVP_EncryptFinal_ex: Unexpected non-zero outl=" << numWritten;
+    if (nonce.size() != kAesGcmIvSize) {
+        LOG(ERROR) << "nonce is not kAesGcmIvSize bytes";
         return {};
     }
 
-    if (EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_GET_TAG, kAesGcmTagSize, tag) != 1) {
-        LOG(ERROR) << "EVP_CIPHER_CTX_ctrl: failed getting tag";
+    vector<uint8_t> encryptedData;
+    encryptedData.resize(data.size() + kAesGcmIvSize + kAesGcmTagSize);
+    if (!encryptAes128Gcm(key.data(), nonce.data(), data.data(), data.size(),
+                          additionalAuthenticatedData.data(), additionalAuthenticatedData.size(),
+                          encryptedData.data())) {
         return {};
     }
-
     return encryptedData;
 }
 
@@ -762,10 +825,9 @@ bool checkEcDsaSignature(const vector<uint8_t>& digest, const vector<uint8_t>& s
 vector<uint8_t> sha256(const vector<uint8_t>& data) {
     vector<uint8_t> ret;
     ret.resize(SHA256_DIGEST_LENGTH);
-    SHA256_CTX ctx;
-    SHA256_Init(&ctx);
-    SHA256_Update(&ctx, data.data(), data.size());
-    SHA256_Final((unsigned char*)ret.data(), &ctx);
+    Sha256 ctx;
+    ctx.update(data.data(), data.size());
+    ctx.finish(ret.data());
     return ret;
 }
 
@@ -801,26 +863,46 @@ optional<vector<uint8_t>> signEcDsa(const vector<uint8_t>& key, const vector<uin
     return signEcDsaDigest(key, sha256(data));
 }
 
-optional<vector<uint8_t>> hmacSha256(const vector<uint8_t>& key, const vector<uint8_t>& data) {
-    HMAC_CTX ctx;
-    HMAC_CTX_init(&ctx);
-    if (HMAC_Init_ex(&ctx, key.data(), key.size(), EVP_sha256(), nullptr /* impl */) != 1) {
+bool HmacSha256::init(const uint8_t* key, size_t keySize) {
+    ctx_.reset(HMAC_CTX_new());
+    if (ctx_.get() == nullptr) {
+        LOG(ERROR) << "HMAC_CTX_new: failed";
+        return false;
+    }
+    if (HMAC_Init_ex(ctx_.get(), key, keySize, EVP_sha256(), nullptr /* impl */) != 1) {
         LOG(ERROR) << "Error initializing HMAC_CTX";
-        return {};
+        return false;
     }
-    if (HMAC_Update(&ctx, data.data(), data.size()) != 1) {
+    return true;
+}
+
+bool HmacSha256::update(const uint8_t* data, size_t size) {
+    if (HMAC_Update(ctx_.get(), data, size) != 1) {
         LOG(ERROR) << "Error updating HMAC_CTX";
-        return {};
+        return false;
     }
-    vector<uint8_t> hmac;
-    hmac.resize(32);
+    return true;
+}
+
+bool HmacSha256::finish(uint8_t* hmac) {
     unsigned int size = 0;
-    if (HMAC_Final(&ctx, hmac.data(), &size) != 1) {
+    if (HMAC_Final(ctx_.get(), hmac, &size) != 1) {
         LOG(ERROR) << "Error finalizing HMAC_CTX";
-        return {};
+        return false;
     }
     if (size != 32) {
         LOG(ERROR) << "Expected 32 bytes from HMAC_Final, got " << size;
+        return false;
+    }
+    return true;
+}
+
+optional<vector<uint8_t>> hmacSha256(const vector<uint8_t>& key, const vector<uint8_t>& data) {
+    HmacSha256 ctx;
+    vector<uint8_t> hmac;
+    hmac.resize(32);
+    if (!ctx.init(key.data(), key.size()) || !ctx.update(data.data(), data.size()) ||
+        !ctx.finish(hmac.data())) {
         return {};
     }
     return hmac;
@@ -1681,29 +1763,6 @@ optional<pair<size_t, size_t>> certificateFindSignature(const vector<uint8_t>& x
 // COSE Utility Functions
 // ---------------------------------------------------------------------------
 
-vector<uint8_t> coseBuildToBeSigned(const vector<uint8_t>& encodedProtectedHeaders,
-                                    const vector<uint8_t>& data,
-                                    const vector<uint8_t>& detachedContent) {
-    cppbor::Array sigStructure;
-    sigStructure.add("Signature1");
-    sigStructure.add(encodedProtectedHeaders);
-
-    // We currently don't support Externally Supplied Data (RFC 8152 section 4.3)
-    // so external_aad is the empty bstr
-    vector<uint8_t> emptyExternalAad;
-    sigStructure.add(emptyExternalAad);
-
-    // Next field is the payload, independently of how it's transported (RFC
-    // 8152 section 4.4). Since our API specifies only one of |data| and
-    // |detachedContent| can be non-empty, it's simply just the non-empty one.
-    if (data.size() > 0) {
-        sigStructure.add(data);
-    } else {
-        sigStructure.add(detachedContent);
-    }
-    return sigStructure.encode();
-}
-
 vector<uint8_t> coseEncodeHeaders(const cppbor::Map& protectedHeaders) {
     if (protectedHeaders.size() == 0) {
         cppbor::Bstr emptyBstr(vector<uint8_t>({}));
@@ -1720,6 +1779,86 @@ const int COSE_LABEL_X5CHAIN = 33;  // temporary identifier
 const int COSE_ALG_ECDSA_256 = -7;
 const int COSE_ALG_HMAC_256_256 = 5;
 
+// Writes the Sig_structure or MAC_structure (RFC 8152 sections 4.4 and 6.3)
+// with the given context string to |encoder|.
+void coseWriteToBeSigned(StreamEncoder& encoder, std::string_view context,
+                         const vector<uint8_t>& encodedProtectedHeaders,
+                         const vector<uint8_t>& data, const vector<uint8_t>& detachedContent) {
+    encoder.beginArray(4).addTstr(context).addBstr(encodedProtectedHeaders);
+
+    // We currently don't support Externally Supplied Data (RFC 8152 section 4.3)
+    // so external_aad is the empty bstr
+    encoder.addBstr(vector<uint8_t>());
+
+    // Next field is the payload, independently of how it's transported (RFC
+    // 8152 section 4.4). Since our API specifies only one of |data| and
+    // |detachedContent| can be non-empty, it's simply just the non-empty one.
+    encoder.addBstr(data.size() > 0 ? data : detachedContent);
+}
+
+// Returns the SHA-256 digest of the Sig_structure. The structure is streamed
+// into the digest, so the payload is not copied into an encoding first.
+vector<uint8_t> coseToBeSignedDigest(const vector<uint8_t>& encodedProtectedHeaders,
+                                     const vector<uint8_t>& data,
+                                     const vector<uint8_t>& detachedContent) {
+    Sha256 ctx;
+    {
+        StreamEncoder encoder(
+                [&](const uint8_t* bytes, size_t size) { ctx.update(bytes, size); });
+        coseWriteToBeSigned(encoder, "Signature1", encodedProtectedHeaders, data,
+                            detachedContent);
+    }
+    vector<uint8_t> digest(SHA256_DIGEST_LENGTH);
+    ctx.finish(digest.data());
+    return digest;
+}
+
+// Encodes a COSE_Sign1 or COSE_Mac0 with |tag| as the signature or MAC. If
+// |certificateChain| is not empty it is put in the unprotected headers.
+optional<vector<uint8_t>> coseEncodeMessage(const vector<uint8_t>& encodedProtectedHeaders,
+                                            const vector<uint8_t>& certificateChain,
+                                            const vector<uint8_t>& data,
+                                            const vector<uint8_t>& tag) {
+    vector<vector<uint8_t>> certs;
+    if (certificateChain.size() != 0) {
+        optional<vector<vector<uint8_t>>> split = support::certificateChainSplit(certificateChain);
+        if (!split) {
+            LOG(ERROR) << "Error splitting certificate chain";
+            return {};
+        }
+        certs = std::move(split.value());
+    }
+
+    vector<uint8_t> message;
+    message.reserve(encodedProtectedHeaders.size() + certificateChain.size() + data.size() +
+                    tag.size() + 32);
+    StreamEncoder encoder([&](const uint8_t* bytes, size_t size) {
+        message.insert(message.end(), bytes, bytes + size);
+    });
+    encoder.beginArray(4).addBstr(encodedProtectedHeaders);
+    if (certs.size() == 0) {
+        encoder.beginMap(0);
+    } else {
+        encoder.beginMap(1).addInt(COSE_LABEL_X5CHAIN);
+        if (certs.size() == 1) {
+            encoder.addBstr(certs[0]);
+        } else {
+            encoder.beginArray(certs.size());
+            for (const vector<uint8_t>& cert : certs) {
+                encoder.addBstr(cert);
+            }
+        }
+    }
+    if (data.size() == 0) {
+        encoder.addNull();
+    } else {
+        encoder.addBstr(data);
+    }
+    encoder.addBstr(tag);
+    encoder.flush();
+    return message;
+}
+
 bool ecdsaSignatureCoseToDer(const vector<uint8_t>& ecdsaCoseSignature,
                              vector<uint8_t>& ecdsaDerSignature) {
     if (ecdsaCoseSignature.size() != 64) {
@@ -1783,50 +1922,16 @@ optional<vector<uint8_t>> coseSignEcDsaWithSignature(const vector<uint8_t>& sign
         return {};
     }
 
-    cppbor::Map unprotectedHeaders;
     cppbor::Map protectedHeaders;
-
     protectedHeaders.add(COSE_LABEL_ALG, COSE_ALG_ECDSA_256);
-
-    if (certificateChain.size() != 0) {
-        optional<vector<vector<uint8_t>>> certs = support::certificateChainSplit(certificateChain);
-        if (!certs) {
-            LOG(ERROR) << "Error splitting certificate chain";
-            return {};
-        }
-        if (certs.value().size() == 1) {
-            unprotectedHeaders.add(COSE_LABEL_X5CHAIN, certs.value()[0]);
-        } else {
-            cppbor::Array certArray;
-            for (const vector<uint8_t>& cert : certs.value()) {
-                certArray.add(cert);
-            }
-            unprotectedHeaders.add(COSE_LABEL_X5CHAIN, std::move(certArray));
-        }
-    }
-
     vector<uint8_t> encodedProtectedHeaders = coseEncodeHeaders(protectedHeaders);
 
-    cppbor::Array coseSign1;
-    coseSign1.add(encodedProtectedHeaders);
-    coseSign1.add(std::move(unprotectedHeaders));
-    if (data.size() == 0) {
-        cppbor::Null nullValue;
-        coseSign1.add(std::move(nullValue));
-    } else {
-        coseSign1.add(data);
-    }
-    coseSign1.add(signatureToBeSigned);
-    vector<uint8_t> signatureCoseSign1;
-    signatureCoseSign1 = coseSign1.encode();
-
-    return signatureCoseSign1;
+    return coseEncodeMessage(encodedProtectedHeaders, certificateChain, data, signatureToBeSigned);
 }
 
 optional<vector<uint8_t>> coseSignEcDsa(const vector<uint8_t>& key, const vector<uint8_t>& data,
                                         const vector<uint8_t>& detachedContent,
                                         const vector<uint8_t>& certificateChain) {
-    cppbor::Map unprotectedHeaders;
     cppbor::Map protectedHeaders;
 
     if (data.size() > 0 && detachedContent.size() > 0) {
@@ -1836,28 +1941,11 @@ optional<vector<uint8_t>> coseSignEcDsa(const vector<uint8_t>& key, const vector
 
     protectedHeaders.add(COSE_LABEL_ALG, COSE_ALG_ECDSA_256);
 
-    if (certificateChain.size() != 0) {
-        optional<vector<vector<uint8_t>>> certs = support::certificateChainSplit(certificateChain);
-        if (!certs) {
-            LOG(ERROR) << "Error splitting certificate chain";
-            return {};
-        }
-        if (certs.value().size() == 1) {
-            unprotectedHeaders.add(COSE_LABEL_X5CHAIN, certs.value()[0]);
-        } else {
-            cppbor::Array certArray;
-            for (const vector<uint8_t>& cert : certs.value()) {
-                certArray.add(cert);
-            }
-            unprotectedHeaders.add(COSE_LABEL_X5CHAIN, std::move(certArray));
-        }
-    }
-
     vector<uint8_t> encodedProtectedHeaders = coseEncodeHeaders(protectedHeaders);
-    vector<uint8_t> toBeSigned =
-            coseBuildToBeSigned(encodedProtectedHeaders, data, detachedContent);
+    vector<uint8_t> toBeSignedDigest =
+            coseToBeSignedDigest(encodedProtectedHeaders, data, detachedContent);
 
-    optional<vector<uint8_t>> derSignature = signEcDsa(key, toBeSigned);
+    optional<vector<uint8_t>> derSignature = signEcDsaDigest(key, toBeSignedDigest);
     if (!derSignature) {
         LOG(ERROR) << "Error signing toBeSigned data";
         return {};
@@ -1868,19 +1956,7 @@ optional<vector<uint8_t>> coseSignEcDsa(const vector<uint8_t>& key, const vector
         return {};
     }
 
-    cppbor::Array coseSign1;
-    coseSign1.add(encodedProtectedHeaders);
-    coseSign1.add(std::move(unprotectedHeaders));
-    if (data.size() == 0) {
-        cppbor::Null nullValue;
-        coseSign1.add(std::move(nullValue));
-    } else {
-        coseSign1.add(data);
-    }
-    coseSign1.add(coseSignature);
-    vector<uint8_t> signatureCoseSign1;
-    signatureCoseSign1 = coseSign1.encode();
-    return signatureCoseSign1;
+    return coseEncodeMessage(encodedProtectedHeaders, certificateChain, data, coseSignature);
 }
 
 bool coseCheckEcDsaSignature(const vector<uint8_t>& signatureCoseSign1,
@@ -1949,9 +2025,9 @@ bool coseCheckEcDsaSignature(const vector<uint8_t>& signatureCoseSign1,
         return false;
     }
 
-    vector<uint8_t> toBeSigned =
-            coseBuildToBeSigned(encodedProtectedHeaders, data, detachedContent);
-    if (!checkEcDsaSignature(support::sha256(toBeSigned), derSignature, publicKey)) {
+    vector<uint8_t> toBeSignedDigest =
+            coseToBeSignedDigest(encodedProtectedHeaders, data, detachedContent);
+    if (!checkEcDsaSignature(toBeSignedDigest, derSignature, publicKey)) {
         LOG(ERROR) << "Signature check failed";
         return false;
     }
@@ -2134,33 +2210,8 @@ optional<vector<uint8_t>> coseSignGetX5Chain(const vector<uint8_t>& signatureCos
     return {};
 }
 
-vector<uint8_t> coseBuildToBeMACed(const vector<uint8_t>& encodedProtectedHeaders,
-                                   const vector<uint8_t>& data,
-                                   const vector<uint8_t>& detachedContent) {
-    cppbor::Array macStructure;
-    macStructure.add("MAC0");
-    macStructure.add(encodedProtectedHeaders);
-
-    // We currently don't support Externally Supplied Data (RFC 8152 section 4.3)
-    // so external_aad is the empty bstr
-    vector<uint8_t> emptyExternalAad;
-    macStructure.add(emptyExternalAad);
-
-    // Next field is the payload, independently of how it's transported (RFC
-    // 8152 section 4.4). Since our API specifies only one of |data| and
-    // |detachedContent| can be non-empty, it's simply just the non-empty one.
-    if (data.size() > 0) {
-        macStructure.add(data);
-    } else {
-        macStructure.add(detachedContent);
-    }
-
-    return macStructure.encode();
-}
-
 optional<vector<uint8_t>> coseMac0(const vector<uint8_t>& key, const vector<uint8_t>& data,
                                    const vector<uint8_t>& detachedContent) {
-    cppbor::Map unprotectedHeaders;
     cppbor::Map protectedHeaders;
 
     if (data.size() > 0 && detachedContent.size() > 0) {
@@ -2171,47 +2222,33 @@ optional<vector<uint8_t>> coseMac0(const vector<uint8_t>& key, const vector<uint
     protectedHeaders.add(COSE_LABEL_ALG, COSE_ALG_HMAC_256_256);
 
     vector<uint8_t> encodedProtectedHeaders = coseEncodeHeaders(protectedHeaders);
-    vector<uint8_t> toBeMACed = coseBuildToBeMACed(encodedProtectedHeaders, data, detachedContent);
 
-    optional<vector<uint8_t>> mac = hmacSha256(key, toBeMACed);
-    if (!mac) {
+    // The MAC_structure is streamed into the HMAC instead of being encoded first.
+    HmacSha256 ctx;
+    bool ok = ctx.init(key.data(), key.size());
+    if (ok) {
+        StreamEncoder encoder(
+                [&](const uint8_t* bytes, size_t size) { ok = ok && ctx.update(bytes, size); });
+        coseWriteToBeSigned(encoder, "MAC0", encodedProtectedHeaders, data, detachedContent);
+    }
+    vector<uint8_t> mac(32);
+    if (!ok || !ctx.finish(mac.data())) {
         LOG(ERROR) << "Error MACing toBeMACed data";
         return {};
     }
 
-    cppbor::Array array;
-    array.add(encodedProtectedHeaders);
-    array.add(std::move(unprotectedHeaders));
-    if (data.size() == 0) {
-        cppbor::Null nullValue;
-        array.add(std::move(nullValue));
-    } else {
-        array.add(data);
-    }
-    array.add(mac.value());
-    return array.encode();
+    return coseEncodeMessage(encodedProtectedHeaders, {}, data, mac);
 }
 
 optional<vector<uint8_t>> coseMacWithDigest(const vector<uint8_t>& digestToBeMaced,
                                             const vector<uint8_t>& data) {
-    cppbor::Map unprotectedHeaders;
     cppbor::Map protectedHeaders;
 
     protectedHeaders.add(COSE_LABEL_ALG, COSE_ALG_HMAC_256_256);
 
     vector<uint8_t> encodedProtectedHeaders = coseEncodeHeaders(protectedHeaders);
 
-    cppbor::Array array;
-    array.add(encodedProtectedHeaders);
-    array.add(std::move(unprotectedHeaders));
-    if (data.size() == 0) {
-        cppbor::Null nullValue;
-        array.add(std::move(nullValue));
-    } else {
-        array.add(data);
-    }
-    array.add(digestToBeMaced);
-    return array.encode();
+    return coseEncodeMessage(encodedProtectedHeaders, {}, data, digestToBeMaced);
 }
 
 // ---------------------------------------------------------------------------
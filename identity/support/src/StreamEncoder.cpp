@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2022, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "IdentityCredentialSupport"
+
+#include <android/hardware/identity/support/StreamEncoder.h>
+
+#include <string.h>
+
+#include <android-base/logging.h>
+
+namespace android {
+namespace hardware {
+namespace identity {
+namespace support {
+
+namespace {
+
+// Largest possible header: initial byte plus an eight byte length.
+constexpr size_t kMaxHeaderSize = 9;
+
+}  // namespace
+
+StreamEncoder& StreamEncoder::addHeader(cppbor::MajorType type, uint64_t addlInfo) {
+    if (kBufferSize - buffered_ < kMaxHeaderSize) flush();
+    uint8_t* pos = buffer_ + buffered_;
+    uint8_t* end = cppbor::encodeHeader(type, addlInfo, pos, buffer_ + kBufferSize);
+    CHECK(end != nullptr);
+    buffered_ += end - pos;
+    encoded_ += end - pos;
+    return *this;
+}
+
+StreamEncoder& StreamEncoder::addBstr(const uint8_t* data, size_t size) {
+    addHeader(cppbor::BSTR, size);
+    return addRaw(data, size);
+}
+
+StreamEncoder& StreamEncoder::addTstr(std::string_view value) {
+    addHeader(cppbor::TSTR, value.size());
+    return addRaw(reinterpret_cast<const uint8_t*>(value.data()), value.size());
+}
+
+StreamEncoder& StreamEncoder::add(const cppbor::Item& item) {
+    size_t size = item.encodedSize();
+    if (size > kBufferSize) {
+        std::vector<uint8_t> encoded = item.encode();
+        return addRaw(encoded.data(), encoded.size());
+    }
+    if (kBufferSize - buffered_ < size) flush();
+    uint8_t* end = item.encode(buffer_ + buffered_, buffer_ + kBufferSize);
+    CHECK(end == buffer_ + buffered_ + size);
+    buffered_ += size;
+    encoded_ += size;
+    return *this;
+}
+
+StreamEncoder& StreamEncoder::addRaw(const uint8_t* data, size_t size) {
+    // Empty vectors may have a null data(), which must not be passed to memcpy().
+    if (size == 0) return *this;
+    encoded_ += size;
+    if (size >= kBufferSize) {
+        flush();
+        sink_(data, size);
+        return *this;
+    }
+    if (kBufferSize - buffered_ < size) flush();
+    memcpy(buffer_ + buffered_, data, size);
+    buffered_ += size;
+    return *this;
+}
+
+void StreamEncoder::flush() {
+    if (buffered_ == 0) return;
+    sink_(buffer_, buffered_);
+    buffered_ = 0;
+}
+
+}  // namespace support
+}  // namespace identity
+}  // namespace hardware
+}  // namespace android
@@ -299,6 +299,76 @@ TEST(IdentityCredentialSupport, hmacSha256) {
     ASSERT_EQ(expected, hmac.value());
 }
 
+TEST(IdentityCredentialSupport, StreamingHashes) {
+    vector<uint8_t> key = strToVec("key");
+    vector<uint8_t> data = strToVec("The quick brown fox jumps over the lazy dog");
+
+    support::Sha256 sha256;
+    support::HmacSha256 hmacSha256;
+    ASSERT_TRUE(hmacSha256.init(key.data(), key.size()));
+    for (size_t n = 0; n < data.size(); n += 10) {
+        size_t size = std::min(data.size() - n, size_t(10));
+        sha256.update(data.data() + n, size);
+        ASSERT_TRUE(hmacSha256.update(data.data() + n, size));
+    }
+    vector<uint8_t> digest(32);
+    sha256.finish(digest.data());
+    EXPECT_EQ(support::sha256(data), digest);
+    vector<uint8_t> hmac(32);
+    ASSERT_TRUE(hmacSha256.finish(hmac.data()));
+    EXPECT_EQ(support::hmacSha256(key, data).value(), hmac);
+}
+
+TEST(IdentityCredentialSupport, Aes128GcmInPlace) {
+    vector<uint8_t> key(support::kAes128GcmKeySize, 0x42);
+    vector<uint8_t> nonce(support::kAesGcmIvSize, 0x17);
+    vector<uint8_t> aad = strToVec("additional data");
+    vector<uint8_t> data(100000);
+    for (size_t n = 0; n < data.size(); n++) {
+        data[n] = n & 0xff;
+    }
+
+    optional<vector<uint8_t>> expected = support::encryptAes128Gcm(key, nonce, data, aad);
+    ASSERT_TRUE(expected);
+
+    vector<uint8_t> encrypted(data.size() + support::kAesGcmIvSize + support::kAesGcmTagSize);
+    ASSERT_TRUE(support::encryptAes128Gcm(key.data(), nonce.data(), data.data(), data.size(),
+                                          aad.data(), aad.size(), encrypted.data()));
+    EXPECT_EQ(expected.value(), encrypted);
+
+    // Chunked encryption produces the same output.
+    vector<uint8_t> chunked(encrypted.size());
+    memcpy(chunked.data(), nonce.data(), nonce.size());
+    support::Aes128GcmEncrypter encrypter;
+    ASSERT_TRUE(encrypter.init(key.data(), nonce.data(), aad.data(), aad.size()));
+    for (size_t n = 0; n < data.size(); n += 4096) {
+        size_t size = std::min(data.size() - n, size_t(4096));
+        ASSERT_TRUE(encrypter.update(data.data() + n, size, chunked.data() + nonce.size() + n));
+    }
+    ASSERT_TRUE(encrypter.finish(chunked.data() + nonce.size() + data.size()));
+    EXPECT_EQ(expected.value(), chunked);
+
+    vector<uint8_t> decrypted(data.size());
+    ASSERT_TRUE(support::decryptAes128Gcm(key.data(), encrypted.data(), encrypted.size(),
+                                          aad.data(), aad.size(), decrypted.data()));
+    EXPECT_EQ(data, decrypted);
+
+    // Decrypting in place over the ciphertext.
+    support::Aes128GcmDecrypter decrypter;
+    uint8_t* cipherText = encrypted.data() + support::kAesGcmIvSize;
+    ASSERT_TRUE(decrypter.init(key.data(), encrypted.data(), aad.data(), aad.size()));
+    ASSERT_TRUE(decrypter.update(cipherText, data.size(), cipherText));
+    ASSERT_TRUE(decrypter.finish(cipherText + data.size()));
+    EXPECT_EQ(data, vector<uint8_t>(cipherText, cipherText + data.size()));
+
+    // Tampering is detected.
+    chunked[chunked.size() - 1] ^= 0x01;
+    EXPECT_FALSE(support::decryptAes128Gcm(key.data(), chunked.data(), chunked.size(), aad.data(),
+                                           aad.size(), decrypted.data()));
+    EXPECT_FALSE(support::decryptAes128Gcm(key.data(), chunked.data(), 27, aad.data(), aad.size(),
+                                           decrypted.data()));
+}
+
 // See also CoseMac0 test in UtilUnitTest.java inside cts/tests/tests/identity/
 TEST(IdentityCredentialSupport, CoseMac0) {
     vector<uint8_t> key;
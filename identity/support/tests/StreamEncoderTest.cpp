@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2022, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <android/hardware/identity/support/StreamEncoder.h>
+
+#include <cppbor.h>
+
+using std::vector;
+
+namespace android {
+namespace hardware {
+namespace identity {
+
+namespace {
+
+// Collects what a StreamEncoder writes and how many times the sink was called.
+struct Collector {
+    vector<uint8_t> bytes;
+    size_t calls = 0;
+
+    support::StreamEncoder::Sink sink() {
+        return [this](const uint8_t* data, size_t size) {
+            bytes.insert(bytes.end(), data, data + size);
+            calls++;
+        };
+    }
+};
+
+cppbor::Map nameSpaces(size_t numElements, size_t valueSize) {
+    cppbor::Array items;
+    for (size_t n = 0; n < numElements; n++) {
+        items.add(cppbor::Map()
+                          .add("digestID", n)
+                          .add("elementIdentifier", "element_" + std::to_string(n))
+                          .add("elementValue", vector<uint8_t>(valueSize, n & 0xff)));
+    }
+    cppbor::Map nameSpaces;
+    nameSpaces.add("org.iso.18013.5.1", std::move(items));
+    return nameSpaces;
+}
+
+}  // namespace
+
+TEST(StreamEncoder, ScalarsMatchItemEncoding) {
+    Collector out;
+    {
+        support::StreamEncoder encoder(out.sink());
+        encoder.beginArray(8)
+                .addUint(0)
+                .addUint(24)
+                .addUint(0x100000000)
+                .addInt(-1)
+                .addInt(-500)
+                .addBool(true)
+                .addNull()
+                .addTstr("");
+    }
+    cppbor::Array expected;
+    expected.add(0)
+            .add(24)
+            .add(0x100000000)
+            .add(-1)
+            .add(-500)
+            .add(cppbor::Bool(true))
+            .add(cppbor::Null())
+            .add("");
+    EXPECT_EQ(expected.encode(), out.bytes);
+}
+
+TEST(StreamEncoder, IncrementalStructureMatchesItemEncoding) {
+    vector<uint8_t> portrait(16 * 1024, 0x42);
+    cppbor::Map inner = nameSpaces(4, 8);
+
+    Collector out;
+    {
+        support::StreamEncoder encoder(out.sink());
+        encoder.beginArray(4)
+                .addTstr("DeviceAuthentication")
+                .addBstr(portrait)
+                .addBstr(vector<uint8_t>())
+                .addSemantic(24)
+                .addBstrWrapped(inner);
+    }
+
+    cppbor::Array expected;
+    expected.add("DeviceAuthentication")
+            .add(portrait)
+            .add(vector<uint8_t>())
+            .add(cppbor::SemanticTag(24, inner.encode()));
+    EXPECT_EQ(expected.encode(), out.bytes);
+}
+
+TEST(StreamEncoder, LargeStringsBypassBuffer) {
+    vector<uint8_t> portrait(16 * 1024, 0x42);
+    Collector out;
+    {
+        support::StreamEncoder encoder(out.sink());
+        encoder.addBstr(portrait);
+    }
+    // The header is flushed before the contents, which are passed through as is.
+    EXPECT_EQ(2u, out.calls);
+    EXPECT_EQ(cppbor::Bstr(portrait).encode(), out.bytes);
+}
+
+TEST(StreamEncoder, AddItem) {
+    // Both an item that fits in the internal buffer and one that doesn't.
+    for (size_t numElements : {1, 64}) {
+        cppbor::Map item = nameSpaces(numElements, 32);
+        Collector out;
+        size_t encoded;
+        {
+            support::StreamEncoder encoder(out.sink());
+            encoder.beginArray(2).addTstr("x").add(item);
+            encoded = encoder.bytesEncoded();
+        }
+        vector<uint8_t> expected = cppbor::Array().add("x").add(item.clone()).encode();
+        EXPECT_EQ(expected, out.bytes) << numElements;
+        EXPECT_EQ(expected.size(), encoded) << numElements;
+    }
+}
+
+}  // namespace identity
+}  // namespace hardware
+}  // namespace android
@@ -17,6 +17,12 @@
 #include <keymasterV4_0/authorization_set.h>
 
 #include <assert.h>
+#include <string.h>
+
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <string>
 
 #include <android-base/logging.h>
 
@@ -83,28 +89,41 @@ bool keyParamEqual(const KeyParameter& a, const KeyParameter& b) {
     return false;
 }
 
+namespace {
+
+// Orders entries by tag alone, for lookups in sets that are sorted by tag.
+struct TagOrder {
+    bool operator()(const KeyParameter& param, Tag tag) const { return param.tag < tag; }
+    bool operator()(Tag tag, const KeyParameter& param) const { return tag < param.tag; }
+    bool operator()(const KeyParameter& a, const KeyParameter& b) const { return a.tag < b.tag; }
+};
+
+// Below this size a linear scan beats a binary search.
+constexpr size_t kBinarySearchMinSize = 32;
+
+}  // namespace
+
+void AuthorizationSet::updateSortedByTag() {
+    sortedByTag_ = std::is_sorted(data_.begin(), data_.end(), TagOrder());
+}
+
 void AuthorizationSet::Sort() {
     std::sort(data_.begin(), data_.end(), keyParamLess);
+    sortedByTag_ = true;
 }
 
 void AuthorizationSet::Deduplicate() {
     if (data_.empty()) return;
 
     Sort();
-    std::vector<KeyParameter> result;
-
-    auto curr = data_.begin();
-    auto prev = curr++;
-    for (; curr != data_.end(); ++prev, ++curr) {
-        if (prev->tag == Tag::INVALID) continue;
 
-        if (!keyParamEqual(*prev, *curr)) {
-            result.push_back(std::move(*prev));
-        }
-    }
-    result.push_back(std::move(*prev));
+    // INVALID sorts first. Invalid entries are dropped unless there is nothing else.
+    auto first = std::find_if(data_.begin(), data_.end(),
+                              [](const KeyParameter& param) { return param.tag != Tag::INVALID; });
+    if (first == data_.end()) --first;
 
-    std::swap(data_, result);
+    data_.erase(std::unique(first, data_.end(), keyParamEqual), data_.end());
+    data_.erase(data_.begin(), first);
 }
 
 void AuthorizationSet::Union(const AuthorizationSet& other) {
@@ -114,32 +133,45 @@ void AuthorizationSet::Union(const AuthorizationSet& other) {
 
 void AuthorizationSet::Subtract(const AuthorizationSet& other) {
     Deduplicate();
+    if (data_.empty()) return;
 
-    auto i = other.begin();
-    while (i != other.end()) {
-        int pos = -1;
-        do {
-            pos = find(i->tag, pos);
-            if (pos != -1 && keyParamEqual(*i, data_[pos])) {
-                data_.erase(data_.begin() + pos);
-                break;
-            }
-        } while (pos != -1);
-        ++i;
+    // data_ is now sorted and free of duplicates, so every entry of other matches at most one
+    // entry, found by binary search. Matches are marked, then removed in a single pass. Sets are
+    // nearly always small enough for the marks to fit in one word.
+    constexpr size_t kSmallSetSize = 64;
+    uint64_t smallMarks = 0;
+    std::vector<bool> largeMarks(data_.size() > kSmallSetSize ? data_.size() : 0);
+    auto marked = [&](size_t i) -> bool {
+        return data_.size() > kSmallSetSize ? largeMarks[i] : (smallMarks >> i) & 1;
+    };
+
+    size_t matches = 0;
+    for (const auto& param : other) {
+        auto pos = std::lower_bound(data_.begin(), data_.end(), param, keyParamLess);
+        if (pos == data_.end() || !keyParamEqual(*pos, param)) continue;
+        size_t i = pos - data_.begin();
+        if (marked(i)) continue;
+        if (data_.size() > kSmallSetSize) {
+            largeMarks[i] = true;
+        } else {
+            smallMarks |= uint64_t(1) << i;
+        }
+        ++matches;
     }
-}
+    if (matches == 0) return;
 
-void AuthorizationSet::Filter(std::function<bool(const KeyParameter&)> doKeep) {
-    std::vector<KeyParameter> result;
-    for (auto& param : data_) {
-        if (doKeep(param)) {
-            result.push_back(std::move(param));
-        }
+    size_t kept = 0;
+    for (size_t i = 0; i < data_.size(); ++i) {
+        if (marked(i)) continue;
+        if (kept != i) data_[kept] = std::move(data_[i]);
+        ++kept;
     }
-    std::swap(data_, result);
+    data_.resize(kept);
 }
 
 KeyParameter& AuthorizationSet::operator[](int at) {
+    // The caller may change the tag.
+    sortedByTag_ = false;
     return data_[at];
 }
 
@@ -149,17 +181,30 @@ const KeyParameter& AuthorizationSet::operator[](int at) const {
 
 void AuthorizationSet::Clear() {
     data_.clear();
+    sortedByTag_ = true;
 }
 
 size_t AuthorizationSet::GetTagCount(Tag tag) const {
+    if (sortedByTag_ && data_.size() >= kBinarySearchMinSize) {
+        auto range = std::equal_range(data_.begin(), data_.end(), tag, TagOrder());
+        return range.second - range.first;
+    }
     size_t count = 0;
-    for (int pos = -1; (pos = find(tag, pos)) != -1;) ++count;
+    for (const auto& param : data_) {
+        if (param.tag == tag) ++count;
+    }
     return count;
 }
 
 int AuthorizationSet::find(Tag tag, int begin) const {
     auto iter = data_.begin() + (1 + begin);
 
+    if (sortedByTag_ && data_.size() >= kBinarySearchMinSize) {
+        iter = std::lower_bound(iter, data_.end(), tag, TagOrder());
+        if (iter != data_.end() && iter->tag == tag) return iter - data_.begin();
+        return -1;
+    }
+
     while (iter != data_.end() && iter->tag != tag) ++iter;
 
     if (iter != data_.end()) return iter - data_.begin();
@@ -200,9 +245,22 @@ NullOr<const KeyParameter&> AuthorizationSet::GetEntry(Tag tag) const {
  * | 32 bit indirect_offset |
  */
 
+/**
+ * The indirect and element sections are collected in plain byte buffers, sized up front, and then
+ * written to the output stream in one go each.
+ */
+struct OutBuffer {
+    std::string data;
+    bool bad = false;
+
+    void write(const void* bytes, size_t size) {
+        data.append(reinterpret_cast<const char*>(bytes), size);
+    }
+};
+
 struct OutStreams {
-    std::ostream& indirect;
-    std::ostream& elements;
+    OutBuffer& indirect;
+    OutBuffer& elements;
     size_t skipped;
 };
 
@@ -212,31 +270,31 @@ OutStreams& serializeParamValue(OutStreams& out, const hidl_vec<uint8_t>& blob)
     // write blob_length
     auto blob_length = blob.size();
     if (blob_length > std::numeric_limits<uint32_t>::max()) {
-        out.elements.setstate(std::ios_base::badbit);
+        out.elements.bad = true;
         return out;
     }
     buffer = blob_length;
-    out.elements.write(reinterpret_cast<const char*>(&buffer), sizeof(uint32_t));
+    out.elements.write(&buffer, sizeof(uint32_t));
 
     // write indirect_offset
-    auto offset = out.indirect.tellp();
-    if (offset < 0 || offset > std::numeric_limits<uint32_t>::max() ||
+    auto offset = out.indirect.data.size();
+    if (offset > std::numeric_limits<uint32_t>::max() ||
         uint32_t(offset) + uint32_t(blob_length) < uint32_t(offset)) {  // overflow check
-        out.elements.setstate(std::ios_base::badbit);
+        out.elements.bad = true;
         return out;
     }
     buffer = offset;
-    out.elements.write(reinterpret_cast<const char*>(&buffer), sizeof(uint32_t));
+    out.elements.write(&buffer, sizeof(uint32_t));
 
     // write blob to indirect stream
-    if (blob_length) out.indirect.write(reinterpret_cast<const char*>(&blob[0]), blob_length);
+    if (blob_length) out.indirect.write(blob.data(), blob_length);
 
     return out;
 }
 
 template <typename T>
 OutStreams& serializeParamValue(OutStreams& out, const T& value) {
-    out.elements.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    out.elements.write(&value, sizeof(T));
     return out;
 }
 
@@ -247,7 +305,7 @@ OutStreams& serialize(TAG_INVALID_t&&, OutStreams& out, const KeyParameter&) {
 }
 template <typename T>
 OutStreams& serialize(T ttag, OutStreams& out, const KeyParameter& param) {
-    out.elements.write(reinterpret_cast<const char*>(&param.tag), sizeof(int32_t));
+    out.elements.write(&param.tag, sizeof(int32_t));
     return serializeParamValue(out, accessTagValue(ttag, param));
 }
 
@@ -286,66 +344,99 @@ OutStreams& serialize(OutStreams& out, const KeyParameter& param) {
 }
 
 std::ostream& serialize(std::ostream& out, const std::vector<KeyParameter>& params) {
-    std::stringstream indirect;
-    std::stringstream elements;
+    OutBuffer indirect;
+    OutBuffer elements;
+    size_t indirect_capacity = 0;
+    for (const auto& param : params) {
+        indirect_capacity += param.blob.size();
+    }
+    indirect.data.reserve(indirect_capacity);
+    // Each element is a tag followed by a 64 bit value or a 32 bit length and offset.
+    elements.data.reserve(params.size() * (sizeof(uint32_t) + sizeof(uint64_t)));
+
     OutStreams streams = {indirect, elements, 0};
     for (const auto& param : params) {
         serialize(streams, param);
     }
-    if (indirect.bad() || elements.bad()) {
+    if (indirect.bad || elements.bad) {
         out.setstate(std::ios_base::badbit);
         return out;
     }
-    auto pos = indirect.tellp();
-    if (pos < 0 || pos > std::numeric_limits<uint32_t>::max()) {
+    if (indirect.data.size() > std::numeric_limits<uint32_t>::max() ||
+        elements.data.size() > std::numeric_limits<uint32_t>::max()) {
         out.setstate(std::ios_base::badbit);
         return out;
     }
-    uint32_t indirect_size = pos;
-    pos = elements.tellp();
-    if (pos < 0 || pos > std::numeric_limits<uint32_t>::max()) {
-        out.setstate(std::ios_base::badbit);
-        return out;
-    }
-    uint32_t elements_size = pos;
+    uint32_t indirect_size = indirect.data.size();
+    uint32_t elements_size = elements.data.size();
     uint32_t element_count = params.size() - streams.skipped;
 
     out.write(reinterpret_cast<const char*>(&indirect_size), sizeof(uint32_t));
-
-    pos = out.tellp();
-    if (indirect_size) out << indirect.rdbuf();
-    assert(out.tellp() - pos == indirect_size);
+    if (indirect_size) out.write(indirect.data.data(), indirect_size);
 
     out.write(reinterpret_cast<const char*>(&element_count), sizeof(uint32_t));
     out.write(reinterpret_cast<const char*>(&elements_size), sizeof(uint32_t));
-
-    pos = out.tellp();
-    if (elements_size) out << elements.rdbuf();
-    assert(out.tellp() - pos == elements_size);
+    if (elements_size) out.write(elements.data.data(), elements_size);
 
     return out;
 }
 
+/**
+ * Reads from one of the sections of a serialized set, which has already been read into memory.
+ * Like an istream, a short read or a seek past the end puts it in a failed state in which all
+ * further reads and seeks do nothing.
+ */
+class InBuffer {
+  public:
+    explicit InBuffer(const std::string& data) : data_(data) {}
+
+    void read(void* out, size_t size) {
+        if (failed_) return;
+        if (data_.size() - pos_ < size) {
+            failed_ = true;
+            return;
+        }
+        if (size) memcpy(out, data_.data() + pos_, size);
+        pos_ += size;
+    }
+
+    void seekg(size_t pos) {
+        if (failed_) return;
+        if (pos > data_.size()) {
+            failed_ = true;
+            return;
+        }
+        pos_ = pos;
+    }
+
+    void setstate(std::ios_base::iostate) { failed_ = true; }
+
+  private:
+    const std::string& data_;
+    size_t pos_ = 0;
+    bool failed_ = false;
+};
+
 struct InStreams {
-    std::istream& indirect;
-    std::istream& elements;
+    InBuffer& indirect;
+    InBuffer& elements;
     size_t invalids;
 };
 
 InStreams& deserializeParamValue(InStreams& in, hidl_vec<uint8_t>* blob) {
     uint32_t blob_length = 0;
     uint32_t offset = 0;
-    in.elements.read(reinterpret_cast<char*>(&blob_length), sizeof(uint32_t));
+    in.elements.read(&blob_length, sizeof(uint32_t));
     blob->resize(blob_length);
-    in.elements.read(reinterpret_cast<char*>(&offset), sizeof(uint32_t));
+    in.elements.read(&offset, sizeof(uint32_t));
     in.indirect.seekg(offset);
-    in.indirect.read(reinterpret_cast<char*>(&(*blob)[0]), blob->size());
+    in.indirect.read(blob->data(), blob->size());
     return in;
 }
 
 template <typename T>
 InStreams& deserializeParamValue(InStreams& in, T* value) {
-    in.elements.read(reinterpret_cast<char*>(value), sizeof(T));
+    in.elements.read(value, sizeof(T));
     return in;
 }
 
@@ -388,7 +479,7 @@ struct choose_deserializer<TypedTag<tag_type, tag>, Tail...> {
 };
 
 InStreams& deserialize(InStreams& in, KeyParameter* param) {
-    in.elements.read(reinterpret_cast<char*>(&param->tag), sizeof(Tag));
+    in.elements.read(&param->tag, sizeof(Tag));
     return choose_deserializer<all_tags_t>::deserialize(in, param);
 }
 
@@ -416,9 +507,8 @@ std::istream& deserialize(std::istream& in, std::vector<KeyParameter>* params) {
 
     if (in.bad()) return in;
 
-    // TODO write one-shot stream buffer to avoid copying here
-    std::stringstream indirect(indirect_buffer);
-    std::stringstream elements(elements_buffer);
+    InBuffer indirect(indirect_buffer);
+    InBuffer elements(elements_buffer);
     InStreams streams = {indirect, elements, 0};
 
     params->resize(element_count);
@@ -432,14 +522,9 @@ std::istream& deserialize(std::istream& in, std::vector<KeyParameter>* params) {
      * This makes sure that invalid tags are filtered from the result before it is returned.
      */
     if (streams.invalids > 0) {
-        std::vector<KeyParameter> filtered(element_count - streams.invalids);
-        auto ifiltered = filtered.begin();
-        for (auto& p : *params) {
-            if (p.tag != Tag::INVALID) {
-                *ifiltered++ = std::move(p);
-            }
-        }
-        *params = std::move(filtered);
+        params->erase(std::remove_if(params->begin(), params->end(),
+                                     [](const KeyParameter& p) { return p.tag == Tag::INVALID; }),
+                      params->end());
     }
     return in;
 }
@@ -450,6 +535,7 @@ void AuthorizationSet::Serialize(std::ostream* out) const {
 
 void AuthorizationSet::Deserialize(std::istream* in) {
     deserialize(*in, &data_);
+    updateSortedByTag();
 }
 
 AuthorizationSetBuilder& AuthorizationSetBuilder::RsaKey(uint32_t key_size,
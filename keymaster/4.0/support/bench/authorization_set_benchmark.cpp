@@ -0,0 +1,151 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sstream>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include <keymasterV4_0/authorization_set.h>
+
+namespace android {
+namespace hardware {
+namespace keymaster {
+namespace V4_0 {
+namespace {
+
+hidl_vec<uint8_t> bytes(const std::string& str) {
+    return hidl_vec<uint8_t>(str.begin(), str.end());
+}
+
+// Roughly what a key generation request from keystore looks like.
+AuthorizationSet keyGenParams() {
+    return AuthorizationSetBuilder()
+            .RsaSigningKey(2048, 65537)
+            .Digest(Digest::SHA_2_256, Digest::SHA_2_384, Digest::SHA_2_512)
+            .Padding(PaddingMode::RSA_PSS, PaddingMode::RSA_PKCS1_1_5_SIGN)
+            .Authorization(TAG_NO_AUTH_REQUIRED)
+            .Authorization(TAG_APPLICATION_ID, bytes("com.example.app"))
+            .Authorization(TAG_CREATION_DATETIME, uint64_t(1600000000000))
+            .Authorization(TAG_ATTESTATION_CHALLENGE, bytes("challenge"));
+}
+
+// Roughly what the key characteristics of an attested key look like, with |extra| additional
+// user secure ids to grow the set.
+AuthorizationSet keyCharacteristics(size_t extra) {
+    AuthorizationSetBuilder builder;
+    builder.Authorizations(keyGenParams())
+            .Authorization(TAG_ORIGIN, KeyOrigin::GENERATED)
+            .Authorization(TAG_OS_VERSION, 110000u)
+            .Authorization(TAG_OS_PATCHLEVEL, 202201u)
+            .Authorization(TAG_VENDOR_PATCHLEVEL, 20220105u)
+            .Authorization(TAG_BOOT_PATCHLEVEL, 20220105u)
+            .Authorization(TAG_USER_AUTH_TYPE, HardwareAuthenticatorType::FINGERPRINT)
+            .Authorization(TAG_AUTH_TIMEOUT, 300u);
+    for (size_t i = 0; i < extra; ++i) {
+        builder.Authorization(TAG_USER_SECURE_ID, uint64_t(i));
+    }
+    return std::move(builder);
+}
+
+void BM_Build(benchmark::State& state) {
+    for (auto _ : state) {
+        AuthorizationSet set = keyGenParams();
+        benchmark::DoNotOptimize(set.data());
+    }
+}
+
+// Validation code asks a handful of questions of each set, e.g. in VTS's
+// CheckCharacteristics() and keystore's enforcement.
+void lookups(benchmark::State& state, const AuthorizationSet& set) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(set.GetTagValue(TAG_KEY_SIZE));
+        benchmark::DoNotOptimize(set.GetTagValue(TAG_OS_PATCHLEVEL));
+        benchmark::DoNotOptimize(set.Contains(TAG_PURPOSE, KeyPurpose::SIGN));
+        benchmark::DoNotOptimize(set.Contains(TAG_DIGEST, Digest::SHA_2_512));
+        benchmark::DoNotOptimize(set.Contains(TAG_NO_AUTH_REQUIRED));
+        benchmark::DoNotOptimize(set.Contains(TAG_UNLOCKED_DEVICE_REQUIRED));
+        benchmark::DoNotOptimize(set.GetTagCount(TAG_USER_SECURE_ID));
+    }
+}
+
+void BM_LookupUnsorted(benchmark::State& state) {
+    lookups(state, keyCharacteristics(state.range(0)));
+}
+
+void BM_LookupSorted(benchmark::State& state) {
+    AuthorizationSet set = keyCharacteristics(state.range(0));
+    set.Sort();
+    lookups(state, set);
+}
+
+void BM_Union(benchmark::State& state) {
+    AuthorizationSet other = keyCharacteristics(state.range(0));
+    for (auto _ : state) {
+        AuthorizationSet set = keyGenParams();
+        set.Union(other);
+        benchmark::DoNotOptimize(set.data());
+    }
+}
+
+void BM_Subtract(benchmark::State& state) {
+    AuthorizationSet params = keyGenParams();
+    for (auto _ : state) {
+        state.PauseTiming();
+        AuthorizationSet set = keyCharacteristics(state.range(0));
+        state.ResumeTiming();
+        set.Subtract(params);
+        benchmark::DoNotOptimize(set.data());
+    }
+}
+
+void BM_Serialize(benchmark::State& state) {
+    AuthorizationSet set = keyCharacteristics(state.range(0));
+    for (auto _ : state) {
+        std::stringstream out;
+        set.Serialize(&out);
+        benchmark::DoNotOptimize(out);
+    }
+}
+
+void BM_Deserialize(benchmark::State& state) {
+    std::stringstream out;
+    keyCharacteristics(state.range(0)).Serialize(&out);
+    std::string serialized = out.str();
+    for (auto _ : state) {
+        std::stringstream in(serialized);
+        AuthorizationSet set;
+        set.Deserialize(&in);
+        benchmark::DoNotOptimize(set.data());
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_Build);
+BENCHMARK(BM_LookupUnsorted)->Arg(0)->Arg(16)->Arg(128);
+BENCHMARK(BM_LookupSorted)->Arg(0)->Arg(16)->Arg(128);
+BENCHMARK(BM_Union)->Arg(0)->Arg(16)->Arg(128);
+BENCHMARK(BM_Subtract)->Arg(0)->Arg(16)->Arg(128);
+BENCHMARK(BM_Serialize)->Arg(0)->Arg(16)->Arg(128);
+BENCHMARK(BM_Deserialize)->Arg(0)->Arg(16)->Arg(128);
+
+}  // namespace V4_0
+}  // namespace keymaster
+}  // namespace hardware
+}  // namespace android
+
+BENCHMARK_MAIN();
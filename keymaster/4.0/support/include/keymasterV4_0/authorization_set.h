@@ -17,6 +17,7 @@
 #ifndef SYSTEM_SECURITY_KEYSTORE_KM4_AUTHORIZATION_SET_H_
 #define SYSTEM_SECURITY_KEYSTORE_KM4_AUTHORIZATION_SET_H_
 
+#include <algorithm>
 #include <functional>
 #include <vector>
 
@@ -33,6 +34,10 @@ class AuthorizationSetBuilder;
  * An ordered collection of KeyParameters. It provides memory ownership and some convenient
  * functionality for sorting, deduplicating, joining, and subtracting sets of KeyParameters.
  * For serialization, wrap the backing store of this structure in a hidl_vec<KeyParameter>.
+ *
+ * The set keeps track of whether its entries are in ascending tag order, which is the case after
+ * Sort(), Deduplicate(), Union() and Subtract(), for sets received in canonical order and for sets
+ * built in tag order. Lookups by tag on such sets are binary searches instead of linear scans.
  */
 class AuthorizationSet {
    public:
@@ -44,10 +49,12 @@ class AuthorizationSet {
     AuthorizationSet(){};
 
     // Copy constructor.
-    AuthorizationSet(const AuthorizationSet& other) : data_(other.data_) {}
+    AuthorizationSet(const AuthorizationSet& other)
+        : data_(other.data_), sortedByTag_(other.sortedByTag_) {}
 
     // Move constructor.
-    AuthorizationSet(AuthorizationSet&& other) noexcept : data_(std::move(other.data_)) {}
+    AuthorizationSet(AuthorizationSet&& other) noexcept
+        : data_(std::move(other.data_)), sortedByTag_(other.sortedByTag_) {}
 
     // Constructor from hidl_vec<KeyParameter>
     AuthorizationSet(const hidl_vec<KeyParameter>& other) { *this = other; }
@@ -55,23 +62,23 @@ class AuthorizationSet {
     // Copy assignment.
     AuthorizationSet& operator=(const AuthorizationSet& other) {
         data_ = other.data_;
+        sortedByTag_ = other.sortedByTag_;
         return *this;
     }
 
     // Move assignment.
     AuthorizationSet& operator=(AuthorizationSet&& other) noexcept {
         data_ = std::move(other.data_);
+        sortedByTag_ = other.sortedByTag_;
         return *this;
     }
 
     AuthorizationSet& operator=(const hidl_vec<KeyParameter>& other) {
         if (other.size() > 0) {
-            data_.resize(other.size());
-            for (size_t i = 0; i < data_.size(); ++i) {
-                /* This makes a deep copy even of embedded blobs.
-                 * See assignment operator/copy constructor of hidl_vec.*/
-                data_[i] = other[i];
-            }
+            /* This makes a deep copy even of embedded blobs.
+             * See assignment operator/copy constructor of hidl_vec.*/
+            data_.assign(other.begin(), other.end());
+            updateSortedByTag();
         }
         return *this;
     }
@@ -98,6 +105,11 @@ class AuthorizationSet {
      */
     const KeyParameter* data() const { return data_.data(); }
 
+    /**
+     * Reserves space for \p count entries.
+     */
+    void reserve(size_t count) { data_.reserve(count); }
+
     /**
      * Sorts the set
      */
@@ -146,7 +158,12 @@ class AuthorizationSet {
      * Modifies this Authorization set such that it only keeps the entries for which doKeep
      * returns true.
      */
-    void Filter(std::function<bool(const KeyParameter&)> doKeep);
+    template <typename Predicate>
+    void Filter(Predicate doKeep) {
+        data_.erase(std::remove_if(data_.begin(), data_.end(),
+                                   [&](const KeyParameter& param) { return !doKeep(param); }),
+                    data_.end());
+    }
     /**
      * Returns the nth element of the set.
      * Like for std::vector::operator[] there is no range check performed. Use of out of range
@@ -169,12 +186,23 @@ class AuthorizationSet {
     template <TagType tag_type, Tag tag, typename ValueT, typename Comparator = std::equal_to<>>
     bool Contains(TypedTag<tag_type, tag> ttag, const ValueT& value,
                   Comparator cmp = Comparator()) const {
-        for (const auto& param : data_) {
-            auto entry = authorizationValue(ttag, param);
+        for (int pos = find(tag); pos != -1; pos = find(tag, pos)) {
+            auto entry = authorizationValue(ttag, data_[pos]);
             if (entry.isOk() && cmp(static_cast<ValueT>(entry.value()), value)) return true;
         }
         return false;
     }
+
+    /**
+     * Calls \p f with the value of each \p ttag entry, in order. The value type is the one
+     * TypedTag2ValueType maps \p ttag to, so mismatches are caught at compile time.
+     */
+    template <TagType tag_type, Tag tag, typename Function>
+    void ForEachTagValue(TypedTag<tag_type, tag> ttag, Function f) const {
+        for (int pos = find(tag); pos != -1; pos = find(tag, pos)) {
+            f(accessTagValue(ttag, data_[pos]));
+        }
+    }
     /**
      * Returns the number of \p tag entries.
      */
@@ -187,8 +215,14 @@ class AuthorizationSet {
         return {};
     }
 
-    void push_back(const KeyParameter& param) { data_.push_back(param); }
-    void push_back(KeyParameter&& param) { data_.push_back(std::move(param)); }
+    void push_back(const KeyParameter& param) {
+        noteAppended(param.tag);
+        data_.push_back(param);
+    }
+    void push_back(KeyParameter&& param) {
+        noteAppended(param.tag);
+        data_.push_back(std::move(param));
+    }
     void push_back(const AuthorizationSet& set) {
         for (auto& entry : set) {
             push_back(entry);
@@ -225,9 +259,18 @@ class AuthorizationSet {
     void Deserialize(std::istream* in);
 
    private:
+    friend class AuthorizationSetTest;
+
     NullOr<const KeyParameter&> GetEntry(Tag tag) const;
 
+    void noteAppended(Tag tag) {
+        if (sortedByTag_ && !data_.empty() && tag < data_.back().tag) sortedByTag_ = false;
+    }
+    void updateSortedByTag();
+
     std::vector<KeyParameter> data_;
+    // True if the entries in data_ are in ascending tag order.
+    bool sortedByTag_ = true;
 };
 
 class AuthorizationSetBuilder : public AuthorizationSet {
@@ -0,0 +1,251 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <keymasterV4_0/authorization_set.h>
+
+namespace android {
+namespace hardware {
+namespace keymaster {
+namespace V4_0 {
+
+// Sets of at least this size are searched with a binary search when sorted by tag.
+constexpr size_t kLargeSetSize = 32;
+
+class AuthorizationSetTest : public ::testing::Test {
+  protected:
+    static bool sortedByTag(const AuthorizationSet& set) { return set.sortedByTag_; }
+
+    // Returns a copy of |set| whose lookups are linear scans.
+    static AuthorizationSet withLinearLookups(const AuthorizationSet& set) {
+        AuthorizationSet copy(set);
+        copy.sortedByTag_ = false;
+        return copy;
+    }
+
+    // Checks that |set|, which must be sorted by tag, gives the same answers with binary searches
+    // as with linear scans.
+    static void expectSameLookups(const AuthorizationSet& set) {
+        ASSERT_TRUE(sortedByTag(set));
+        ASSERT_GE(set.size(), kLargeSetSize);
+        expectSameLookups(set, withLinearLookups(set));
+    }
+
+    static void expectSameLookups(const AuthorizationSet& a, const AuthorizationSet& b);
+};
+
+namespace {
+
+hidl_vec<uint8_t> bytes(const std::string& str) {
+    return hidl_vec<uint8_t>(str.begin(), str.end());
+}
+
+// Tags present in largeSet(), some of them repeated, and tags that are absent, including tags
+// that sort before, between and after the present ones.
+const Tag kTags[] = {
+        Tag::INVALID,          Tag::PURPOSE,         Tag::ALGORITHM,
+        Tag::KEY_SIZE,         Tag::BLOCK_MODE,      Tag::DIGEST,
+        Tag::PADDING,          Tag::RSA_PUBLIC_EXPONENT,
+        Tag::USER_SECURE_ID,   Tag::NO_AUTH_REQUIRED, Tag::USER_AUTH_TYPE,
+        Tag::AUTH_TIMEOUT,     Tag::APPLICATION_ID,  Tag::CREATION_DATETIME,
+        Tag::ORIGIN,           Tag::OS_VERSION,      Tag::OS_PATCHLEVEL,
+        Tag::UNLOCKED_DEVICE_REQUIRED,               Tag::ATTESTATION_CHALLENGE,
+        Tag::BOOT_PATCHLEVEL,
+};
+
+// Key characteristics with enough user secure ids to be searched with binary searches once
+// sorted. Built the way keymaster builds them, which is not in tag order.
+AuthorizationSet largeSet() {
+    AuthorizationSetBuilder builder;
+    builder.RsaSigningKey(2048, 65537)
+            .Digest(Digest::SHA_2_256, Digest::SHA_2_384, Digest::SHA_2_512)
+            .Padding(PaddingMode::RSA_PSS, PaddingMode::RSA_PKCS1_1_5_SIGN)
+            .Authorization(TAG_NO_AUTH_REQUIRED)
+            .Authorization(TAG_APPLICATION_ID, bytes("com.example.app"))
+            .Authorization(TAG_CREATION_DATETIME, uint64_t(1600000000000))
+            .Authorization(TAG_ORIGIN, KeyOrigin::GENERATED)
+            .Authorization(TAG_OS_PATCHLEVEL, 202201u)
+            .Authorization(TAG_USER_AUTH_TYPE, HardwareAuthenticatorType::FINGERPRINT)
+            .Authorization(TAG_AUTH_TIMEOUT, 300u);
+    for (uint64_t i = 0; i < 24; ++i) {
+        builder.Authorization(TAG_USER_SECURE_ID, i);
+    }
+    return std::move(builder);
+}
+
+AuthorizationSet sortedLargeSet() {
+    AuthorizationSet set = largeSet();
+    set.Sort();
+    return set;
+}
+
+std::vector<int> positions(const AuthorizationSet& set, Tag tag) {
+    std::vector<int> result;
+    for (int pos = set.find(tag); pos != -1; pos = set.find(tag, pos)) {
+        result.push_back(pos);
+    }
+    return result;
+}
+
+}  // namespace
+
+void AuthorizationSetTest::expectSameLookups(const AuthorizationSet& a,
+                                             const AuthorizationSet& b) {
+    for (Tag tag : kTags) {
+        EXPECT_EQ(a.Contains(tag), b.Contains(tag)) << toString(tag);
+        EXPECT_EQ(a.GetTagCount(tag), b.GetTagCount(tag)) << toString(tag);
+        EXPECT_EQ(positions(a, tag), positions(b, tag)) << toString(tag);
+    }
+
+    auto keySize = a.GetTagValue(TAG_KEY_SIZE);
+    ASSERT_EQ(keySize.isOk(), b.GetTagValue(TAG_KEY_SIZE).isOk());
+    if (keySize.isOk()) {
+        EXPECT_EQ(keySize.value(), b.GetTagValue(TAG_KEY_SIZE).value());
+    }
+    auto appId = a.GetTagValue(TAG_APPLICATION_ID);
+    ASSERT_EQ(appId.isOk(), b.GetTagValue(TAG_APPLICATION_ID).isOk());
+    if (appId.isOk()) {
+        EXPECT_EQ(appId.value(), b.GetTagValue(TAG_APPLICATION_ID).value());
+    }
+    EXPECT_EQ(a.GetTagValue(TAG_OS_VERSION).isOk(), b.GetTagValue(TAG_OS_VERSION).isOk());
+
+    EXPECT_EQ(a.Contains(TAG_DIGEST, Digest::SHA_2_512), b.Contains(TAG_DIGEST, Digest::SHA_2_512));
+    EXPECT_EQ(a.Contains(TAG_DIGEST, Digest::MD5), b.Contains(TAG_DIGEST, Digest::MD5));
+    EXPECT_EQ(a.Contains(TAG_USER_SECURE_ID, uint64_t(17)),
+              b.Contains(TAG_USER_SECURE_ID, uint64_t(17)));
+    EXPECT_EQ(a.Contains(TAG_USER_SECURE_ID, uint64_t(24)),
+              b.Contains(TAG_USER_SECURE_ID, uint64_t(24)));
+}
+
+TEST_F(AuthorizationSetTest, SortedLookupsMatchLinearLookups) {
+    AuthorizationSet unsorted = largeSet();
+    EXPECT_FALSE(sortedByTag(unsorted));
+
+    AuthorizationSet set = sortedLargeSet();
+    expectSameLookups(set);
+
+    EXPECT_TRUE(set.Contains(TAG_DIGEST, Digest::SHA_2_512));
+    EXPECT_TRUE(set.Contains(TAG_USER_SECURE_ID, uint64_t(17)));
+    EXPECT_FALSE(set.Contains(TAG_USER_SECURE_ID, uint64_t(24)));
+    EXPECT_EQ(24u, set.GetTagCount(Tag::USER_SECURE_ID));
+    EXPECT_EQ(2048u, set.GetTagValue(TAG_KEY_SIZE).value());
+    for (Tag tag : kTags) {
+        EXPECT_EQ(unsorted.GetTagCount(tag), set.GetTagCount(tag)) << toString(tag);
+    }
+}
+
+TEST_F(AuthorizationSetTest, PushBackInTagOrderKeepsSorted) {
+    // Tags are ordered by their numeric value, which puts the tag type first.
+    AuthorizationSet set;
+    set.push_back(TAG_ALGORITHM, Algorithm::EC);
+    set.push_back(TAG_PURPOSE, KeyPurpose::SIGN);
+    set.push_back(TAG_KEY_SIZE, 256u);
+    set.push_back(TAG_NO_AUTH_REQUIRED);
+    for (uint64_t i = 0; i < kLargeSetSize; ++i) {
+        set.push_back(TAG_USER_SECURE_ID, i);
+    }
+    expectSameLookups(set);
+}
+
+TEST_F(AuthorizationSetTest, PushBackOutOfTagOrderClearsSorted) {
+    AuthorizationSet set = sortedLargeSet();
+    // Appending the last tag again keeps the set sorted.
+    set.push_back(TAG_USER_SECURE_ID, uint64_t(100));
+    expectSameLookups(set);
+
+    set.push_back(TAG_PURPOSE, KeyPurpose::VERIFY);
+    EXPECT_FALSE(sortedByTag(set));
+    EXPECT_TRUE(set.Contains(TAG_PURPOSE, KeyPurpose::VERIFY));
+    EXPECT_EQ(positions(set, Tag::PURPOSE).back(), static_cast<int>(set.size()) - 1);
+
+    AuthorizationSet other;
+    other.push_back(TAG_ALGORITHM, Algorithm::RSA);
+    set = sortedLargeSet();
+    set.push_back(other);
+    EXPECT_FALSE(sortedByTag(set));
+    EXPECT_EQ(2u, set.GetTagCount(Tag::ALGORITHM));
+}
+
+TEST_F(AuthorizationSetTest, EraseKeepsSortedness) {
+    AuthorizationSet set = sortedLargeSet();
+    set.erase(set.find(Tag::DIGEST));
+    set.erase(set.find(Tag::USER_SECURE_ID));
+    expectSameLookups(set);
+    EXPECT_EQ(2u, set.GetTagCount(Tag::DIGEST));
+    EXPECT_EQ(23u, set.GetTagCount(Tag::USER_SECURE_ID));
+
+    AuthorizationSet unsorted = largeSet();
+    unsorted.erase(0);
+    EXPECT_FALSE(sortedByTag(unsorted));
+}
+
+TEST_F(AuthorizationSetTest, MutableIndexingClearsSorted) {
+    AuthorizationSet set = sortedLargeSet();
+    set[0] = Authorization(TAG_BOOT_PATCHLEVEL, 20220105u);
+    EXPECT_FALSE(sortedByTag(set));
+    EXPECT_TRUE(set.Contains(Tag::BOOT_PATCHLEVEL));
+
+    set.Clear();
+    EXPECT_TRUE(sortedByTag(set));
+}
+
+TEST_F(AuthorizationSetTest, UnionAndSubtractSort) {
+    AuthorizationSet set = largeSet();
+    AuthorizationSet extra;
+    extra.push_back(TAG_OS_VERSION, 110000u);
+    extra.push_back(TAG_PURPOSE, KeyPurpose::VERIFY);
+    set.Union(extra);
+    expectSameLookups(set);
+    EXPECT_TRUE(set.Contains(TAG_OS_VERSION, 110000u));
+    EXPECT_TRUE(set.Contains(TAG_PURPOSE, KeyPurpose::VERIFY));
+
+    set = largeSet();
+    AuthorizationSet removed;
+    removed.push_back(TAG_USER_SECURE_ID, uint64_t(3));
+    removed.push_back(TAG_DIGEST, Digest::SHA_2_256);
+    set.Subtract(removed);
+    expectSameLookups(set);
+    EXPECT_FALSE(set.Contains(TAG_USER_SECURE_ID, uint64_t(3)));
+    EXPECT_FALSE(set.Contains(TAG_DIGEST, Digest::SHA_2_256));
+    EXPECT_EQ(23u, set.GetTagCount(Tag::USER_SECURE_ID));
+}
+
+TEST_F(AuthorizationSetTest, DeserializeDetectsTagOrder) {
+    for (bool sorted : {true, false}) {
+        AuthorizationSet original = sorted ? sortedLargeSet() : largeSet();
+        std::stringstream stream;
+        original.Serialize(&stream);
+
+        AuthorizationSet set;
+        set.Deserialize(&stream);
+        ASSERT_FALSE(stream.bad());
+        EXPECT_EQ(sorted, sortedByTag(set));
+        if (sorted) {
+            expectSameLookups(set);
+        }
+        expectSameLookups(set, withLinearLookups(original));
+    }
+}
+
+}  // namespace V4_0
+}  // namespace keymaster
+}  // namespace hardware
+}  // namespace android
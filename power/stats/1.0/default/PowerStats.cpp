@@ -22,8 +22,10 @@
 #include <android-base/properties.h>
 #include <android-base/stringprintf.h>
 #include <android-base/strings.h>
+#include <fcntl.h>
 #include <inttypes.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <algorithm>
 #include <exception>
 #include <thread>
@@ -44,15 +46,52 @@ constexpr char kDeviceName[] = "pm_device_name";
 constexpr char kDeviceType[] = "iio:device";
 constexpr uint32_t MAX_SAMPLING_RATE = 10;
 constexpr uint64_t WRITE_TIMEOUT_NS = 1000000000;
+constexpr size_t kEnergyBufferSize = 4096;
 
-void PowerStats::findIioPowerMonitorNodes() {
+namespace {
+
+// strtoull() of a field which is not NUL-terminated
+uint64_t parseUint64(std::string_view field) {
+    char buf[32];
+    if (field.size() >= sizeof(buf)) {
+        return strtoull(std::string(field).c_str(), NULL, 10);
+    }
+    memcpy(buf, field.data(), field.size());
+    buf[field.size()] = '\0';
+    return strtoull(buf, NULL, 10);
+}
+
+// Reads the whole of |fd| from offset 0 into |buffer|, growing it if needed, and returns the
+// number of bytes read or -1 on error.
+ssize_t preadAll(int fd, std::string* buffer) {
+    if (buffer->empty()) {
+        buffer->resize(kEnergyBufferSize);
+    }
+    size_t size = 0;
+    while (true) {
+        ssize_t n = TEMP_FAILURE_RETRY(pread(fd, &(*buffer)[size], buffer->size() - size, size));
+        if (n < 0) {
+            return -1;
+        }
+        size += n;
+        // sysfs returns the whole attribute on the first read, so a short read is the end of it
+        if (size < buffer->size()) {
+            return size;
+        }
+        buffer->resize(buffer->size() * 2);
+    }
+}
+
+}  // namespace
+
+void PowerStats::findIioPowerMonitorNodes(const std::string& iioDirRoot) {
     struct dirent* ent;
     int fd;
     char devName[MAX_DEVICE_NAME_LEN];
     char filePath[MAX_FILE_PATH_LEN];
-    DIR* iioDir = opendir(kIioDirRoot);
+    DIR* iioDir = opendir(iioDirRoot.c_str());
     if (!iioDir) {
-        ALOGE("Error opening directory: %s", kIioDirRoot);
+        ALOGE("Error opening directory: %s", iioDirRoot.c_str());
         return;
     }
     while (ent = readdir(iioDir), ent) {
@@ -72,7 +111,7 @@ void PowerStats::findIioPowerMonitorNodes() {
             }
 
             if (strncmp(devName, kDeviceName, strlen(kDeviceName)) == 0) {
-                snprintf(filePath, MAX_FILE_PATH_LEN, "%s/%s", kIioDirRoot, ent->d_name);
+                snprintf(filePath, MAX_FILE_PATH_LEN, "%s/%s", iioDirRoot.c_str(), ent->d_name);
                 mPm.devicePaths.push_back(filePath);
             }
             close(fd);
@@ -123,42 +162,60 @@ size_t PowerStats::parsePowerRails() {
     return index;
 }
 
-int PowerStats::parseIioEnergyNode(std::string devName) {
-    int ret = 0;
-    std::string data;
-    std::string fileName = devName + "/energy_value";
-    if (!android::base::ReadFileToString(fileName, &data)) {
-        ALOGE("Error reading file: %s", fileName.c_str());
+int PowerStats::parseIioEnergyNode(size_t devIndex) {
+    const std::string& devName = mPm.devicePaths[devIndex];
+    android::base::unique_fd& fd = mPm.energyFds[devIndex];
+    if (fd < 0) {
+        std::string fileName = devName + "/energy_value";
+        fd.reset(TEMP_FAILURE_RETRY(open(fileName.c_str(), O_RDONLY | O_CLOEXEC)));
+        if (fd < 0) {
+            ALOGE("Error opening file: %s", fileName.c_str());
+            return -1;
+        }
+    }
+
+    ssize_t size = preadAll(fd, &mPm.energyBuffer);
+    if (size < 0) {
+        ALOGE("Error reading file: %s/energy_value", devName.c_str());
+        // Reopen the node on the next attempt
+        fd.reset();
         return -1;
     }
 
-    std::istringstream energyData(data);
-    std::string line;
+    // The node is parsed in place: one timestamp line followed by "<rail>,<energy>" lines
+    int ret = 0;
+    std::string_view data(mPm.energyBuffer.data(), size);
     uint64_t timestamp = 0;
     bool timestampRead = false;
-    while (std::getline(energyData, line)) {
-        std::vector<std::string> words = android::base::Split(line, ",");
+    while (!data.empty()) {
+        size_t eol = data.find('\n');
+        std::string_view line = data.substr(0, eol);
+        data.remove_prefix(eol == std::string_view::npos ? data.size() : eol + 1);
+
+        size_t comma = line.find(',');
+        bool oneWord = comma == std::string_view::npos;
+        bool twoWords = !oneWord && line.find(',', comma + 1) == std::string_view::npos;
         if (timestampRead == false) {
-            if (words.size() == 1) {
-                timestamp = strtoull(words[0].c_str(), NULL, 10);
+            if (oneWord) {
+                timestamp = parseUint64(line);
                 if (timestamp == 0 || timestamp == ULLONG_MAX) {
                     ALOGW("Potentially wrong timestamp: %" PRIu64, timestamp);
                 }
                 timestampRead = true;
             }
-        } else if (words.size() == 2) {
-            std::string railName = words[0];
-            if (mPm.railsInfo.count(railName) != 0) {
-                size_t index = mPm.railsInfo[railName].index;
+        } else if (twoWords) {
+            auto railData = mPm.railsInfo.find(line.substr(0, comma));
+            if (railData != mPm.railsInfo.end()) {
+                size_t index = railData->second.index;
                 mPm.reading[index].index = index;
                 mPm.reading[index].timestamp = timestamp;
-                mPm.reading[index].energy = strtoull(words[1].c_str(), NULL, 10);
+                mPm.reading[index].energy = parseUint64(line.substr(comma + 1));
                 if (mPm.reading[index].energy == ULLONG_MAX) {
                     ALOGW("Potentially wrong energy value: %" PRIu64, mPm.reading[index].energy);
                 }
             }
         } else {
-            ALOGW("Unexpected format in file: %s", fileName.c_str());
+            ALOGW("Unexpected format in file: %s/energy_value", devName.c_str());
             ret = -1;
             break;
         }
@@ -172,8 +229,8 @@ Status PowerStats::parseIioEnergyNodes() {
         return Status::NOT_SUPPORTED;
     }
 
-    for (const auto& devicePath : mPm.devicePaths) {
-        if (parseIioEnergyNode(devicePath) < 0) {
+    for (size_t i = 0; i < mPm.devicePaths.size(); i++) {
+        if (parseIioEnergyNode(i) < 0) {
             ALOGE("Error in parsing power stats");
             ret = Status::FILESYSTEM_ERROR;
             break;
@@ -182,14 +239,17 @@ Status PowerStats::parseIioEnergyNodes() {
     return ret;
 }
 
-PowerStats::PowerStats() {
-    findIioPowerMonitorNodes();
+PowerStats::PowerStats() : PowerStats(kIioDirRoot) {}
+
+PowerStats::PowerStats(const std::string& iioDirRoot) {
+    findIioPowerMonitorNodes(iioDirRoot);
     size_t numRails = parsePowerRails();
     if (mPm.devicePaths.empty() || numRails == 0) {
         mPm.hwEnabled = false;
     } else {
         mPm.hwEnabled = true;
         mPm.reading.resize(numRails);
+        mPm.energyFds.resize(mPm.devicePaths.size());
     }
 }
 
@@ -17,10 +17,12 @@
 #ifndef ANDROID_HARDWARE_POWERSTATS_V1_0_POWERSTATS_H
 #define ANDROID_HARDWARE_POWERSTATS_V1_0_POWERSTATS_H
 
+#include <android-base/unique_fd.h>
 #include <android/hardware/power/stats/1.0/IPowerStats.h>
 #include <fmq/MessageQueue.h>
 #include <hidl/MQDescriptor.h>
 #include <hidl/Status.h>
+#include <string_view>
 #include <unordered_map>
 
 namespace android {
@@ -56,7 +58,11 @@ struct OnDeviceMmt {
     std::mutex mLock;
     bool hwEnabled;
     std::vector<std::string> devicePaths;
-    std::map<std::string, RailData> railsInfo;
+    // energy_value node of each of devicePaths, kept open and re-read with pread()
+    std::vector<android::base::unique_fd> energyFds;
+    // Reused by every read of an energy_value node
+    std::string energyBuffer;
+    std::map<std::string, RailData, std::less<>> railsInfo;
     std::vector<EnergyData> reading;
     std::unique_ptr<MessageQueueSync> fmqSynchronized;
 };
@@ -72,6 +78,8 @@ class IStateResidencyDataProvider {
 struct PowerStats : public IPowerStats {
    public:
     PowerStats();
+    // Looks for power monitors under |iioDirRoot| instead of /sys/bus/iio/devices/
+    explicit PowerStats(const std::string& iioDirRoot);
     uint32_t addPowerEntity(const std::string& name, PowerEntityType type);
     void addStateResidencyDataProvider(std::shared_ptr<IStateResidencyDataProvider> p);
     // Methods from ::android::hardware::power::stats::V1_0::IPowerStats follow.
@@ -92,9 +100,9 @@ struct PowerStats : public IPowerStats {
 
    private:
     OnDeviceMmt mPm;
-    void findIioPowerMonitorNodes();
+    void findIioPowerMonitorNodes(const std::string& iioDirRoot);
     size_t parsePowerRails();
-    int parseIioEnergyNode(std::string devName);
+    int parseIioEnergyNode(size_t devIndex);
     Status parseIioEnergyNodes();
     std::vector<PowerEntityInfo> mPowerEntityInfos;
     std::unordered_map<uint32_t, PowerEntityStateSpace> mPowerEntityStateSpaces;
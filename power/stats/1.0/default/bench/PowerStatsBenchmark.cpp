@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Reads energy data from a fake /sys/bus/iio/devices tree with two power monitors, each with
+// a configurable number of rails.
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <benchmark/benchmark.h>
+#include <sys/stat.h>
+
+#include "PowerStats.h"
+
+using android::base::StringPrintf;
+using android::base::WriteStringToFile;
+using android::hardware::hidl_vec;
+using android::hardware::power::stats::V1_0::EnergyData;
+using android::hardware::power::stats::V1_0::Status;
+using android::hardware::power::stats::V1_0::implementation::PowerStats;
+
+namespace {
+
+constexpr int kNumDevices = 2;
+
+bool makeFakeIioTree(const std::string& root, int railsPerDevice) {
+    int rail = 0;
+    for (int device = 0; device < kNumDevices; device++) {
+        std::string path = StringPrintf("%s/iio:device%d", root.c_str(), device);
+        if (mkdir(path.c_str(), 0700) != 0) {
+            return false;
+        }
+        std::string enabledRails;
+        std::string energyValue = "t=123456789\n";
+        for (int i = 0; i < railsPerDevice; i++, rail++) {
+            enabledRails += StringPrintf("RAIL_%d:SUBSYS_%d\n", rail, rail);
+            energyValue += StringPrintf("RAIL_%d,%d\n", rail, 1000000 + rail * 7919);
+        }
+        if (!WriteStringToFile("pm_device_name\n", path + "/name") ||
+            !WriteStringToFile("10\n", path + "/sampling_rate") ||
+            !WriteStringToFile(enabledRails, path + "/enabled_rails") ||
+            !WriteStringToFile(energyValue, path + "/energy_value")) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BM_GetEnergyData(benchmark::State& state) {
+    TemporaryDir root;
+    if (!makeFakeIioTree(root.path, state.range(0))) {
+        state.SkipWithError("Failed to create fake iio tree");
+        return;
+    }
+    android::sp<PowerStats> powerStats = new PowerStats(root.path);
+
+    for (auto _ : state) {
+        Status status;
+        powerStats->getEnergyData({}, [&status](const hidl_vec<EnergyData>& data, Status s) {
+            benchmark::DoNotOptimize(data.data());
+            status = s;
+        });
+        if (status != Status::SUCCESS) {
+            state.SkipWithError("getEnergyData failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kNumDevices * state.range(0));
+}
+
+}  // namespace
+
+BENCHMARK(BM_GetEnergyData)->Arg(8)->Arg(16)->Arg(64);
+
+BENCHMARK_MAIN();
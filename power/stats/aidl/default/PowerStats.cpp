@@ -26,6 +26,17 @@ namespace hardware {
 namespace power {
 namespace stats {
 
+PowerStats::~PowerStats() {
+    {
+        std::lock_guard<std::mutex> lock(mStateResidencyLock);
+        mStopStateResidencySampler = true;
+    }
+    mStateResidencySamplerCv.notify_all();
+    if (mStateResidencySampler.joinable()) {
+        mStateResidencySampler.join();
+    }
+}
+
 void PowerStats::addStateResidencyDataProvider(std::unique_ptr<IStateResidencyDataProvider> p) {
     if (!p) {
         return;
@@ -36,6 +47,8 @@ void PowerStats::addStateResidencyDataProvider(std::unique_ptr<IStateResidencyDa
 
     size_t index = mStateResidencyDataProviders.size();
     mStateResidencyDataProviders.emplace_back(std::move(p));
+    mStateResidencySampleTimes.emplace_back(std::chrono::steady_clock::time_point::min());
+    std::vector<int32_t>& entityIds = mStateResidencyDataProviderEntityIds.emplace_back();
 
     for (const auto& [entityName, states] : info) {
         PowerEntity i = {
@@ -43,8 +56,48 @@ void PowerStats::addStateResidencyDataProvider(std::unique_ptr<IStateResidencyDa
                 .name = entityName,
                 .states = states,
         };
+        entityIds.emplace_back(i.id);
         mPowerEntityInfos.emplace_back(i);
         mStateResidencyDataProviderIndex.emplace_back(index);
+        mStateResidencies.emplace_back();
+    }
+}
+
+void PowerStats::setStateResidencyStaleness(std::chrono::milliseconds staleness) {
+    std::lock_guard<std::mutex> lock(mStateResidencyLock);
+    mStateResidencyStaleness = staleness;
+}
+
+void PowerStats::startStateResidencySampler(std::chrono::milliseconds period) {
+    if (mStateResidencySampler.joinable()) {
+        return;
+    }
+
+    mStateResidencySampler = std::thread([this, period] {
+        std::unique_lock<std::mutex> lock(mStateResidencyLock);
+        while (!mStopStateResidencySampler) {
+            for (size_t i = 0; i < mStateResidencyDataProviders.size(); i++) {
+                sampleStateResidencyDataProvider(i);
+            }
+            mStateResidencySamplerCv.wait_for(lock, period,
+                                              [this] { return mStopStateResidencySampler; });
+        }
+    });
+}
+
+void PowerStats::sampleStateResidencyDataProvider(size_t index) {
+    // Residencies are as old as the start of the query
+    mStateResidencySampleTimes[index] = std::chrono::steady_clock::now();
+
+    mStateResidencyResults.clear();
+    mStateResidencyDataProviders[index]->getStateResidencies(&mStateResidencyResults);
+    for (const int32_t id : mStateResidencyDataProviderEntityIds[index]) {
+        auto result = mStateResidencyResults.find(mPowerEntityInfos[id].name);
+        if (result != mStateResidencyResults.end()) {
+            mStateResidencies[id] = std::move(result->second);
+        } else {
+            mStateResidencies[id].reset();
+        }
     }
 }
 
@@ -85,7 +138,10 @@ ndk::ScopedAStatus PowerStats::getStateResidency(const std::vector<int32_t>& in_
         return getStateResidency(v, _aidl_return);
     }
 
-    std::unordered_map<std::string, std::vector<StateResidency>> stateResidencies;
+    std::lock_guard<std::mutex> lock(mStateResidencyLock);
+    // Providers sampled before this are queried again
+    auto oldestSampleTime = std::chrono::steady_clock::now() - mStateResidencyStaleness;
+    _aidl_return->reserve(_aidl_return->size() + in_powerEntityIds.size());
 
     for (const int32_t id : in_powerEntityIds) {
         // check for invalid ids
@@ -93,24 +149,24 @@ ndk::ScopedAStatus PowerStats::getStateResidency(const std::vector<int32_t>& in_
             return ndk::ScopedAStatus(AStatus_fromExceptionCode(EX_ILLEGAL_ARGUMENT));
         }
 
-        // Check to see if we already have data for the given id
-        std::string powerEntityName = mPowerEntityInfos[id].name;
-        if (stateResidencies.find(powerEntityName) == stateResidencies.end()) {
-            mStateResidencyDataProviders.at(mStateResidencyDataProviderIndex.at(id))
-                    ->getStateResidencies(&stateResidencies);
+        // Each provider is queried at most once per call, and not at all if its last sample is
+        // recent enough
+        size_t index = mStateResidencyDataProviderIndex[id];
+        if (mStateResidencySampleTimes[index] < oldestSampleTime) {
+            sampleStateResidencyDataProvider(index);
         }
 
         // Append results if we have them
-        auto stateResidency = stateResidencies.find(powerEntityName);
-        if (stateResidency != stateResidencies.end()) {
+        const auto& stateResidency = mStateResidencies[id];
+        if (stateResidency) {
             StateResidencyResult res = {
                     .id = id,
-                    .stateResidencyData = stateResidency->second,
+                    .stateResidencyData = *stateResidency,
             };
-            _aidl_return->emplace_back(res);
+            _aidl_return->emplace_back(std::move(res));
         } else {
             // Failed to get results for the given id.
-            LOG(ERROR) << "Failed to get results for " << powerEntityName;
+            LOG(ERROR) << "Failed to get results for " << mPowerEntityInfos[id].name;
         }
     }
 
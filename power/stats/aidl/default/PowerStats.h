@@ -18,6 +18,11 @@
 
 #include <aidl/android/hardware/power/stats/BnPowerStats.h>
 
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
 #include <unordered_map>
 
 namespace aidl {
@@ -54,11 +59,24 @@ class PowerStats : public BnPowerStats {
     };
 
     PowerStats() = default;
+    ~PowerStats();
 
     void addStateResidencyDataProvider(std::unique_ptr<IStateResidencyDataProvider> p);
     void addEnergyConsumer(std::unique_ptr<IEnergyConsumer> p);
     void setEnergyMeter(std::unique_ptr<IEnergyMeter> p);
 
+    /*
+     * By default getStateResidency() queries the providers on every call. Allowing residencies
+     * to be up to |staleness| old lets calls within that window be served from the last sample.
+     */
+    void setStateResidencyStaleness(std::chrono::milliseconds staleness);
+    /*
+     * Samples every provider each |period| on a background thread so that getStateResidency()
+     * rarely has to wait on a provider. Only effective together with a staleness of at least
+     * |period|. Call after all providers have been added.
+     */
+    void startStateResidencySampler(std::chrono::milliseconds period);
+
     // Methods from aidl::android::hardware::power::stats::IPowerStats
     ndk::ScopedAStatus getPowerEntityInfo(std::vector<PowerEntity>* _aidl_return) override;
     ndk::ScopedAStatus getStateResidency(const std::vector<int32_t>& in_powerEntityIds,
@@ -71,10 +89,28 @@ class PowerStats : public BnPowerStats {
                                        std::vector<EnergyMeasurement>* _aidl_return) override;
 
   private:
+    /* Queries provider |index| and stores its results in mStateResidencies */
+    void sampleStateResidencyDataProvider(size_t index);
+
     std::vector<std::unique_ptr<IStateResidencyDataProvider>> mStateResidencyDataProviders;
     std::vector<PowerEntity> mPowerEntityInfos;
     /* Index that maps each power entity id to an entry in mStateResidencyDataProviders */
     std::vector<size_t> mStateResidencyDataProviderIndex;
+    /* Power entity ids reported by each entry in mStateResidencyDataProviders */
+    std::vector<std::vector<int32_t>> mStateResidencyDataProviderEntityIds;
+
+    /* Guards the state residency samples and serializes calls into the providers */
+    std::mutex mStateResidencyLock;
+    /* Last sampled residencies, indexed by power entity id */
+    std::vector<std::optional<std::vector<StateResidency>>> mStateResidencies;
+    /* When each entry in mStateResidencyDataProviders was last sampled */
+    std::vector<std::chrono::steady_clock::time_point> mStateResidencySampleTimes;
+    /* Reused to collect the results of a provider */
+    std::unordered_map<std::string, std::vector<StateResidency>> mStateResidencyResults;
+    std::chrono::milliseconds mStateResidencyStaleness{0};
+    std::thread mStateResidencySampler;
+    std::condition_variable mStateResidencySamplerCv;
+    bool mStopStateResidencySampler = false;
 
     std::vector<std::unique_ptr<IEnergyConsumer>> mEnergyConsumers;
     std::vector<EnergyConsumer> mEnergyConsumerInfos;
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Queries the residencies of all power entities of a number of fake providers, with every call
+// going to the providers, with a staleness bound, and with a background sampler.
+
+#include <benchmark/benchmark.h>
+
+#include "FakeStateResidencyDataProvider.h"
+#include "PowerStats.h"
+
+using aidl::android::hardware::power::stats::FakeStateResidencyDataProvider;
+using aidl::android::hardware::power::stats::PowerStats;
+using aidl::android::hardware::power::stats::State;
+using aidl::android::hardware::power::stats::StateResidencyResult;
+
+namespace {
+
+std::shared_ptr<PowerStats> makePowerStats(int numProviders) {
+    std::shared_ptr<PowerStats> p = ndk::SharedRefBase::make<PowerStats>();
+    for (int i = 0; i < numProviders; i++) {
+        p->addStateResidencyDataProvider(std::make_unique<FakeStateResidencyDataProvider>(
+                "Entity" + std::to_string(i),
+                std::vector<State>{{0, "Off"}, {1, "Idle"}, {2, "Active"}}));
+    }
+    return p;
+}
+
+void getStateResidency(benchmark::State& state, PowerStats* p) {
+    for (auto _ : state) {
+        std::vector<StateResidencyResult> results;
+        p->getStateResidency({}, &results);
+        benchmark::DoNotOptimize(results.data());
+    }
+}
+
+void BM_GetStateResidency(benchmark::State& state) {
+    std::shared_ptr<PowerStats> p = makePowerStats(state.range(0));
+    getStateResidency(state, p.get());
+}
+
+void BM_GetStateResidencyStale(benchmark::State& state) {
+    std::shared_ptr<PowerStats> p = makePowerStats(state.range(0));
+    p->setStateResidencyStaleness(std::chrono::milliseconds(100));
+    getStateResidency(state, p.get());
+}
+
+void BM_GetStateResidencySampled(benchmark::State& state) {
+    std::shared_ptr<PowerStats> p = makePowerStats(state.range(0));
+    p->setStateResidencyStaleness(std::chrono::milliseconds(100));
+    p->startStateResidencySampler(std::chrono::milliseconds(50));
+    getStateResidency(state, p.get());
+}
+
+}  // namespace
+
+BENCHMARK(BM_GetStateResidency)->Arg(2)->Arg(16)->Arg(64);
+BENCHMARK(BM_GetStateResidencyStale)->Arg(2)->Arg(16)->Arg(64);
+BENCHMARK(BM_GetStateResidencySampled)->Arg(2)->Arg(16)->Arg(64);
+
+BENCHMARK_MAIN();
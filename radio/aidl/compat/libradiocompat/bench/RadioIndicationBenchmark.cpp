@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays the network indications a modem sends on a dense cellular site through RadioIndication
+// and compares converting each one into a new AIDL value with converting in place into a reused
+// one.
+
+#include <benchmark/benchmark.h>
+
+#include <libradiocompat/RadioIndication.h>
+
+#include "commonStructs.h"
+#include "network/structs.h"
+
+#include "collections.h"
+
+namespace android::hardware::radio::compat {
+namespace {
+
+namespace aidl = ::aidl::android::hardware::radio::network;
+using ::aidl::android::hardware::radio::RadioIndicationType;
+using ::benchmark::State;
+using ::ndk::ScopedAStatus;
+
+class CountingNetworkIndication : public aidl::IRadioNetworkIndicationDefault {
+  public:
+    size_t delivered = 0;
+
+    ScopedAStatus cellInfoList(RadioIndicationType, const std::vector<aidl::CellInfo>&) override {
+        delivered++;
+        return ScopedAStatus::ok();
+    }
+    ScopedAStatus currentSignalStrength(RadioIndicationType, const aidl::SignalStrength&) override {
+        delivered++;
+        return ScopedAStatus::ok();
+    }
+    ScopedAStatus networkScanResult(RadioIndicationType, const aidl::NetworkScanResult&) override {
+        delivered++;
+        return ScopedAStatus::ok();
+    }
+};
+
+V1_5::CellInfo lteCell(int32_t index, int32_t rsrp) {
+    V1_5::CellIdentityLte id = {};
+    id.base.base.mcc = "310";
+    id.base.base.mnc = "260";
+    id.base.base.ci = 0x1000 + index;
+    id.base.base.pci = index % 504;
+    id.base.base.tac = 0x2a;
+    id.base.base.earfcn = 5230;
+    id.base.operatorNames.alphaLong = "Example Wireless Operator";
+    id.base.operatorNames.alphaShort = "Example";
+    id.base.bandwidth = 10000;
+    id.additionalPlmns = hidl_vec<hidl_string>{"310120", "311490", "312250"};
+    id.bands = hidl_vec<V1_5::EutranBands>{V1_5::EutranBands::BAND_2, V1_5::EutranBands::BAND_66};
+
+    V1_5::CellInfoLte lte = {};
+    lte.cellIdentityLte = id;
+    lte.signalStrengthLte.rsrp = rsrp;
+    lte.signalStrengthLte.rsrq = 10;
+
+    V1_5::CellInfo info = {};
+    info.registered = index == 0;
+    info.connectionStatus = index == 0 ? V1_2::CellConnectionStatus::PRIMARY_SERVING
+                                       : V1_2::CellConnectionStatus::NONE;
+    info.ratSpecificInfo.lte(lte);
+    return info;
+}
+
+V1_5::CellInfo nrCell(int32_t index, int32_t ssRsrp) {
+    V1_5::CellIdentityNr id = {};
+    id.base.mcc = "310";
+    id.base.mnc = "260";
+    id.base.nci = 0x100000 + index;
+    id.base.pci = index % 1008;
+    id.base.tac = 0x2a;
+    id.base.nrarfcn = 126400;
+    id.base.operatorNames.alphaLong = "Example Wireless Operator";
+    id.base.operatorNames.alphaShort = "Example";
+    id.additionalPlmns = hidl_vec<hidl_string>{"310120"};
+    id.bands = hidl_vec<V1_5::NgranBands>{V1_5::NgranBands::BAND_71};
+
+    V1_5::CellInfoNr nr = {};
+    nr.cellIdentityNr = id;
+    nr.signalStrengthNr.ssRsrp = ssRsrp;
+
+    V1_5::CellInfo info = {};
+    info.ratSpecificInfo.nr(nr);
+    return info;
+}
+
+// What a modem camped on a dense site reports: mostly LTE neighbours with a few NR cells. |round|
+// changes the measurements.
+hidl_vec<V1_5::CellInfo> denseSite(size_t cells, int32_t round) {
+    hidl_vec<V1_5::CellInfo> records(cells);
+    for (size_t i = 0; i < cells; i++) {
+        int32_t index = static_cast<int32_t>(i);
+        records[i] = (i % 4 == 3) ? nrCell(index, 80 + round) : lteCell(index, 90 + round);
+    }
+    return records;
+}
+
+void BM_ConvertCellInfoListValue(State& state) {
+    hidl_vec<V1_5::CellInfo> records = denseSite(state.range(0), 0);
+    for (auto _ : state) {
+        std::vector<aidl::CellInfo> cells = toAidl(records);
+        benchmark::DoNotOptimize(cells.data());
+    }
+    state.SetItemsProcessed(state.iterations() * records.size());
+}
+
+void BM_ConvertCellInfoListInPlace(State& state) {
+    hidl_vec<V1_5::CellInfo> records = denseSite(state.range(0), 0);
+    std::vector<aidl::CellInfo> cells;
+    for (auto _ : state) {
+        toAidl(records, &cells);
+        benchmark::DoNotOptimize(cells.data());
+    }
+    state.SetItemsProcessed(state.iterations() * records.size());
+}
+
+struct Replay {
+    std::shared_ptr<CountingNetworkIndication> callback =
+            ndk::SharedRefBase::make<CountingNetworkIndication>();
+    sp<RadioIndication> indication = sp<RadioIndication>::make(std::make_shared<DriverContext>());
+    sp<V1_6::IRadioIndication> hidl = indication;
+
+    Replay() {
+        indication->setResponseFunction(std::shared_ptr<aidl::IRadioNetworkIndication>(callback));
+    }
+
+    // Fraction of the replayed indications that reached the AIDL callback.
+    void report(State& state) {
+        state.counters["delivered"] = callback->delivered / double(state.iterations());
+    }
+};
+
+// Replays cell info lists where the measurements change every |range(1)| indications.
+void BM_ReplayCellInfoList(State& state) {
+    std::vector<hidl_vec<V1_5::CellInfo>> rounds;
+    for (int32_t round = 0; round < 8; round++) rounds.push_back(denseSite(state.range(0), round));
+
+    Replay replay;
+    size_t n = 0;
+    for (auto _ : state) {
+        const auto& records = rounds[(n++ / state.range(1)) % rounds.size()];
+        replay.hidl->cellInfoList_1_5(V1_0::RadioIndicationType::UNSOLICITED, records);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    replay.report(state);
+}
+
+void BM_ReplaySignalStrength(State& state) {
+    std::vector<V1_4::SignalStrength> rounds(8);
+    for (size_t round = 0; round < rounds.size(); round++) {
+        rounds[round].lte.base.rsrp = 90 + round;
+        rounds[round].nr.base.ssRsrp = 80 + round;
+    }
+
+    Replay replay;
+    size_t n = 0;
+    for (auto _ : state) {
+        const auto& sig = rounds[(n++ / state.range(0)) % rounds.size()];
+        replay.hidl->currentSignalStrength_1_4(V1_0::RadioIndicationType::UNSOLICITED, sig);
+    }
+    replay.report(state);
+}
+
+// A manual network scan reporting the same partial result until the final one.
+void BM_ReplayNetworkScanResult(State& state) {
+    V1_5::NetworkScanResult partial = {};
+    partial.status = V1_1::ScanStatus::PARTIAL;
+    partial.networkInfos = denseSite(state.range(0), 0);
+    V1_5::NetworkScanResult complete = partial;
+    complete.status = V1_1::ScanStatus::COMPLETE;
+
+    Replay replay;
+    size_t n = 0;
+    for (auto _ : state) {
+        const auto& result = (++n % 8 == 0) ? complete : partial;
+        replay.hidl->networkScanResult_1_5(V1_0::RadioIndicationType::UNSOLICITED, result);
+    }
+    replay.report(state);
+}
+
+}  // namespace
+
+BENCHMARK(BM_ConvertCellInfoListValue)->Arg(8)->Arg(32)->Arg(128);
+BENCHMARK(BM_ConvertCellInfoListInPlace)->Arg(8)->Arg(32)->Arg(128);
+// Measurements changing with every indication, and repeated four times.
+BENCHMARK(BM_ReplayCellInfoList)->Args({32, 1})->Args({32, 4})->Args({128, 1})->Args({128, 4});
+BENCHMARK(BM_ReplaySignalStrength)->Arg(1)->Arg(4);
+BENCHMARK(BM_ReplayNetworkScanResult)->Arg(32)->Arg(128);
+
+}  // namespace android::hardware::radio::compat
+
+BENCHMARK_MAIN();
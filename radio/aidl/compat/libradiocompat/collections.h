@@ -31,13 +31,48 @@ namespace android::hardware::radio::compat {
  */
 template <typename T>
 auto toAidl(const hidl_vec<T>& inp) {
-    std::vector<decltype(toAidl(T{}))> out(inp.size());
-    for (size_t i = 0; i < inp.size(); i++) {
-        out[i] = toAidl(inp[i]);
+    std::vector<decltype(toAidl(T{}))> out;
+    out.reserve(inp.size());
+    for (const auto& e : inp) {
+        out.push_back(toAidl(e));
     }
     return out;
 }
 
+/**
+ * Converts T HIDL value into an existing U AIDL value.
+ *
+ * This is the fallback for types without a dedicated in-place conversion, which just assigns the
+ * result of toAidl for a given type T, assuming it's defined.
+ *
+ * \param inp value to convert
+ * \param out value to overwrite
+ */
+template <typename T, typename U>
+void toAidl(const T& inp, U* out) {
+    *out = toAidl(inp);
+}
+
+/**
+ * Converts hidl_vec<T> HIDL list into an existing std::vector<U> AIDL list.
+ *
+ * Elements already present in the list are overwritten in place, so that the strings and lists
+ * they hold keep their allocations when the same kind of message is converted repeatedly.
+ *
+ * To convert values, the template uses in-place toAidl functions for a given type T if defined,
+ * or falls back to the value returning ones.
+ *
+ * \param inp vector to convert
+ * \param out vector to overwrite
+ */
+template <typename T, typename U>
+void toAidl(const hidl_vec<T>& inp, std::vector<U>* out) {
+    out->resize(inp.size());
+    for (size_t i = 0; i < inp.size(); i++) {
+        toAidl(inp[i], &(*out)[i]);
+    }
+}
+
 /**
  * Converts std::vector<T> AIDL list to hidl_vec<T> HIDL list.
  *
@@ -32,6 +32,10 @@ std::string toAidl(const hidl_string& str) {
     return str;
 }
 
+void toAidl(const hidl_string& str, std::string* out) {
+    out->assign(str.c_str(), str.size());
+}
+
 hidl_string toHidl(const std::string& str) {
     return str;
 }
@@ -24,6 +24,7 @@ namespace android::hardware::radio::compat {
 aidl::android::hardware::radio::RadioResponseInfo notSupported(int32_t serial);
 
 std::string toAidl(const hidl_string& str);
+void toAidl(const hidl_string& str, std::string* out);
 hidl_string toHidl(const std::string& str);
 uint8_t toAidl(int8_t v);
 int8_t toAidl(uint8_t v);
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <android-base/thread_annotations.h>
+
+#include <mutex>
+#include <utility>
+
+namespace android::hardware::radio::compat {
+
+/**
+ * Per-indication conversion state for high volume unsolicited indications.
+ *
+ * HIDL indications arrive as const references to HIDL types, so they can't be moved into the AIDL
+ * ones. Instead, each indication is converted in place into a scratch object that is kept between
+ * calls, so repeated indications of the same shape reuse the strings and lists allocated for the
+ * previous ones. The last delivered value is kept as well, which allows identical consecutive
+ * indications to be dropped before they reach the AIDL callback.
+ */
+template <typename T>
+class IndicationCache {
+    std::mutex mGuard;
+    T mScratch GUARDED_BY(mGuard);
+    T mLast GUARDED_BY(mGuard);
+    bool mHaveLast GUARDED_BY(mGuard) = false;
+
+  public:
+    /**
+     * Converts an indication and passes it to the callback.
+     *
+     * \param dropDuplicate whether to skip delivery if the value equals the last delivered one
+     * \param convert function converting the indication into the T* it's given
+     * \param deliver function passing the const T& it's given to the AIDL callback
+     * \return true if the indication was delivered
+     */
+    template <typename Convert, typename Deliver>
+    bool update(bool dropDuplicate, Convert convert, Deliver deliver) {
+        const std::lock_guard<std::mutex> lock(mGuard);
+        convert(&mScratch);
+        if (dropDuplicate && mHaveLast && mScratch == mLast) return false;
+
+        deliver(std::as_const(mScratch));
+        // The previously delivered value becomes the scratch object for the next indication.
+        std::swap(mScratch, mLast);
+        mHaveLast = true;
+        return true;
+    }
+
+    /** Forgets the last delivered value, e.g. when the callback changes. */
+    void reset() {
+        const std::lock_guard<std::mutex> lock(mGuard);
+        mHaveLast = false;
+    }
+};
+
+}  // namespace android::hardware::radio::compat
@@ -17,6 +17,7 @@
 
 #include "DriverContext.h"
 #include "GuaranteedCallback.h"
+#include "IndicationCache.h"
 
 #include <aidl/android/hardware/radio/data/IRadioDataIndication.h>
 #include <aidl/android/hardware/radio/messaging/IRadioMessagingIndication.h>
@@ -56,6 +57,12 @@ class RadioIndication : public V1_6::IRadioIndication {
             ::aidl::android::hardware::radio::voice::IRadioVoiceIndicationDefault, true>
             mVoiceCb;
 
+    IndicationCache<std::vector<::aidl::android::hardware::radio::network::CellInfo>>
+            mCellInfoList;
+    IndicationCache<::aidl::android::hardware::radio::network::SignalStrength> mSignalStrength;
+    IndicationCache<::aidl::android::hardware::radio::network::NetworkScanResult>
+            mNetworkScanResult;
+
     // IRadioIndication @ 1.0
     Return<void> radioStateChanged(V1_0::RadioIndicationType type,
                                    V1_0::RadioState radioState) override;
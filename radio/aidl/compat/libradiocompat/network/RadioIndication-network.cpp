@@ -29,8 +29,20 @@ namespace android::hardware::radio::compat {
 using ::aidl::android::hardware::radio::RadioTechnology;
 namespace aidl = ::aidl::android::hardware::radio::network;
 
+/**
+ * Whether an indication identical to the previous one may be dropped.
+ *
+ * Indications that expect an ack must always reach the client, which sends the ack.
+ */
+static bool mayDropDuplicate(V1_0::RadioIndicationType type) {
+    return type == V1_0::RadioIndicationType::UNSOLICITED;
+}
+
 void RadioIndication::setResponseFunction(std::shared_ptr<aidl::IRadioNetworkIndication> netCb) {
     mNetworkCb = netCb;
+    mCellInfoList.reset();
+    mSignalStrength.reset();
+    mNetworkScanResult.reset();
 }
 
 std::shared_ptr<aidl::IRadioNetworkIndication> RadioIndication::networkCb() {
@@ -75,14 +87,18 @@ Return<void> RadioIndication::cellInfoList_1_4(V1_0::RadioIndicationType type,
 Return<void> RadioIndication::cellInfoList_1_5(V1_0::RadioIndicationType type,
                                                const hidl_vec<V1_5::CellInfo>& records) {
     LOG_CALL << type;
-    networkCb()->cellInfoList(toAidl(type), toAidl(records));
+    mCellInfoList.update(
+            mayDropDuplicate(type), [&](auto* out) { toAidl(records, out); },
+            [&](const auto& cells) { networkCb()->cellInfoList(toAidl(type), cells); });
     return {};
 }
 
 Return<void> RadioIndication::cellInfoList_1_6(V1_0::RadioIndicationType type,
                                                const hidl_vec<V1_6::CellInfo>& records) {
     LOG_CALL << type;
-    networkCb()->cellInfoList(toAidl(type), toAidl(records));
+    mCellInfoList.update(
+            mayDropDuplicate(type), [&](auto* out) { toAidl(records, out); },
+            [&](const auto& cells) { networkCb()->cellInfoList(toAidl(type), cells); });
     return {};
 }
 
@@ -138,14 +154,18 @@ Return<void> RadioIndication::currentSignalStrength_1_2(V1_0::RadioIndicationTyp
 Return<void> RadioIndication::currentSignalStrength_1_4(
         V1_0::RadioIndicationType type, const V1_4::SignalStrength& signalStrength) {
     LOG_CALL << type;
-    networkCb()->currentSignalStrength(toAidl(type), toAidl(signalStrength));
+    mSignalStrength.update(
+            mayDropDuplicate(type), [&](auto* out) { *out = toAidl(signalStrength); },
+            [&](const auto& sig) { networkCb()->currentSignalStrength(toAidl(type), sig); });
     return {};
 }
 
 Return<void> RadioIndication::currentSignalStrength_1_6(
         V1_0::RadioIndicationType type, const V1_6::SignalStrength& signalStrength) {
     LOG_CALL << type;
-    networkCb()->currentSignalStrength(toAidl(type), toAidl(signalStrength));
+    mSignalStrength.update(
+            mayDropDuplicate(type), [&](auto* out) { *out = toAidl(signalStrength); },
+            [&](const auto& sig) { networkCb()->currentSignalStrength(toAidl(type), sig); });
     return {};
 }
 
@@ -179,14 +199,22 @@ Return<void> RadioIndication::networkScanResult_1_4(V1_0::RadioIndicationType ty
 Return<void> RadioIndication::networkScanResult_1_5(V1_0::RadioIndicationType type,
                                                     const V1_5::NetworkScanResult& result) {
     LOG_CALL << type;
-    networkCb()->networkScanResult(toAidl(type), toAidl(result));
+    // Partial results of a scan in progress are reported periodically and often repeat.
+    const bool partial = result.status == V1_1::ScanStatus::PARTIAL;
+    mNetworkScanResult.update(
+            partial && mayDropDuplicate(type), [&](auto* out) { toAidl(result, out); },
+            [&](const auto& res) { networkCb()->networkScanResult(toAidl(type), res); });
     return {};
 }
 
 Return<void> RadioIndication::networkScanResult_1_6(V1_0::RadioIndicationType type,
                                                     const V1_6::NetworkScanResult& result) {
     LOG_CALL << type;
-    networkCb()->networkScanResult(toAidl(type), toAidl(result));
+    // Partial results of a scan in progress are reported periodically and often repeat.
+    const bool partial = result.status == V1_1::ScanStatus::PARTIAL;
+    mNetworkScanResult.update(
+            partial && mayDropDuplicate(type), [&](auto* out) { toAidl(result, out); },
+            [&](const auto& res) { networkCb()->networkScanResult(toAidl(type), res); });
     return {};
 }
 
@@ -165,26 +165,34 @@ V1_5::NetworkScanRequest toHidl(const aidl::NetworkScanRequest& req) {
     };
 }
 
-static aidl::OperatorInfo toAidl(const V1_2::CellIdentityOperatorNames& names) {
-    return {
-            .alphaLong = names.alphaLong,
-            .alphaShort = names.alphaShort,
-            .operatorNumeric = "",
-            .status = aidl::OperatorInfo::STATUS_UNKNOWN,
-    };
+/**
+ * Returns the |tag| member of an AIDL union, switching the union to it first if needed.
+ *
+ * Used by the in-place conversions below, so that converting a cell of the same technology as
+ * before reuses the strings and lists it holds.
+ */
+template <auto tag, typename Union>
+static auto& emplaceTag(Union* u) {
+    if (u->getTag() != tag) u->template set<tag>();
+    return u->template get<tag>();
 }
 
-static aidl::CellIdentityGsm toAidl(const V1_5::CellIdentityGsm& ci) {
-    return {
-            .mcc = ci.base.base.mcc,
-            .mnc = ci.base.base.mnc,
-            .lac = ci.base.base.lac,
-            .cid = ci.base.base.cid,
-            .arfcn = ci.base.base.arfcn,
-            .bsic = static_cast<int8_t>(ci.base.base.bsic),
-            .operatorNames = toAidl(ci.base.operatorNames),
-            .additionalPlmns = toAidl(ci.additionalPlmns),
-    };
+static void toAidl(const V1_2::CellIdentityOperatorNames& names, aidl::OperatorInfo* out) {
+    toAidl(names.alphaLong, &out->alphaLong);
+    toAidl(names.alphaShort, &out->alphaShort);
+    out->operatorNumeric.clear();
+    out->status = aidl::OperatorInfo::STATUS_UNKNOWN;
+}
+
+static void toAidl(const V1_5::CellIdentityGsm& ci, aidl::CellIdentityGsm* out) {
+    toAidl(ci.base.base.mcc, &out->mcc);
+    toAidl(ci.base.base.mnc, &out->mnc);
+    out->lac = ci.base.base.lac;
+    out->cid = ci.base.base.cid;
+    out->arfcn = ci.base.base.arfcn;
+    out->bsic = static_cast<int8_t>(ci.base.base.bsic);
+    toAidl(ci.base.operatorNames, &out->operatorNames);
+    toAidl(ci.additionalPlmns, &out->additionalPlmns);
 }
 
 aidl::ClosedSubscriberGroupInfo toAidl(const V1_5::ClosedSubscriberGroupInfo& info) {
@@ -195,93 +203,99 @@ aidl::ClosedSubscriberGroupInfo toAidl(const V1_5::ClosedSubscriberGroupInfo& in
     };
 }
 
-static std::optional<aidl::ClosedSubscriberGroupInfo> toAidl(const V1_5::OptionalCsgInfo& opt) {
+static void toAidl(const V1_5::OptionalCsgInfo& opt,
+                   std::optional<aidl::ClosedSubscriberGroupInfo>* out) {
     using descr = V1_5::OptionalCsgInfo::hidl_discriminator;
-    if (opt.getDiscriminator() == descr::noinit) return std::nullopt;
-    return toAidl(opt.csgInfo());
-}
-
-static aidl::CellIdentityWcdma toAidl(const V1_5::CellIdentityWcdma& ci) {
-    return {
-            .mcc = ci.base.base.mcc,
-            .mnc = ci.base.base.mnc,
-            .lac = ci.base.base.lac,
-            .cid = ci.base.base.cid,
-            .psc = ci.base.base.psc,
-            .uarfcn = ci.base.base.uarfcn,
-            .operatorNames = toAidl(ci.base.operatorNames),
-            .additionalPlmns = toAidl(ci.additionalPlmns),
-            .csgInfo = toAidl(ci.optionalCsgInfo),
-    };
-}
-
-static aidl::CellIdentityTdscdma toAidl(const V1_5::CellIdentityTdscdma& ci) {
-    return {
-            .mcc = ci.base.base.mcc,
-            .mnc = ci.base.base.mnc,
-            .lac = ci.base.base.lac,
-            .cid = ci.base.base.cid,
-            .cpid = ci.base.base.cpid,
-            .uarfcn = ci.base.uarfcn,
-            .operatorNames = toAidl(ci.base.operatorNames),
-            .additionalPlmns = toAidl(ci.additionalPlmns),
-            .csgInfo = toAidl(ci.optionalCsgInfo),
-    };
-}
-
-static aidl::CellIdentityCdma toAidl(const V1_2::CellIdentityCdma& ci) {
-    return {
-            .networkId = ci.base.networkId,
-            .systemId = ci.base.systemId,
-            .baseStationId = ci.base.baseStationId,
-            .longitude = ci.base.longitude,
-            .latitude = ci.base.latitude,
-            .operatorNames = toAidl(ci.operatorNames),
-    };
-}
+    if (opt.getDiscriminator() == descr::noinit) {
+        out->reset();
+        return;
+    }
+    if (!out->has_value()) out->emplace();
+
+    const auto& info = opt.csgInfo();
+    (*out)->csgIndication = info.csgIndication;
+    toAidl(info.homeNodebName, &(*out)->homeNodebName);
+    (*out)->csgIdentity = info.csgIdentity;
+}
+
+static void toAidl(const V1_5::CellIdentityWcdma& ci, aidl::CellIdentityWcdma* out) {
+    toAidl(ci.base.base.mcc, &out->mcc);
+    toAidl(ci.base.base.mnc, &out->mnc);
+    out->lac = ci.base.base.lac;
+    out->cid = ci.base.base.cid;
+    out->psc = ci.base.base.psc;
+    out->uarfcn = ci.base.base.uarfcn;
+    toAidl(ci.base.operatorNames, &out->operatorNames);
+    toAidl(ci.additionalPlmns, &out->additionalPlmns);
+    toAidl(ci.optionalCsgInfo, &out->csgInfo);
+}
+
+static void toAidl(const V1_5::CellIdentityTdscdma& ci, aidl::CellIdentityTdscdma* out) {
+    toAidl(ci.base.base.mcc, &out->mcc);
+    toAidl(ci.base.base.mnc, &out->mnc);
+    out->lac = ci.base.base.lac;
+    out->cid = ci.base.base.cid;
+    out->cpid = ci.base.base.cpid;
+    out->uarfcn = ci.base.uarfcn;
+    toAidl(ci.base.operatorNames, &out->operatorNames);
+    toAidl(ci.additionalPlmns, &out->additionalPlmns);
+    toAidl(ci.optionalCsgInfo, &out->csgInfo);
+}
+
+static void toAidl(const V1_2::CellIdentityCdma& ci, aidl::CellIdentityCdma* out) {
+    out->networkId = ci.base.networkId;
+    out->systemId = ci.base.systemId;
+    out->baseStationId = ci.base.baseStationId;
+    out->longitude = ci.base.longitude;
+    out->latitude = ci.base.latitude;
+    toAidl(ci.operatorNames, &out->operatorNames);
+}
+
+static void toAidl(const V1_5::CellIdentityLte& ci, aidl::CellIdentityLte* out) {
+    toAidl(ci.base.base.mcc, &out->mcc);
+    toAidl(ci.base.base.mnc, &out->mnc);
+    out->ci = ci.base.base.ci;
+    out->pci = ci.base.base.pci;
+    out->tac = ci.base.base.tac;
+    out->earfcn = ci.base.base.earfcn;
+    toAidl(ci.base.operatorNames, &out->operatorNames);
+    out->bandwidth = ci.base.bandwidth;
+    toAidl(ci.additionalPlmns, &out->additionalPlmns);
+    toAidl(ci.optionalCsgInfo, &out->csgInfo);
+    toAidl(ci.bands, &out->bands);
+}
+
+static void toAidl(const V1_5::CellIdentityNr& ci, aidl::CellIdentityNr* out) {
+    toAidl(ci.base.mcc, &out->mcc);
+    toAidl(ci.base.mnc, &out->mnc);
+    out->nci = static_cast<int64_t>(ci.base.nci);
+    out->pci = static_cast<int32_t>(ci.base.pci);
+    out->tac = ci.base.tac;
+    out->nrarfcn = ci.base.nrarfcn;
+    toAidl(ci.base.operatorNames, &out->operatorNames);
+    toAidl(ci.additionalPlmns, &out->additionalPlmns);
+    toAidl(ci.bands, &out->bands);
+}
+
+static void toAidl(const V1_5::CellIdentity& ci, aidl::CellIdentity* out) {
+    using Discr = V1_5::CellIdentity::hidl_discriminator;
+    using Tag = aidl::CellIdentity::Tag;
+    const auto discr = ci.getDiscriminator();
 
-static aidl::CellIdentityLte toAidl(const V1_5::CellIdentityLte& ci) {
-    return {
-            .mcc = ci.base.base.mcc,
-            .mnc = ci.base.base.mnc,
-            .ci = ci.base.base.ci,
-            .pci = ci.base.base.pci,
-            .tac = ci.base.base.tac,
-            .earfcn = ci.base.base.earfcn,
-            .operatorNames = toAidl(ci.base.operatorNames),
-            .bandwidth = ci.base.bandwidth,
-            .additionalPlmns = toAidl(ci.additionalPlmns),
-            .csgInfo = toAidl(ci.optionalCsgInfo),
-            .bands = toAidl(ci.bands),
-    };
-}
+    if (discr == Discr::gsm) return toAidl(ci.gsm(), &emplaceTag<Tag::gsm>(out));
+    if (discr == Discr::wcdma) return toAidl(ci.wcdma(), &emplaceTag<Tag::wcdma>(out));
+    if (discr == Discr::tdscdma) return toAidl(ci.tdscdma(), &emplaceTag<Tag::tdscdma>(out));
+    if (discr == Discr::cdma) return toAidl(ci.cdma(), &emplaceTag<Tag::cdma>(out));
+    if (discr == Discr::lte) return toAidl(ci.lte(), &emplaceTag<Tag::lte>(out));
+    if (discr == Discr::nr) return toAidl(ci.nr(), &emplaceTag<Tag::nr>(out));
 
-static aidl::CellIdentityNr toAidl(const V1_5::CellIdentityNr& ci) {
-    return {
-            .mcc = ci.base.mcc,
-            .mnc = ci.base.mnc,
-            .nci = static_cast<int64_t>(ci.base.nci),
-            .pci = static_cast<int32_t>(ci.base.pci),
-            .tac = ci.base.tac,
-            .nrarfcn = ci.base.nrarfcn,
-            .operatorNames = toAidl(ci.base.operatorNames),
-            .additionalPlmns = toAidl(ci.additionalPlmns),
-            .bands = toAidl(ci.bands),
-    };
+    *out = {};
 }
 
 aidl::CellIdentity toAidl(const V1_5::CellIdentity& ci) {
-    using Discr = V1_5::CellIdentity::hidl_discriminator;
-    const auto discr = ci.getDiscriminator();
-
-    if (discr == Discr::gsm) return toAidl(ci.gsm());
-    if (discr == Discr::wcdma) return toAidl(ci.wcdma());
-    if (discr == Discr::tdscdma) return toAidl(ci.tdscdma());
-    if (discr == Discr::cdma) return toAidl(ci.cdma());
-    if (discr == Discr::lte) return toAidl(ci.lte());
-    if (discr == Discr::nr) return toAidl(ci.nr());
-
-    return {};
+    aidl::CellIdentity out;
+    toAidl(ci, &out);
+    return out;
 }
 
 static std::optional<aidl::BarringTypeSpecificInfo>  //
@@ -313,11 +327,9 @@ static aidl::GsmSignalStrength toAidl(const V1_0::GsmSignalStrength& sig) {
     };
 }
 
-static aidl::CellInfoGsm toAidl(const V1_5::CellInfoGsm& info) {
-    return {
-            .cellIdentityGsm = toAidl(info.cellIdentityGsm),
-            .signalStrengthGsm = toAidl(info.signalStrengthGsm),
-    };
+static void toAidl(const V1_5::CellInfoGsm& info, aidl::CellInfoGsm* out) {
+    toAidl(info.cellIdentityGsm, &out->cellIdentityGsm);
+    out->signalStrengthGsm = toAidl(info.signalStrengthGsm);
 }
 
 static aidl::WcdmaSignalStrength toAidl(const V1_2::WcdmaSignalStrength& sig) {
@@ -329,11 +341,9 @@ static aidl::WcdmaSignalStrength toAidl(const V1_2::WcdmaSignalStrength& sig) {
     };
 }
 
-static aidl::CellInfoWcdma toAidl(const V1_5::CellInfoWcdma& info) {
-    return {
-            .cellIdentityWcdma = toAidl(info.cellIdentityWcdma),
-            .signalStrengthWcdma = toAidl(info.signalStrengthWcdma),
-    };
+static void toAidl(const V1_5::CellInfoWcdma& info, aidl::CellInfoWcdma* out) {
+    toAidl(info.cellIdentityWcdma, &out->cellIdentityWcdma);
+    out->signalStrengthWcdma = toAidl(info.signalStrengthWcdma);
 }
 
 static aidl::TdscdmaSignalStrength toAidl(const V1_2::TdscdmaSignalStrength& sig) {
@@ -344,11 +354,9 @@ static aidl::TdscdmaSignalStrength toAidl(const V1_2::TdscdmaSignalStrength& sig
     };
 }
 
-static aidl::CellInfoTdscdma toAidl(const V1_5::CellInfoTdscdma& info) {
-    return {
-            .cellIdentityTdscdma = toAidl(info.cellIdentityTdscdma),
-            .signalStrengthTdscdma = toAidl(info.signalStrengthTdscdma),
-    };
+static void toAidl(const V1_5::CellInfoTdscdma& info, aidl::CellInfoTdscdma* out) {
+    toAidl(info.cellIdentityTdscdma, &out->cellIdentityTdscdma);
+    out->signalStrengthTdscdma = toAidl(info.signalStrengthTdscdma);
 }
 
 static aidl::LteSignalStrength toAidl(const V1_6::LteSignalStrength& sig) {
@@ -367,18 +375,14 @@ static aidl::LteSignalStrength toAidl(const V1_0::LteSignalStrength& sig) {
     return toAidl({sig, 0});
 }
 
-static aidl::CellInfoLte toAidl(const V1_5::CellInfoLte& info) {
-    return {
-            .cellIdentityLte = toAidl(info.cellIdentityLte),
-            .signalStrengthLte = toAidl(info.signalStrengthLte),
-    };
+static void toAidl(const V1_5::CellInfoLte& info, aidl::CellInfoLte* out) {
+    toAidl(info.cellIdentityLte, &out->cellIdentityLte);
+    out->signalStrengthLte = toAidl(info.signalStrengthLte);
 }
 
-static aidl::CellInfoLte toAidl(const V1_6::CellInfoLte& info) {
-    return {
-            .cellIdentityLte = toAidl(info.cellIdentityLte),
-            .signalStrengthLte = toAidl(info.signalStrengthLte),
-    };
+static void toAidl(const V1_6::CellInfoLte& info, aidl::CellInfoLte* out) {
+    toAidl(info.cellIdentityLte, &out->cellIdentityLte);
+    out->signalStrengthLte = toAidl(info.signalStrengthLte);
 }
 
 static aidl::NrSignalStrength toAidl(const V1_6::NrSignalStrength& sig) {
@@ -398,18 +402,14 @@ static aidl::NrSignalStrength toAidl(const V1_4::NrSignalStrength& sig) {
     return toAidl({sig, 0, 0});
 }
 
-static aidl::CellInfoNr toAidl(const V1_5::CellInfoNr& info) {
-    return {
-            .cellIdentityNr = toAidl(info.cellIdentityNr),
-            .signalStrengthNr = toAidl(info.signalStrengthNr),
-    };
+static void toAidl(const V1_5::CellInfoNr& info, aidl::CellInfoNr* out) {
+    toAidl(info.cellIdentityNr, &out->cellIdentityNr);
+    out->signalStrengthNr = toAidl(info.signalStrengthNr);
 }
 
-static aidl::CellInfoNr toAidl(const V1_6::CellInfoNr& info) {
-    return {
-            .cellIdentityNr = toAidl(info.cellIdentityNr),
-            .signalStrengthNr = toAidl(info.signalStrengthNr),
-    };
+static void toAidl(const V1_6::CellInfoNr& info, aidl::CellInfoNr* out) {
+    toAidl(info.cellIdentityNr, &out->cellIdentityNr);
+    out->signalStrengthNr = toAidl(info.signalStrengthNr);
 }
 
 static aidl::CdmaSignalStrength toAidl(const V1_0::CdmaSignalStrength& sig) {
@@ -427,57 +427,67 @@ static aidl::EvdoSignalStrength toAidl(const V1_0::EvdoSignalStrength& sig) {
     };
 }
 
-static aidl::CellInfoCdma toAidl(const V1_2::CellInfoCdma& info) {
-    return {
-            .cellIdentityCdma = toAidl(info.cellIdentityCdma),
-            .signalStrengthCdma = toAidl(info.signalStrengthCdma),
-            .signalStrengthEvdo = toAidl(info.signalStrengthEvdo),
-    };
+static void toAidl(const V1_2::CellInfoCdma& info, aidl::CellInfoCdma* out) {
+    toAidl(info.cellIdentityCdma, &out->cellIdentityCdma);
+    out->signalStrengthCdma = toAidl(info.signalStrengthCdma);
+    out->signalStrengthEvdo = toAidl(info.signalStrengthEvdo);
 }
 
-static aidl::CellInfoRatSpecificInfo toAidl(const V1_5::CellInfo::CellInfoRatSpecificInfo& ci) {
+static void toAidl(const V1_5::CellInfo::CellInfoRatSpecificInfo& ci,
+                   aidl::CellInfoRatSpecificInfo* out) {
     using Discr = V1_5::CellInfo::CellInfoRatSpecificInfo::hidl_discriminator;
+    using Tag = aidl::CellInfoRatSpecificInfo::Tag;
     const auto discr = ci.getDiscriminator();
 
-    if (discr == Discr::gsm) return toAidl(ci.gsm());
-    if (discr == Discr::wcdma) return toAidl(ci.wcdma());
-    if (discr == Discr::tdscdma) return toAidl(ci.tdscdma());
-    if (discr == Discr::lte) return toAidl(ci.lte());
-    if (discr == Discr::nr) return toAidl(ci.nr());
-    if (discr == Discr::cdma) return toAidl(ci.cdma());
+    if (discr == Discr::gsm) return toAidl(ci.gsm(), &emplaceTag<Tag::gsm>(out));
+    if (discr == Discr::wcdma) return toAidl(ci.wcdma(), &emplaceTag<Tag::wcdma>(out));
+    if (discr == Discr::tdscdma) return toAidl(ci.tdscdma(), &emplaceTag<Tag::tdscdma>(out));
+    if (discr == Discr::lte) return toAidl(ci.lte(), &emplaceTag<Tag::lte>(out));
+    if (discr == Discr::nr) return toAidl(ci.nr(), &emplaceTag<Tag::nr>(out));
+    if (discr == Discr::cdma) return toAidl(ci.cdma(), &emplaceTag<Tag::cdma>(out));
 
-    return {};
+    *out = {};
 }
 
-static aidl::CellInfoRatSpecificInfo toAidl(const V1_6::CellInfo::CellInfoRatSpecificInfo& ci) {
+static void toAidl(const V1_6::CellInfo::CellInfoRatSpecificInfo& ci,
+                   aidl::CellInfoRatSpecificInfo* out) {
     using Discr = V1_6::CellInfo::CellInfoRatSpecificInfo::hidl_discriminator;
+    using Tag = aidl::CellInfoRatSpecificInfo::Tag;
     const auto discr = ci.getDiscriminator();
 
-    if (discr == Discr::gsm) return toAidl(ci.gsm());
-    if (discr == Discr::wcdma) return toAidl(ci.wcdma());
-    if (discr == Discr::tdscdma) return toAidl(ci.tdscdma());
-    if (discr == Discr::lte) return toAidl(ci.lte());
-    if (discr == Discr::nr) return toAidl(ci.nr());
-    if (discr == Discr::cdma) return toAidl(ci.cdma());
+    if (discr == Discr::gsm) return toAidl(ci.gsm(), &emplaceTag<Tag::gsm>(out));
+    if (discr == Discr::wcdma) return toAidl(ci.wcdma(), &emplaceTag<Tag::wcdma>(out));
+    if (discr == Discr::tdscdma) return toAidl(ci.tdscdma(), &emplaceTag<Tag::tdscdma>(out));
+    if (discr == Discr::lte) return toAidl(ci.lte(), &emplaceTag<Tag::lte>(out));
+    if (discr == Discr::nr) return toAidl(ci.nr(), &emplaceTag<Tag::nr>(out));
+    if (discr == Discr::cdma) return toAidl(ci.cdma(), &emplaceTag<Tag::cdma>(out));
 
-    return {};
+    *out = {};
+}
+
+void toAidl(const V1_5::CellInfo& info, aidl::CellInfo* out) {
+    out->registered = info.registered;
+    // ignored: timeStampType and timeStamp
+    out->connectionStatus = aidl::CellConnectionStatus(info.connectionStatus);
+    toAidl(info.ratSpecificInfo, &out->ratSpecificInfo);
+}
+
+void toAidl(const V1_6::CellInfo& info, aidl::CellInfo* out) {
+    out->registered = info.registered;
+    out->connectionStatus = aidl::CellConnectionStatus(info.connectionStatus);
+    toAidl(info.ratSpecificInfo, &out->ratSpecificInfo);
 }
 
 aidl::CellInfo toAidl(const V1_5::CellInfo& info) {
-    return {
-            .registered = info.registered,
-            // ignored: timeStampType and timeStamp
-            .connectionStatus = aidl::CellConnectionStatus(info.connectionStatus),
-            .ratSpecificInfo = toAidl(info.ratSpecificInfo),
-    };
+    aidl::CellInfo out;
+    toAidl(info, &out);
+    return out;
 }
 
 aidl::CellInfo toAidl(const V1_6::CellInfo& info) {
-    return {
-            .registered = info.registered,
-            .connectionStatus = aidl::CellConnectionStatus(info.connectionStatus),
-            .ratSpecificInfo = toAidl(info.ratSpecificInfo),
-    };
+    aidl::CellInfo out;
+    toAidl(info, &out);
+    return out;
 }
 
 aidl::LinkCapacityEstimate toAidl(const V1_2::LinkCapacityEstimate& e) {
@@ -572,6 +582,12 @@ aidl::NetworkScanResult toAidl(const V1_5::NetworkScanResult& res) {
     };
 }
 
+void toAidl(const V1_5::NetworkScanResult& res, aidl::NetworkScanResult* out) {
+    out->status = static_cast<int32_t>(res.status);
+    out->error = toAidl(res.error);
+    toAidl(res.networkInfos, &out->networkInfos);
+}
+
 aidl::NetworkScanResult toAidl(const V1_6::NetworkScanResult& res) {
     return {
             .status = static_cast<int32_t>(res.status),
@@ -580,6 +596,12 @@ aidl::NetworkScanResult toAidl(const V1_6::NetworkScanResult& res) {
     };
 }
 
+void toAidl(const V1_6::NetworkScanResult& res, aidl::NetworkScanResult* out) {
+    out->status = static_cast<int32_t>(res.status);
+    out->error = toAidl(res.error);
+    toAidl(res.networkInfos, &out->networkInfos);
+}
+
 aidl::SuppSvcNotification toAidl(const V1_0::SuppSvcNotification& svc) {
     return {
             .isMT = svc.isMT,
@@ -66,6 +66,8 @@ toAidl(const V1_5::ClosedSubscriberGroupInfo& info);
 
 ::aidl::android::hardware::radio::network::CellInfo toAidl(const V1_5::CellInfo& info);
 ::aidl::android::hardware::radio::network::CellInfo toAidl(const V1_6::CellInfo& info);
+void toAidl(const V1_5::CellInfo& info, ::aidl::android::hardware::radio::network::CellInfo* out);
+void toAidl(const V1_6::CellInfo& info, ::aidl::android::hardware::radio::network::CellInfo* out);
 
 ::aidl::android::hardware::radio::network::LinkCapacityEstimate  //
 toAidl(const V1_2::LinkCapacityEstimate& lce);
@@ -84,6 +86,10 @@ toAidl(const V1_6::PhysicalChannelConfig& cfg);
 toAidl(const V1_5::NetworkScanResult& res);
 ::aidl::android::hardware::radio::network::NetworkScanResult  //
 toAidl(const V1_6::NetworkScanResult& res);
+void toAidl(const V1_5::NetworkScanResult& res,
+            ::aidl::android::hardware::radio::network::NetworkScanResult* out);
+void toAidl(const V1_6::NetworkScanResult& res,
+            ::aidl::android::hardware::radio::network::NetworkScanResult* out);
 
 ::aidl::android::hardware::radio::network::SuppSvcNotification  //
 toAidl(const V1_0::SuppSvcNotification& svc);
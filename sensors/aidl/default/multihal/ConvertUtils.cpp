@@ -205,11 +205,50 @@ void convertToHidlEvent(const AidlEvent& aidlEvent, V2_1Event* hidlEvent) {
     }
 }
 
-void convertToAidlEvent(const V2_1Event& hidlEvent, AidlEvent* aidlEvent) {
-    static_assert(decltype(hidlEvent.u.data)::elementCount() == 16);
+namespace {
+
+// Conversions shared by convertToAidlEvent() and the per type loops of convertToAidlEvents().
+
+inline void convertToAidlEventHeader(const V2_1Event& hidlEvent, AidlEvent* aidlEvent) {
     aidlEvent->timestamp = hidlEvent.timestamp;
     aidlEvent->sensorHandle = hidlEvent.sensorHandle;
     aidlEvent->sensorType = (AidlSensorType)hidlEvent.sensorType;
+}
+
+inline AidlEvent::EventPayload::Vec3 convertToAidlVec3(const V2_1Event& hidlEvent) {
+    AidlEvent::EventPayload::Vec3 vec3;
+    vec3.x = hidlEvent.u.vec3.x;
+    vec3.y = hidlEvent.u.vec3.y;
+    vec3.z = hidlEvent.u.vec3.z;
+    vec3.status = (SensorStatus)hidlEvent.u.vec3.status;
+    return vec3;
+}
+
+inline AidlEvent::EventPayload::Vec4 convertToAidlVec4(const V2_1Event& hidlEvent) {
+    AidlEvent::EventPayload::Vec4 vec4;
+    vec4.x = hidlEvent.u.vec4.x;
+    vec4.y = hidlEvent.u.vec4.y;
+    vec4.z = hidlEvent.u.vec4.z;
+    vec4.w = hidlEvent.u.vec4.w;
+    return vec4;
+}
+
+inline AidlEvent::EventPayload::Uncal convertToAidlUncal(const V2_1Event& hidlEvent) {
+    AidlEvent::EventPayload::Uncal uncal;
+    uncal.x = hidlEvent.u.uncal.x;
+    uncal.y = hidlEvent.u.uncal.y;
+    uncal.z = hidlEvent.u.uncal.z;
+    uncal.xBias = hidlEvent.u.uncal.x_bias;
+    uncal.yBias = hidlEvent.u.uncal.y_bias;
+    uncal.zBias = hidlEvent.u.uncal.z_bias;
+    return uncal;
+}
+
+}  // namespace
+
+void convertToAidlEvent(const V2_1Event& hidlEvent, AidlEvent* aidlEvent) {
+    static_assert(decltype(hidlEvent.u.data)::elementCount() == 16);
+    convertToAidlEventHeader(hidlEvent, aidlEvent);
     switch (hidlEvent.sensorType) {
         case V2_1SensorType::META_DATA: {
             AidlEvent::EventPayload::MetaData meta;
@@ -222,24 +261,12 @@ void convertToAidlEvent(const V2_1Event& hidlEvent, AidlEvent* aidlEvent) {
         case V2_1SensorType::ORIENTATION:
         case V2_1SensorType::GYROSCOPE:
         case V2_1SensorType::GRAVITY:
-        case V2_1SensorType::LINEAR_ACCELERATION: {
-            AidlEvent::EventPayload::Vec3 vec3;
-            vec3.x = hidlEvent.u.vec3.x;
-            vec3.y = hidlEvent.u.vec3.y;
-            vec3.z = hidlEvent.u.vec3.z;
-            vec3.status = (SensorStatus)hidlEvent.u.vec3.status;
-            aidlEvent->payload.set<Event::EventPayload::vec3>(vec3);
+        case V2_1SensorType::LINEAR_ACCELERATION:
+            aidlEvent->payload.set<Event::EventPayload::vec3>(convertToAidlVec3(hidlEvent));
             break;
-        }
-        case V2_1SensorType::GAME_ROTATION_VECTOR: {
-            AidlEvent::EventPayload::Vec4 vec4;
-            vec4.x = hidlEvent.u.vec4.x;
-            vec4.y = hidlEvent.u.vec4.y;
-            vec4.z = hidlEvent.u.vec4.z;
-            vec4.w = hidlEvent.u.vec4.w;
-            aidlEvent->payload.set<Event::EventPayload::vec4>(vec4);
+        case V2_1SensorType::GAME_ROTATION_VECTOR:
+            aidlEvent->payload.set<Event::EventPayload::vec4>(convertToAidlVec4(hidlEvent));
             break;
-        }
         case V2_1SensorType::ROTATION_VECTOR:
         case V2_1SensorType::GEOMAGNETIC_ROTATION_VECTOR: {
             AidlEvent::EventPayload::Data data;
@@ -250,17 +277,9 @@ void convertToAidlEvent(const V2_1Event& hidlEvent, AidlEvent* aidlEvent) {
         }
         case V2_1SensorType::MAGNETIC_FIELD_UNCALIBRATED:
         case V2_1SensorType::GYROSCOPE_UNCALIBRATED:
-        case V2_1SensorType::ACCELEROMETER_UNCALIBRATED: {
-            AidlEvent::EventPayload::Uncal uncal;
-            uncal.x = hidlEvent.u.uncal.x;
-            uncal.y = hidlEvent.u.uncal.y;
-            uncal.z = hidlEvent.u.uncal.z;
-            uncal.xBias = hidlEvent.u.uncal.x_bias;
-            uncal.yBias = hidlEvent.u.uncal.y_bias;
-            uncal.zBias = hidlEvent.u.uncal.z_bias;
-            aidlEvent->payload.set<Event::EventPayload::uncal>(uncal);
+        case V2_1SensorType::ACCELEROMETER_UNCALIBRATED:
+            aidlEvent->payload.set<Event::EventPayload::uncal>(convertToAidlUncal(hidlEvent));
             break;
-        }
         case V2_1SensorType::DEVICE_ORIENTATION:
         case V2_1SensorType::LIGHT:
         case V2_1SensorType::PRESSURE:
@@ -356,6 +375,54 @@ void convertToAidlEvent(const V2_1Event& hidlEvent, AidlEvent* aidlEvent) {
     }
 }
 
+void convertToAidlEvents(const V2_1Event* hidlEvents, size_t count, AidlEvent* aidlEvents) {
+    size_t i = 0;
+    while (i < count) {
+        const V2_1SensorType sensorType = hidlEvents[i].sensorType;
+        size_t end = i + 1;
+        while (end < count && hidlEvents[end].sensorType == sensorType) {
+            ++end;
+        }
+
+        // Only the payloads of high rate sensors have a loop of their own.
+        switch (sensorType) {
+            case V2_1SensorType::ACCELEROMETER:
+            case V2_1SensorType::MAGNETIC_FIELD:
+            case V2_1SensorType::ORIENTATION:
+            case V2_1SensorType::GYROSCOPE:
+            case V2_1SensorType::GRAVITY:
+            case V2_1SensorType::LINEAR_ACCELERATION:
+                for (; i < end; ++i) {
+                    convertToAidlEventHeader(hidlEvents[i], &aidlEvents[i]);
+                    aidlEvents[i].payload.set<Event::EventPayload::vec3>(
+                            convertToAidlVec3(hidlEvents[i]));
+                }
+                break;
+            case V2_1SensorType::GAME_ROTATION_VECTOR:
+                for (; i < end; ++i) {
+                    convertToAidlEventHeader(hidlEvents[i], &aidlEvents[i]);
+                    aidlEvents[i].payload.set<Event::EventPayload::vec4>(
+                            convertToAidlVec4(hidlEvents[i]));
+                }
+                break;
+            case V2_1SensorType::MAGNETIC_FIELD_UNCALIBRATED:
+            case V2_1SensorType::GYROSCOPE_UNCALIBRATED:
+            case V2_1SensorType::ACCELEROMETER_UNCALIBRATED:
+                for (; i < end; ++i) {
+                    convertToAidlEventHeader(hidlEvents[i], &aidlEvents[i]);
+                    aidlEvents[i].payload.set<Event::EventPayload::uncal>(
+                            convertToAidlUncal(hidlEvents[i]));
+                }
+                break;
+            default:
+                for (; i < end; ++i) {
+                    convertToAidlEvent(hidlEvents[i], &aidlEvents[i]);
+                }
+                break;
+        }
+    }
+}
+
 }  // namespace implementation
 }  // namespace sensors
 }  // namespace hardware
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the event throughput of HalProxyAidl. BM_PostEvents has a fake
+// sub-HAL post batches of accelerometer events through its callback, like a
+// sensor thread does, and reads them back from the AIDL event queue, like the
+// framework does. BM_ConvertEach and BM_ConvertBatch compare converting events
+// to the AIDL layout one at a time and in batches, for a single sensor type and
+// for interleaved types (argument 1).
+
+#include <benchmark/benchmark.h>
+
+#include <iterator>
+#include <vector>
+
+#include <aidl/android/hardware/sensors/BnSensorsCallback.h>
+#include <android/hardware/sensors/2.1/types.h>
+#include <fmq/AidlMessageQueue.h>
+
+#include "ConvertUtils.h"
+#include "HalProxyAidl.h"
+#include "SensorsSubHal.h"
+
+using ::aidl::android::hardware::common::fmq::SynchronizedReadWrite;
+using ::aidl::android::hardware::sensors::BnSensorsCallback;
+using ::aidl::android::hardware::sensors::ISensors;
+using ::aidl::android::hardware::sensors::implementation::convertToAidlEvent;
+using ::aidl::android::hardware::sensors::implementation::convertToAidlEvents;
+using ::aidl::android::hardware::sensors::implementation::HalProxyAidl;
+using ::android::AidlMessageQueue;
+using ::android::hardware::sensors::V2_1::implementation::HalProxy;
+using ::android::hardware::sensors::V2_1::subhal::implementation::ContinuousSensorsSubHal;
+using ::android::hardware::sensors::V2_1::subhal::implementation::SensorsSubHalV2_1;
+using ::benchmark::State;
+using ::ndk::ScopedAStatus;
+
+using AidlEvent = ::aidl::android::hardware::sensors::Event;
+using AidlSensorInfo = ::aidl::android::hardware::sensors::SensorInfo;
+using HidlEvent = ::android::hardware::sensors::V2_1::Event;
+using HidlSensorType = ::android::hardware::sensors::V2_1::SensorType;
+
+namespace {
+
+// Same as the event queue of the framework.
+constexpr size_t kQueueSize = 256;
+
+class NoOpSensorsCallback : public BnSensorsCallback {
+  public:
+    ScopedAStatus onDynamicSensorsConnected(
+            const std::vector<AidlSensorInfo>& /*sensorInfos*/) override {
+        return ScopedAStatus::ok();
+    }
+
+    ScopedAStatus onDynamicSensorsDisconnected(
+            const std::vector<int32_t>& /*sensorHandles*/) override {
+        return ScopedAStatus::ok();
+    }
+};
+
+std::vector<HidlEvent> makeEvents(size_t count, int32_t sensorHandle, bool interleaved) {
+    static constexpr HidlSensorType kTypes[] = {HidlSensorType::ACCELEROMETER,
+                                                HidlSensorType::GYROSCOPE,
+                                                HidlSensorType::MAGNETIC_FIELD_UNCALIBRATED,
+                                                HidlSensorType::GAME_ROTATION_VECTOR};
+    std::vector<HidlEvent> events(count);
+    for (size_t i = 0; i < count; ++i) {
+        HidlEvent& event = events[i];
+        event.sensorHandle = sensorHandle;
+        event.sensorType = interleaved ? kTypes[i % std::size(kTypes)] : kTypes[0];
+        event.timestamp = i * 5000000;
+        event.u.uncal.x = 0.1f;
+        event.u.uncal.y = 9.8f;
+        event.u.uncal.z = 0.2f;
+    }
+    return events;
+}
+
+void BM_PostEvents(State& state) {
+    ContinuousSensorsSubHal<SensorsSubHalV2_1> subHal;
+    std::vector<HalProxy::ISensorsSubHalV2_0*> subHals;
+    std::vector<HalProxy::ISensorsSubHalV2_1*> subHalsV2_1 = {&subHal};
+    std::shared_ptr<ISensors> proxy =
+            ndk::SharedRefBase::make<HalProxyAidl>(subHals, subHalsV2_1);
+
+    AidlMessageQueue<AidlEvent, SynchronizedReadWrite> eventQueue(kQueueSize,
+                                                                  true /* configureEventFlag */);
+    AidlMessageQueue<int32_t, SynchronizedReadWrite> wakeLockQueue(kQueueSize,
+                                                                   true /* configureEventFlag */);
+    if (!proxy->initialize(eventQueue.dupeDesc(), wakeLockQueue.dupeDesc(),
+                           ndk::SharedRefBase::make<NoOpSensorsCallback>())
+                 .isOk()) {
+        state.SkipWithError("initialize failed");
+        return;
+    }
+
+    int32_t sensorHandle = -1;
+    subHal.getSensorsList_2_1([&](const auto& sensors) {
+        for (const auto& sensor : sensors) {
+            if (sensor.type == HidlSensorType::ACCELEROMETER) sensorHandle = sensor.sensorHandle;
+        }
+    });
+    const std::vector<HidlEvent> events =
+            makeEvents(state.range(0), sensorHandle, false /* interleaved */);
+    std::vector<AidlEvent> received(events.size());
+    for (auto _ : state) {
+        subHal.postEvents(events, false /* wakeup */);
+        if (!eventQueue.read(received.data(), received.size())) {
+            state.SkipWithError("read failed");
+            return;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * events.size());
+}
+
+void BM_ConvertEach(State& state) {
+    const std::vector<HidlEvent> events = makeEvents(kQueueSize, 0, state.range(0));
+    std::vector<AidlEvent> aidlEvents(events.size());
+    for (auto _ : state) {
+        for (size_t i = 0; i < events.size(); ++i) {
+            convertToAidlEvent(events[i], &aidlEvents[i]);
+        }
+        benchmark::DoNotOptimize(aidlEvents.data());
+    }
+    state.SetItemsProcessed(state.iterations() * events.size());
+}
+
+void BM_ConvertBatch(State& state) {
+    const std::vector<HidlEvent> events = makeEvents(kQueueSize, 0, state.range(0));
+    std::vector<AidlEvent> aidlEvents(events.size());
+    for (auto _ : state) {
+        convertToAidlEvents(events.data(), events.size(), aidlEvents.data());
+        benchmark::DoNotOptimize(aidlEvents.data());
+    }
+    state.SetItemsProcessed(state.iterations() * events.size());
+}
+
+BENCHMARK(BM_PostEvents)->Arg(1)->Arg(16)->Arg(64)->Arg(kQueueSize);
+BENCHMARK(BM_ConvertEach)->Arg(0)->Arg(1);
+BENCHMARK(BM_ConvertBatch)->Arg(0)->Arg(1);
+
+}  // namespace
+
+BENCHMARK_MAIN();
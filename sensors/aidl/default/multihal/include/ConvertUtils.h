@@ -43,6 +43,13 @@ void convertToHidlEvent(const ::aidl::android::hardware::sensors::Event& aidlEve
 void convertToAidlEvent(const ::android::hardware::sensors::V2_1::Event& hidlEvent,
                         ::aidl::android::hardware::sensors::Event* aidlEvent);
 
+/**
+ * Populates AIDL Event instances based on HIDL V2.1 Event instances. Runs of events of the same
+ * sensor type are converted without dispatching on the type of every event.
+ */
+void convertToAidlEvents(const ::android::hardware::sensors::V2_1::Event* hidlEvents, size_t count,
+                         ::aidl::android::hardware::sensors::Event* aidlEvents);
+
 }  // namespace implementation
 }  // namespace sensors
 }  // namespace hardware
@@ -22,6 +22,8 @@
 #include "EventMessageQueueWrapper.h"
 #include "ISensorsWrapper.h"
 
+#include <vector>
+
 namespace aidl {
 namespace android {
 namespace hardware {
@@ -31,11 +33,12 @@ namespace implementation {
 class EventMessageQueueWrapperAidl
     : public ::android::hardware::sensors::V2_1::implementation::EventMessageQueueWrapperBase {
   public:
-    EventMessageQueueWrapperAidl(
-            std::unique_ptr<::android::AidlMessageQueue<
-                    ::aidl::android::hardware::sensors::Event,
-                    ::aidl::android::hardware::common::fmq::SynchronizedReadWrite>>& queue)
-        : mQueue(std::move(queue)) {}
+    using AidlEventMessageQueue =
+            ::android::AidlMessageQueue<::aidl::android::hardware::sensors::Event,
+                                        ::aidl::android::hardware::common::fmq::SynchronizedReadWrite>;
+
+    EventMessageQueueWrapperAidl(std::unique_ptr<AidlEventMessageQueue>& queue)
+        : mQueue(std::move(queue)), mIntermediateEventBuffer(mQueue->getQuantumCount()) {}
 
     virtual std::atomic<uint32_t>* getEventFlagWord() override {
         return mQueue->getEventFlagWord();
@@ -47,35 +50,50 @@ class EventMessageQueueWrapperAidl
 
     virtual bool read(::android::hardware::sensors::V2_1::Event* events,
                       size_t numToRead) override {
-        bool success = mQueue->read(mIntermediateEventBuffer.data(), numToRead);
-        for (int i = 0; i < numToRead; ++i) {
-            convertToHidlEvent(mIntermediateEventBuffer[i], &events[i]);
+        AidlEventMessageQueue::MemTransaction tx;
+        if (!mQueue->beginRead(numToRead, &tx)) {
+            return false;
+        }
+        const auto& first = tx.getFirstRegion();
+        const auto& second = tx.getSecondRegion();
+        for (size_t i = 0; i < first.getLength(); ++i) {
+            convertToHidlEvent(first.getAddress()[i], &events[i]);
         }
-        return success;
+        for (size_t i = 0; i < second.getLength(); ++i) {
+            convertToHidlEvent(second.getAddress()[i], &events[first.getLength() + i]);
+        }
+        return mQueue->commitRead(numToRead);
     }
 
     bool write(const ::android::hardware::sensors::V2_1::Event* events,
                size_t numToWrite) override {
-        for (int i = 0; i < numToWrite; ++i) {
-            convertToAidlEvent(events[i], &mIntermediateEventBuffer[i]);
+        // Events are converted in place in the queue, which the transaction splits in at most two
+        // regions when it wraps around.
+        AidlEventMessageQueue::MemTransaction tx;
+        if (!mQueue->beginWrite(numToWrite, &tx)) {
+            return false;
         }
-        return mQueue->write(mIntermediateEventBuffer.data(), numToWrite);
+        const auto& first = tx.getFirstRegion();
+        const auto& second = tx.getSecondRegion();
+        convertToAidlEvents(events, first.getLength(), first.getAddress());
+        convertToAidlEvents(events + first.getLength(), second.getLength(), second.getAddress());
+        return mQueue->commitWrite(numToWrite);
     }
 
     virtual bool write(
             const std::vector<::android::hardware::sensors::V2_1::Event>& events) override {
-        for (int i = 0; i < events.size(); ++i) {
-            convertToAidlEvent(events[i], &mIntermediateEventBuffer[i]);
-        }
-        return mQueue->write(mIntermediateEventBuffer.data(), events.size());
+        return write(events.data(), events.size());
     }
 
     bool writeBlocking(const ::android::hardware::sensors::V2_1::Event* events, size_t count,
                        uint32_t readNotification, uint32_t writeNotification, int64_t timeOutNanos,
                        ::android::hardware::EventFlag* evFlag) override {
-        for (int i = 0; i < count; ++i) {
-            convertToAidlEvent(events[i], &mIntermediateEventBuffer[i]);
+        // The space to write into is only known once the reader has made room for it, so blocking
+        // writes still go through the intermediate buffer.
+        if (count > mIntermediateEventBuffer.size()) {
+            return false;
         }
+        convertToAidlEvents(events, count, mIntermediateEventBuffer.data());
         return mQueue->writeBlocking(mIntermediateEventBuffer.data(), count, readNotification,
                                      writeNotification, timeOutNanos, evFlag);
     }
@@ -83,13 +101,8 @@ class EventMessageQueueWrapperAidl
     size_t getQuantumCount() override { return mQueue->getQuantumCount(); }
 
   private:
-    std::unique_ptr<::android::AidlMessageQueue<
-            ::aidl::android::hardware::sensors::Event,
-            ::aidl::android::hardware::common::fmq::SynchronizedReadWrite>>
-            mQueue;
-    std::array<::aidl::android::hardware::sensors::Event,
-               ::android::hardware::sensors::V2_1::implementation::MAX_RECEIVE_BUFFER_EVENT_COUNT>
-            mIntermediateEventBuffer;
+    std::unique_ptr<AidlEventMessageQueue> mQueue;
+    std::vector<::aidl::android::hardware::sensors::Event> mIntermediateEventBuffer;
 };
 
 }  // namespace implementation
@@ -27,6 +27,11 @@ namespace implementation {
 
 class HalProxyAidl : public ::android::hardware::sensors::V2_1::implementation::HalProxy,
                      public ::aidl::android::hardware::sensors::BnSensors {
+  public:
+    // Test only constructors, which take the sub-HALs to proxy.
+    using HalProxy::HalProxy;
+
+  private:
     ::ndk::ScopedAStatus activate(int32_t in_sensorHandle, bool in_enabled) override;
     ::ndk::ScopedAStatus batch(int32_t in_sensorHandle, int64_t in_samplingPeriodNs,
                                int64_t in_maxReportLatencyNs) override;
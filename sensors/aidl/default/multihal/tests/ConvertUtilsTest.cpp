@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <hidl/HidlSupport.h>
+
+#include <vector>
+
+#include "ConvertUtils.h"
+
+namespace {
+
+using ::aidl::android::hardware::sensors::implementation::convertToAidlEvent;
+using ::aidl::android::hardware::sensors::implementation::convertToAidlEvents;
+using ::android::hardware::hidl_enum_range;
+using AidlEvent = ::aidl::android::hardware::sensors::Event;
+using AidlSensorType = ::aidl::android::hardware::sensors::SensorType;
+using V2_1Event = ::android::hardware::sensors::V2_1::Event;
+using V2_1SensorType = ::android::hardware::sensors::V2_1::SensorType;
+
+// Every type a HIDL sub-HAL can report, including the AIDL only head tracker which is passed
+// through HIDL as raw data.
+std::vector<V2_1SensorType> allSensorTypes() {
+    std::vector<V2_1SensorType> types;
+    for (V2_1SensorType type : hidl_enum_range<V2_1SensorType>()) {
+        types.push_back(type);
+    }
+    types.push_back(static_cast<V2_1SensorType>(AidlSensorType::HEAD_TRACKER));
+    return types;
+}
+
+// An event whose payload words are all distinct, so that a field read from the wrong offset
+// shows up as a mismatch.
+V2_1Event makeEvent(V2_1SensorType type, int n) {
+    V2_1Event event;
+    event.timestamp = 1000000 + n;
+    event.sensorHandle = 0x100 + n;
+    event.sensorType = type;
+    for (size_t i = 0; i < event.u.data.size(); i++) {
+        event.u.data[i] = n * 16 + i + 0.25f;
+    }
+    return event;
+}
+
+void expectBatchMatchesSingleEvents(const std::vector<V2_1Event>& hidlEvents) {
+    std::vector<AidlEvent> expected(hidlEvents.size());
+    for (size_t i = 0; i < hidlEvents.size(); i++) {
+        convertToAidlEvent(hidlEvents[i], &expected[i]);
+    }
+
+    std::vector<AidlEvent> actual(hidlEvents.size());
+    convertToAidlEvents(hidlEvents.data(), hidlEvents.size(), actual.data());
+
+    for (size_t i = 0; i < hidlEvents.size(); i++) {
+        EXPECT_TRUE(expected[i] == actual[i])
+                << "event " << i << " of type " << toString(hidlEvents[i].sensorType)
+                << "\nexpected: " << expected[i].toString() << "\nactual: " << actual[i].toString();
+    }
+}
+
+TEST(ConvertUtilsTest, RunOfEachTypeMatchesSingleEventConversion) {
+    for (V2_1SensorType type : allSensorTypes()) {
+        std::vector<V2_1Event> hidlEvents;
+        for (int n = 0; n < 3; n++) {
+            hidlEvents.push_back(makeEvent(type, n));
+        }
+        expectBatchMatchesSingleEvents(hidlEvents);
+    }
+}
+
+TEST(ConvertUtilsTest, MixedRunsMatchSingleEventConversion) {
+    // Runs of one to three events of every type, then every type again in reverse order, so that
+    // each type follows a run of a different type.
+    std::vector<V2_1SensorType> types = allSensorTypes();
+    std::vector<V2_1Event> hidlEvents;
+    int n = 0;
+    for (V2_1SensorType type : types) {
+        for (int i = 0; i <= n % 3; i++) {
+            hidlEvents.push_back(makeEvent(type, n++));
+        }
+    }
+    for (auto it = types.rbegin(); it != types.rend(); ++it) {
+        hidlEvents.push_back(makeEvent(*it, n++));
+    }
+    expectBatchMatchesSingleEvents(hidlEvents);
+}
+
+}  // namespace
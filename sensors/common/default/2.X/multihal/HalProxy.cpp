@@ -221,8 +221,8 @@ Return<Result> HalProxy::initializeCommon(
     disableAllSensors();
 
     // Clears the queue if any events were pending write before.
-    mPendingWriteEventsQueue = std::queue<std::pair<std::vector<V2_1::Event>, size_t>>();
-    mSizePendingWriteEventsQueue = 0;
+    mPendingWriteWakeupEvents.clear();
+    mPendingWriteEvents.clear();
 
     // Clears previously connected dynamic sensors
     mDynamicSensors.clear();
@@ -366,14 +366,26 @@ Return<void> HalProxy::debug(const hidl_handle& fd, const hidl_vec<hidl_string>&
     stream << "  Wakelock timeout reset time: " << msFromNs(now - mWakelockTimeoutResetTime)
            << " ms ago" << std::endl;
     // TODO(b/142969448): Add logging for history of wakelock acquisition per subhal.
-    stream << "  Wakelock ref count: " << mWakelockRefCount << std::endl;
-    stream << "  # of events on pending write writes queue: " << mSizePendingWriteEventsQueue
-           << std::endl;
-    stream << " Most events seen on pending write events queue: "
-           << mMostEventsObservedPendingWriteEventsQueue << std::endl;
-    if (!mPendingWriteEventsQueue.empty()) {
-        stream << "  Size of events list on front of pending writes queue: "
-               << mPendingWriteEventsQueue.front().first.size() << std::endl;
+    stream << "  Wakelock ref count: " << mWakelockRefCount.load() << std::endl;
+    {
+        std::lock_guard<std::mutex> lock(mEventQueueWriteMutex);
+        stream << "  # of events on pending write writes queue: "
+               << mPendingWriteWakeupEvents.size() + mPendingWriteEvents.size() << " ("
+               << mPendingWriteWakeupEvents.size() << " wakeup)" << std::endl;
+        stream << " Most events seen on pending write events queue: "
+               << mMostEventsObservedPendingWriteEventsQueue << std::endl;
+        stream << "  # of events written from pending write events queue: "
+               << mNumPendingWrittenEvents << std::endl;
+        if (mNumPendingWrittenEvents > 0) {
+            stream << "  Pending write latency: average "
+                   << msFromNs(mTotalPendingWriteLatencyNs / mNumPendingWrittenEvents)
+                   << " ms, max " << msFromNs(mMaxPendingWriteLatencyNs) << " ms" << std::endl;
+        }
+        stream << "  Dropped events per sensor (" << mNumDroppedEvents.size() << "):" << std::endl;
+        for (const auto& [sensorHandle, numDropped] : mNumDroppedEvents) {
+            stream << "    handle 0x" << std::hex << sensorHandle << std::dec << ": " << numDropped
+                   << std::endl;
+        }
     }
     stream << "  # of non-dynamic sensors across all subhals: " << mSensors.size() << std::endl;
     stream << "  # of dynamic sensors across all subhals: " << mDynamicSensors.size() << std::endl;
@@ -567,45 +579,104 @@ void HalProxy::startPendingWritesThread(HalProxy* halProxy) {
 }
 
 void HalProxy::handlePendingWrites() {
-    // TODO(b/143302327): Find a way to optimize locking strategy maybe using two mutexes instead of
-    // one.
     std::unique_lock<std::mutex> lock(mEventQueueWriteMutex);
     while (mThreadsRun.load()) {
-        mEventQueueWriteCV.wait(
-                lock, [&] { return !mPendingWriteEventsQueue.empty() || !mThreadsRun.load(); });
-        if (mThreadsRun.load()) {
-            std::vector<Event>& pendingWriteEvents = mPendingWriteEventsQueue.front().first;
-            size_t numWakeupEvents = mPendingWriteEventsQueue.front().second;
-            size_t eventQueueSize = mEventQueue->getQuantumCount();
-            size_t numToWrite = std::min(pendingWriteEvents.size(), eventQueueSize);
-            lock.unlock();
-            if (!mEventQueue->writeBlocking(
-                        pendingWriteEvents.data(), numToWrite,
-                        static_cast<uint32_t>(EventQueueFlagBits::EVENTS_READ),
-                        static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS),
-                        kPendingWriteTimeoutNs, mEventQueueFlag)) {
-                ALOGE("Dropping %zu events after blockingWrite failed.", numToWrite);
-                if (numWakeupEvents > 0) {
-                    if (pendingWriteEvents.size() > eventQueueSize) {
-                        decrementRefCountAndMaybeReleaseWakelock(
-                                countNumWakeupEvents(pendingWriteEvents, eventQueueSize));
-                    } else {
-                        decrementRefCountAndMaybeReleaseWakelock(numWakeupEvents);
-                    }
-                }
-            }
-            lock.lock();
-            mSizePendingWriteEventsQueue -= numToWrite;
-            if (pendingWriteEvents.size() > eventQueueSize) {
-                // TODO(b/143302327): Check if this erase operation is too inefficient. It will copy
-                // all the events ahead of it down to fill gap off array at front after the erase.
-                pendingWriteEvents.erase(pendingWriteEvents.begin(),
-                                         pendingWriteEvents.begin() + eventQueueSize);
-            } else {
-                mPendingWriteEventsQueue.pop();
+        mEventQueueWriteCV.wait(lock, [&] {
+            return !mPendingWriteWakeupEvents.empty() || !mPendingWriteEvents.empty() ||
+                   !mThreadsRun.load();
+        });
+        if (!mThreadsRun.load()) break;
+        if (writePendingEventsLocked() > 0) {
+            mEventQueueFlag->wake(static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS));
+        }
+        if (mPendingWriteWakeupEvents.empty() && mPendingWriteEvents.empty()) continue;
+
+        // The fmq is full, so wait for the framework to read from it.
+        lock.unlock();
+        uint32_t efState = 0;
+        status_t status =
+                mEventQueueFlag->wait(static_cast<uint32_t>(EventQueueFlagBits::EVENTS_READ),
+                                      &efState, kPendingWriteTimeoutNs, true /* retry */);
+        lock.lock();
+        if (status == TIMED_OUT && mThreadsRun.load() && mEventQueue->availableToWrite() == 0) {
+            size_t numToDrop = mEventQueue->getQuantumCount();
+            ALOGE("Dropping up to %zu events after the event queue stayed full.", numToDrop);
+            dropPendingEventsLocked(numToDrop);
+        }
+    }
+}
+
+size_t HalProxy::writeEventsLocked(const Event* events, size_t numEvents) {
+    size_t numWritten = 0;
+    // The framework may read while events are written, so keep writing until the fmq is full.
+    while (numWritten < numEvents) {
+        size_t numToWrite = std::min(numEvents - numWritten, mEventQueue->availableToWrite());
+        if (numToWrite == 0 || !mEventQueue->write(events + numWritten, numToWrite)) break;
+        numWritten += numToWrite;
+    }
+    return numWritten;
+}
+
+size_t HalProxy::writePendingEventsLocked() {
+    size_t numWritten = 0;
+    for (PendingWriteRing* ring : {&mPendingWriteWakeupEvents, &mPendingWriteEvents}) {
+        while (!ring->empty()) {
+            size_t numToWrite;
+            const Event* events = ring->frontBlock(&numToWrite);
+            size_t numBlockWritten = writeEventsLocked(events, numToWrite);
+            int64_t now = getTimeNow();
+            for (size_t i = 0; i < numBlockWritten; i++) {
+                int64_t latency = now - ring->frontAddedAtNs();
+                mTotalPendingWriteLatencyNs += latency;
+                mMaxPendingWriteLatencyNs = std::max(mMaxPendingWriteLatencyNs, latency);
+                ring->pop();
             }
+            mNumPendingWrittenEvents += numBlockWritten;
+            numWritten += numBlockWritten;
+            if (numBlockWritten < numToWrite) return numWritten;
+        }
+    }
+    return numWritten;
+}
+
+void HalProxy::addPendingEventsLocked(const Event* events, size_t numEvents,
+                                      size_t numWakeupEvents, bool wakeupEventsCounted) {
+    int64_t now = getTimeNow();
+    size_t numDroppedWakeupEvents = 0;
+    for (size_t i = 0; i < numEvents; i++) {
+        // Only look up the sensor when the events come from both kinds of sensors.
+        bool isWakeup = numWakeupEvents == numEvents ||
+                        (numWakeupEvents > 0 && isWakeupEvent(events[i]));
+        PendingWriteRing& ring = isWakeup ? mPendingWriteWakeupEvents : mPendingWriteEvents;
+        if (ring.full()) {
+            mNumDroppedEvents[events[i].sensorHandle]++;
+            if (isWakeup) numDroppedWakeupEvents++;
+        } else {
+            ring.push(events[i], now, isWakeup && wakeupEventsCounted);
+        }
+    }
+    if (numDroppedWakeupEvents > 0 && wakeupEventsCounted) {
+        decrementRefCountAndMaybeReleaseWakelock(numDroppedWakeupEvents);
+    }
+    mMostEventsObservedPendingWriteEventsQueue =
+            std::max(mMostEventsObservedPendingWriteEventsQueue,
+                     mPendingWriteWakeupEvents.size() + mPendingWriteEvents.size());
+}
+
+void HalProxy::dropPendingEventsLocked(size_t numEvents) {
+    // Wakeup events posted without a wakelock never added to the ref count, so only the counted
+    // ones give theirs back.
+    size_t numDroppedCountedEvents = 0;
+    for (PendingWriteRing* ring : {&mPendingWriteEvents, &mPendingWriteWakeupEvents}) {
+        for (; numEvents > 0 && !ring->empty(); numEvents--) {
+            mNumDroppedEvents[ring->front().sensorHandle]++;
+            if (ring->frontCounted()) numDroppedCountedEvents++;
+            ring->pop();
         }
     }
+    if (numDroppedCountedEvents > 0) {
+        decrementRefCountAndMaybeReleaseWakelock(numDroppedCountedEvents);
+    }
 }
 
 void HalProxy::startWakelockThread(HalProxy* halProxy) {
@@ -613,20 +684,21 @@ void HalProxy::startWakelockThread(HalProxy* halProxy) {
 }
 
 void HalProxy::handleWakelocks() {
-    std::unique_lock<std::recursive_mutex> lock(mWakelockMutex);
     while (mThreadsRun.load()) {
-        mWakelockCV.wait(lock, [&] { return mWakelockRefCount > 0 || !mThreadsRun.load(); });
+        {
+            std::unique_lock<std::mutex> lock(mWakelockMutex);
+            mWakelockCV.wait(lock,
+                             [&] { return mWakelockRefCount.load() > 0 || !mThreadsRun.load(); });
+        }
         if (mThreadsRun.load()) {
             int64_t timeLeft;
             if (sharedWakelockDidTimeout(&timeLeft)) {
                 resetSharedWakelock();
             } else {
                 uint32_t numWakeLocksProcessed;
-                lock.unlock();
                 bool success = mWakeLockQueue->readBlocking(
                         &numWakeLocksProcessed, 1, 0,
                         static_cast<uint32_t>(WakeLockQueueFlagBits::DATA_WRITTEN), timeLeft);
-                lock.lock();
                 if (success) {
                     decrementRefCountAndMaybeReleaseWakelock(
                             static_cast<size_t>(numWakeLocksProcessed));
@@ -639,7 +711,7 @@ void HalProxy::handleWakelocks() {
 
 bool HalProxy::sharedWakelockDidTimeout(int64_t* timeLeft) {
     bool didTimeout;
-    int64_t duration = getTimeNow() - mWakelockTimeoutStartTime;
+    int64_t duration = getTimeNow() - mWakelockTimeoutStartTime.load();
     if (duration > kWakelockTimeoutNs) {
         didTimeout = true;
     } else {
@@ -650,9 +722,27 @@ bool HalProxy::sharedWakelockDidTimeout(int64_t* timeLeft) {
 }
 
 void HalProxy::resetSharedWakelock() {
-    std::lock_guard<std::recursive_mutex> lockGuard(mWakelockMutex);
-    decrementRefCountAndMaybeReleaseWakelock(mWakelockRefCount);
-    mWakelockTimeoutResetTime = getTimeNow();
+    // The ref count is cleared before the reset time moves, so that a ref count taken in between
+    // is kept until the next timeout rather than dropped while its holder still needs it.
+    mWakelockRefCount.store(0);
+    mWakelockTimeoutResetTime.store(getTimeNow());
+    updateSharedWakelock();
+}
+
+void HalProxy::updateSharedWakelock() {
+    std::lock_guard<std::mutex> lock(mWakelockMutex);
+    bool needed = mWakelockRefCount.load() > 0;
+    if (needed && !mWakelockHeld) {
+        acquire_wake_lock(PARTIAL_WAKE_LOCK, kWakelockName);
+    } else if (!needed && mWakelockHeld) {
+        release_wake_lock(kWakelockName);
+    }
+    mWakelockHeld = needed;
+    // The wakelock thread may have gone to sleep after the count reached 0 but before the
+    // release above, so wake it whenever the count is up again, not only on acquisition.
+    if (needed) {
+        mWakelockCV.notify_one();
+    }
 }
 
 void HalProxy::postEventsToMessageQueue(const std::vector<Event>& events, size_t numWakeupEvents,
@@ -662,26 +752,25 @@ void HalProxy::postEventsToMessageQueue(const std::vector<Event>& events, size_t
     if (wakelock.isLocked()) {
         incrementRefCountAndMaybeAcquireWakelock(numWakeupEvents);
     }
-    if (mPendingWriteEventsQueue.empty()) {
-        numToWrite = std::min(events.size(), mEventQueue->availableToWrite());
+    // Events only bypass the pending ones when there are none, to keep the events of each sensor
+    // in order.
+    if (mPendingWriteWakeupEvents.empty() && mPendingWriteEvents.empty()) {
+        numToWrite = writeEventsLocked(events.data(), events.size());
         if (numToWrite > 0) {
-            if (mEventQueue->write(events.data(), numToWrite)) {
-                // TODO(b/143302327): While loop if mEventQueue->avaiableToWrite > 0 to possibly fit
-                // in more writes immediately
-                mEventQueueFlag->wake(static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS));
-            } else {
-                numToWrite = 0;
-            }
+            mEventQueueFlag->wake(static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS));
         }
     }
-    size_t numLeft = events.size() - numToWrite;
-    if (numToWrite < events.size() &&
-        mSizePendingWriteEventsQueue + numLeft <= kMaxSizePendingWriteEventsQueue) {
-        std::vector<Event> eventsLeft(events.begin() + numToWrite, events.end());
-        mPendingWriteEventsQueue.push({eventsLeft, numWakeupEvents});
-        mSizePendingWriteEventsQueue += numLeft;
-        mMostEventsObservedPendingWriteEventsQueue =
-                std::max(mMostEventsObservedPendingWriteEventsQueue, mSizePendingWriteEventsQueue);
+    if (numToWrite < events.size()) {
+        size_t numWrittenWakeupEvents = 0;
+        if (numWakeupEvents > 0 && numWakeupEvents < events.size()) {
+            for (size_t i = 0; i < numToWrite; i++) {
+                if (isWakeupEvent(events[i])) numWrittenWakeupEvents++;
+            }
+        } else if (numWakeupEvents > 0) {
+            numWrittenWakeupEvents = numToWrite;
+        }
+        addPendingEventsLocked(events.data() + numToWrite, events.size() - numToWrite,
+                               numWakeupEvents - numWrittenWakeupEvents, wakelock.isLocked());
         mEventQueueWriteCV.notify_one();
     }
 }
@@ -689,15 +778,13 @@ void HalProxy::postEventsToMessageQueue(const std::vector<Event>& events, size_t
 bool HalProxy::incrementRefCountAndMaybeAcquireWakelock(size_t delta,
                                                         int64_t* timeoutStart /* = nullptr */) {
     if (!mThreadsRun.load()) return false;
-    std::lock_guard<std::recursive_mutex> lockGuard(mWakelockMutex);
-    if (mWakelockRefCount == 0) {
-        acquire_wake_lock(PARTIAL_WAKE_LOCK, kWakelockName);
-        mWakelockCV.notify_one();
+    int64_t now = getTimeNow();
+    mWakelockTimeoutStartTime.store(now);
+    if (mWakelockRefCount.fetch_add(delta) == 0) {
+        updateSharedWakelock();
     }
-    mWakelockTimeoutStartTime = getTimeNow();
-    mWakelockRefCount += delta;
     if (timeoutStart != nullptr) {
-        *timeoutStart = mWakelockTimeoutStartTime;
+        *timeoutStart = now;
     }
     return true;
 }
@@ -705,16 +792,19 @@ bool HalProxy::incrementRefCountAndMaybeAcquireWakelock(size_t delta,
 void HalProxy::decrementRefCountAndMaybeReleaseWakelock(size_t delta,
                                                         int64_t timeoutStart /* = -1 */) {
     if (!mThreadsRun.load()) return;
-    std::lock_guard<std::recursive_mutex> lockGuard(mWakelockMutex);
-    if (delta > mWakelockRefCount) {
-        ALOGE("Decrementing wakelock ref count by %zu when count is %zu",
-              delta, mWakelockRefCount);
-    }
-    if (timeoutStart == -1) timeoutStart = mWakelockTimeoutResetTime;
-    if (mWakelockRefCount == 0 || timeoutStart < mWakelockTimeoutResetTime) return;
-    mWakelockRefCount -= std::min(mWakelockRefCount, delta);
-    if (mWakelockRefCount == 0) {
-        release_wake_lock(kWakelockName);
+    int64_t resetTime = mWakelockTimeoutResetTime.load();
+    if (timeoutStart == -1) timeoutStart = resetTime;
+    if (timeoutStart < resetTime) return;
+    size_t refCount = mWakelockRefCount.load();
+    do {
+        if (refCount == 0) return;
+        if (delta > refCount) {
+            ALOGE("Decrementing wakelock ref count by %zu when count is %zu", delta, refCount);
+        }
+    } while (!mWakelockRefCount.compare_exchange_weak(refCount,
+                                                      refCount - std::min(refCount, delta)));
+    if (delta >= refCount) {
+        updateSharedWakelock();
     }
 }
 
@@ -741,15 +831,10 @@ bool HalProxy::isSubHalIndexValid(int32_t sensorHandle) {
     return extractSubHalIndex(sensorHandle) < mSubHalList.size();
 }
 
-size_t HalProxy::countNumWakeupEvents(const std::vector<Event>& events, size_t n) {
-    size_t numWakeupEvents = 0;
-    for (size_t i = 0; i < n; i++) {
-        int32_t sensorHandle = events[i].sensorHandle;
-        if (mSensors[sensorHandle].flags & static_cast<uint32_t>(V1_0::SensorFlagBits::WAKE_UP)) {
-            numWakeupEvents++;
-        }
-    }
-    return numWakeupEvents;
+bool HalProxy::isWakeupEvent(const Event& event) {
+    auto sensor = mSensors.find(event.sensorHandle);
+    return sensor != mSensors.end() &&
+           (sensor->second.flags & static_cast<uint32_t>(V1_0::SensorFlagBits::WAKE_UP)) != 0;
 }
 
 int32_t HalProxy::clearSubHalIndex(int32_t sensorHandle) {
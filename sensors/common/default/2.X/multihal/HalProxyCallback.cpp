@@ -66,6 +66,7 @@ std::vector<V2_1::Event> HalProxyCallbackBase::processEvents(const std::vector<V
                                                              size_t* numWakeupEvents) const {
     *numWakeupEvents = 0;
     std::vector<V2_1::Event> eventsOut;
+    eventsOut.reserve(events.size());
     for (V2_1::Event event : events) {
         event.sensorHandle = setSubHalIndex(event.sensorHandle, mSubHalIndex);
         if (event.sensorType == V2_1::SensorType::DYNAMIC_SENSOR_META) {
@@ -33,11 +33,12 @@
 #include <hidl/MQDescriptor.h>
 #include <hidl/Status.h>
 
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
 #include <map>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <utility>
 
@@ -144,6 +145,8 @@ class HalProxy : public V2_0::implementation::IScopedWakelockRefCounter,
     const std::map<int32_t, SensorInfo>& getSensors() { return mSensors; }
 
   private:
+    friend class HalProxyPeer;
+
     using EventMessageQueueV2_1 = MessageQueue<V2_1::Event, kSynchronizedReadWrite>;
     using EventMessageQueueV2_0 = MessageQueue<V1_0::Event, kSynchronizedReadWrite>;
     using WakeLockMessageQueue = MessageQueue<uint32_t, kSynchronizedReadWrite>;
@@ -202,19 +205,81 @@ class HalProxy : public V2_0::implementation::IScopedWakelockRefCounter,
     static constexpr int32_t kSensorHandleSubHalIndexMask = 0xFF000000;
 
     /**
-     * A FIFO queue of pairs of vector of events and the number of wakeup events in that vector
-     * which are waiting to be written to the events fmq in the background thread.
+     * A ring of events waiting to be written to the events fmq in the background thread, along
+     * with the time each of them was added and whether it holds a wakelock ref count. The storage
+     * is allocated once, so that spilling events doesn't allocate.
+     */
+    class PendingWriteRing {
+      public:
+        explicit PendingWriteRing(size_t capacity)
+            : mEvents(new Event[capacity]),
+              mAddedAtNs(new int64_t[capacity]),
+              mCounted(new bool[capacity]),
+              mCapacity(capacity) {}
+
+        size_t size() const { return mSize; }
+        bool empty() const { return mSize == 0; }
+        bool full() const { return mSize == mCapacity; }
+        void clear() { mHead = mSize = 0; }
+
+        //! Adds an event at the back of the ring, which must not be full.
+        void push(const Event& event, int64_t now, bool counted) {
+            size_t index = (mHead + mSize++) % mCapacity;
+            mEvents[index] = event;
+            mAddedAtNs[index] = now;
+            mCounted[index] = counted;
+        }
+
+        //! The event at the front of the ring, the time it was added and whether it is counted.
+        const Event& front() const { return mEvents[mHead]; }
+        int64_t frontAddedAtNs() const { return mAddedAtNs[mHead]; }
+        bool frontCounted() const { return mCounted[mHead]; }
+
+        //! The events from the front of the ring up to its end or to the back, whichever is first.
+        const Event* frontBlock(size_t* count) const {
+            *count = std::min(mSize, mCapacity - mHead);
+            return &mEvents[mHead];
+        }
+
+        void pop() {
+            mHead = (mHead + 1) % mCapacity;
+            mSize--;
+        }
+
+      private:
+        std::unique_ptr<Event[]> mEvents;
+        std::unique_ptr<int64_t[]> mAddedAtNs;
+        std::unique_ptr<bool[]> mCounted;
+        const size_t mCapacity;
+        size_t mHead = 0;
+        size_t mSize = 0;
+    };
+
+    //! The max number of events of non wakeup sensors allowed in the pending write events queue
+    static constexpr size_t kMaxSizePendingWriteEventsQueue = 100000;
+
+    //! The max number of events of wakeup sensors allowed in the pending write events queue
+    static constexpr size_t kMaxSizePendingWriteWakeupEventsQueue = 10000;
+
+    /**
+     * The events of wakeup sensors waiting to be written. They have room of their own so that
+     * non wakeup events can't crowd them out, and are written first.
      */
-    std::queue<std::pair<std::vector<Event>, size_t>> mPendingWriteEventsQueue;
+    PendingWriteRing mPendingWriteWakeupEvents{kMaxSizePendingWriteWakeupEventsQueue};
+
+    //! The events of non wakeup sensors waiting to be written.
+    PendingWriteRing mPendingWriteEvents{kMaxSizePendingWriteEventsQueue};
 
     //! The most events observed on the pending write events queue for debug purposes.
     size_t mMostEventsObservedPendingWriteEventsQueue = 0;
 
-    //! The max number of events allowed in the pending write events queue
-    static constexpr size_t kMaxSizePendingWriteEventsQueue = 100000;
+    //! The number of events dropped from or before the pending write events queue, per sensor.
+    std::map<int32_t, uint64_t> mNumDroppedEvents;
 
-    //! The number of events in the pending write events queue
-    size_t mSizePendingWriteEventsQueue = 0;
+    //! The number of events written from the pending write events queue, and how long they waited.
+    uint64_t mNumPendingWrittenEvents = 0;
+    int64_t mTotalPendingWriteLatencyNs = 0;
+    int64_t mMaxPendingWriteLatencyNs = 0;
 
     //! The mutex protecting writing to the fmq and the pending events queue
     std::mutex mEventQueueWriteMutex;
@@ -236,18 +301,23 @@ class HalProxy : public V2_0::implementation::IScopedWakelockRefCounter,
 
     // WakelockRefCount membar vars below
 
-    //! The mutex protecting the wakelock refcount and subsequent wakelock releases and
-    //! acquisitions
-    std::recursive_mutex mWakelockMutex;
+    /**
+     * The mutex serializing the acquisitions and releases of the shared wakelock, which only
+     * happen when the refcount leaves or reaches 0. The refcount itself is updated without it.
+     */
+    std::mutex mWakelockMutex;
 
-    std::condition_variable_any mWakelockCV;
+    std::condition_variable mWakelockCV;
 
     //! The refcount of how many ScopedWakelocks and pending wakeup events are active
-    size_t mWakelockRefCount = 0;
+    std::atomic<size_t> mWakelockRefCount = 0;
 
-    int64_t mWakelockTimeoutStartTime = V2_0::implementation::getTimeNow();
+    //! Whether the shared wakelock is acquired, guarded by mWakelockMutex.
+    bool mWakelockHeld = false;
 
-    int64_t mWakelockTimeoutResetTime = V2_0::implementation::getTimeNow();
+    std::atomic<int64_t> mWakelockTimeoutStartTime = V2_0::implementation::getTimeNow();
+
+    std::atomic<int64_t> mWakelockTimeoutResetTime = V2_0::implementation::getTimeNow();
 
     const char* kWakelockName = "SensorsHAL_WAKEUP";
 
@@ -328,6 +398,46 @@ class HalProxy : public V2_0::implementation::IScopedWakelockRefCounter,
      */
     void resetSharedWakelock();
 
+    /**
+     * Acquire or release the shared wakelock so that it is held if and only if the ref count is
+     * not 0.
+     */
+    void updateSharedWakelock();
+
+    /**
+     * Write events to the event fmq until they are all written or the fmq is full, without waking
+     * up the framework. Must be called with mEventQueueWriteMutex held.
+     *
+     * @return The number of events written.
+     */
+    size_t writeEventsLocked(const Event* events, size_t numEvents);
+
+    /**
+     * Write pending events to the event fmq until they are all written or the fmq is full, the
+     * events of wakeup sensors first. Must be called with mEventQueueWriteMutex held.
+     *
+     * @return The number of events written.
+     */
+    size_t writePendingEventsLocked();
+
+    /**
+     * Add events to the pending write events queue, dropping the ones that don't fit. Must be
+     * called with mEventQueueWriteMutex held.
+     *
+     * @param numWakeupEvents The number of wakeup events among the events.
+     * @param wakeupEventsCounted Whether the wakeup events hold a wakelock ref count.
+     */
+    void addPendingEventsLocked(const Event* events, size_t numEvents, size_t numWakeupEvents,
+                                bool wakeupEventsCounted);
+
+    /**
+     * Drop the oldest pending events, the ones of non wakeup sensors first. Must be called with
+     * mEventQueueWriteMutex held.
+     *
+     * @param numEvents The max number of events to drop.
+     */
+    void dropPendingEventsLocked(size_t numEvents);
+
     /**
      * Clear direct channel flags if the HalProxy has already chosen a subhal as its direct channel
      * subhal. Set the directChannelSubHal pointer to the subHal passed in if this is the first
@@ -357,14 +467,11 @@ class HalProxy : public V2_0::implementation::IScopedWakelockRefCounter,
     bool isSubHalIndexValid(int32_t sensorHandle);
 
     /**
-     * Count the number of wakeup events in the first n events of the vector.
-     *
-     * @param events The vector of Event objects.
-     * @param n The end index not inclusive of events to consider.
+     * @param event The event to check.
      *
-     * @return The number of wakeup events of the considered events.
+     * @return true if the event comes from a wakeup sensor.
      */
-    size_t countNumWakeupEvents(const std::vector<Event>& events, size_t n);
+    bool isWakeupEvent(const Event& event);
 
     /*
      * Clear out the subhal index bytes from a sensorHandle.
@@ -30,6 +30,55 @@
 #include <thread>
 #include <vector>
 
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+// Gives tests access to the pending write events and the wakelock ref count of a HalProxy.
+class HalProxyPeer {
+  public:
+    static constexpr size_t kWakeupRingCapacity = HalProxy::kMaxSizePendingWriteWakeupEventsQueue;
+
+    explicit HalProxyPeer(HalProxy& proxy) : mProxy(proxy) {}
+
+    // Adds wakeup events to the pending write events as if the event fmq were full. Counted
+    // events take a ref count each, like the events of a subhal posting with a wakelock.
+    void addPendingWakeupEvents(const std::vector<Event>& events, bool counted) {
+        std::lock_guard<std::mutex> lock(mProxy.mEventQueueWriteMutex);
+        if (counted) mProxy.incrementRefCountAndMaybeAcquireWakelock(events.size());
+        mProxy.addPendingEventsLocked(events.data(), events.size(), events.size(), counted);
+    }
+
+    void dropPendingEvents(size_t numEvents) {
+        std::lock_guard<std::mutex> lock(mProxy.mEventQueueWriteMutex);
+        mProxy.dropPendingEventsLocked(numEvents);
+    }
+
+    size_t numPendingWakeupEvents() {
+        std::lock_guard<std::mutex> lock(mProxy.mEventQueueWriteMutex);
+        return mProxy.mPendingWriteWakeupEvents.size();
+    }
+
+    uint64_t numDroppedEvents(int32_t sensorHandle) {
+        std::lock_guard<std::mutex> lock(mProxy.mEventQueueWriteMutex);
+        auto it = mProxy.mNumDroppedEvents.find(sensorHandle);
+        return it == mProxy.mNumDroppedEvents.end() ? 0 : it->second;
+    }
+
+    size_t wakelockRefCount() const { return mProxy.mWakelockRefCount.load(); }
+
+  private:
+    HalProxy& mProxy;
+};
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
+
 namespace {
 
 using ::android::hardware::EventFlag;
@@ -47,6 +96,7 @@ using ::android::hardware::sensors::V2_0::implementation::ScopedWakelock;
 using ::android::hardware::sensors::V2_1::implementation::convertToNewEvents;
 using ::android::hardware::sensors::V2_1::implementation::convertToNewSensorInfos;
 using ::android::hardware::sensors::V2_1::implementation::HalProxy;
+using ::android::hardware::sensors::V2_1::implementation::HalProxyPeer;
 using ::android::hardware::sensors::V2_1::subhal::implementation::AddAndRemoveDynamicSensorsSubHal;
 using ::android::hardware::sensors::V2_1::subhal::implementation::AllSensorsSubHal;
 using ::android::hardware::sensors::V2_1::subhal::implementation::
@@ -798,6 +848,96 @@ TEST(HalProxyTest, FillAndDrainPendingQueueTest) {
     EXPECT_TRUE(readEventsOutOfQueue(1, eventQueue, eventQueueFlag));
 }
 
+TEST(HalProxyTest, PendingWakeupEventsWrittenFirst) {
+    constexpr size_t kQueueSize = 5;
+    AllSensorsSubHal<SensorsSubHalV2_0> subHal;
+    std::vector<ISensorsSubHal*> subHals{&subHal};
+    HalProxy proxy(subHals);
+    std::unique_ptr<EventMessageQueueV2_0> eventQueue = makeEventFMQ(kQueueSize);
+    std::unique_ptr<WakeupMessageQueue> wakeLockQueue = makeWakelockFMQ(kQueueSize);
+    ::android::sp<ISensorsCallbackV2_0> callback = new SensorsCallback();
+    proxy.initialize(*eventQueue->getDesc(), *wakeLockQueue->getDesc(), callback);
+
+    EventFlag* eventQueueFlag;
+    EventFlag::createEventFlag(eventQueue->getEventFlagWord(), &eventQueueFlag);
+
+    EventFlag* wakelockQueueFlag;
+    EventFlag::createEventFlag(wakeLockQueue->getEventFlagWord(), &wakelockQueueFlag);
+
+    // Fill the event queue, then leave non wakeup events and a wakeup event pending.
+    std::vector<EventV1_0> events = makeMultipleAccelerometerEvents(2 * kQueueSize);
+    subHal.postEvents(convertToNewEvents(events), false /* wakeup */);
+    events = {makeProximityEvent()};
+    subHal.postEvents(convertToNewEvents(events), true /* wakeup */);
+
+    ASSERT_TRUE(readEventsOutOfQueue(kQueueSize, eventQueue, eventQueueFlag));
+
+    // The wakeup event should have been written ahead of the non wakeup events.
+    std::vector<EventV1_0> eventsOut(kQueueSize);
+    ASSERT_TRUE(eventQueue->readBlocking(
+            eventsOut.data(), kQueueSize, static_cast<uint32_t>(EventQueueFlagBits::EVENTS_READ),
+            static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS),
+            INT64_C(500000000) /* timeOutNanos */, eventQueueFlag));
+    EXPECT_EQ(eventsOut[0].sensorType, SensorType::PROXIMITY);
+    for (size_t i = 1; i < kQueueSize; i++) {
+        EXPECT_EQ(eventsOut[i].sensorType, SensorType::ACCELEROMETER);
+    }
+    ackWakeupEventsToHalProxy(1, wakeLockQueue, wakelockQueueFlag);
+}
+
+TEST(HalProxyTest, DroppedPendingWakeupEventsReleaseOnlyTheirRefCounts) {
+    constexpr size_t kQueueSize = 5;
+    constexpr size_t kRingCapacity = HalProxyPeer::kWakeupRingCapacity;
+    // Wakeup events read by the framework but not acked yet.
+    constexpr size_t kNumUnackedEvents = 10;
+    AllSensorsSubHal<SensorsSubHalV2_0> subHal1, subHal2;
+    std::vector<ISensorsSubHal*> subHals{&subHal1, &subHal2};
+    HalProxy proxy(subHals);
+    std::unique_ptr<EventMessageQueueV2_0> eventQueue = makeEventFMQ(kQueueSize);
+    std::unique_ptr<WakeupMessageQueue> wakeLockQueue = makeWakelockFMQ(kQueueSize);
+    ::android::sp<ISensorsCallbackV2_0> callback = new SensorsCallback();
+    proxy.initialize(*eventQueue->getDesc(), *wakeLockQueue->getDesc(), callback);
+    HalProxyPeer peer(proxy);
+
+    // Fill the event queue so that the events added below stay pending.
+    std::vector<EventV1_0> events = makeMultipleAccelerometerEvents(kQueueSize);
+    subHal1.postEvents(convertToNewEvents(events), false /* wakeup */);
+    proxy.incrementRefCountAndMaybeAcquireWakelock(kNumUnackedEvents);
+
+    // The proximity sensors of both subhals.
+    constexpr int32_t kSensorHandle1 = 0x00000008;
+    constexpr int32_t kSensorHandle2 = 0x01000008;
+    std::vector<EventV2_1> events1 =
+            convertToNewEvents(makeMultipleProximityEvents(kRingCapacity - 2));
+    std::vector<EventV2_1> events2 = convertToNewEvents(makeMultipleProximityEvents(4));
+    for (EventV2_1& event : events2) {
+        event.sensorHandle = kSensorHandle2;
+    }
+
+    // Fill the wakeup ring with counted events and two uncounted ones, dropping two more
+    // uncounted ones, which have no ref count to give back.
+    peer.addPendingWakeupEvents(events1, true /* counted */);
+    peer.addPendingWakeupEvents(events2, false /* counted */);
+    EXPECT_EQ(kRingCapacity, peer.numPendingWakeupEvents());
+    EXPECT_EQ(0u, peer.numDroppedEvents(kSensorHandle1));
+    EXPECT_EQ(2u, peer.numDroppedEvents(kSensorHandle2));
+    EXPECT_EQ(kNumUnackedEvents + kRingCapacity - 2, peer.wakelockRefCount());
+
+    // Counted events that don't fit give their ref counts back right away.
+    peer.addPendingWakeupEvents(std::vector<EventV2_1>(events1.begin(), events1.begin() + 3),
+                                true /* counted */);
+    EXPECT_EQ(3u, peer.numDroppedEvents(kSensorHandle1));
+    EXPECT_EQ(kNumUnackedEvents + kRingCapacity - 2, peer.wakelockRefCount());
+
+    // Dropping the pending events gives back the ref counts of the counted ones only, and leaves
+    // those of the events the framework has yet to ack.
+    peer.dropPendingEvents(kRingCapacity);
+    EXPECT_EQ(0u, peer.numPendingWakeupEvents());
+    EXPECT_EQ(3u + kRingCapacity - 2, peer.numDroppedEvents(kSensorHandle1));
+    EXPECT_EQ(4u, peer.numDroppedEvents(kSensorHandle2));
+    EXPECT_EQ(kNumUnackedEvents, peer.wakelockRefCount());
+}
+
 TEST(HalProxyTest, PostEventsMultipleSubhalsThreadedV2_1) {
     constexpr size_t kQueueSize = 5;
     constexpr size_t kNumEvents = 2;
@@ -0,0 +1,365 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * FMQ transport benchmarks.
+ *
+ * A writer sends batches of fixed size elements to a reader running on another
+ * thread (process:0) or in a forked process (process:1), for every combination of
+ * - queue flavor, synchronized or unsynchronized write,
+ * - element size (template argument) and batch size,
+ * - wait mode: polling (wait:0), an EventFlag shared by both sides (wait:1), or
+ *   readBlocking()/writeBlocking() of synchronized queues (wait:2),
+ * - copying read()/write() (zerocopy:0) or beginRead()/beginWrite() (zerocopy:1).
+ *
+ * Each batch carries the time its writing started. Percentiles of the time until
+ * the reader is done with it are reported as counters, next to the delivered
+ * element rate, so
+ *     --benchmark_format=json, or --benchmark_out=<file>
+ * gives machine-readable results to track for regressions. Unsynchronized runs
+ * also report how many reads failed because the writer overran the reader.
+ */
+
+#include <benchmark/benchmark.h>
+#include <fmq/EventFlag.h>
+#include <fmq/MessageQueue.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using ::android::hardware::EventFlag;
+using ::android::hardware::kSynchronizedReadWrite;
+using ::android::hardware::kUnsynchronizedWrite;
+using ::android::hardware::MessageQueue;
+using ::android::hardware::MQFlavor;
+using ::benchmark::Counter;
+using ::benchmark::State;
+
+enum WaitMode : int64_t { kPoll, kEventFlag, kBlocking };
+
+constexpr uint32_t kNotEmpty = 1 << 0;
+constexpr uint32_t kNotFull = 1 << 1;
+
+// Waits are bounded, so the reader notices the end of a run and the writer a dead reader.
+constexpr int64_t kReaderWaitNs = 10 * 1000 * 1000;
+constexpr int64_t kWriterTimeoutNs = 1000 * 1000 * 1000;
+
+constexpr size_t kQueueBytes = 256 * 1024;
+constexpr size_t kMaxLatencySamples = 1 << 20;
+
+template <size_t N>
+struct Element {
+    static_assert(N >= sizeof(int64_t), "elements carry a timestamp");
+    uint8_t bytes[N];
+};
+
+// What the reader reports back, in memory shared across fork()
+struct Results {
+    std::atomic<bool> stop;
+    std::atomic<uint64_t> received;
+    std::atomic<uint64_t> overflows;
+    size_t numLatencies;
+    int64_t latencies[kMaxLatencySamples];
+};
+
+struct Config {
+    size_t batch;
+    WaitMode wait;
+    bool zeroCopy;
+};
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+}
+
+// Calls fn(elements, count) for both regions of a transaction
+template <typename Transaction, typename Fn>
+void forEachRegion(const Transaction& tx, Fn fn) {
+    auto first = tx.getFirstRegion();
+    auto second = tx.getSecondRegion();
+    if (first.getLength() > 0) fn(first.getAddress(), first.getLength());
+    if (second.getLength() > 0) fn(second.getAddress(), second.getLength());
+}
+
+// The writer produces each element in full, stamping it with the batch start time
+template <size_t N>
+void produce(Element<N>* elements, size_t count, int64_t stamp) {
+    for (size_t i = 0; i < count; i++) {
+        memset(elements[i].bytes, static_cast<int>(stamp), N);
+        memcpy(elements[i].bytes, &stamp, sizeof(stamp));
+    }
+}
+
+// The reader only looks at the stamp and the last byte of each element
+template <size_t N>
+int64_t consume(const Element<N>* elements, size_t count) {
+    int64_t stamp;
+    memcpy(&stamp, elements[0].bytes, sizeof(stamp));
+    uint8_t sum = 0;
+    for (size_t i = 0; i < count; i++) sum += elements[i].bytes[N - 1];
+    benchmark::DoNotOptimize(sum);
+    return stamp;
+}
+
+template <MQFlavor flavor, size_t N>
+class FmqRun {
+  public:
+    using Queue = MessageQueue<Element<N>, flavor>;
+
+    FmqRun(Queue& queue, const Config& config, Results* results)
+        : mQueue(queue), mConfig(config), mResults(results), mBuffer(config.batch) {
+        EventFlag::createEventFlag(mQueue.getEventFlagWord(), &mEventFlag);
+    }
+
+    ~FmqRun() { EventFlag::deleteEventFlag(&mEventFlag); }
+
+    /* Sends one batch, waiting for room as configured. Returns false if the
+     * reader made no room for kWriterTimeoutNs. */
+    bool write() {
+        const int64_t stamp = nowNs();
+        if (!mConfig.zeroCopy) produce(mBuffer.data(), mBuffer.size(), stamp);
+
+        while (!tryWrite(stamp)) {
+            if (nowNs() - stamp > kWriterTimeoutNs) return false;
+            if (mConfig.wait == kEventFlag) {
+                uint32_t efState = 0;
+                mEventFlag->wait(kNotFull, &efState, kReaderWaitNs);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        if (mConfig.wait == kEventFlag) {
+            mEventFlag->wake(kNotEmpty);
+        } else if (flavor == kUnsynchronizedWrite) {
+            // Nothing else would let a reader sharing the core keep up with an unpaced writer
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    /* Reads batches until the writer stopped and the queue is drained. */
+    void read() {
+        for (;;) {
+            // Sampled before reading, so that stopping only after an empty read means drained
+            const bool stopping = mResults->stop.load();
+            if (tryRead()) {
+                if (mConfig.wait == kEventFlag) mEventFlag->wake(kNotFull);
+                continue;
+            }
+            if (stopping) return;
+            if (mConfig.wait == kEventFlag) {
+                uint32_t efState = 0;
+                mEventFlag->wait(kNotEmpty, &efState, kReaderWaitNs);
+            } else if (mConfig.wait == kPoll) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void stop() {
+        mResults->stop = true;
+        mEventFlag->wake(kNotEmpty);
+    }
+
+  private:
+    Queue& mQueue;
+    const Config mConfig;
+    Results* const mResults;
+    std::vector<Element<N>> mBuffer;
+    EventFlag* mEventFlag = nullptr;
+
+    bool tryWrite(int64_t stamp) {
+        if (mConfig.zeroCopy) {
+            typename Queue::MemTransaction tx;
+            if (!mQueue.beginWrite(mConfig.batch, &tx)) return false;
+            forEachRegion(tx, [stamp](Element<N>* elements, size_t count) {
+                produce(elements, count, stamp);
+            });
+            return mQueue.commitWrite(mConfig.batch);
+        }
+        if constexpr (flavor == kSynchronizedReadWrite) {
+            if (mConfig.wait == kBlocking) {
+                return mQueue.writeBlocking(mBuffer.data(), mConfig.batch, kWriterTimeoutNs);
+            }
+        }
+        return mQueue.write(mBuffer.data(), mConfig.batch);
+    }
+
+    bool tryRead() {
+        bool blocking = false;
+        if constexpr (flavor == kSynchronizedReadWrite) blocking = mConfig.wait == kBlocking;
+        // Polled reads of partial batches would fail anyway; this tells them apart from overruns
+        if (!blocking && mQueue.availableToRead() < mConfig.batch) return false;
+
+        int64_t stamp = 0;
+        bool ok;
+        if (mConfig.zeroCopy) {
+            typename Queue::MemTransaction tx;
+            ok = mQueue.beginRead(mConfig.batch, &tx);
+            if (ok) {
+                bool first = true;
+                forEachRegion(tx, [&](const Element<N>* elements, size_t count) {
+                    int64_t regionStamp = consume(elements, count);
+                    if (first) stamp = regionStamp;
+                    first = false;
+                });
+                ok = mQueue.commitRead(mConfig.batch);
+            }
+        } else {
+            if constexpr (flavor == kSynchronizedReadWrite) {
+                if (blocking) {
+                    ok = mQueue.readBlocking(mBuffer.data(), mConfig.batch, kReaderWaitNs);
+                    if (!ok) return false;
+                } else {
+                    ok = mQueue.read(mBuffer.data(), mConfig.batch);
+                }
+            } else {
+                ok = mQueue.read(mBuffer.data(), mConfig.batch);
+            }
+            if (ok) stamp = consume(mBuffer.data(), mConfig.batch);
+        }
+
+        if (!ok) {
+            // Enough data was available, so the writer overran this reader
+            mResults->overflows++;
+            return true;
+        }
+        const int64_t latency = nowNs() - stamp;
+        if (mResults->numLatencies < kMaxLatencySamples) {
+            mResults->latencies[mResults->numLatencies++] = latency;
+        }
+        mResults->received += mConfig.batch;
+        return true;
+    }
+};
+
+void reportLatencies(State& state, Results* results) {
+    auto begin = results->latencies;
+    auto end = begin + results->numLatencies;
+    if (begin == end) return;
+    std::sort(begin, end);
+    auto percentile = [&](double p) {
+        return static_cast<double>(begin[static_cast<size_t>(p * (end - begin - 1))]);
+    };
+    state.counters["p50_ns"] = percentile(0.5);
+    state.counters["p90_ns"] = percentile(0.9);
+    state.counters["p99_ns"] = percentile(0.99);
+    state.counters["p999_ns"] = percentile(0.999);
+    state.counters["max_ns"] = static_cast<double>(end[-1]);
+}
+
+template <MQFlavor flavor, size_t N>
+void BM_Fmq(State& state) {
+    using Run = FmqRun<flavor, N>;
+    const Config config{static_cast<size_t>(state.range(0)), static_cast<WaitMode>(state.range(1)),
+                        state.range(2) != 0};
+    const bool crossProcess = state.range(3) != 0;
+
+    typename Run::Queue queue(std::max(kQueueBytes / N, 4 * config.batch),
+                              /* configureEventFlagWord */ true);
+    void* shared = mmap(nullptr, sizeof(Results), PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (!queue.isValid() || shared == MAP_FAILED) {
+        state.SkipWithError("failed to set up the queue");
+        return;
+    }
+    Results* results = new (shared) Results();
+
+    std::thread readerThread;
+    pid_t readerPid = -1;
+    if (crossProcess) {
+        readerPid = fork();
+        if (readerPid == 0) {
+            typename Run::Queue readerQueue(*queue.getDesc(), /* resetPointers */ false);
+            if (!readerQueue.isValid()) _exit(1);
+            Run(readerQueue, config, results).read();
+            _exit(0);
+        }
+    } else {
+        readerThread = std::thread([&]() { Run(queue, config, results).read(); });
+    }
+
+    Run writer(queue, config, results);
+    for (auto _ : state) {
+        if (!writer.write()) {
+            state.SkipWithError("reader stopped reading");
+            break;
+        }
+    }
+    writer.stop();
+
+    int status = 0;
+    if (crossProcess) {
+        waitpid(readerPid, &status, 0);
+    } else {
+        readerThread.join();
+    }
+    if (status != 0) {
+        state.SkipWithError("reader failed");
+    } else if (flavor == kSynchronizedReadWrite &&
+               results->received != state.iterations() * config.batch) {
+        state.SkipWithError("elements were lost");
+    }
+
+    state.SetItemsProcessed(results->received);
+    state.SetBytesProcessed(results->received * N);
+    if (flavor == kUnsynchronizedWrite) {
+        state.counters["overflows"] = Counter(results->overflows, Counter::kIsRate);
+    }
+    reportLatencies(state, results);
+
+    results->~Results();
+    munmap(shared, sizeof(Results));
+}
+
+template <MQFlavor flavor>
+void allConfigs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"batch", "wait", "zerocopy", "process"});
+    for (int64_t process : {0, 1}) {
+        for (int64_t wait : {kPoll, kEventFlag, kBlocking}) {
+            // The queue's blocking calls are for synchronized queues, and copy
+            if (wait == kBlocking && flavor != kSynchronizedReadWrite) continue;
+            for (int64_t zeroCopy : {0, 1}) {
+                if (wait == kBlocking && zeroCopy) continue;
+                for (int64_t batch : {1, 16, 64}) b->Args({batch, wait, zeroCopy, process});
+            }
+        }
+    }
+    b->UseRealTime();
+}
+
+BENCHMARK_TEMPLATE(BM_Fmq, kSynchronizedReadWrite, 16)->Apply(allConfigs<kSynchronizedReadWrite>);
+BENCHMARK_TEMPLATE(BM_Fmq, kSynchronizedReadWrite, 256)->Apply(allConfigs<kSynchronizedReadWrite>);
+BENCHMARK_TEMPLATE(BM_Fmq, kSynchronizedReadWrite, 4096)->Apply(allConfigs<kSynchronizedReadWrite>);
+BENCHMARK_TEMPLATE(BM_Fmq, kUnsynchronizedWrite, 16)->Apply(allConfigs<kUnsynchronizedWrite>);
+BENCHMARK_TEMPLATE(BM_Fmq, kUnsynchronizedWrite, 256)->Apply(allConfigs<kUnsynchronizedWrite>);
+BENCHMARK_TEMPLATE(BM_Fmq, kUnsynchronizedWrite, 4096)->Apply(allConfigs<kUnsynchronizedWrite>);
+
+}  // anonymous namespace
+
+BENCHMARK_MAIN();
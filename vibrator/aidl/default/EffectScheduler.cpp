@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vibrator-impl/EffectScheduler.h"
+
+#include <android-base/logging.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <vector>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace vibrator {
+
+EffectScheduler::EffectScheduler()
+    // steady_clock is CLOCK_MONOTONIC, so deadlines can be handed to the timer as they are.
+    : mTimerFd(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC)) {
+    CHECK(mTimerFd.ok()) << "Failed to create timerfd: " << strerror(errno);
+    mThread = std::thread([this] { run(); });
+}
+
+EffectScheduler::~EffectScheduler() {
+    cancel();
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStopping = true;
+        armTimerLocked();
+    }
+    mThread.join();
+}
+
+void EffectScheduler::scheduleStep(Clock::time_point deadline, Task step) {
+    schedule(deadline, {std::move(step), false});
+}
+
+void EffectScheduler::scheduleCompletion(Clock::time_point deadline, Task completion) {
+    schedule(deadline, {std::move(completion), true});
+}
+
+void EffectScheduler::schedule(Clock::time_point deadline, Entry entry) {
+    std::lock_guard<std::mutex> lock(mLock);
+    bool earliest = mTasks.empty() || deadline < mTasks.begin()->first;
+    mTasks.emplace(deadline, std::move(entry));
+    if (earliest) {
+        armTimerLocked();
+    }
+}
+
+void EffectScheduler::cancel() {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (mTasks.empty()) {
+        return;
+    }
+    // Completions are set aside and only re-inserted once the walk is over, since a node
+    // re-inserted at min() could otherwise be visited again.
+    std::vector<decltype(mTasks)::node_type> completions;
+    for (auto it = mTasks.begin(); it != mTasks.end();) {
+        auto next = std::next(it);
+        if (it->second.isCompletion) {
+            completions.push_back(mTasks.extract(it));
+        } else {
+            mTasks.erase(it);
+        }
+        it = next;
+    }
+    for (auto& node : completions) {
+        // Make the completion due now, reusing its node
+        node.key() = Clock::time_point::min();
+        mTasks.insert(std::move(node));
+    }
+    armTimerLocked();
+}
+
+void EffectScheduler::armTimerLocked() {
+    itimerspec spec = {};
+    if (mStopping || !mTasks.empty()) {
+        // A zero it_value would disarm the timer, so anything already due fires at 1ns.
+        int64_t ns = 1;
+        if (!mStopping) {
+            ns = std::max<int64_t>(
+                    ns, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                mTasks.begin()->first.time_since_epoch())
+                                .count());
+        }
+        spec.it_value.tv_sec = ns / 1000000000;
+        spec.it_value.tv_nsec = ns % 1000000000;
+    }
+    if (timerfd_settime(mTimerFd.get(), TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
+        PLOG(ERROR) << "Failed to arm effect timer";
+    }
+}
+
+void EffectScheduler::run() {
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        Clock::time_point now = Clock::now();
+        while (!mTasks.empty() && mTasks.begin()->first <= now) {
+            Task task = std::move(mTasks.begin()->second.task);
+            mTasks.erase(mTasks.begin());
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+        if (mStopping) {
+            break;
+        }
+        armTimerLocked();
+        lock.unlock();
+
+        uint64_t expirations;
+        if (TEMP_FAILURE_RETRY(read(mTimerFd.get(), &expirations, sizeof(expirations))) < 0) {
+            PLOG(ERROR) << "Failed to wait for effect timer";
+        }
+        lock.lock();
+    }
+}
+
+}  // namespace vibrator
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -17,7 +17,6 @@
 #include "vibrator-impl/VibratorManager.h"
 
 #include <android-base/logging.h>
-#include <thread>
 
 namespace aidl {
 namespace android {
@@ -66,18 +65,19 @@ ndk::ScopedAStatus VibratorManager::prepareSynced(const std::vector<int32_t>& vi
 ndk::ScopedAStatus VibratorManager::triggerSynced(
         const std::shared_ptr<IVibratorCallback>& callback) {
     LOG(INFO) << "Vibrator Manager trigger synced";
-    std::thread([callback] {
-        if (callback != nullptr) {
+    if (callback != nullptr) {
+        mScheduler.scheduleCompletion(EffectScheduler::Clock::now(), [callback] {
             LOG(INFO) << "Notifying perform complete";
             callback->onComplete();
-        }
-    }).detach();
+        });
+    }
 
     return ndk::ScopedAStatus::ok();
 }
 
 ndk::ScopedAStatus VibratorManager::cancelSynced() {
     LOG(INFO) << "Vibrator Manager cancel synced";
+    mScheduler.cancel();
     return ndk::ScopedAStatus::ok();
 }
 
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace aidl {
+namespace android {
+namespace hardware {
+namespace vibrator {
+
+/*
+ * Runs the steps and completion callbacks of effects on a single thread, woken by an absolute
+ * deadline timerfd, so that no thread is created per effect and composition steps do not drift.
+ */
+class EffectScheduler {
+  public:
+    using Clock = std::chrono::steady_clock;
+    using Task = std::function<void()>;
+
+    EffectScheduler();
+    /* Runs pending completions, drops pending steps and stops the thread */
+    ~EffectScheduler();
+
+    /* Runs |step| at |deadline| unless the effect is cancelled first */
+    void scheduleStep(Clock::time_point deadline, Task step);
+    /* Runs |completion| at |deadline|, or as soon as the effect is cancelled */
+    void scheduleCompletion(Clock::time_point deadline, Task completion);
+    /* Drops pending steps and runs pending completions right away */
+    void cancel();
+
+  private:
+    struct Entry {
+        Task task;
+        bool isCompletion;
+    };
+
+    void schedule(Clock::time_point deadline, Entry entry);
+    /* Arms the timer for the earliest pending task, or disarms it if there is none */
+    void armTimerLocked();
+    void run();
+
+    ::android::base::unique_fd mTimerFd;
+    std::mutex mLock;
+    std::multimap<Clock::time_point, Entry> mTasks;
+    bool mStopping = false;
+    std::thread mThread;
+};
+
+}  // namespace vibrator
+}  // namespace hardware
+}  // namespace android
+}  // namespace aidl
@@ -18,6 +18,8 @@
 
 #include <aidl/android/hardware/vibrator/BnVibrator.h>
 
+#include "vibrator-impl/EffectScheduler.h"
+
 namespace aidl {
 namespace android {
 namespace hardware {
@@ -55,6 +57,11 @@ class Vibrator : public BnVibrator {
     ndk::ScopedAStatus composePwle(const std::vector<PrimitivePwle> &composite,
                                    const std::shared_ptr<IVibratorCallback> &callback) override;
 
+  private:
+    /* Completes the current effect, if any, and schedules a new one lasting |durationMs| */
+    void startEffect(int32_t durationMs, const std::shared_ptr<IVibratorCallback>& callback);
+
+    EffectScheduler mScheduler;
 };
 
 }  // namespace vibrator
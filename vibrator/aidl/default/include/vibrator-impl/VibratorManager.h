@@ -18,6 +18,8 @@
 
 #include <aidl/android/hardware/vibrator/BnVibratorManager.h>
 
+#include "vibrator-impl/EffectScheduler.h"
+
 namespace aidl {
 namespace android {
 namespace hardware {
@@ -36,6 +38,7 @@ class VibratorManager : public BnVibratorManager {
 
   private:
     std::shared_ptr<IVibrator> mDefaultVibrator;
+    EffectScheduler mScheduler;
 };
 
 }  // namespace vibrator
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "vibrator-impl/EffectScheduler.h"
+
+using aidl::android::hardware::vibrator::EffectScheduler;
+using namespace std::chrono_literals;
+
+namespace {
+
+// Counts events and lets a test wait for them.
+class Counter {
+  public:
+    void increment() {
+        std::lock_guard<std::mutex> lock(mLock);
+        mCount++;
+        mCondition.notify_all();
+    }
+
+    bool waitFor(int count) {
+        std::unique_lock<std::mutex> lock(mLock);
+        return mCondition.wait_for(lock, 5s, [&] { return mCount >= count; });
+    }
+
+    int get() {
+        std::lock_guard<std::mutex> lock(mLock);
+        return mCount;
+    }
+
+  private:
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    int mCount = 0;
+};
+
+TEST(EffectSchedulerTest, RunsTasksInDeadlineOrder) {
+    EffectScheduler scheduler;
+    std::mutex lock;
+    std::vector<int> order;
+    Counter done;
+    auto now = EffectScheduler::Clock::now();
+    scheduler.scheduleStep(now + 20ms, [&] {
+        std::lock_guard<std::mutex> guard(lock);
+        order.push_back(2);
+    });
+    scheduler.scheduleStep(now + 10ms, [&] {
+        std::lock_guard<std::mutex> guard(lock);
+        order.push_back(1);
+    });
+    scheduler.scheduleCompletion(now + 30ms, [&] { done.increment(); });
+
+    ASSERT_TRUE(done.waitFor(1));
+    std::lock_guard<std::mutex> guard(lock);
+    EXPECT_EQ(order, (std::vector<int>{1, 2}));
+}
+
+TEST(EffectSchedulerTest, CancelDropsStepsAndRunsCompletions) {
+    EffectScheduler scheduler;
+    Counter steps;
+    Counter completions;
+    auto later = EffectScheduler::Clock::now() + 1h;
+    scheduler.scheduleStep(later, [&] { steps.increment(); });
+    scheduler.scheduleCompletion(later, [&] { completions.increment(); });
+
+    scheduler.cancel();
+
+    ASSERT_TRUE(completions.waitFor(1));
+    EXPECT_EQ(steps.get(), 0);
+}
+
+TEST(EffectSchedulerTest, CancelTwiceWhileCompletionRuns) {
+    EffectScheduler scheduler;
+    Counter started;
+    Counter completions;
+    std::mutex releaseLock;
+    std::condition_variable releaseCondition;
+    bool released = false;
+
+    // Keep the scheduler thread busy in a slow completion, so that cancelled completions stay
+    // pending at the front of the queue.
+    scheduler.scheduleCompletion(EffectScheduler::Clock::now(), [&] {
+        started.increment();
+        std::unique_lock<std::mutex> lock(releaseLock);
+        releaseCondition.wait(lock, [&] { return released; });
+    });
+    ASSERT_TRUE(started.waitFor(1));
+
+    auto later = EffectScheduler::Clock::now() + 1h;
+    scheduler.scheduleCompletion(later, [&] { completions.increment(); });
+    scheduler.scheduleCompletion(later, [&] { completions.increment(); });
+    scheduler.cancel();
+    scheduler.cancel();
+
+    {
+        std::lock_guard<std::mutex> lock(releaseLock);
+        released = true;
+    }
+    releaseCondition.notify_all();
+    EXPECT_TRUE(completions.waitFor(2));
+}
+
+}  // namespace
@@ -21,6 +21,10 @@
 #include <android/hardware/vibrator/IVibrator.h>
 #include <binder/IServiceManager.h>
 
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+
 using ::android::enum_range;
 using ::android::sp;
 using ::android::hardware::hidl_enum_range;
@@ -34,6 +38,7 @@ using ::benchmark::internal::Benchmark;
 using ::std::chrono::duration;
 using ::std::chrono::duration_cast;
 using ::std::chrono::high_resolution_clock;
+using ::std::chrono::milliseconds;
 
 namespace Aidl = ::android::hardware::vibrator;
 namespace V1_0 = ::android::hardware::vibrator::V1_0;
@@ -574,4 +579,130 @@ BENCHMARK_WRAPPER(VibratorPrimitivesBench_Aidl, compose, {
     }
 });
 
+// Records when the HAL reports completion, to time compose() and off() end to end.
+class CompletionCallback : public Aidl::BnVibratorCallback {
+  public:
+    android::binder::Status onComplete() override {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCompletionTime = high_resolution_clock::now();
+        mCondition.notify_all();
+        return android::binder::Status::ok();
+    }
+
+    void reset() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCompletionTime.reset();
+    }
+
+    std::optional<high_resolution_clock::time_point> waitForCompletion(milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait_for(lock, timeout, [this] { return mCompletionTime.has_value(); });
+        return mCompletionTime;
+    }
+
+  private:
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::optional<high_resolution_clock::time_point> mCompletionTime;
+};
+
+// Reports the measured time until the HAL called back rather than the time spent in the calls.
+class VibratorCompletionBench_Aidl : public VibratorBench_Aidl {
+  public:
+    static void DefaultConfig(Benchmark* b) { b->Unit(kMicrosecond)->UseManualTime(); }
+
+  protected:
+    static constexpr int32_t kComposeSize = 8;
+    static constexpr int32_t kComposeDelayMs = 5;
+
+    // A composition of kComposeSize clicks kComposeDelayMs apart, and how long it should last.
+    bool getComposition(std::vector<Aidl::CompositeEffect>* effects, milliseconds* durationMs) {
+        int32_t capabilities = 0;
+        mVibrator->getCapabilities(&capabilities);
+        if ((capabilities & Aidl::IVibrator::CAP_COMPOSE_EFFECTS) == 0) {
+            return false;
+        }
+
+        std::vector<Aidl::CompositePrimitive> supported;
+        mVibrator->getSupportedPrimitives(&supported);
+        if (std::find(supported.begin(), supported.end(), Aidl::CompositePrimitive::CLICK) ==
+            supported.end()) {
+            return false;
+        }
+
+        int32_t primitiveMs = 0;
+        mVibrator->getPrimitiveDuration(Aidl::CompositePrimitive::CLICK, &primitiveMs);
+
+        Aidl::CompositeEffect effect;
+        effect.primitive = Aidl::CompositePrimitive::CLICK;
+        effect.scale = 1.0f;
+        effect.delayMs = kComposeDelayMs;
+        effects->assign(kComposeSize, effect);
+        *durationMs = milliseconds(kComposeSize * (kComposeDelayMs + primitiveMs));
+        return true;
+    }
+};
+
+// How late compose() completes compared to the duration of the composition.
+BENCHMARK_WRAPPER(VibratorCompletionBench_Aidl, composeJitter, {
+    std::vector<Aidl::CompositeEffect> effects;
+    milliseconds expected;
+    if (!getComposition(&effects, &expected)) {
+        return;
+    }
+
+    android::sp<CompletionCallback> cb = new CompletionCallback();
+    double totalJitterUs = 0;
+    double maxJitterUs = 0;
+
+    for (auto _ : state) {
+        cb->reset();
+        auto start = high_resolution_clock::now();
+        mVibrator->compose(effects, cb);
+        auto end = cb->waitForCompletion(expected + milliseconds(1000));
+        if (!end) {
+            state.SkipWithError("compose did not complete");
+            break;
+        }
+        duration<double> elapsed = *end - start;
+        state.SetIterationTime(elapsed.count());
+
+        double jitterUs = duration<double, std::micro>(elapsed - expected).count();
+        totalJitterUs += jitterUs;
+        maxJitterUs = std::max(maxJitterUs, jitterUs);
+    }
+
+    state.counters["jitterUs"] = Counter(totalJitterUs, Counter::kAvgIterations);
+    state.counters["maxJitterUs"] = maxJitterUs;
+});
+
+// How quickly off() ends a composition in progress and reports its completion.
+BENCHMARK_WRAPPER(VibratorCompletionBench_Aidl, composeCancel, {
+    std::vector<Aidl::CompositeEffect> effects;
+    milliseconds expected;
+    if (!getComposition(&effects, &expected)) {
+        return;
+    }
+
+    android::sp<CompletionCallback> cb = new CompletionCallback();
+    double maxLatencyUs = 0;
+
+    for (auto _ : state) {
+        cb->reset();
+        mVibrator->compose(effects, cb);
+        auto start = high_resolution_clock::now();
+        mVibrator->off();
+        auto end = cb->waitForCompletion(expected + milliseconds(1000));
+        if (!end) {
+            state.SkipWithError("compose did not complete after off");
+            break;
+        }
+        duration<double> elapsed = *end - start;
+        state.SetIterationTime(elapsed.count());
+        maxLatencyUs = std::max(maxLatencyUs, duration<double, std::micro>(elapsed).count());
+    }
+
+    state.counters["maxLatencyUs"] = maxLatencyUs;
+});
+
 BENCHMARK_MAIN();